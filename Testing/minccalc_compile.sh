@@ -0,0 +1,111 @@
+#! /bin/sh
+#
+# Check that compiled minccalc expressions give exactly the same result
+# as evaluating them from the parse tree (-nocompile).
+
+set -e
+
+# Input volumes: random bytes, random signed shorts and a float volume
+# with invalid (NaN) voxels in it.
+#
+dd if=/dev/urandom bs=4096 count=9 2>/dev/null | \
+   ../rawtominc -byte -real_range 0 255 -clobber _calc_a.mnc 9 64 64
+dd if=/dev/urandom bs=8192 count=9 2>/dev/null | \
+   ../rawtominc -short -signed -real_range -32768 32767 -clobber \
+      _calc_b.mnc 9 64 64
+../minccalc -quiet -clobber -float \
+   -expression 'A[0] < 40 ? NaN : A[0] / 7 - 10' _calc_a.mnc _calc_n.mnc
+
+files="_calc_a.mnc _calc_b.mnc _calc_n.mnc"
+
+# Evaluate an expression both ways with the given options and compare
+# the voxel values.
+#
+check () {
+   expr=$1
+   shift
+   ../minccalc -quiet -clobber -double "$@" -expression "$expr" \
+      $files _calc_c.mnc
+   ../minccalc -quiet -clobber -double -nocompile "$@" -expression "$expr" \
+      $files _calc_t.mnc
+   ../mincextract -double _calc_c.mnc > _calc_c.raw
+   ../mincextract -double _calc_t.mnc > _calc_t.raw
+   if cmp -s _calc_c.raw _calc_t.raw; then :; else
+      echo "Compiled and tree evaluation differ ($*): $expr"
+      exit 1
+   fi
+}
+
+# Check that two (compiled) expressions give the same voxel values.
+#
+check_same () {
+   ../minccalc -quiet -clobber -double -expression "$1" $files _calc_c.mnc
+   ../minccalc -quiet -clobber -double -expression "$2" $files _calc_t.mnc
+   ../mincextract -double _calc_c.mnc > _calc_c.raw
+   ../mincextract -double _calc_t.mnc > _calc_t.raw
+   if cmp -s _calc_c.raw _calc_t.raw; then :; else
+      echo "Expressions differ: $1 and $2"
+      exit 1
+   fi
+}
+
+for opts in "" "-eval_width 1" "-eval_width 7" "-threads 3"; do
+
+   # Arithmetic and functions
+   check 'A[0] * 2 + A[1] / 3 - A[2]' $opts
+   check 'sqrt(abs(A[1])) + exp(-A[0] / 50) * sin(A[1]) - A[0] ^ 2' $opts
+   check 'clamp(A[1], -100, 100) + segment(A[0], 50, 150) * 1000' $opts
+   check 'avg(A) + sum(A) * prod([1, 2, 3]) - max(A) + min(A)' $opts
+   check 'imax(A) * 10 + imin(A)' $opts
+   check 'A[0] > A[1] && A[1] != 0 || !(A[0] <= 30)' $opts
+
+   # if / else, including nested ones and ones whose test is the same
+   # for all voxels of a buffer
+   check 'if (A[0] > 128) A[0] * 2 else A[1] + 1' $opts
+   check 's = 0;
+          if (A[0] > A[1]) { s = A[0] - A[1]; s * s }
+          else if (A[1] > 1000) { s = 1 }
+          else { s = A[1] / 2 };
+          s + 1' $opts
+   check 'A[0] < 10 ? -1 : A[0] < 100 ? A[1] : A[0]' $opts
+   check 'if (A[0] > 1000) log(-1) else A[0]' $opts
+   check 'if (A[0] >= 0) A[1] else A[0]' $opts
+   check 's = A[1]; if (A[0] > 100) s = 2; s' $opts
+   check 'V = A; if (A[0] > 100) V = [1, 2, 3]; sum(V)' $opts
+
+   # for loops and vector generators
+   check 't = 0; for {i in [0:len(A))} t = t + A[i] * (i + 1); t' $opts
+   check 't = 0; for {i in [0:2]} {
+             if (A[i] > 100) t = t + A[i] else t = t - 1
+          }; t' $opts
+   check 'V = { i in [0:len(A)) | A[i] * i }; sum(V) + V[1]' $opts
+   check 'let a = A[0], b = A[1] in a * b - len({i in (0:5] | i})' $opts
+
+   # Invalid values (NaN inputs and illegal operations)
+   check 'A[2] + A[0]' $opts
+   check 'isnan(A[2]) ? -1 : A[2] * 2' $opts
+   check 'log(A[0] - 100) + A[2]' $opts
+   check 'A[0] / (A[0] - A[0])' $opts
+   check 'avg(A) + max(A) + min(A)' $opts
+   check 'if (isnan(A[2])) NaN else A[2]' $opts
+   check 'if (A[2] > 0) A[0] else A[1]' $opts
+   check 't = 0; for {i in [0:len(A))} t = t + A[i]; t' $opts
+   check 's = 0; if (A[2] > 10) { s = 1; 2 } else { s = 3; 4 }; s' $opts
+   for nanopts in "-ignore_nan" "-zero" "-illegal_value 7"; do
+      check 'A[2] + A[0]' $opts $nanopts
+      check 'log(A[0] - 100) + A[2]' $opts $nanopts
+      check 'sum(A) / (A[1] - A[1])' $opts $nanopts
+      check 'if (A[2] > 0) A[0] else sqrt(-A[0])' $opts $nanopts
+   done
+
+done
+
+# Constant folding and branches that are never taken
+#
+check_same 'A[0] * (2 + 3 * 4) - sqrt(16)' 'A[0] * 14 - 4'
+check_same 'if (1 > 2) A[1] else A[0] + len([0:4))' 'A[0] + 4'
+check_same 'if (len(A) == 3) A[0] else log(-1)' 'A[0]'
+check_same '(2 < 1) ? NaN : A[1] * (1 - 1) + A[0]' 'A[0]'
+check_same 'A[[0, 1, 2][1]] + 0 * 5' 'A[1]'
+
+exit 0
@@ -0,0 +1,64 @@
+#! /bin/sh
+#
+# Check that the minccmp -all_pairs matrices agree with comparing the
+# files two at a time, and that the z-score is the same whether the
+# voxel values are kept from the first pass or the files are read again.
+
+set -e
+
+# Input volumes: random bytes, random signed shorts, a volume made from
+# the first one and a mask.
+#
+dd if=/dev/urandom bs=4096 count=9 2>/dev/null | \
+   ../rawtominc -byte -real_range 0 255 -clobber _cmp_a.mnc 9 64 64
+dd if=/dev/urandom bs=8192 count=9 2>/dev/null | \
+   ../rawtominc -short -signed -real_range -32768 32767 -clobber \
+      _cmp_b.mnc 9 64 64
+../minccalc -quiet -clobber -float \
+   -expression 'A[0] * 3 - 100 + A[1] / 1000' _cmp_a.mnc _cmp_b.mnc _cmp_c.mnc
+../minccalc -quiet -clobber -byte \
+   -expression 'A[0] > 60' _cmp_b.mnc _cmp_m.mnc
+
+files="_cmp_a.mnc _cmp_b.mnc _cmp_c.mnc"
+
+# Check that row 0 of an -all_pairs matrix has the pairwise value of
+# the first file with each of the others (the diagonal is skipped).
+#
+check_row () {
+   stat=$1
+   shift
+   ../minccmp -quiet "$@" -all_pairs -$stat $files | head -1 | \
+      cut -d' ' -f2- > _cmp_row.txt
+   row=""
+   for file in _cmp_b.mnc _cmp_c.mnc; do
+      row="$row${row:+ }`../minccmp -quiet "$@" -$stat _cmp_a.mnc $file`"
+   done
+   if [ "`cat _cmp_row.txt`" != "$row" ]; then
+      echo "-all_pairs -$stat row 0 differs from pairwise ($*):"
+      echo "   `cat _cmp_row.txt`"
+      echo "   $row"
+      exit 1
+   fi
+}
+
+# Check that the z-score does not change when the values do not fit in
+# the cache, so the files are read a second time.
+#
+check_zscore () {
+   ../minccmp -quiet "$@" -zscore $files > _cmp_z1.txt
+   ../minccmp -quiet "$@" -zscore -max_cache_size_in_kb 0 $files > _cmp_z2.txt
+   ../minccmp -quiet "$@" -zscore -max_cache_size_in_kb 1 $files > _cmp_z3.txt
+   if cmp -s _cmp_z1.txt _cmp_z2.txt && cmp -s _cmp_z1.txt _cmp_z3.txt; then :
+   else
+      echo "-zscore differs without the cache ($*)"
+      exit 1
+   fi
+}
+
+for opts in "" "-mask _cmp_m.mnc" "-range 20 200" "-max_buffer_size_in_kb 8"; do
+   check_row rmse $opts
+   check_row xcorr $opts
+   check_zscore $opts
+done
+
+exit 0
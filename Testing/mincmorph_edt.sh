@@ -0,0 +1,74 @@
+#! /bin/sh
+#
+# Check the mincmorph exact euclidean distance transform (T) against a
+# brute force search on a small anisotropic volume, and check that the
+# threaded transform gives the same result.
+
+set -e
+
+nz=6
+ny=10
+nx=12
+
+# Pick some background voxels (z y x), with value 1. Everything else is 2.
+#
+awk 'BEGIN { srand(12); for (i = 0; i < 5; i++)
+      print int(rand() * 6), int(rand() * 10), int(rand() * 12) }' \
+   > _edt_bg.txt
+awk -v nz=$nz -v ny=$ny -v nx=$nx '
+   { bg[$1 " " $2 " " $3] = 1 }
+   END {
+      for (z = 0; z < nz; z++) for (y = 0; y < ny; y++) for (x = 0; x < nx; x++)
+         printf "%c", ((z " " y " " x) in bg) ? 1 : 2
+   }' _edt_bg.txt | \
+   ../rawtominc -byte -real_range 0 255 -clobber \
+      -xstep 1 -ystep 2 -zstep 3 _edt_in.mnc $nz $ny $nx
+
+../mincmorph -clobber -float -background 1 -threads 1 \
+   -successive 'T[_edt_feat.mnc]' _edt_in.mnc _edt_out.mnc
+../mincmorph -clobber -float -background 1 -threads 3 \
+   -successive T _edt_in.mnc _edt_out3.mnc
+
+../mincextract -ascii _edt_out.mnc > _edt_out.txt
+../mincextract -ascii _edt_out3.mnc > _edt_out3.txt
+../mincextract -ascii _edt_feat.mnc > _edt_feat.txt
+cmp _edt_out.txt _edt_out3.txt || { echo "Threaded EDT differs"; exit 1; }
+
+# Each voxel must be at the distance of the nearest background voxel, and
+# the nearest feature index must point to a background voxel at that
+# distance
+#
+paste _edt_out.txt _edt_feat.txt | \
+awk -v nz=$nz -v ny=$ny -v nx=$nx -v bgfile=_edt_bg.txt '
+   function dist(z1, y1, x1, z2, y2, x2) {
+      return sqrt(((z1 - z2) * 3) ^ 2 + ((y1 - y2) * 2) ^ 2 + (x1 - x2) ^ 2)
+   }
+   BEGIN {
+      n = 0
+      while ((getline line < bgfile) > 0) {
+         split(line, p, " ")
+         bz[n] = p[1]; by[n] = p[2]; bx[n] = p[3]; n++
+         isbg[p[1] " " p[2] " " p[3]] = 1
+      }
+   }
+   {
+      i = NR - 1
+      x = i % nx; y = int(i / nx) % ny; z = int(i / (nx * ny))
+      d = 1e30
+      for (j = 0; j < n; j++) {
+         dj = dist(z, y, x, bz[j], by[j], bx[j])
+         if (dj < d) d = dj
+      }
+      if ((d - $1) ^ 2 > 1e-8 * (1 + d * d)) {
+         print "Voxel", z, y, x, "distance", $1, "should be", d; bad++
+      }
+      f = $2
+      fx = f % nx; fy = int(f / nx) % ny; fz = int(f / (nx * ny))
+      if (!((fz " " fy " " fx) in isbg) ||
+          (dist(z, y, x, fz, fy, fx) - d) ^ 2 > 1e-8 * (1 + d * d)) {
+         print "Voxel", z, y, x, "has wrong nearest feature", f; bad++
+      }
+   }
+   END { exit (bad > 0) }'
+
+exit 0
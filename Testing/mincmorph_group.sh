@@ -0,0 +1,88 @@
+#! /bin/sh
+#
+# Check the mincmorph group labelling (G). The threaded labelling must
+# give the same labels as a single thread, and on a volume of separated
+# boxes the labels and group stats must match the old labelling
+# (-no_buffer) and the box sizes.
+
+set -e
+
+# A random binary volume with about 25% foreground
+#
+dd if=/dev/urandom bs=4096 count=24 2>/dev/null | \
+   ../rawtominc -byte -real_range 0 255 -clobber _grp_rand.mnc 24 64 64
+for kern in -3D06 -3D26; do
+   ../mincmorph -clobber -int $kern -threads 1 -successive 'B[192:255:1:0]G' \
+      _grp_rand.mnc _grp_out1.mnc
+   ../mincextract -ascii _grp_out1.mnc > _grp_out1.txt
+   for threads in 3 4; do
+      ../mincmorph -clobber -int $kern -threads $threads \
+         -successive 'B[192:255:1:0]G' _grp_rand.mnc _grp_outn.mnc
+      ../mincextract -ascii _grp_outn.mnc > _grp_outn.txt
+      cmp _grp_out1.txt _grp_outn.txt || {
+         echo "Groups differ with $kern and $threads threads"; exit 1; }
+   done
+done
+
+# Boxes (zmin zmax ymin ymax xmin xmax) of distinct sizes, away from the
+# volume border. The last two only touch at a corner, so they are one
+# group with a 26 neighbour kernel and two groups with a 6 neighbour one.
+#
+cat > _grp_boxes.txt <<EOF
+7 9 3 8 15 20
+2 3 10 12 10 20
+2 4 2 5 2 6
+8 9 14 16 3 5
+6 6 17 17 20 20
+5 6 14 15 10 11
+7 7 16 17 12 12
+EOF
+awk '
+   { z0[NR] = $1; z1[NR] = $2; y0[NR] = $3; y1[NR] = $4; x0[NR] = $5; x1[NR] = $6 }
+   END {
+      for (z = 0; z < 12; z++) for (y = 0; y < 20; y++) for (x = 0; x < 24; x++) {
+         v = 1
+         for (b = 1; b <= NR; b++)
+            if (z >= z0[b] && z <= z1[b] && y >= y0[b] && y <= y1[b] &&
+                x >= x0[b] && x <= x1[b]) v = 2
+         printf "%c", v
+      }
+   }' _grp_boxes.txt | \
+   ../rawtominc -byte -real_range 0 255 -clobber \
+      -xstart 0 -ystart 0 -zstart 0 -xstep 1 -ystep 1 -zstep 1 \
+      _grp_box.mnc 12 20 24
+
+# label count xmin xmax ymin ymax zmin zmax centroid_x centroid_y centroid_z
+#
+cat > _grp_stats06.txt <<EOF
+1 108 15 20 3 8 7 9 17.5 5.5 8
+2 66 10 20 10 12 2 3 15 11 2.5
+3 60 2 6 2 5 2 4 4 3.5 3
+4 18 3 5 14 16 8 9 4 15 8.5
+5 8 10 11 14 15 5 6 10.5 14.5 5.5
+6 2 12 12 16 17 7 7 12 16.5 7
+7 1 20 20 17 17 6 6 20 17 6
+EOF
+cat > _grp_stats26.txt <<EOF
+1 108 15 20 3 8 7 9 17.5 5.5 8
+2 66 10 20 10 12 2 3 15 11 2.5
+3 60 2 6 2 5 2 4 4 3.5 3
+4 18 3 5 14 16 8 9 4 15 8.5
+5 10 10 12 14 17 5 7 10.8 14.9 5.8
+6 1 20 20 17 17 6 6 20 17 6
+EOF
+
+for kern in 06 26; do
+   ../mincmorph -clobber -int -3D$kern -background 1 -threads 3 \
+      -group_stats _grp_stats.txt -successive G _grp_box.mnc _grp_out1.mnc
+   ../mincmorph -clobber -int -3D$kern -background 1 -no_buffer \
+      -successive G _grp_box.mnc _grp_outn.mnc
+   ../mincextract -ascii _grp_out1.mnc > _grp_out1.txt
+   ../mincextract -ascii _grp_outn.mnc > _grp_outn.txt
+   cmp _grp_out1.txt _grp_outn.txt || {
+      echo "Groups differ from -no_buffer with -3D$kern"; exit 1; }
+   grep -v '^#' _grp_stats.txt | cmp - _grp_stats$kern.txt || {
+      echo "Wrong group stats with -3D$kern"; exit 1; }
+done
+
+exit 0
@@ -0,0 +1,393 @@
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : parallel_voxel_loop.c
+@DESCRIPTION: File containing a driver for voxel_loop that splits each
+              buffer of voxels across several threads.
+@METHOD     : voxel_loop reads a buffer of voxels and hands it to the
+              voxel function. Here the voxel function is replaced by
+              one that cuts the buffer into contiguous pieces and gives
+              one piece to each thread, calling the original voxel
+              function on it. The calling thread does the first piece
+              itself and waits for the others before returning to
+              voxel_loop, which then writes the output and reads the
+              next buffer. Voxel functions that accumulate into their
+              caller data can be given separate data for each thread,
+              to be merged by the caller afterwards. Accumulation into
+              the output buffers (set_loop_accumulate) is voxel by voxel
+              and needs nothing special.
+@GLOBALS    :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <minc.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include <parallel_voxel_loop.h>
+
+#ifndef TRUE
+#  define TRUE 1
+#  define FALSE 0
+#endif
+
+/* Buffers smaller than this (per thread) are not worth splitting */
+#define MIN_VALUES_PER_THREAD 4096
+
+/* Description of the loop in progress (there is only ever one) */
+typedef struct {
+   int nthreads;
+   void **thread_data;
+   VoxelFunction voxel_function;
+
+   /* The buffer currently being processed */
+   long num_voxels;
+   int input_num_buffers;
+   int input_vector_length;
+   double **input_data;
+   int output_num_buffers;
+   int output_vector_length;
+   double **output_data;
+   Loop_Info *loop_info;
+   void *caller_data;
+   int nparts;
+
+   /* Buffer offset of the piece being done by each thread */
+   long *offset;
+
+#ifdef HAVE_PTHREAD
+   pthread_t *threads;
+   pthread_mutex_t mutex;
+   pthread_cond_t start_cond;
+   pthread_cond_t done_cond;
+   long generation;
+   int nbusy;
+   int finished;
+   pthread_key_t thread_key;
+#endif
+} Parallel_Loop;
+
+static Parallel_Loop parallel_loop;
+
+/* Function prototypes */
+static void parallel_voxel_function(void *caller_data, long num_voxels,
+                                    int input_num_buffers,
+                                    int input_vector_length,
+                                    double *input_data[],
+                                    int output_num_buffers,
+                                    int output_vector_length,
+                                    double *output_data[],
+                                    Loop_Info *loop_info);
+static void do_part(int ipart);
+#ifdef HAVE_PTHREAD
+static void *loop_worker(void *arg);
+#endif
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : parallel_voxel_loop
+@INPUT      : nthreads - number of threads to use
+              thread_data - array of nthreads pointers to caller data,
+                 one for each thread. If NULL, all threads get caller_data.
+              The remaining arguments are those of voxel_loop.
+@OUTPUT     : (none)
+@RETURNS    : (nothing)
+@DESCRIPTION: Like voxel_loop, but the voxel function is called from
+              nthreads threads at once on disjoint pieces of each buffer.
+              The voxel function must only write to its own piece of the
+              output buffers and must not call netCDF or MINC routines.
+              If it keeps running totals in its caller data, then
+              thread_data should be given and the caller must combine
+              the totals for the threads once the loop is done. A voxel
+              function that needs the position of a voxel in the whole
+              buffer (e.g. for get_info_voxel_index) must add
+              get_parallel_loop_offset() to its own index. Start and
+              finish functions are still called with caller_data from a
+              single thread.
+@METHOD     :
+@GLOBALS    :
+@CALLS      : voxel_loop
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+void parallel_voxel_loop(int nthreads, void *thread_data[],
+                         int num_input_files, char *input_files[],
+                         int num_output_files, char *output_files[],
+                         char *arg_string,
+                         Loop_Options *loop_options,
+                         VoxelFunction voxel_function,
+                         void *caller_data)
+{
+   int ithread;
+
+   if (nthreads < 1) nthreads = 1;
+#ifndef HAVE_PTHREAD
+   if (nthreads > 1) {
+      (void) fprintf(stderr,
+         "Warning: threads are not supported, using a single thread.\n");
+      nthreads = 1;
+   }
+#endif
+
+   parallel_loop.nthreads = nthreads;
+   parallel_loop.thread_data = thread_data;
+   parallel_loop.voxel_function = voxel_function;
+   parallel_loop.offset = malloc(nthreads * sizeof(long));
+   for (ithread=0; ithread < nthreads; ithread++) {
+      parallel_loop.offset[ithread] = 0;
+   }
+
+#ifdef HAVE_PTHREAD
+   /* Start the workers. The calling thread is thread 0. */
+   (void) pthread_key_create(&parallel_loop.thread_key, NULL);
+   (void) pthread_setspecific(parallel_loop.thread_key,
+                              &parallel_loop.offset[0]);
+   if (nthreads > 1) {
+      (void) pthread_mutex_init(&parallel_loop.mutex, NULL);
+      (void) pthread_cond_init(&parallel_loop.start_cond, NULL);
+      (void) pthread_cond_init(&parallel_loop.done_cond, NULL);
+      parallel_loop.generation = 0;
+      parallel_loop.nbusy = 0;
+      parallel_loop.finished = FALSE;
+      parallel_loop.threads = malloc(nthreads * sizeof(pthread_t));
+      for (ithread=1; ithread < nthreads; ithread++) {
+         if (pthread_create(&parallel_loop.threads[ithread], NULL,
+                            loop_worker,
+                            (void *) &parallel_loop.offset[ithread]) != 0) {
+            (void) fprintf(stderr, "Error creating worker thread.\n");
+            exit(EXIT_FAILURE);
+         }
+      }
+   }
+#endif
+
+   voxel_loop(num_input_files, input_files, num_output_files, output_files,
+              arg_string, loop_options, parallel_voxel_function, caller_data);
+
+#ifdef HAVE_PTHREAD
+   /* Stop the workers */
+   if (nthreads > 1) {
+      (void) pthread_mutex_lock(&parallel_loop.mutex);
+      parallel_loop.finished = TRUE;
+      (void) pthread_cond_broadcast(&parallel_loop.start_cond);
+      (void) pthread_mutex_unlock(&parallel_loop.mutex);
+      for (ithread=1; ithread < nthreads; ithread++) {
+         (void) pthread_join(parallel_loop.threads[ithread], NULL);
+      }
+      free(parallel_loop.threads);
+      (void) pthread_mutex_destroy(&parallel_loop.mutex);
+      (void) pthread_cond_destroy(&parallel_loop.start_cond);
+      (void) pthread_cond_destroy(&parallel_loop.done_cond);
+   }
+   (void) pthread_key_delete(parallel_loop.thread_key);
+#endif
+
+   free(parallel_loop.offset);
+   parallel_loop.offset = NULL;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : get_parallel_loop_offset
+@INPUT      : (none)
+@OUTPUT     : (none)
+@RETURNS    : Offset (in values, as for the index into input_data) of the
+              piece of the buffer being done by the calling thread.
+@DESCRIPTION: To be called from a voxel function run by
+              parallel_voxel_loop to find where its piece lies in the
+              buffer given by voxel_loop.
+@METHOD     :
+@GLOBALS    :
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+long get_parallel_loop_offset(void)
+{
+#ifdef HAVE_PTHREAD
+   long *offset;
+
+   offset = pthread_getspecific(parallel_loop.thread_key);
+   return (offset != NULL) ? *offset : 0;
+#else
+   return (parallel_loop.offset != NULL) ? parallel_loop.offset[0] : 0;
+#endif
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : parallel_voxel_function
+@INPUT      : Standard for voxel loop
+@OUTPUT     : Standard for voxel loop
+@RETURNS    : (nothing)
+@DESCRIPTION: Voxel function given to voxel_loop. Splits the buffer into
+              pieces, one for each thread, and waits for all of them to
+              be done.
+@METHOD     :
+@GLOBALS    : parallel_loop
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+static void parallel_voxel_function(void *caller_data, long num_voxels,
+                                    int input_num_buffers,
+                                    int input_vector_length,
+                                    double *input_data[],
+                                    int output_num_buffers,
+                                    int output_vector_length,
+                                    double *output_data[],
+                                    Loop_Info *loop_info)
+{
+   long nparts;
+
+   parallel_loop.num_voxels = num_voxels;
+   parallel_loop.input_num_buffers = input_num_buffers;
+   parallel_loop.input_vector_length = input_vector_length;
+   parallel_loop.input_data = input_data;
+   parallel_loop.output_num_buffers = output_num_buffers;
+   parallel_loop.output_vector_length = output_vector_length;
+   parallel_loop.output_data = output_data;
+   parallel_loop.loop_info = loop_info;
+   parallel_loop.caller_data = caller_data;
+
+   /* Work out how many pieces it is worth cutting the buffer into */
+   nparts = (num_voxels * input_vector_length) / MIN_VALUES_PER_THREAD;
+   if (nparts > parallel_loop.nthreads) nparts = parallel_loop.nthreads;
+   if (nparts > num_voxels) nparts = num_voxels;
+   if (nparts < 1) nparts = 1;
+   parallel_loop.nparts = nparts;
+
+   /* Small buffers are done in this thread */
+   if (nparts <= 1) {
+      do_part(0);
+      return;
+   }
+
+#ifdef HAVE_PTHREAD
+   /* Wake up the workers, do our own part and wait for theirs */
+   (void) pthread_mutex_lock(&parallel_loop.mutex);
+   parallel_loop.generation++;
+   parallel_loop.nbusy = parallel_loop.nthreads - 1;
+   (void) pthread_cond_broadcast(&parallel_loop.start_cond);
+   (void) pthread_mutex_unlock(&parallel_loop.mutex);
+
+   do_part(0);
+
+   (void) pthread_mutex_lock(&parallel_loop.mutex);
+   while (parallel_loop.nbusy > 0) {
+      (void) pthread_cond_wait(&parallel_loop.done_cond,
+                               &parallel_loop.mutex);
+   }
+   (void) pthread_mutex_unlock(&parallel_loop.mutex);
+#endif
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : do_part
+@INPUT      : ipart - number of piece of the buffer to do (also the number
+                 of the thread doing it)
+@OUTPUT     : (none)
+@RETURNS    : (nothing)
+@DESCRIPTION: Calls the voxel function on one piece of the current buffer.
+@METHOD     :
+@GLOBALS    : parallel_loop
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+static void do_part(int ipart)
+{
+   long first, last;
+   int ibuff;
+   double **input_data, **output_data;
+   void *caller_data;
+
+   if (ipart >= parallel_loop.nparts) return;
+
+   /* Get the range of voxels for this piece */
+   first = (parallel_loop.num_voxels * ipart) / parallel_loop.nparts;
+   last = (parallel_loop.num_voxels * (ipart+1)) / parallel_loop.nparts;
+   parallel_loop.offset[ipart] = first * parallel_loop.input_vector_length;
+
+   /* Point to the piece in each buffer */
+   input_data = malloc((parallel_loop.input_num_buffers +
+                        parallel_loop.output_num_buffers + 1) *
+                       sizeof(double *));
+   output_data = input_data + parallel_loop.input_num_buffers;
+   for (ibuff=0; ibuff < parallel_loop.input_num_buffers; ibuff++) {
+      input_data[ibuff] = parallel_loop.input_data[ibuff] +
+         first * parallel_loop.input_vector_length;
+   }
+   for (ibuff=0; ibuff < parallel_loop.output_num_buffers; ibuff++) {
+      output_data[ibuff] = parallel_loop.output_data[ibuff] +
+         first * parallel_loop.output_vector_length;
+   }
+
+   if (parallel_loop.thread_data != NULL)
+      caller_data = parallel_loop.thread_data[ipart];
+   else
+      caller_data = parallel_loop.caller_data;
+
+   parallel_loop.voxel_function(caller_data, last - first,
+                                parallel_loop.input_num_buffers,
+                                parallel_loop.input_vector_length,
+                                input_data,
+                                parallel_loop.output_num_buffers,
+                                parallel_loop.output_vector_length,
+                                output_data,
+                                parallel_loop.loop_info);
+
+   parallel_loop.offset[ipart] = 0;
+   free(input_data);
+}
+
+#ifdef HAVE_PTHREAD
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : loop_worker
+@INPUT      : arg - pointer to offset of this thread in parallel_loop.offset
+@OUTPUT     : (none)
+@RETURNS    : NULL
+@DESCRIPTION: Worker thread routine. Waits for each new buffer and does its
+              piece of it.
+@METHOD     :
+@GLOBALS    : parallel_loop
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+static void *loop_worker(void *arg)
+{
+   long *offset = arg;
+   long generation;
+   int ithread;
+
+   ithread = offset - parallel_loop.offset;
+   (void) pthread_setspecific(parallel_loop.thread_key, offset);
+
+   generation = 0;
+   (void) pthread_mutex_lock(&parallel_loop.mutex);
+   for (;;) {
+      while ((parallel_loop.generation == generation) &&
+             !parallel_loop.finished) {
+         (void) pthread_cond_wait(&parallel_loop.start_cond,
+                                  &parallel_loop.mutex);
+      }
+      if (parallel_loop.finished) break;
+      generation = parallel_loop.generation;
+      (void) pthread_mutex_unlock(&parallel_loop.mutex);
+
+      do_part(ithread);
+
+      (void) pthread_mutex_lock(&parallel_loop.mutex);
+      parallel_loop.nbusy--;
+      if (parallel_loop.nbusy <= 0) {
+         (void) pthread_cond_signal(&parallel_loop.done_cond);
+      }
+   }
+   (void) pthread_mutex_unlock(&parallel_loop.mutex);
+
+   return NULL;
+}
+#endif
@@ -0,0 +1,20 @@
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : parallel_voxel_loop.h
+@DESCRIPTION: Header file for parallel_voxel_loop.c
+@METHOD     :
+@GLOBALS    :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+
+#include <voxel_loop.h>
+
+void parallel_voxel_loop(int nthreads, void *thread_data[],
+                         int num_input_files, char *input_files[],
+                         int num_output_files, char *output_files[],
+                         char *arg_string,
+                         Loop_Options *loop_options,
+                         VoxelFunction voxel_function,
+                         void *caller_data);
+
+long get_parallel_loop_offset(void);
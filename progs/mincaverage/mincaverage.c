@@ -105,6 +105,7 @@
 #include <ParseArgv.h>
 #include <time_stamp.h>
 #include <voxel_loop.h>
+#include <parallel_voxel_loop.h>
 
 /* Constants */
 
@@ -119,6 +120,11 @@
 
 #define DEFAULT_BOOLEAN -1
 
+/* Averaging methods */
+#define MEAN_AVERAGE       0
+#define PERCENTILE_AVERAGE 1
+#define TRIMMED_AVERAGE    2
+
 /* Double_Array structure */
 typedef struct {
    int numvalues;
@@ -138,8 +144,18 @@ typedef struct {
    int num_weights;
    double *weights;
    double weight_thresh;
+   int method;
+   double percent;
+   int partial_input;
+   int save_partial;
 } Average_Data;
 
+/* Scratch space for one thread of a median, percentile or trimmed mean */
+typedef struct {
+   Average_Data *average_data;
+   double *column;
+} Column_Data;
+
 typedef struct {
    int threshold_set;
    double threshold;
@@ -168,11 +184,25 @@ static void finish_average(void *caller_data, long num_voxels,
                           int output_num_buffers, int output_vector_length,
                           double *output_data[],
                           Loop_Info *loop_info);
+static void do_column_average(void *caller_data, long num_voxels, 
+                              int input_num_buffers, int input_vector_length,
+                              double *input_data[],
+                              int output_num_buffers, int output_vector_length,
+                              double *output_data[],
+                              Loop_Info *loop_info);
+static void get_accumulators(Average_Data *average_data, 
+                             double *output_data[],
+                             double **weight, double **mean, double **m2,
+                             long *stride);
+static double select_value(double values[], int nvalues, int k);
+static double get_percentile(double values[], int nvalues, double percent);
+static double get_trimmed_mean(double values[], int nvalues, double percent);
 static int get_double_list(char *dst, char *key, char *nextarg);
 
 /* Argument variables */
 static int clobber = FALSE;
 static int verbose = TRUE;
+static int nthreads = 1;
 static int debug = FALSE;
 static int check_dimensions = TRUE;
 #ifdef NO_DEFAULT_NORM
@@ -198,6 +228,11 @@ static double weight_thresh_fraction = 0.0;
 static Double_Array weights = {0, NULL};
 static int width_weighted = FALSE;
 static char *filelist = NULL;
+static int median = FALSE;
+static double trimmed_mean = -1.0;
+static double percentile = -1.0;
+static char *partial_file = NULL;
+static int partial_input = FALSE;
 #if MINC2
 static int minc2_format = FALSE;
 #endif /* MINC2 */
@@ -229,6 +264,8 @@ ArgvInfo argTable[] = {
    {"-max_buffer_size_in_kb", ARGV_INT, (char *) 1, 
        (char *) &max_buffer_size_in_kb,
        "Specify the maximum size of the internal buffers (in kbytes)."},
+   {"-threads", ARGV_INT, (char *) 1, (char *) &nthreads,
+       "Number of threads used to process each buffer (default 1)."},
    {"-filetype", ARGV_CONSTANT, (char *) MI_ORIGINAL_TYPE, (char *) &datatype,
        "Use data type of first file (default)."},
    {"-byte", ARGV_CONSTANT, (char *) NC_BYTE, (char *) &datatype,
@@ -286,6 +323,16 @@ ArgvInfo argTable[] = {
        "Minimum cumulative weight needed for calculating the average or sd." },
    {"-min_weight_fraction", ARGV_FLOAT, (char *) 1, (char *) &weight_thresh_fraction,
        "Same as -min_weight, but specified as a fraction of the sum of the input weights (or the number of input volumes, if no weight is specified)." },
+   {"-median", ARGV_CONSTANT, (char *) TRUE, (char *) &median,
+       "Calculate the median of the input values for each voxel."},
+   {"-trimmed_mean", ARGV_FLOAT, (char *) 1, (char *) &trimmed_mean,
+       "Calculate the mean discarding this percentage of values at each end."},
+   {"-percentile", ARGV_FLOAT, (char *) 1, (char *) &percentile,
+       "Calculate this percentile (0 to 100) of the input values."},
+   {"-save_partial", ARGV_STRING, (char *) 1, (char *) &partial_file,
+       "Save the running weight, mean and sum of squared deviations to a file\n\t\tinstead of writing the average (no output file is given)."},
+   {"-partial_input", ARGV_CONSTANT, (char *) TRUE, (char *) &partial_input,
+       "Input files are partial results saved with -save_partial."},
    {NULL, ARGV_END, NULL, NULL, NULL}
 };
 
@@ -295,6 +342,9 @@ int main(int argc, char *argv[])
 {
    char **infiles, *outfiles[3];
    int nfiles, nout;
+   Column_Data *column_data;
+   void **thread_data;
+   int ithread, nmethods;
    char *arg_string;
    Norm_Data norm_data;
    Average_Data average_data;
@@ -313,16 +363,33 @@ int main(int argc, char *argv[])
    arg_string = time_stamp(argc, argv);
 
    /* Get arguments */
-   if (ParseArgv(&argc, argv, argTable, 0) || (argc < 2)) {
+   if (ParseArgv(&argc, argv, argTable, 0) || 
+       (argc < ((partial_file == NULL) ? 2 : 1))) {
       (void) fprintf(stderr, 
       "\nUsage: %s [options] [<in1.mnc> ...] <out.mnc>\n",
                      argv[0]);
+      (void) fprintf(stderr, 
+      "       %s [options] -save_partial <partial.mnc> [<in1.mnc> ...]\n",
+                     argv[0]);
       (void) fprintf(stderr, 
         "       %s -help\n\n", argv[0]);
       exit(EXIT_FAILURE);
    }
    outfiles[0] = outfiles[1] = outfiles[2] = NULL;
-   outfiles[0] = argv[argc-1];
+   if (partial_file != NULL) {
+      if ((sdfile != NULL) || (weightfile != NULL)) {
+         (void) fprintf(stderr, 
+            "%s: -sdfile and -weightfile cannot be used with -save_partial.\n",
+                        argv[0]);
+         exit(EXIT_FAILURE);
+      }
+      outfiles[0] = partial_file;
+      nfiles = argc - 1;
+   }
+   else {
+      outfiles[0] = argv[argc-1];
+      nfiles = argc - 2;
+   }
    nout = 1;
    if( sdfile != NULL )
 	   outfiles[nout++] = sdfile;
@@ -333,7 +400,6 @@ int main(int argc, char *argv[])
 
    /* Get the list of input files either from the command line or
       from a file, or report an error if both are specified */
-   nfiles = argc - 2;
    if (filelist == NULL) {
       infiles = &argv[1];
    }
@@ -366,6 +432,72 @@ int main(int argc, char *argv[])
    /* Are we averaging over a dimension? */
    average_data.averaging_over_dimension = (averaging_dimension != NULL);
 
+   /* Check for a median, percentile or trimmed mean */
+   nmethods = (median != FALSE) + (percentile >= 0.0) + (trimmed_mean >= 0.0);
+   average_data.method = MEAN_AVERAGE;
+   average_data.percent = 0.0;
+   if (nmethods > 1) {
+      (void) fprintf(stderr, 
+         "%s: Specify only one of -median, -percentile and -trimmed_mean.\n",
+                     argv[0]);
+      exit(EXIT_FAILURE);
+   }
+   else if (median) {
+      average_data.method = PERCENTILE_AVERAGE;
+      average_data.percent = 50.0;
+   }
+   else if (percentile >= 0.0) {
+      if (percentile > 100.0) {
+         (void) fprintf(stderr, 
+                        "%s: The percentile must be between 0 and 100.\n",
+                        argv[0]);
+         exit(EXIT_FAILURE);
+      }
+      average_data.method = PERCENTILE_AVERAGE;
+      average_data.percent = percentile;
+   }
+   else if (trimmed_mean >= 0.0) {
+      if (trimmed_mean >= 50.0) {
+         (void) fprintf(stderr, 
+            "%s: The trimmed percentage must be less than 50.\n",
+                        argv[0]);
+         exit(EXIT_FAILURE);
+      }
+      average_data.method = TRIMMED_AVERAGE;
+      average_data.percent = trimmed_mean;
+   }
+   if ((average_data.method != MEAN_AVERAGE) && 
+       ((partial_file != NULL) || partial_input)) {
+      (void) fprintf(stderr, 
+         "%s: Partial results can only be used for the mean.\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+   if (average_data.method != MEAN_AVERAGE) {
+      if ((averaging_dimension != NULL) || (sdfile != NULL) ||
+          (weights.numvalues > 0) || width_weighted) {
+         (void) fprintf(stderr, 
+"%s: -avgdim, -sdfile and weighting cannot be used with -median,\n\
+-percentile or -trimmed_mean.\n", argv[0]);
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   /* Partial results already hold weighted values, so they are merged as
+      they are */
+   average_data.partial_input = partial_input;
+   average_data.save_partial = (partial_file != NULL);
+   if (partial_input) {
+      if ((averaging_dimension != NULL) || (weights.numvalues > 0) || 
+          width_weighted || binarize || (normalize == TRUE) ||
+          (ignore_below != -DBL_MAX) || (ignore_above != DBL_MAX)) {
+         (void) fprintf(stderr, 
+"%s: -avgdim, weighting, normalization, binarization and -ignore options\n\
+cannot be used with -partial_input.\n", argv[0]);
+         exit(EXIT_FAILURE);
+      }
+      normalize = FALSE;
+   }
+
    /* Check for weights and width-weighting */
    weights_specified = weights.numvalues > 0;
    if (weights_specified && width_weighted) {
@@ -631,13 +763,51 @@ int main(int argc, char *argv[])
    set_loop_clobber(loop_options, clobber);
    set_loop_datatype(loop_options, datatype, is_signed, 
                      valid_range[0], valid_range[1]);
-   set_loop_accumulate(loop_options, TRUE, 1, start_average, finish_average);
    set_loop_copy_all_header(loop_options, copy_all_header);
-   set_loop_dimension(loop_options, averaging_dimension);
    set_loop_buffer_size(loop_options, (long) 1024 * max_buffer_size_in_kb);
    set_loop_check_dim_info(loop_options, check_dimensions);
-   voxel_loop(nfiles, infiles, nout, outfiles, arg_string, loop_options,
-              do_average, (void *) &average_data);
+   if (average_data.method == MEAN_AVERAGE) {
+      set_loop_accumulate(loop_options, TRUE, 1, 
+                          start_average, finish_average);
+      set_loop_dimension(loop_options, averaging_dimension);
+
+      /* Partial results are kept as a vector of weight, mean and sum of
+         squared deviations for each voxel, in full precision */
+      if (average_data.save_partial) {
+         set_loop_datatype(loop_options, NC_DOUBLE, TRUE, 0.0, 0.0);
+         set_loop_output_vector_size(loop_options, 3);
+      }
+      else if (average_data.partial_input) {
+         set_loop_output_vector_size(loop_options, 1);
+      }
+      parallel_voxel_loop(nthreads, NULL, nfiles, infiles, nout, outfiles, 
+                          arg_string, loop_options,
+                          do_average, (void *) &average_data);
+   }
+   else {
+
+      /* All of the files are read together, a block of voxels at a time,
+         and each thread gathers the values for its voxels in its own
+         column array. The buffer size bounds the memory used however 
+         many files there are. */
+      if (nthreads < 1) nthreads = 1;
+      column_data = malloc(sizeof(*column_data) * nthreads);
+      thread_data = malloc(sizeof(*thread_data) * nthreads);
+      for (ithread=0; ithread < nthreads; ithread++) {
+         column_data[ithread].average_data = &average_data;
+         column_data[ithread].column = 
+            malloc(sizeof(*column_data[ithread].column) * nfiles);
+         thread_data[ithread] = (void *) &column_data[ithread];
+      }
+      parallel_voxel_loop(nthreads, thread_data, nfiles, infiles, 
+                          nout, outfiles, arg_string, loop_options,
+                          do_column_average, (void *) &average_data);
+      for (ithread=0; ithread < nthreads; ithread++) {
+         free(column_data[ithread].column);
+      }
+      free(column_data);
+      free(thread_data);
+   }
    free_loop_options(loop_options);
 
    /* Free stuff */
@@ -783,11 +953,15 @@ static void find_mincfile_range(int mincid, double *minimum, double *maximum)
 @RETURNS    : (nothing)
 @DESCRIPTION: Routine to loop through an array of voxels and perform averaging
               of across volumes.
-@METHOD     : 
+@METHOD     : Keeps a running weight, mean and sum of squared deviations
+              from the mean for each voxel (West's weighted form of 
+              Welford's update), which does not lose precision for data 
+              with a large mean and small variance. Partial results are 
+              merged with the pairwise update of Chan, Golub and LeVeque.
 @GLOBALS    : 
 @CALLS      : 
 @CREATED    : April 25, 1995 (Peter Neelin)
-@MODIFIED   : 
+@MODIFIED   : October 16, 2026 - running mean and squared deviations
 ---------------------------------------------------------------------------- */
 static void do_average(void *caller_data, long num_voxels, 
                        int input_num_buffers, int input_vector_length,
@@ -798,8 +972,9 @@ static void do_average(void *caller_data, long num_voxels,
      /* ARGSUSED */
 {
    Average_Data *average_data;
-   long ivox;
-   double value;
+   long ivox, nvalues, iacc, stride;
+   double value, delta, mean, sum0;
+   double *acc_weight, *acc_mean, *acc_m2;
    int curfile, curindex;
    int num_out;
    double norm_factor, binmin, binmax, weight, ignore_below, ignore_above;
@@ -813,11 +988,53 @@ static void do_average(void *caller_data, long num_voxels,
        ( average_data->need_sd != 0 ) + 
        ( average_data->need_weight != 0 );
 
-   if ((input_num_buffers != 1) || (output_num_buffers != num_out) || 
-       (output_vector_length != input_vector_length)) {
+   if ((input_num_buffers != 1) || (output_num_buffers != num_out)) {
       (void) fprintf(stderr, "Bad arguments to do_average!\n");
       exit(EXIT_FAILURE);
    }
+   if (average_data->partial_input) {
+      if (input_vector_length != 3) {
+         (void) fprintf(stderr, 
+                        "Input file does not hold partial results!\n");
+         exit(EXIT_FAILURE);
+      }
+      nvalues = num_voxels;
+   }
+   else {
+      if (output_vector_length != 
+          (average_data->save_partial ? 3 * input_vector_length :
+           input_vector_length)) {
+         (void) fprintf(stderr, 
+            "Partial results can only be saved for scalar input files!\n");
+         exit(EXIT_FAILURE);
+      }
+      nvalues = num_voxels * input_vector_length;
+   }
+   get_accumulators(average_data, output_data,
+                    &acc_weight, &acc_mean, &acc_m2, &stride);
+
+   /* Merge partial results */
+   if (average_data->partial_input) {
+      for (ivox=0; ivox < nvalues; ivox++) {
+         weight = input_data[0][3*ivox];
+         mean = input_data[0][3*ivox+1];
+         value = input_data[0][3*ivox+2];
+         if ((weight == -DBL_MAX) || (weight == 0.0) || 
+             (mean == -DBL_MAX) || (value == -DBL_MAX))
+            continue;
+         iacc = ivox * stride;
+         sum0 = acc_weight[iacc] + weight;
+         if (sum0 != 0.0) {
+            delta = mean - acc_mean[iacc];
+            acc_mean[iacc] += delta * weight / sum0;
+            if (acc_m2 != NULL)
+               acc_m2[iacc] += value + 
+                  delta * delta * acc_weight[iacc] * weight / sum0;
+         }
+         acc_weight[iacc] = sum0;
+      }
+      return;
+   }
 
    /* Get the normalization factor and binarization range */
    curfile = get_info_current_file(loop_info);
@@ -849,23 +1066,66 @@ static void do_average(void *caller_data, long num_voxels,
    ignore_above = average_data->ignore_above;
 
    /* Loop through the voxels */
-   for (ivox=0; ivox < num_voxels*input_vector_length; ivox++) {
+   for (ivox=0; ivox < nvalues; ivox++) {
       value = input_data[0][ivox];
       if (binarize) {
          value = ( ((value >= binmin) && (value <= binmax)) ? 1.0 : 0.0 );
       }
       if (value != -DBL_MAX && value > ignore_below && value < ignore_above ) {
          value *= norm_factor;
-         output_data[0][ivox] += weight;
-         output_data[1][ivox] += value * weight;
-         if (average_data->need_sd)
-            output_data[2][ivox] += value * value * weight;
+         iacc = ivox * stride;
+         sum0 = acc_weight[iacc] + weight;
+         if (sum0 != 0.0) {
+            delta = value - acc_mean[iacc];
+            acc_mean[iacc] += delta * weight / sum0;
+            if (acc_m2 != NULL)
+               acc_m2[iacc] += weight * delta * (value - acc_mean[iacc]);
+         }
+         acc_weight[iacc] = sum0;
       }
    }
 
    return;
 }
 
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : get_accumulators
+@INPUT      : average_data - averaging information
+              output_data - output buffers from voxel_loop
+@OUTPUT     : weight - running weight for each voxel
+              mean - running mean for each voxel
+              m2 - running sum of squared deviations (NULL if not needed)
+              stride - step between voxels in these arrays
+@RETURNS    : (nothing)
+@DESCRIPTION: Finds where the running values are kept in the output 
+              buffers. When partial results are saved they are kept
+              together as a vector for each voxel, otherwise they are
+              in the first three buffers.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void get_accumulators(Average_Data *average_data, 
+                             double *output_data[],
+                             double **weight, double **mean, double **m2,
+                             long *stride)
+{
+   if (average_data->save_partial) {
+      *weight = &output_data[0][0];
+      *mean = &output_data[0][1];
+      *m2 = &output_data[0][2];
+      *stride = 3;
+   }
+   else {
+      *weight = output_data[0];
+      *mean = output_data[1];
+      *m2 = (average_data->need_sd ? output_data[2] : NULL);
+      *stride = 1;
+   }
+}
+
 /* ----------------------------- MNI Header -----------------------------------
 @NAME       : start_average
 @INPUT      : Standard for voxel loop
@@ -933,7 +1193,7 @@ static void finish_average(void *caller_data, long num_voxels,
    Average_Data *average_data;
    long ivox;
    int num_out, i_weight;
-   double sum0, sum1, sum2, value;
+   double sum0, mean, m2, value;
 
    /* Get pointer to window info */
    average_data = (Average_Data *) caller_data;
@@ -951,16 +1211,19 @@ static void finish_average(void *caller_data, long num_voxels,
       exit(EXIT_FAILURE);
    }
 
+   /* Partial results are written as they are */
+   if (average_data->save_partial) return;
+
    /* Loop through the voxels */
    for (ivox=0; ivox < num_voxels*output_vector_length; ivox++) {
       sum0 = output_data[0][ivox];
-      sum1 = output_data[1][ivox];
+      mean = output_data[1][ivox];
       if (sum0 > 0.0 && sum0 >= average_data->weight_thresh) {
-         output_data[0][ivox] = sum1 / sum0;
+         output_data[0][ivox] = mean;
          if (average_data->need_sd) {
-            sum2 = output_data[2][ivox];
+            m2 = output_data[2][ivox];
             if (sum0 > 1.0) {
-               value = (sum2 - sum1*sum1 / sum0) / (sum0 - 1.0);
+               value = m2 / (sum0 - 1.0);
                if (value > 0.0)
                   value = sqrt(value);
                else
@@ -986,6 +1249,206 @@ static void finish_average(void *caller_data, long num_voxels,
    return;
 }
 
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : do_column_average
+@INPUT      : Standard for voxel loop
+@OUTPUT     : Standard for voxel loop
+@RETURNS    : (nothing)
+@DESCRIPTION: Routine to loop through an array of voxels from all of the
+              input files at once and calculate the median, a percentile
+              or a trimmed mean of the values for each voxel.
+@METHOD     : The valid values for a voxel are gathered into the column
+              array of the thread and the needed order statistics are
+              found by selection rather than sorting.
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void do_column_average(void *caller_data, long num_voxels, 
+                              int input_num_buffers, int input_vector_length,
+                              double *input_data[],
+                              int output_num_buffers, int output_vector_length,
+                              double *output_data[],
+                              Loop_Info *loop_info)
+     /* ARGSUSED */
+{
+   Column_Data *column_data;
+   Average_Data *average_data;
+   double *column;
+   long ivox;
+   int ifile, nvalues, num_out;
+   double value;
+
+   /* Get pointer to window info */
+   column_data = (Column_Data *) caller_data;
+   average_data = column_data->average_data;
+   column = column_data->column;
+
+   /* Check arguments */
+   num_out = 1 + ( average_data->need_weight != 0 );
+   if ((output_num_buffers != num_out) || 
+       (output_vector_length != input_vector_length)) {
+      (void) fprintf(stderr, "Bad arguments to do_column_average!\n");
+      exit(EXIT_FAILURE);
+   }
+
+   /* Loop through the voxels */
+   for (ivox=0; ivox < num_voxels*input_vector_length; ivox++) {
+
+      /* Gather the values from each file */
+      nvalues = 0;
+      for (ifile=0; ifile < input_num_buffers; ifile++) {
+         value = input_data[ifile][ivox];
+         if (average_data->binarize) {
+            value = ( ((value >= average_data->binrange[0]) && 
+                       (value <= average_data->binrange[1])) ? 1.0 : 0.0 );
+         }
+         if (value != -DBL_MAX && value > average_data->ignore_below && 
+             value < average_data->ignore_above) {
+            column[nvalues++] = value * average_data->norm_factor[ifile];
+         }
+      }
+
+      /* Get the result */
+      if ((nvalues <= 0) || (nvalues < average_data->weight_thresh))
+         value = 0.0;
+      else if (average_data->method == TRIMMED_AVERAGE)
+         value = get_trimmed_mean(column, nvalues, average_data->percent);
+      else
+         value = get_percentile(column, nvalues, average_data->percent);
+      output_data[0][ivox] = value;
+      if (average_data->need_weight)
+         output_data[1][ivox] = nvalues;
+   }
+
+   return;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : select_value
+@INPUT      : values - array of values (reordered)
+              nvalues - number of values
+              k - rank of the wanted value (0 is the smallest)
+@OUTPUT     : values - partially ordered so that no value before
+                 position k is larger than values[k] and no value after
+                 it is smaller
+@RETURNS    : The k-th smallest value
+@DESCRIPTION: Finds the k-th smallest value of an array in linear time
+              (on average) without sorting it.
+@METHOD     : Hoare's selection, as given by N. Wirth
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static double select_value(double values[], int nvalues, int k)
+{
+   int left, right, i, j;
+   double pivot, temp;
+
+   left = 0;
+   right = nvalues - 1;
+   while (left < right) {
+      pivot = values[k];
+      i = left;
+      j = right;
+      do {
+         while (values[i] < pivot) i++;
+         while (pivot < values[j]) j--;
+         if (i <= j) {
+            temp = values[i];
+            values[i] = values[j];
+            values[j] = temp;
+            i++;
+            j--;
+         }
+      } while (i <= j);
+      if (j < k) left = i;
+      if (k < i) right = j;
+   }
+
+   return values[k];
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : get_percentile
+@INPUT      : values - array of values (reordered)
+              nvalues - number of values (at least 1)
+              percent - percentile to find (0 to 100)
+@OUTPUT     : (none)
+@RETURNS    : The percentile of the values
+@DESCRIPTION: Finds a percentile of an array of values, interpolating
+              linearly between the two closest values so that the 50th
+              percentile of an even number of values is the mean of the
+              middle two.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static double get_percentile(double values[], int nvalues, double percent)
+{
+   double position, fraction, lower, upper;
+   int k, i;
+
+   position = percent / 100.0 * (nvalues - 1);
+   k = (int) position;
+   if (k > nvalues - 1) k = nvalues - 1;
+   fraction = position - k;
+
+   lower = select_value(values, nvalues, k);
+   if ((fraction <= 0.0) || (k >= nvalues - 1))
+      return lower;
+
+   /* The next value up is the smallest of those above position k */
+   upper = values[k+1];
+   for (i=k+2; i < nvalues; i++) {
+      if (values[i] < upper) upper = values[i];
+   }
+
+   return lower + fraction * (upper - lower);
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : get_trimmed_mean
+@INPUT      : values - array of values (reordered)
+              nvalues - number of values (at least 1)
+              percent - percentage of values to drop at each end (< 50)
+@OUTPUT     : (none)
+@RETURNS    : The trimmed mean of the values
+@DESCRIPTION: Finds the mean of an array of values leaving out the
+              given percentage of the smallest and of the largest values.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static double get_trimmed_mean(double values[], int nvalues, double percent)
+{
+   int ntrim, nkeep, i;
+   double sum;
+
+   ntrim = (int) (nvalues * percent / 100.0);
+   if (2 * ntrim >= nvalues) ntrim = (nvalues - 1) / 2;
+   nkeep = nvalues - 2 * ntrim;
+
+   /* Move the smallest and largest values to the ends of the array */
+   if (ntrim > 0) {
+      (void) select_value(values, nvalues, ntrim);
+      (void) select_value(&values[ntrim], nvalues - ntrim, nkeep - 1);
+   }
+
+   sum = 0.0;
+   for (i=ntrim; i < ntrim + nkeep; i++) {
+      sum += values[i];
+   }
+
+   return sum / nkeep;
+}
+
 /* ----------------------------- MNI Header -----------------------------------
 @NAME       : get_double_list
 @INPUT      : dst - client data passed by ParseArgv
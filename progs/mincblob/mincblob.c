@@ -18,6 +18,8 @@
 /* Wed Nov  1 17:47:35 EST 2000 - rewrote translation option (new equation)   */
 /* Thu Feb  7 23:42:40 EST 2002 - complete rewrite to use volume_io           */
 /* Mon May  6 21:07:18 EDT 2002 - added -determinant option (jacobian)        */
+/* Fri Oct 16 10:00:00 EST 2026 - several outputs from one threaded sweep     */
+/*                                of the input, read a slab at a time         */
 
 /* TRACE */
 /* Compute the areas within the deformation field that equate to volume       */
@@ -37,29 +39,61 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <math.h>
+#include <float.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include <minc.h>
 #include <volume_io.h>
 #include <time_stamp.h>
 #include <ParseArgv.h>
 
-typedef enum { NO_OP, TRACE, DETERMINANT, TRANSLATION, MAGNITUDE } op;
+/* number of slices read at a time (plus one either side) */
+#define SLAB_SLICES 8
+
+typedef enum { NO_OP, TRACE, DETERMINANT, TRANSLATION, MAGNITUDE, N_OPS } op;
+
+/* input axes in the order they are used */
+typedef enum { VEC_AXIS, Z_AXIS, Y_AXIS, X_AXIS, N_AXES } axis;
+
+/* structure for a slab of input vectors and the outputs from it */
+typedef struct {
+   double  *data;                      /* input slab in file order     */
+   long     stride[N_AXES];            /* step in data along each axis */
+   int      sizes[N_AXES];             /* sizes of the whole volume    */
+   double   steps[N_AXES];             /* separations of the volume    */
+   int      data_start;                /* first slice in data          */
+   int      out_start;                 /* first slice of the outputs   */
+   float   *out[N_OPS];                /* outputs (NULL if not wanted) */
+   } Blob_Info;
+
+/* structure for the slices done by each thread */
+typedef struct {
+   Blob_Info *info;
+   int      first;
+   int      last;
+   } Blob_Range;
 
 /* function prototypes */
 double   fdiv(double num, double denom);
 double   farccos(double a0, double b0, double c0, double a1, double b1, double c1);
 double   cindex(double a0, double b0, double c0, double a1, double b1, double c1);
 double   feuc(double a, double b, double c);
-void     clear_borders(VIO_Volume v, int sizes[3]);
-void     fill_slice0(VIO_Volume v, VIO_Real value, int v0, int v1_size, int v2_size);
-void     fill_slice1(VIO_Volume v, VIO_Real value, int v0_size, int v1, int v2_size);
-void     fill_slice2(VIO_Volume v, VIO_Real value, int v0_size, int v1_size, int v2);
+void     get_dim_geometry(int mincid, char *dimname, double *start, double *step);
+void     blob_slices(Blob_Info * info, int first, int last);
+void     run_blob_slices(Blob_Info * info, int first, int last);
 void     print_version_info(void);
 
 /* argument variables */
 static int verbose = FALSE;
 static int clobber = FALSE;
+static int nthreads = 1;
 static op operation = NO_OP;
+static char *outfiles[N_OPS] = { NULL, NULL, NULL, NULL, NULL };
+static char *op_names[N_OPS] = { NULL, "trace", "determinant", "translation", "magnitude" };
 
 /* argument table */
 static ArgvInfo argTable[] = {
@@ -71,16 +105,28 @@ static ArgvInfo argTable[] = {
     "print out extra information"},
    {"-clobber", ARGV_CONSTANT, (char *)TRUE, (char *)&clobber,
     "clobber existing files"},
+   {"-threads", ARGV_INT, (char *)1, (char *)&nthreads,
+    "number of threads to use (default 1)"},
    {NULL, ARGV_HELP, (char *)NULL, (char *)NULL,
-    "\nOperations:"},
+    "\nOperations (output to <out.mnc>):"},
    {"-trace", ARGV_CONSTANT, (char *)TRACE, (char *)&operation,
-    "compute the trace (approximate growth and shrinkage) -- FAST"},
+    "compute the trace (approximate growth and shrinkage)"},
    {"-determinant", ARGV_CONSTANT, (char *)DETERMINANT, (char *)&operation,
-    "compute the determinant (exact growth and shrinkage) -- SLOW"},
+    "compute the determinant (exact growth and shrinkage)"},
    {"-translation", ARGV_CONSTANT, (char *)TRANSLATION, (char *)&operation,
     "compute translation (structure displacement)"},
    {"-magnitude", ARGV_CONSTANT, (char *)MAGNITUDE, (char *)&operation,
     "compute the magnitude of the displacement vector"},
+   {NULL, ARGV_HELP, (char *)NULL, (char *)NULL,
+    "\nOutput files (any number of these can be computed in one pass):"},
+   {"-trace_file", ARGV_STRING, (char *)1, (char *)&outfiles[TRACE],
+    "<trace.mnc> write the trace"},
+   {"-determinant_file", ARGV_STRING, (char *)1, (char *)&outfiles[DETERMINANT],
+    "<det.mnc> write the determinant"},
+   {"-translation_file", ARGV_STRING, (char *)1, (char *)&outfiles[TRANSLATION],
+    "<trans.mnc> write the translation"},
+   {"-magnitude_file", ARGV_STRING, (char *)1, (char *)&outfiles[MAGNITUDE],
+    "<mag.mnc> write the magnitude"},
    {NULL, ARGV_HELP, (char *)NULL, (char *)NULL, ""},
    {NULL, ARGV_END, NULL, NULL, NULL}
    };
@@ -89,243 +135,410 @@ int main(int argc, char **argv)
 {
    char    *arg_string;
    char    *infile;
-   char    *outfile;
-   VIO_Volume   in_vol;
-   VIO_Volume   out_vol;
-   nc_type    datatype;
-   VIO_BOOL   signed_flag;
-   VIO_Real   steps[MAX_VAR_DIMS];
-   VIO_Real   starts[MAX_VAR_DIMS];
-   int        sizes[MAX_VAR_DIMS];
-
-   double   out_real_max, out_real_min;
-
-   char    *in_axis_order[4] = { MIvector_dimension, MIzspace, MIyspace, MIxspace };
+   int      mincid, imgid, icvid;
+   int      ndims, dims[MAX_VAR_DIMS];
+   char     dimname[MAX_NC_NAME];
+   char    *axis_names[N_AXES] = { MIvector_dimension, MIzspace, MIyspace, MIxspace };
+   int      file_axis[N_AXES];
+   long     dim_size;
+   long     start[MAX_VAR_DIMS], count[MAX_VAR_DIMS];
+   nc_type  datatype;
+   int      signed_flag;
+   VIO_Volume out_vol[N_OPS];
+   VIO_Real starts[N_AXES];
+   int      n_outputs;
+
+   double   out_real_max[N_OPS], out_real_min[N_OPS];
+
    char    *out_axis_order[3] = { MIzspace, MIyspace, MIxspace };
 
-   int      x, y, z;
+   int      x, y, z, a, i, o;
+   int      slab_first, slab_last, read_first, read_last;
+   long     nvoxels, idx;
    double   value;
+   Blob_Info info;
    VIO_progress_struct progress;
 
-   /* Jacobian matrix */
-   VIO_Real     J[3][3];
-
    /* Save list of arguments as strings  */
    arg_string = time_stamp(argc, argv);
 
    /* Check arguments   */
-   if(ParseArgv(&argc, argv, argTable, 0) || (argc != 3)){
-      fprintf(stderr, "\nUsage: %s [options] <vec_in.mnc> <out.mnc>\n", argv[0]);
+   if(ParseArgv(&argc, argv, argTable, 0) || (argc < 2) || (argc > 3)){
+      fprintf(stderr, "\nUsage: %s [options] <vec_in.mnc> [<out.mnc>]\n", argv[0]);
       fprintf(stderr, "       %s -help\n\n", argv[0]);
       exit(EXIT_FAILURE);
       }
    infile = argv[1];
-   outfile = argv[2];
 
-   /* check for an operation */
-   if(operation == NO_OP){
-      fprintf(stderr, "%s: You need to specify an operation!\n\n", argv[0]);
+   /* the single operation writes to the outfile on the command line */
+   if(argc == 3){
+      if(operation == NO_OP){
+         fprintf(stderr, "%s: You need to specify an operation!\n\n", argv[0]);
+         exit(EXIT_FAILURE);
+         }
+      outfiles[operation] = argv[2];
+      }
+   else if(operation != NO_OP){
+      fprintf(stderr, "%s: -%s needs an output file\n\n", argv[0], op_names[operation]);
       exit(EXIT_FAILURE);
       }
 
-   /* check for the infile and outfile */
+   /* check for the infile and outfiles */
    if(access(infile, F_OK) != 0){
       fprintf(stderr, "%s: Couldn't find %s\n\n", argv[0], infile);
       exit(EXIT_FAILURE);
       }
-   if(access(outfile, F_OK) == 0 && !clobber){
-      fprintf(stderr, "%s: %s exists! (use -clobber to overwrite)\n\n", argv[0], outfile);
+   n_outputs = 0;
+   for(o = TRACE; o < N_OPS; o++){
+      if(outfiles[o] == NULL){
+         continue;
+         }
+      if(access(outfiles[o], F_OK) == 0 && !clobber){
+         fprintf(stderr, "%s: %s exists! (use -clobber to overwrite)\n\n", argv[0],
+                 outfiles[o]);
+         exit(EXIT_FAILURE);
+         }
+      n_outputs++;
+      }
+   if(n_outputs == 0){
+      fprintf(stderr, "%s: You need to specify an operation!\n\n", argv[0]);
       exit(EXIT_FAILURE);
       }
+   if(nthreads < 1){
+      nthreads = 1;
+      }
 
-   /* read in the input volume and a few other things.... */
-   if(input_volume(infile, 4, in_axis_order,
-                   NC_UNSPECIFIED, TRUE, 0.0, 0.0, TRUE, &in_vol, NULL) != 0){
-      fprintf(stderr, "%s: Error reading input volume (%s)\n\n", argv[0], infile);
-      exit(EXIT_FAILURE);
+   /* open the input and find its axes */
+   mincid = miopen(infile, NC_NOWRITE);
+   imgid = ncvarid(mincid, MIimage);
+   (void)miget_datatype(mincid, imgid, &datatype, &signed_flag);
+   (void)ncvarinq(mincid, imgid, NULL, NULL, &ndims, dims, NULL);
+   for(a = 0; a < N_AXES; a++){
+      file_axis[a] = -1;
+      }
+   for(i = 0; i < ndims; i++){
+      (void)ncdiminq(mincid, dims[i], dimname, &dim_size);
+      for(a = 0; a < N_AXES; a++){
+         if(strcmp(dimname, axis_names[a]) == 0){
+            file_axis[a] = i;
+            info.sizes[a] = dim_size;
+            }
+         }
       }
-   datatype = get_volume_nc_data_type(in_vol, &signed_flag);
-   get_volume_sizes(in_vol, sizes);
-   get_volume_starts(in_vol, starts);
-   get_volume_separations(in_vol, steps);
-
-   switch (operation){
-   default:
-   case NO_OP:
-      fprintf(stderr, "%s: GNARKLE! this shouldn't happen!\n\n", argv[0]);
+   for(a = 0; a < N_AXES; a++){
+      if(ndims != N_AXES || file_axis[a] == -1){
+         fprintf(stderr, "%s: %s must have dimensions %s, %s, %s and %s\n\n", argv[0],
+                 infile, MIvector_dimension, MIzspace, MIyspace, MIxspace);
+         exit(EXIT_FAILURE);
+         }
+      }
+   if(info.sizes[VEC_AXIS] != 3){
+      fprintf(stderr, "%s: %s must have 3 vector components\n\n", argv[0], infile);
       exit(EXIT_FAILURE);
-      break;
-
-   case TRACE:
-   case DETERMINANT:
-      out_real_min = -1.0;
-      out_real_max = 1.0;
-      break;
-
-   case MAGNITUDE:
-   case TRANSLATION:
-      out_real_min = 0.0;
-      out_real_max = 1.0;
-      break;
+      }
+   info.steps[VEC_AXIS] = 1.0;
+   for(a = Z_AXIS; a < N_AXES; a++){
+      get_dim_geometry(mincid, axis_names[a], &starts[a], &info.steps[a]);
       }
 
-   /* set up the output volume */
-   out_vol = create_volume(3, out_axis_order, NC_DOUBLE, TRUE, 0.0, 0.0);
-   set_volume_sizes(out_vol, &sizes[1]);
-   set_volume_starts(out_vol, &starts[1]);
-   set_volume_separations(out_vol, &steps[1]);
-   alloc_volume_data(out_vol);
+   /* read real values, keeping the vector components */
+   icvid = miicv_create();
+   (void)miicv_setint(icvid, MI_ICV_TYPE, NC_DOUBLE);
+   (void)miicv_setint(icvid, MI_ICV_DO_NORM, TRUE);
+   (void)miicv_setint(icvid, MI_ICV_DO_SCALAR, FALSE);
+   (void)miicv_attach(icvid, mincid, imgid);
+
+   /* slabs are whole in every axis but z */
+   for(a = 0; a < N_AXES; a++){
+      start[file_axis[a]] = 0;
+      count[file_axis[a]] = info.sizes[a];
+      }
+   nvoxels = (long)info.sizes[Y_AXIS] * info.sizes[X_AXIS];
+   info.data = (double *)malloc((SLAB_SLICES + 2) * nvoxels * 3 * sizeof(double));
+
+   /* set up the output volumes and slabs */
+   for(o = TRACE; o < N_OPS; o++){
+      info.out[o] = NULL;
+      if(outfiles[o] == NULL){
+         continue;
+         }
 
-   /* set the surrounding voxels to 0 */
-   clear_borders(out_vol, &sizes[1]);
+      out_vol[o] = create_volume(3, out_axis_order, NC_FLOAT, TRUE, 0.0, 0.0);
+      set_volume_sizes(out_vol[o], &info.sizes[Z_AXIS]);
+      set_volume_starts(out_vol[o], &starts[Z_AXIS]);
+      set_volume_separations(out_vol[o], &info.steps[Z_AXIS]);
+      alloc_volume_data(out_vol[o]);
+
+      info.out[o] = (float *)malloc(SLAB_SLICES * nvoxels * sizeof(float));
+
+      switch (o){
+      case TRACE:
+      case DETERMINANT:
+         out_real_min[o] = -1.0;
+         out_real_max[o] = 1.0;
+         break;
+
+      default:
+         out_real_min[o] = 0.0;
+         out_real_max[o] = 1.0;
+         break;
+         }
+      }
 
    /* start to do some stuff */
-   initialize_progress_report(&progress, FALSE, sizes[2] - 2, "Blobberising");
-   for(z = 1; z < sizes[1] - 1; z++){
-      for(y = 1; y < sizes[2] - 1; y++){
-         for(x = 1; x < sizes[3] - 1; x++){
-
-            switch (operation){
-            default:
-            case NO_OP:
-               fprintf(stderr, "%s: GNARKLE! this shouldn't happen!\n\n", argv[0]);
-               exit(EXIT_FAILURE);
-               break;
-
-            case TRACE:
-               value =
-                  ((get_volume_real_value(in_vol, 0, z, y, x + 1, 0) -
-                    get_volume_real_value(in_vol, 0, z, y, x - 1, 0)) / (steps[3] * 2))
-                  +
-                  ((get_volume_real_value(in_vol, 1, z, y + 1, x, 0) -
-                    get_volume_real_value(in_vol, 1, z, y - 1, x, 0)) / (steps[2] * 2))
-                  +
-                  ((get_volume_real_value(in_vol, 2, z + 1, y, x, 0) -
-                    get_volume_real_value(in_vol, 2, z - 1, y, x, 0)) / (steps[1] * 2));
-               break;
-
-            case DETERMINANT:
+   initialize_progress_report(&progress, FALSE, info.sizes[Z_AXIS], "Blobberising");
+   for(slab_first = 0; slab_first < info.sizes[Z_AXIS]; slab_first += SLAB_SLICES){
+      slab_last = slab_first + SLAB_SLICES;
+      if(slab_last > info.sizes[Z_AXIS]){
+         slab_last = info.sizes[Z_AXIS];
+         }
+
+      /* read the slab with a slice either side (if there is one) */
+      read_first = (slab_first > 0) ? slab_first - 1 : 0;
+      read_last = (slab_last < info.sizes[Z_AXIS]) ? slab_last + 1 : slab_last;
+      start[file_axis[Z_AXIS]] = read_first;
+      count[file_axis[Z_AXIS]] = read_last - read_first;
+      (void)miicv_get(icvid, start, count, info.data);
+
+      /* strides of the slab in file order */
+      for(a = 0; a < N_AXES; a++){
+         info.stride[a] = 1;
+         for(i = file_axis[a] + 1; i < ndims; i++){
+            info.stride[a] *= count[i];
+            }
+         }
+
+      info.data_start = read_first;
+      info.out_start = slab_first;
+      run_blob_slices(&info, slab_first, slab_last);
+
+      /* copy the results to the output volumes */
+      for(o = TRACE; o < N_OPS; o++){
+         if(info.out[o] == NULL){
+            continue;
+            }
+
+         idx = 0;
+         for(z = slab_first; z < slab_last; z++){
+            for(y = 0; y < info.sizes[Y_AXIS]; y++){
+               for(x = 0; x < info.sizes[X_AXIS]; x++){
+                  value = info.out[o][idx++];
+                  set_volume_real_value(out_vol[o], z, y, x, 0, 0, value);
+
+                  /* check the min and max */
+                  if(value < out_real_min[o]){
+                     out_real_min[o] = value;
+                     }
+                  else if(value > out_real_max[o]){
+                     out_real_max[o] = value;
+                     }
+                  }
+               }
+            }
+         }
+      update_progress_report(&progress, slab_last);
+      }
+   terminate_progress_report(&progress);
+   (void)miicv_free(icvid);
+   (void)miclose(mincid);
+   free(info.data);
+
+   /* write out the results */
+   for(o = TRACE; o < N_OPS; o++){
+      if(info.out[o] == NULL){
+         continue;
+         }
+
+      if(verbose){
+         fprintf(stdout, "%s: Found %s range of [%g:%g]\n", argv[0], op_names[o],
+                 out_real_min[o], out_real_max[o]);
+         }
+      set_volume_real_range(out_vol[o], out_real_min[o], out_real_max[o]);
+      output_volume(outfiles[o], datatype, signed_flag, 0.0, 0.0, out_vol[o],
+                    arg_string, NULL);
+
+      delete_volume(out_vol[o]);
+      free(info.out[o]);
+      }
+
+   return (EXIT_SUCCESS);
+   }
+
+/* get the start and step of a spatial dimension (0 and 1 if not set) */
+void get_dim_geometry(int mincid, char *dimname, double *start, double *step)
+{
+   int      varid;
+
+   *start = 0.0;
+   *step = 1.0;
+
+   ncopts = 0;
+   varid = ncvarid(mincid, dimname);
+   if(varid != MI_ERROR){
+      (void)miattget1(mincid, varid, MIstart, NC_DOUBLE, start);
+      (void)miattget1(mincid, varid, MIstep, NC_DOUBLE, step);
+      if(*step == 0.0){
+         *step = 1.0;
+         }
+      }
+   ncopts = NC_VERBOSE | NC_FATAL;
+   }
+
+/* compute all of the wanted outputs for slices [first, last) of a    */
+/* slab. Voxels on the edge of the volume have no neighbours and are 0 */
+void blob_slices(Blob_Info * info, int first, int last)
+{
+   int      x, y, z, o;
+   long     idx;
+   long     sv = info->stride[VEC_AXIS];
+   long     sz = info->stride[Z_AXIS];
+   long     sy = info->stride[Y_AXIS];
+   long     sx = info->stride[X_AXIS];
+   double  *p;
+   double   value[N_OPS];
+
+   /* partial derivatives of each component along x, y and z */
+   double   D[3][3];
+
+   /* Jacobian matrix */
+   double   J[3][3];
+
+/* vector component c of the neighbour (dz, dy, dx) of the current voxel */
+#define VEC(c, dz, dy, dx) p[(c) * sv + (dz) * sz + (dy) * sy + (dx) * sx]
+
+   for(z = first; z < last; z++){
+      idx = (long)(z - info->out_start) * info->sizes[Y_AXIS] * info->sizes[X_AXIS];
+      for(y = 0; y < info->sizes[Y_AXIS]; y++){
+         for(x = 0; x < info->sizes[X_AXIS]; x++, idx++){
+
+            if(z == 0 || z == info->sizes[Z_AXIS] - 1 ||
+               y == 0 || y == info->sizes[Y_AXIS] - 1 ||
+               x == 0 || x == info->sizes[X_AXIS] - 1){
+               for(o = TRACE; o < N_OPS; o++){
+                  if(info->out[o] != NULL){
+                     info->out[o][idx] = 0.0;
+                     }
+                  }
+               continue;
+               }
+
+            p = &info->data[(z - info->data_start) * sz + y * sy + x * sx];
+
+            /* derivatives needed for the trace and determinant */
+            if(info->out[TRACE] != NULL || info->out[DETERMINANT] != NULL){
+               D[0][0] = (VEC(0, 0, 0, 1) - VEC(0, 0, 0, -1)) / (info->steps[X_AXIS] * 2);
+               D[1][1] = (VEC(1, 0, 1, 0) - VEC(1, 0, -1, 0)) / (info->steps[Y_AXIS] * 2);
+               D[2][2] = (VEC(2, 1, 0, 0) - VEC(2, -1, 0, 0)) / (info->steps[Z_AXIS] * 2);
+               value[TRACE] = D[0][0] + D[1][1] + D[2][2];
+               }
+
+            if(info->out[DETERMINANT] != NULL){
+               D[0][1] = (VEC(0, 0, 1, 0) - VEC(0, 0, -1, 0)) / (info->steps[Y_AXIS] * 2);
+               D[0][2] = (VEC(0, 1, 0, 0) - VEC(0, -1, 0, 0)) / (info->steps[Z_AXIS] * 2);
+               D[1][0] = (VEC(1, 0, 0, 1) - VEC(1, 0, 0, -1)) / (info->steps[X_AXIS] * 2);
+               D[1][2] = (VEC(1, 1, 0, 0) - VEC(1, -1, 0, 0)) / (info->steps[Z_AXIS] * 2);
+               D[2][0] = (VEC(2, 0, 0, 1) - VEC(2, 0, 0, -1)) / (info->steps[X_AXIS] * 2);
+               D[2][1] = (VEC(2, 0, 1, 0) - VEC(2, 0, -1, 0)) / (info->steps[Y_AXIS] * 2);
+
                /* compute the Jacobian matrix */
-               J[0][0] = 1 + ((get_volume_real_value(in_vol, 0, z, y, x + 1, 0) -
-                               get_volume_real_value(in_vol, 0, z, y, x - 1,
-                                                     0)) / (steps[3] * 2));
-               J[0][1] =
-                  (get_volume_real_value(in_vol, 0, z, y + 1, x, 0) -
-                   get_volume_real_value(in_vol, 0, z, y - 1, x, 0)) / (steps[2] * 2);
-               J[0][2] =
-                  (get_volume_real_value(in_vol, 0, z + 1, y, x, 0) -
-                   get_volume_real_value(in_vol, 0, z - 1, y, x, 0)) / (steps[1] * 2);
-
-               J[1][0] = (get_volume_real_value(in_vol, 1, z, y, x + 1, 0) -
-                          get_volume_real_value(in_vol, 1, z, y, x - 1,
-                                                0)) / (steps[3] * 2);
-               J[1][1] =
-                  1 +
-                  ((get_volume_real_value(in_vol, 1, z, y + 1, x, 0) -
-                    get_volume_real_value(in_vol, 1, z, y - 1, x, 0)) / (steps[2] * 2));
-               J[1][2] =
-                  (get_volume_real_value(in_vol, 1, z + 1, y, x, 0) -
-                   get_volume_real_value(in_vol, 1, z - 1, y, x, 0)) / (steps[1] * 2);
-
-               J[2][0] = (get_volume_real_value(in_vol, 2, z, y, x + 1, 0) -
-                          get_volume_real_value(in_vol, 2, z, y, x - 1,
-                                                0)) / (steps[3] * 2);
-               J[2][1] =
-                  (get_volume_real_value(in_vol, 2, z, y + 1, x, 0) -
-                   get_volume_real_value(in_vol, 2, z, y - 1, x, 0)) / (steps[2] * 2);
-               J[2][2] =
-                  1 +
-                  ((get_volume_real_value(in_vol, 2, z + 1, y, x, 0) -
-                    get_volume_real_value(in_vol, 2, z - 1, y, x, 0)) / (steps[1] * 2));
-
-               value = (J[0][0] * ((J[1][1] * J[2][2]) - (J[1][2] * J[2][1])) -
-                        J[0][1] * ((J[1][0] * J[2][2]) - (J[1][2] * J[2][0])) +
-                        J[0][2] * ((J[1][0] * J[2][1]) - (J[1][1] * J[2][0]))
+               J[0][0] = 1 + D[0][0];
+               J[0][1] = D[0][1];
+               J[0][2] = D[0][2];
+               J[1][0] = D[1][0];
+               J[1][1] = 1 + D[1][1];
+               J[1][2] = D[1][2];
+               J[2][0] = D[2][0];
+               J[2][1] = D[2][1];
+               J[2][2] = 1 + D[2][2];
+
+               value[DETERMINANT] = (J[0][0] * ((J[1][1] * J[2][2]) - (J[1][2] * J[2][1])) -
+                                     J[0][1] * ((J[1][0] * J[2][2]) - (J[1][2] * J[2][0])) +
+                                     J[0][2] * ((J[1][0] * J[2][1]) - (J[1][1] * J[2][0]))
                   ) - 1;
-               break;
-
-            case TRANSLATION:
-               value = (
-                          /* x direction */
-                          cindex(get_volume_real_value(in_vol, 0, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 1, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 2, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 0, z, y, x - 1, 0),
-                                 get_volume_real_value(in_vol, 1, z, y, x - 1, 0),
-                                 get_volume_real_value(in_vol, 2, z, y, x - 1, 0))
-                          +
-                          cindex(get_volume_real_value(in_vol, 0, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 1, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 2, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 0, z, y, x + 1, 0),
-                                 get_volume_real_value(in_vol, 1, z, y, x + 1, 0),
-                                 get_volume_real_value(in_vol, 2, z, y, x + 1, 0))
-                          +
-                          /* y direction */
-                          cindex(get_volume_real_value(in_vol, 0, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 1, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 2, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 0, z, y - 1, x, 0),
-                                 get_volume_real_value(in_vol, 1, z, y - 1, x, 0),
-                                 get_volume_real_value(in_vol, 2, z, y - 1, x, 0))
-                          +
-                          cindex(get_volume_real_value(in_vol, 0, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 1, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 2, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 0, z, y + 1, x, 0),
-                                 get_volume_real_value(in_vol, 1, z, y + 1, x, 0),
-                                 get_volume_real_value(in_vol, 2, z, y + 1, x, 0))
-                          +
-                          /* z direction */
-                          cindex(get_volume_real_value(in_vol, 0, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 1, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 2, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 0, z - 1, y, x, 0),
-                                 get_volume_real_value(in_vol, 1, z - 1, y, x, 0),
-                                 get_volume_real_value(in_vol, 2, z - 1, y, x, 0))
-                          +
-                          cindex(get_volume_real_value(in_vol, 0, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 1, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 2, z, y, x, 0),
-                                 get_volume_real_value(in_vol, 0, z + 1, y, x, 0),
-                                 get_volume_real_value(in_vol, 1, z + 1, y, x, 0),
-                                 get_volume_real_value(in_vol, 2, z + 1, y, x, 0))
-                  ) / 6;
-               break;
-
-            case MAGNITUDE:
-               value =
-                  sqrt((get_volume_real_value(in_vol, 0, z, y, x, 0) *
-                        get_volume_real_value(in_vol, 0, z, y, x, 0)) +
-                       (get_volume_real_value(in_vol, 1, z, y, x, 0) *
-                        get_volume_real_value(in_vol, 1, z, y, x, 0)) +
-                       (get_volume_real_value(in_vol, 2, z, y, x, 0) *
-                        get_volume_real_value(in_vol, 2, z, y, x, 0)));
-               break;
                }
 
-            set_volume_real_value(out_vol, z, y, x, 0, 0, value);
+            if(info->out[TRANSLATION] != NULL){
+               value[TRANSLATION] = (
+                                       /* x direction */
+                                       cindex(VEC(0, 0, 0, 0), VEC(1, 0, 0, 0), VEC(2, 0, 0, 0),
+                                              VEC(0, 0, 0, -1), VEC(1, 0, 0, -1), VEC(2, 0, 0, -1))
+                                       +
+                                       cindex(VEC(0, 0, 0, 0), VEC(1, 0, 0, 0), VEC(2, 0, 0, 0),
+                                              VEC(0, 0, 0, 1), VEC(1, 0, 0, 1), VEC(2, 0, 0, 1))
+                                       +
+                                       /* y direction */
+                                       cindex(VEC(0, 0, 0, 0), VEC(1, 0, 0, 0), VEC(2, 0, 0, 0),
+                                              VEC(0, 0, -1, 0), VEC(1, 0, -1, 0), VEC(2, 0, -1, 0))
+                                       +
+                                       cindex(VEC(0, 0, 0, 0), VEC(1, 0, 0, 0), VEC(2, 0, 0, 0),
+                                              VEC(0, 0, 1, 0), VEC(1, 0, 1, 0), VEC(2, 0, 1, 0))
+                                       +
+                                       /* z direction */
+                                       cindex(VEC(0, 0, 0, 0), VEC(1, 0, 0, 0), VEC(2, 0, 0, 0),
+                                              VEC(0, -1, 0, 0), VEC(1, -1, 0, 0), VEC(2, -1, 0, 0))
+                                       +
+                                       cindex(VEC(0, 0, 0, 0), VEC(1, 0, 0, 0), VEC(2, 0, 0, 0),
+                                              VEC(0, 1, 0, 0), VEC(1, 1, 0, 0), VEC(2, 1, 0, 0))
+                  ) / 6;
+               }
 
-            /* check the min and max */
-            if(value < out_real_min){
-               out_real_min = value;
+            if(info->out[MAGNITUDE] != NULL){
+               value[MAGNITUDE] = feuc(VEC(0, 0, 0, 0), VEC(1, 0, 0, 0), VEC(2, 0, 0, 0));
                }
-            else if(value > out_real_max){
-               out_real_max = value;
+
+            for(o = TRACE; o < N_OPS; o++){
+               if(info->out[o] != NULL){
+                  info->out[o][idx] = value[o];
+                  }
                }
             }
          }
-      update_progress_report(&progress, z + 1);
       }
-   terminate_progress_report(&progress);
 
-   if(verbose){
-      fprintf(stdout, "%s: Found output range of [%g:%g]\n", argv[0], out_real_min,
-              out_real_max);
+#undef VEC
+   }
+
+#ifdef HAVE_PTHREAD
+static void *blob_thread(void *arg)
+{
+   Blob_Range *range = (Blob_Range *) arg;
+
+   blob_slices(range->info, range->first, range->last);
+   return (NULL);
+   }
+#endif
+
+/* compute slices [first, last) of a slab, split between the threads */
+void run_blob_slices(Blob_Info * info, int first, int last)
+{
+#ifdef HAVE_PTHREAD
+   int      i, n;
+   pthread_t *threads;
+   Blob_Range *ranges;
+
+   n = (nthreads < last - first) ? nthreads : last - first;
+   if(n > 1){
+      threads = (pthread_t *) malloc(n * sizeof(pthread_t));
+      ranges = (Blob_Range *) malloc(n * sizeof(Blob_Range));
+      for(i = 0; i < n; i++){
+         ranges[i].info = info;
+         ranges[i].first = first + (last - first) * i / n;
+         ranges[i].last = first + (last - first) * (i + 1) / n;
+         if(pthread_create(&threads[i], NULL, blob_thread, &ranges[i]) != 0){
+            fprintf(stderr, "run_blob_slices(): could not create thread\n");
+            exit(EXIT_FAILURE);
+            }
+         }
+      for(i = 0; i < n; i++){
+         pthread_join(threads[i], NULL);
+         }
+      free(threads);
+      free(ranges);
+      return;
       }
-   set_volume_real_range(out_vol, out_real_min, out_real_max);
-   output_volume(outfile, datatype, signed_flag, 0.0, 0.0, out_vol, arg_string, NULL);
-   return (EXIT_SUCCESS);
+#endif
+
+   blob_slices(info, first, last);
    }
 
 double fdiv(double num, double denom)
@@ -355,52 +568,6 @@ double cindex(double a0, double b0, double c0, double a1, double b1, double c1)
       * exp(-1.0 * (fabs(feuc(a0, b0, c0) - feuc(a1, b1, c1))));
    }
 
-/* steve's super-dooper padding function(s) */
-void clear_borders(VIO_Volume v, int sizes[3])
-{
-   fill_slice0(v, 0, 0, sizes[1], sizes[2]);
-   fill_slice0(v, 0, sizes[0] - 1, sizes[1], sizes[2]);
-
-   fill_slice1(v, 0, sizes[0], 0, sizes[2]);
-   fill_slice1(v, 0, sizes[0], sizes[1] - 1, sizes[2]);
-
-   fill_slice2(v, 0, sizes[0], sizes[1], 0);
-   fill_slice2(v, 0, sizes[0], sizes[1], sizes[2] - 1);
-   }
-
-void fill_slice0(VIO_Volume v, VIO_Real value, int v0, int v1_size, int v2_size)
-{
-   int      v1, v2;
-
-   for(v1 = 0; v1 < v1_size; ++v1){
-      for(v2 = 0; v2 < v2_size; ++v2){
-         set_volume_real_value(v, v0, v1, v2, 0, 0, value);
-         }
-      }
-   }
-
-void fill_slice1(VIO_Volume v, VIO_Real value, int v0_size, int v1, int v2_size)
-{
-   int      v0, v2;
-
-   for(v0 = 0; v0 < v0_size; ++v0){
-      for(v2 = 0; v2 < v2_size; ++v2){
-         set_volume_real_value(v, v0, v1, v2, 0, 0, value);
-         }
-      }
-   }
-
-void fill_slice2(VIO_Volume v, VIO_Real value, int v0_size, int v1_size, int v2)
-{
-   int      v0, v1;
-
-   for(v0 = 0; v0 < v0_size; ++v0){
-      for(v1 = 0; v1 < v1_size; ++v1){
-         set_volume_real_value(v, v0, v1, v2, 0, 0, value);
-         }
-      }
-   }
-
 void print_version_info(void)
 {
    fprintf(stdout, "%s version %s\n", PACKAGE_STRING, PACKAGE_VERSION);
@@ -0,0 +1,1267 @@
+/* Copyright David Leonard & Andrew Janke, 2000. All rights reserved. */
+
+/* Compile an expression tree into a flat program for a register machine.
+
+   Every scalar value lives in a register holding one value per voxel of
+   the evaluation width, and a vector is simply a list of registers whose
+   length is known when the expression is compiled. Each instruction is
+   executed as a single loop over the width, so there is no recursion, no
+   allocation and no reference counting while voxels are processed. The
+   program itself is never modified when it runs, so any number of
+   machines (sets of registers) can run it at once.
+
+   If and for are handled with masks of the voxels that take a branch,
+   and a branch that no voxel takes is jumped over. Values that are known
+   when compiling (constants, vector lengths, elements picked out by known
+   indices) are worked out here, once. Expressions whose vector lengths
+   depend on the data cannot be compiled and are left to eval_scalar, as
+   are expressions in error, so that the errors are reported as before. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include "node.h"
+
+#ifndef TRUE
+#  define TRUE 1
+#endif
+
+#ifndef FALSE
+#  define FALSE 0
+#endif
+
+#define INVALID_VALUE -DBL_MAX
+
+/* No mask - the instruction applies to every voxel */
+#define NO_MASK (-1)
+
+/* Give up on expressions that would compile to something this big */
+#define MAX_REGISTERS 100000
+#define MAX_INSTRUCTIONS 1000000
+#define MAX_RANGE_LENGTH 10000
+
+extern int propagate_nan;
+extern double value_for_illegal_operations;
+
+enum opcode {
+   OP_ARITH,         /* dst = type(a, b, c), all scalar arguments */
+   OP_REDUCE,        /* dst = type(list) for sum, prod, avg, max, ... */
+   OP_INDEX,         /* dst = list[a] */
+   OP_COPY,          /* dst = a */
+   OP_SPLIT,         /* masks dst = (a is true), b = (a is false) */
+   OP_SKIP,          /* jump to target if mask is empty */
+   OP_MERGE,         /* dst = (a invalid ? illegal : a ? b : c) */
+   OP_LOOP_START,    /* counter[n] = 0 */
+   OP_LOOP_SET,      /* dst = list[counter[n]] */
+   OP_LOOP_END       /* if (++counter[n] < len) jump to target */
+};
+
+/* Operations that store values only store them for voxels in the
+   instruction mask. The others are done for every voxel - the values
+   outside the mask are never used. */
+typedef struct {
+   enum opcode op;
+   enum nodetype type;
+   int dst, a, b, c;
+   int mask;
+   int n;
+   int len;
+   int *list;
+   int target;
+   node_t node;
+} instr_t;
+
+enum regkind { REG_TEMP, REG_CONST, REG_VAR };
+
+struct program {
+   instr_t *code;
+   int ncode, maxcode;
+   int nregs, maxregs;
+   enum regkind *kind;
+   double *constval;
+   int nmasks;
+   int *mask_parent;
+   int ncounters;
+   int maxlist;
+   int ninputs;
+   int *inputs;
+   int noutputs;
+   int *outputs;
+};
+
+struct machine {
+   program_t prog;
+   int width;
+   double *block;
+   double **reg;
+   unsigned char *mask_block;
+   unsigned char **mask;
+   int *counter;
+   double *scratch;
+   double **src;
+};
+
+/* A list of registers making up a vector */
+typedef struct {
+   int len;
+   int *regs;
+} reglist_t;
+
+/* What is known about a symbol while compiling */
+typedef struct {
+   ident_t ident;
+   int is_scalar;
+   reglist_t value;
+   int assigned;        /* Assigned somewhere in the expression */
+   int known;           /* Scalar value known when compiling ... */
+   double known_value;
+   int known_mask;      /* ... for the voxels in this mask */
+} binding_t;
+
+/* Compilation state */
+static program_t Prog;
+static binding_t *Bindings;
+static int Nbindings;
+static ident_t *Assigned;
+static int Nassigned;
+static int Cur_mask;
+static int Loop_depth;
+static int Compile_failed;
+
+static int compile_scalar(node_t n);
+static reglist_t compile_vector(node_t n);
+static void exec_arith(enum nodetype type, int width, double *r,
+                       double *a, double *b, double *c);
+
+/* Note that the expression cannot be compiled. Nothing is reported -
+   the expression will be evaluated from the tree instead. */
+static void fail(void){
+   Compile_failed = TRUE;
+}
+
+static int new_register(enum regkind kind){
+   if (Prog->nregs >= MAX_REGISTERS) {
+      fail();
+      return 0;
+   }
+   if (Prog->nregs >= Prog->maxregs) {
+      Prog->maxregs = 2 * Prog->maxregs + 64;
+      Prog->kind = realloc(Prog->kind, Prog->maxregs * sizeof(*Prog->kind));
+      Prog->constval = realloc(Prog->constval,
+                               Prog->maxregs * sizeof(*Prog->constval));
+   }
+   Prog->kind[Prog->nregs] = kind;
+   Prog->constval[Prog->nregs] = 0.0;
+   return Prog->nregs++;
+}
+
+static int const_register(double value){
+   int reg;
+
+   for (reg=0; reg < Prog->nregs; reg++) {
+      if (Prog->kind[reg] == REG_CONST &&
+          memcmp(&Prog->constval[reg], &value, sizeof(value)) == 0)
+         return reg;
+   }
+   reg = new_register(REG_CONST);
+   Prog->constval[reg] = value;
+   return reg;
+}
+
+static int is_const(int reg){
+   return (Prog->kind[reg] == REG_CONST);
+}
+
+static int new_mask(void){
+   Prog->mask_parent = realloc(Prog->mask_parent,
+                               (Prog->nmasks+1) * sizeof(int));
+   Prog->mask_parent[Prog->nmasks] = Cur_mask;
+   return Prog->nmasks++;
+}
+
+/* Is mask inner the same as mask outer or nested inside it? */
+static int mask_within(int inner, int outer){
+   while (inner != NO_MASK) {
+      if (inner == outer) return TRUE;
+      inner = Prog->mask_parent[inner];
+   }
+   return (outer == NO_MASK);
+}
+
+static reglist_t new_list(int len){
+   reglist_t l;
+
+   l.len = len;
+   l.regs = malloc((len > 0 ? len : 1) * sizeof(*l.regs));
+   return l;
+}
+
+/* Copy of a register list for an instruction */
+static int *instr_list(reglist_t l){
+   int *list;
+
+   list = malloc((l.len > 0 ? l.len : 1) * sizeof(*list));
+   if (l.len > 0)
+      (void) memcpy(list, l.regs, l.len * sizeof(*list));
+   if (l.len > Prog->maxlist) Prog->maxlist = l.len;
+   return list;
+}
+
+static instr_t *emit(enum opcode op, node_t n){
+   instr_t *ip;
+
+   if (Prog->ncode >= MAX_INSTRUCTIONS)
+      fail();
+   if (Prog->ncode >= Prog->maxcode) {
+      Prog->maxcode = 2 * Prog->maxcode + 64;
+      Prog->code = realloc(Prog->code, Prog->maxcode * sizeof(*Prog->code));
+   }
+   ip = &Prog->code[Prog->ncode++];
+   (void) memset(ip, 0, sizeof(*ip));
+   ip->op = op;
+   ip->node = n;
+   ip->mask = Cur_mask;
+   ip->dst = ip->a = ip->b = ip->c = -1;
+   return ip;
+}
+
+static binding_t *lookup_binding(ident_t id){
+   int i;
+
+   for (i=0; i < Nbindings; i++) {
+      if (Bindings[i].ident == id) return &Bindings[i];
+   }
+   return NULL;
+}
+
+static binding_t *new_binding(ident_t id, int is_scalar, int len){
+   binding_t *b;
+   int i;
+
+   Bindings = realloc(Bindings, (Nbindings+1) * sizeof(*Bindings));
+   b = &Bindings[Nbindings++];
+   b->ident = id;
+   b->is_scalar = is_scalar;
+   b->value = new_list(len);
+   for (i=0; i < len; i++)
+      b->value.regs[i] = new_register(REG_VAR);
+   b->assigned = FALSE;
+   for (i=0; i < Nassigned; i++) {
+      if (Assigned[i] == id) b->assigned = TRUE;
+   }
+   b->known = FALSE;
+   return b;
+}
+
+/* Scalar symbol for a loop variable, created if necessary */
+static binding_t *loop_binding(ident_t id){
+   binding_t *b;
+
+   b = lookup_binding(id);
+   if (b == NULL)
+      b = new_binding(id, TRUE, 1);
+   if (!b->is_scalar || b->value.len != 1) {
+      fail();
+      return NULL;
+   }
+   return b;
+}
+
+/* Find the symbols that are assigned anywhere below n. Either add them
+   to the Assigned list or forget what is known about their values. */
+static void scan_assignments(node_t n, int forget){
+   binding_t *b;
+   int i;
+
+   switch (n->type) {
+   case NODETYPE_ASSIGN:
+   case NODETYPE_LET:
+   case NODETYPE_GEN:
+   case NODETYPE_FOR:
+      if (forget) {
+         b = lookup_binding(n->ident);
+         if (b != NULL) b->known = FALSE;
+      }
+      else {
+         Assigned = realloc(Assigned, (Nassigned+1) * sizeof(*Assigned));
+         Assigned[Nassigned++] = n->ident;
+      }
+      break;
+   case NODETYPE_IDENT:
+   case NODETYPE_REAL:
+      return;
+   default:
+      break;
+   }
+   for (i=0; i < n->numargs; i++)
+      scan_assignments(n->expr[i], forget);
+}
+
+/* Assign a value to a symbol. Vector symbols cannot change length in
+   an if or a loop, since the length would then depend on the data. */
+static void assign_symbol(node_t n, ident_t id, reglist_t value,
+                          int is_scalar){
+   binding_t *b;
+   reglist_t src;
+   instr_t *ip;
+   int i, j;
+
+   if (Compile_failed) return;
+   b = lookup_binding(id);
+   if (b == NULL)
+      b = new_binding(id, is_scalar, value.len);
+   if (b->is_scalar != is_scalar) {
+      fail();
+      return;
+   }
+   if (b->value.len != value.len) {
+      if (Cur_mask != NO_MASK || Loop_depth > 0) {
+         fail();
+         return;
+      }
+      free(b->value.regs);
+      b->value = new_list(value.len);
+      for (i=0; i < value.len; i++)
+         b->value.regs[i] = new_register(REG_VAR);
+   }
+
+   /* The elements are copied one at a time, so an element of the
+      symbol that is also to be copied elsewhere must be saved first */
+   src = new_list(value.len);
+   for (i=0; i < value.len; i++) {
+      src.regs[i] = value.regs[i];
+      for (j=0; j < value.len; j++) {
+         if (j != i && value.regs[i] == b->value.regs[j]) {
+            ip = emit(OP_COPY, n);
+            ip->dst = src.regs[i] = new_register(REG_TEMP);
+            ip->a = value.regs[i];
+            ip->mask = NO_MASK;
+            break;
+         }
+      }
+   }
+   for (i=0; i < value.len; i++) {
+      if (src.regs[i] == b->value.regs[i]) continue;
+      ip = emit(OP_COPY, n);
+      ip->dst = b->value.regs[i];
+      ip->a = src.regs[i];
+   }
+   free(src.regs);
+
+   b->known = (is_scalar && is_const(value.regs[0]));
+   if (b->known) {
+      b->known_value = Prog->constval[value.regs[0]];
+      b->known_mask = Cur_mask;
+   }
+}
+
+/* A register of a symbol that is assigned somewhere may change before
+   a value taken from it is used, so such values are copied out */
+static int stable_register(node_t n, int reg){
+   instr_t *ip;
+   int i, j;
+
+   if (Prog->kind[reg] != REG_VAR) return reg;
+   for (i=0; i < Nbindings; i++) {
+      if (!Bindings[i].assigned) continue;
+      for (j=0; j < Bindings[i].value.len; j++) {
+         if (Bindings[i].value.regs[j] == reg) {
+            ip = emit(OP_COPY, n);
+            ip->dst = new_register(REG_TEMP);
+            ip->a = reg;
+            ip->mask = NO_MASK;
+            return ip->dst;
+         }
+      }
+   }
+   return reg;
+}
+
+/* Value of a scalar operation on constants */
+static int fold_arith(enum nodetype type, int nargs, int args[]){
+   double vals[3], result;
+   int iarg;
+
+   for (iarg=0; iarg < 3; iarg++)
+      vals[iarg] = Prog->constval[args[iarg < nargs ? iarg : 0]];
+   exec_arith(type, 1, &result, &vals[0], &vals[1], &vals[2]);
+   return const_register(result);
+}
+
+/* Compile the two parts of an if whose condition is in register cond.
+   The results are returned in then_part and else_part (else_part is
+   empty if there is no else). */
+static void compile_branches(node_t n, int cond, int is_scalar,
+                             reglist_t *then_part, reglist_t *else_part){
+   instr_t *split, *skip;
+   int parent, then_mask, else_mask;
+
+   parent = Cur_mask;
+   then_mask = new_mask();
+   else_mask = new_mask();
+   split = emit(OP_SPLIT, n);
+   split->a = cond;
+   split->dst = then_mask;
+   split->b = else_mask;
+
+   Cur_mask = then_mask;
+   skip = emit(OP_SKIP, n);
+   if (is_scalar) {
+      *then_part = new_list(1);
+      then_part->regs[0] = compile_scalar(n->expr[1]);
+   }
+   else {
+      *then_part = compile_vector(n->expr[1]);
+   }
+   skip->target = Prog->ncode;
+
+   *else_part = new_list(0);
+   if (n->numargs > 2) {
+      free(else_part->regs);
+      Cur_mask = else_mask;
+      skip = emit(OP_SKIP, n);
+      if (is_scalar) {
+         *else_part = new_list(1);
+         else_part->regs[0] = compile_scalar(n->expr[2]);
+      }
+      else {
+         *else_part = compile_vector(n->expr[2]);
+      }
+      skip->target = Prog->ncode;
+   }
+
+   Cur_mask = parent;
+}
+
+/* Combine the parts of an if element by element */
+static reglist_t merge_branches(node_t n, int cond,
+                                reglist_t then_part, reglist_t else_part){
+   reglist_t v;
+   instr_t *ip;
+   int iel;
+
+   if (n->numargs > 2 && then_part.len != else_part.len) {
+      fail();
+      then_part.len = 0;
+   }
+   v = new_list(then_part.len);
+   for (iel=0; iel < v.len; iel++) {
+      ip = emit(OP_MERGE, n);
+      ip->dst = v.regs[iel] = new_register(REG_TEMP);
+      ip->a = cond;
+      ip->b = then_part.regs[iel];
+      ip->c = (n->numargs > 2) ? else_part.regs[iel] : -1;
+   }
+   free(then_part.regs);
+   free(else_part.regs);
+   return v;
+}
+
+static int compile_reduce(node_t n){
+   reglist_t v;
+   instr_t *ip;
+   int reg;
+
+   v = compile_vector(n->expr[0]);
+   if (n->type == NODETYPE_LEN) {
+      reg = const_register((double) v.len);
+   }
+   else {
+      ip = emit(OP_REDUCE, n);
+      ip->type = n->type;
+      ip->dst = reg = new_register(REG_TEMP);
+      ip->len = v.len;
+      ip->list = instr_list(v);
+   }
+   free(v.regs);
+   return reg;
+}
+
+static int compile_index(node_t n){
+   reglist_t v;
+   instr_t *ip;
+   double index;
+   int reg, ireg;
+
+   v = compile_vector(n->expr[0]);
+   ireg = compile_scalar(n->expr[1]);
+   if (Compile_failed) {
+      free(v.regs);
+      return 0;
+   }
+
+   /* A known index picks out the element when compiling */
+   reg = 0;
+   if (is_const(ireg)) {
+      index = SCALAR_ROUND(Prog->constval[ireg]);
+      if (index >= 0.0 && index < (double) v.len)
+         reg = v.regs[(int) index];
+      else
+         fail();
+   }
+
+   else {
+      ip = emit(OP_INDEX, n);
+      ip->dst = reg = new_register(REG_TEMP);
+      ip->a = ireg;
+      ip->len = v.len;
+      ip->list = instr_list(v);
+   }
+   free(v.regs);
+   return reg;
+}
+
+/* A for loop runs the body compiled once, with the loop variable set
+   from the list of elements by a counter */
+static int compile_for(node_t n){
+   reglist_t els;
+   binding_t *b;
+   instr_t *ip;
+   int counter, top, var;
+
+   if (!ident_is_scalar(n->ident)) {
+      fail();
+      return 0;
+   }
+   els = compile_vector(n->expr[0]);
+   if (els.len > 0 && !Compile_failed) {
+      b = loop_binding(n->ident);
+      if (b == NULL) {
+         free(els.regs);
+         return 0;
+      }
+      var = b->value.regs[0];
+
+      /* Anything assigned in the body changes from one pass to the next */
+      b->known = FALSE;
+      scan_assignments(n->expr[1], TRUE);
+
+      counter = Prog->ncounters++;
+      ip = emit(OP_LOOP_START, n);
+      ip->n = counter;
+      top = Prog->ncode;
+      ip = emit(OP_LOOP_SET, n);
+      ip->dst = var;
+      ip->n = counter;
+      ip->len = els.len;
+      ip->list = instr_list(els);
+
+      Loop_depth++;
+      (void) compile_scalar(n->expr[1]);
+      Loop_depth--;
+
+      ip = emit(OP_LOOP_END, n);
+      ip->n = counter;
+      ip->len = els.len;
+      ip->target = top;
+   }
+   free(els.regs);
+
+   return const_register((double) els.len);
+}
+
+/* A generated vector is unrolled, giving one copy of the expression for
+   each element */
+static reglist_t compile_gen(node_t n){
+   reglist_t els, v, var;
+   int iel;
+
+   v = new_list(0);
+   if (!ident_is_scalar(n->ident)) {
+      fail();
+      return v;
+   }
+   els = compile_vector(n->expr[0]);
+   free(v.regs);
+   v = new_list(els.len);
+   var = new_list(1);
+   for (iel=0; iel < els.len && !Compile_failed; iel++) {
+      var.regs[0] = els.regs[iel];
+      assign_symbol(n, n->ident, var, TRUE);
+      v.regs[iel] = stable_register(n, compile_scalar(n->expr[1]));
+   }
+   free(var.regs);
+   free(els.regs);
+   if (Compile_failed) v.len = 0;
+   return v;
+}
+
+/* Ranges must have known ends */
+static reglist_t compile_range(node_t n){
+   reglist_t v;
+   double start, stop;
+   int sreg, ereg, length, iel;
+
+   sreg = compile_scalar(n->expr[0]);
+   ereg = compile_scalar(n->expr[1]);
+   if (Compile_failed || !is_const(sreg) || !is_const(ereg)) {
+      fail();
+      return new_list(0);
+   }
+   start = SCALAR_ROUND(Prog->constval[sreg]);
+   stop = SCALAR_ROUND(Prog->constval[ereg]);
+   if (!(n->flags & RANGE_EXACT_LOWER)) start++;
+   if (!(n->flags & RANGE_EXACT_UPPER)) stop--;
+   if (fabs(start) > INT_MAX/2 || fabs(stop) > INT_MAX/2 ||
+       stop - start >= MAX_RANGE_LENGTH) {
+      fail();
+      return new_list(0);
+   }
+   length = (int) (stop - start) + 1;
+   if (length < 0) length = 0;
+
+   v = new_list(length);
+   for (iel=0; iel < length; iel++)
+      v.regs[iel] = const_register(start + iel);
+   return v;
+}
+
+/* Compile an expression in a scalar context, returning the register
+   holding its value */
+static int compile_scalar(node_t n){
+   reglist_t v, then_part, else_part;
+   binding_t *b;
+   instr_t *ip;
+   double cval;
+   int args[3];
+   int iarg, all_const, reg, cond;
+
+   if (Compile_failed) return 0;
+   if (!node_is_scalar(n)) {
+      fail();
+      return 0;
+   }
+
+   if (n->flags & ALLARGS_SCALAR) {
+      if (n->numargs < 1 || n->numargs > 3) {
+         fail();
+         return 0;
+      }
+      all_const = TRUE;
+      for (iarg=0; iarg < n->numargs; iarg++) {
+         args[iarg] = compile_scalar(n->expr[iarg]);
+         if (Compile_failed) return 0;
+         if (!is_const(args[iarg])) all_const = FALSE;
+      }
+      if (all_const)
+         return fold_arith(n->type, n->numargs, args);
+      ip = emit(OP_ARITH, n);
+      ip->type = n->type;
+      ip->dst = new_register(REG_TEMP);
+      ip->a = args[0];
+      ip->b = (n->numargs > 1) ? args[1] : args[0];
+      ip->c = (n->numargs > 2) ? args[2] : args[0];
+      return ip->dst;
+   }
+
+   switch (n->type) {
+   case NODETYPE_EXPRLIST:
+      if (node_is_scalar(n->expr[0])) {
+         (void) compile_scalar(n->expr[0]);
+      }
+      else {
+         v = compile_vector(n->expr[0]);
+         free(v.regs);
+      }
+      return compile_scalar(n->expr[1]);
+
+   case NODETYPE_INDEX:
+      return compile_index(n);
+
+   case NODETYPE_SUM:
+   case NODETYPE_PROD:
+   case NODETYPE_AVG:
+   case NODETYPE_LEN:
+   case NODETYPE_MAX:
+   case NODETYPE_MIN:
+   case NODETYPE_IMAX:
+   case NODETYPE_IMIN:
+      return compile_reduce(n);
+
+   case NODETYPE_FOR:
+      return compile_for(n);
+
+   case NODETYPE_IDENT:
+      b = lookup_binding(n->ident);
+      if (b == NULL || !b->is_scalar || b->value.len != 1) {
+         fail();
+         return 0;
+      }
+      if (b->known && mask_within(Cur_mask, b->known_mask))
+         return const_register(b->known_value);
+      return b->value.regs[0];
+
+   case NODETYPE_REAL:
+      return const_register(n->real);
+
+   case NODETYPE_ASSIGN:
+      v = new_list(1);
+      v.regs[0] = compile_scalar(n->expr[0]);
+      assign_symbol(n, n->ident, v, TRUE);
+      reg = v.regs[0];
+      free(v.regs);
+      return reg;
+
+   case NODETYPE_LET:
+      if (ident_is_scalar(n->ident)) {
+         v = new_list(1);
+         v.regs[0] = compile_scalar(n->expr[0]);
+      }
+      else {
+         v = compile_vector(n->expr[0]);
+      }
+      assign_symbol(n, n->ident, v, ident_is_scalar(n->ident));
+      free(v.regs);
+      return compile_scalar(n->expr[1]);
+
+   case NODETYPE_IFELSE:
+      cond = compile_scalar(n->expr[0]);
+      if (Compile_failed) return 0;
+
+      /* Only one part of an if with a known condition is needed */
+      if (is_const(cond)) {
+         cval = Prog->constval[cond];
+         if (cval == INVALID_VALUE)
+            return const_register(value_for_illegal_operations);
+         else if (cval != 0.0)
+            return compile_scalar(n->expr[1]);
+         else if (n->numargs > 2)
+            return compile_scalar(n->expr[2]);
+         else
+            return const_register(0.0);
+      }
+
+      compile_branches(n, cond, TRUE, &then_part, &else_part);
+      if (Compile_failed) {
+         free(then_part.regs);
+         free(else_part.regs);
+         return 0;
+      }
+      v = merge_branches(n, cond, then_part, else_part);
+      reg = (v.len > 0) ? v.regs[0] : 0;
+      free(v.regs);
+      return reg;
+
+   default:
+      fail();
+      return 0;
+   }
+}
+
+/* Compile an expression in a vector context, returning the list of
+   registers holding its elements. The list must be freed by the
+   caller. */
+static reglist_t compile_vector(node_t n){
+   reglist_t v, then_part, else_part;
+   binding_t *b;
+   double cval;
+   int reg, cond;
+
+   if (Compile_failed) return new_list(0);
+   if (node_is_scalar(n)) {
+      fail();
+      return new_list(0);
+   }
+
+   switch (n->type) {
+   case NODETYPE_EXPRLIST:
+      if (node_is_scalar(n->expr[0])) {
+         (void) compile_scalar(n->expr[0]);
+      }
+      else {
+         v = compile_vector(n->expr[0]);
+         free(v.regs);
+      }
+      return compile_vector(n->expr[1]);
+
+   case NODETYPE_ASSIGN:
+      v = compile_vector(n->expr[0]);
+      assign_symbol(n, n->ident, v, FALSE);
+      return v;
+
+   case NODETYPE_VEC2:
+      v = compile_vector(n->expr[0]);
+      reg = compile_scalar(n->expr[1]);
+      v.regs = realloc(v.regs, (v.len + 1) * sizeof(*v.regs));
+      v.regs[v.len++] = reg;
+      return v;
+
+   case NODETYPE_VEC1:
+      v = new_list(1);
+      v.regs[0] = compile_scalar(n->expr[0]);
+      return v;
+
+   case NODETYPE_GEN:
+      return compile_gen(n);
+
+   case NODETYPE_RANGE:
+      return compile_range(n);
+
+   case NODETYPE_IFELSE:
+      cond = compile_scalar(n->expr[0]);
+      if (Compile_failed) return new_list(0);
+      if (is_const(cond)) {
+         cval = Prog->constval[cond];
+         if (cval == INVALID_VALUE) {
+            fail();
+            return new_list(0);
+         }
+         else if (cval != 0.0)
+            return compile_vector(n->expr[1]);
+         else if (n->numargs > 2)
+            return compile_vector(n->expr[2]);
+         else
+            return new_list(0);
+      }
+      compile_branches(n, cond, FALSE, &then_part, &else_part);
+      return merge_branches(n, cond, then_part, else_part);
+
+   case NODETYPE_IDENT:
+      b = lookup_binding(n->ident);
+      if (b == NULL || b->is_scalar) {
+         fail();
+         return new_list(0);
+      }
+      v = new_list(b->value.len);
+      if (v.len > 0)
+         (void) memcpy(v.regs, b->value.regs, v.len * sizeof(*v.regs));
+      return v;
+
+   default:
+      fail();
+      return new_list(0);
+   }
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : compile_program
+@INPUT      : root - expression tree
+              ninputs - number of elements of the input vector A
+              noutputs - number of symbols to write out (0 to write out
+                 the value of the expression)
+              outputs - identifiers of the symbols to write out
+@OUTPUT     : (none)
+@RETURNS    : Program, or NULL if the expression cannot be compiled
+@DESCRIPTION: Compiles an expression into a program for execute_program.
+@METHOD     :
+@GLOBALS    :
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+program_t compile_program(node_t root, int ninputs,
+                          int noutputs, ident_t outputs[]){
+   program_t prog;
+   binding_t *b;
+   int i, result;
+
+   Prog = prog = calloc(1, sizeof(*prog));
+   Bindings = NULL;
+   Nbindings = 0;
+   Assigned = NULL;
+   Nassigned = 0;
+   Cur_mask = NO_MASK;
+   Loop_depth = 0;
+   Compile_failed = FALSE;
+   scan_assignments(root, FALSE);
+
+   /* The input vector and the output symbols exist from the start */
+   b = new_binding(new_ident("A"), FALSE, ninputs);
+   prog->ninputs = ninputs;
+   prog->inputs = malloc((ninputs > 0 ? ninputs : 1) * sizeof(int));
+   for (i=0; i < ninputs; i++)
+      prog->inputs[i] = b->value.regs[i];
+   for (i=0; i < noutputs; i++) {
+      if (lookup_binding(outputs[i]) == NULL)
+         (void) new_binding(outputs[i], TRUE, 1);
+   }
+
+   result = compile_scalar(root);
+
+   /* Output symbols are scalars, which never move */
+   prog->noutputs = (noutputs > 0) ? noutputs : 1;
+   prog->outputs = malloc(prog->noutputs * sizeof(int));
+   if (noutputs == 0)
+      prog->outputs[0] = result;
+   for (i=0; i < noutputs; i++) {
+      b = lookup_binding(outputs[i]);
+      if (!b->is_scalar || b->value.len != 1)
+         fail();
+      else
+         prog->outputs[i] = b->value.regs[0];
+   }
+
+   for (i=0; i < Nbindings; i++)
+      free(Bindings[i].value.regs);
+   free(Bindings);
+   free(Assigned);
+   Prog = NULL;
+
+   if (Compile_failed) {
+      free_program(prog);
+      return NULL;
+   }
+   return prog;
+}
+
+void free_program(program_t prog){
+   int i;
+
+   for (i=0; i < prog->ncode; i++) {
+      if (prog->code[i].list != NULL) free(prog->code[i].list);
+   }
+   free(prog->code);
+   free(prog->kind);
+   free(prog->constval);
+   free(prog->mask_parent);
+   free(prog->inputs);
+   free(prog->outputs);
+   free(prog);
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : new_machine
+@INPUT      : prog - compiled program
+              width - largest number of voxels to evaluate at once
+@OUTPUT     : (none)
+@RETURNS    : Machine for running prog
+@DESCRIPTION: Allocates the registers needed to run a program. Each
+              thread running the program needs its own machine.
+@METHOD     :
+@GLOBALS    :
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+machine_t new_machine(program_t prog, int width){
+   machine_t m;
+   int reg, imask, ivalue;
+
+   m = malloc(sizeof(*m));
+   m->prog = prog;
+   m->width = width;
+   m->block = malloc((size_t) prog->nregs * width * sizeof(double));
+   m->reg = malloc((prog->nregs > 0 ? prog->nregs : 1) * sizeof(double *));
+   for (reg=0; reg < prog->nregs; reg++) {
+      m->reg[reg] = &m->block[(size_t) reg * width];
+      for (ivalue=0; ivalue < width; ivalue++)
+         m->reg[reg][ivalue] = prog->constval[reg];
+   }
+   m->mask_block = calloc((size_t) (prog->nmasks > 0 ? prog->nmasks : 1) *
+                          width, 1);
+   m->mask = malloc((prog->nmasks > 0 ? prog->nmasks : 1) *
+                    sizeof(unsigned char *));
+   for (imask=0; imask < prog->nmasks; imask++)
+      m->mask[imask] = &m->mask_block[(size_t) imask * width];
+   m->counter = calloc(prog->ncounters > 0 ? prog->ncounters : 1,
+                       sizeof(int));
+   m->scratch = malloc(2 * width * sizeof(double));
+   m->src = malloc((prog->maxlist > 0 ? prog->maxlist : 1) *
+                   sizeof(double *));
+   return m;
+}
+
+void free_machine(machine_t m){
+   free(m->block);
+   free(m->reg);
+   free(m->mask_block);
+   free(m->mask);
+   free(m->counter);
+   free(m->scratch);
+   free(m->src);
+   free(m);
+}
+
+/* Where to put the values of element i of the input vector */
+double *machine_input(machine_t m, int i){
+   return m->reg[m->prog->inputs[i]];
+}
+
+/* Where to find the values of output i after execute_program */
+double *machine_output(machine_t m, int i){
+   return m->reg[m->prog->outputs[i]];
+}
+
+/* Scalar operations. An invalid argument gives an invalid result. */
+static void exec_arith(enum nodetype type, int width, double *r,
+                       double *a, double *b, double *c){
+   double illegal = value_for_illegal_operations;
+   double x, y, z;
+   int i;
+
+#define UNARY_LOOP(expr) \
+   for (i=0; i < width; i++) { \
+      x = a[i]; \
+      r[i] = (x == INVALID_VALUE) ? INVALID_VALUE : (expr); \
+   } \
+   break
+
+#define BINARY_LOOP(expr) \
+   for (i=0; i < width; i++) { \
+      x = a[i]; y = b[i]; \
+      r[i] = (x == INVALID_VALUE || y == INVALID_VALUE) ? \
+         INVALID_VALUE : (expr); \
+   } \
+   break
+
+#define TERNARY_LOOP(expr) \
+   for (i=0; i < width; i++) { \
+      x = a[i]; y = b[i]; z = c[i]; \
+      r[i] = (x == INVALID_VALUE || y == INVALID_VALUE || \
+              z == INVALID_VALUE) ? INVALID_VALUE : (expr); \
+   } \
+   break
+
+   switch (type) {
+   case NODETYPE_ADD: BINARY_LOOP(x + y);
+   case NODETYPE_SUB: BINARY_LOOP(x - y);
+   case NODETYPE_MUL: BINARY_LOOP(x * y);
+   case NODETYPE_DIV: BINARY_LOOP((y == 0.0) ? illegal : x / y);
+   case NODETYPE_POW: BINARY_LOOP(pow(x, y));
+   case NODETYPE_LT:  BINARY_LOOP((double) (x < y));
+   case NODETYPE_LE:  BINARY_LOOP((double) (x <= y));
+   case NODETYPE_GT:  BINARY_LOOP((double) (x > y));
+   case NODETYPE_GE:  BINARY_LOOP((double) (x >= y));
+   case NODETYPE_EQ:  BINARY_LOOP((double) (x == y));
+   case NODETYPE_NE:  BINARY_LOOP((double) (x != y));
+   case NODETYPE_AND: BINARY_LOOP((double) ((x != 0.0) && (y != 0.0)));
+   case NODETYPE_OR:  BINARY_LOOP((double) ((x != 0.0) || (y != 0.0)));
+   case NODETYPE_NOT: UNARY_LOOP((double) (x == 0.0));
+   case NODETYPE_SQRT: UNARY_LOOP((x < 0.0) ? illegal : sqrt(x));
+   case NODETYPE_ABS: UNARY_LOOP(fabs(x));
+   case NODETYPE_EXP: UNARY_LOOP(exp(x));
+   case NODETYPE_LOG: UNARY_LOOP((x <= 0.0) ? illegal : log(x));
+   case NODETYPE_SIN: UNARY_LOOP(sin(x));
+   case NODETYPE_COS: UNARY_LOOP(cos(x));
+   case NODETYPE_TAN: UNARY_LOOP(tan(x));
+   case NODETYPE_ASIN: UNARY_LOOP(asin(x));
+   case NODETYPE_ACOS: UNARY_LOOP(acos(x));
+   case NODETYPE_ATAN: UNARY_LOOP(atan(x));
+   case NODETYPE_CLAMP:
+      TERNARY_LOOP((x < y) ? y : ((x > z) ? z : x));
+   case NODETYPE_SEGMENT:
+      TERNARY_LOOP((x >= y && x <= z) ? 1.0 : 0.0);
+   case NODETYPE_ISNAN:
+      for (i=0; i < width; i++)
+         r[i] = (a[i] == INVALID_VALUE) ? 1.0 : 0.0;
+      break;
+   default:
+      (void) fprintf(stderr, "Internal error: bad scalar operation\n");
+      exit(1);
+   }
+
+#undef UNARY_LOOP
+#undef BINARY_LOOP
+#undef TERNARY_LOOP
+}
+
+/* Operations over the elements of a vector. The elements are taken in
+   the same order as eval_sum and eval_max so that the results are the
+   same. */
+static void exec_reduce(machine_t m, instr_t *ip, int width){
+   double *r, *s, *nvalid, *ninvalid, *extreme;
+   double value, sign;
+   int i, iel, valid;
+
+   r = m->reg[ip->dst];
+   for (iel=0; iel < ip->len; iel++)
+      m->src[iel] = m->reg[ip->list[iel]];
+
+   switch (ip->type) {
+   case NODETYPE_SUM:
+   case NODETYPE_AVG:
+   case NODETYPE_PROD:
+      nvalid = m->scratch;
+      ninvalid = m->scratch + width;
+      for (i=0; i < width; i++) {
+         r[i] = (ip->type == NODETYPE_PROD) ? 1.0 : 0.0;
+         nvalid[i] = ninvalid[i] = 0.0;
+      }
+      for (iel=0; iel < ip->len; iel++) {
+         s = m->src[iel];
+         if (ip->type == NODETYPE_PROD) {
+            for (i=0; i < width; i++) {
+               valid = (s[i] != INVALID_VALUE);
+               r[i] *= valid ? s[i] : 1.0;
+               nvalid[i] += valid;
+               ninvalid[i] += !valid;
+            }
+         }
+         else {
+            for (i=0; i < width; i++) {
+               valid = (s[i] != INVALID_VALUE);
+               r[i] += valid ? s[i] : 0.0;
+               nvalid[i] += valid;
+               ninvalid[i] += !valid;
+            }
+         }
+      }
+      for (i=0; i < width; i++) {
+         if ((ninvalid[i] > 0.0 && propagate_nan) || nvalid[i] == 0.0)
+            r[i] = value_for_illegal_operations;
+         if (ip->type == NODETYPE_AVG && r[i] != INVALID_VALUE)
+            r[i] /= (double) ip->len;
+      }
+      break;
+
+   case NODETYPE_MAX:
+   case NODETYPE_MIN:
+   case NODETYPE_IMAX:
+   case NODETYPE_IMIN:
+      sign = (ip->type == NODETYPE_MAX || ip->type == NODETYPE_IMAX) ?
+         1.0 : -1.0;
+      extreme = (ip->type == NODETYPE_MAX || ip->type == NODETYPE_MIN) ?
+         r : m->scratch;
+      for (i=0; i < width; i++) {
+         r[i] = extreme[i] = INVALID_VALUE;
+      }
+      for (iel=0; iel < ip->len; iel++) {
+         s = m->src[iel];
+         for (i=0; i < width; i++) {
+            value = s[i];
+            if (value != INVALID_VALUE &&
+                (extreme[i] == INVALID_VALUE ||
+                 sign * (value - extreme[i]) > 0.0)) {
+               extreme[i] = value;
+               if (extreme != r) r[i] = (double) iel;
+            }
+         }
+      }
+      break;
+
+   default:
+      (void) fprintf(stderr, "Internal error: bad vector operation\n");
+      exit(1);
+   }
+}
+
+/* Indexing by values that are not known until the data is seen */
+static void exec_index(machine_t m, instr_t *ip, int width){
+   unsigned char *mask;
+   double *r, *index;
+   double idx;
+   int i;
+
+   mask = (ip->mask == NO_MASK) ? NULL : m->mask[ip->mask];
+   r = m->reg[ip->dst];
+   index = m->reg[ip->a];
+   for (i=0; i < width; i++) {
+      if (mask != NULL && !mask[i]) continue;
+      idx = SCALAR_ROUND(index[i]);
+      if (!(idx >= 0.0 && idx < (double) ip->len))
+         eval_error(ip->node, "index out of bounds");
+      r[i] = m->reg[ip->list[(int) idx]][i];
+   }
+}
+
+/* Copy values for the voxels in a mask */
+static void exec_copy(double *r, double *a, unsigned char *mask, int width){
+   int i;
+
+   if (mask == NULL) {
+      (void) memcpy(r, a, width * sizeof(*r));
+   }
+   else {
+      for (i=0; i < width; i++)
+         r[i] = mask[i] ? a[i] : r[i];
+   }
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : execute_program
+@INPUT      : m - machine with the input registers filled in
+              width - number of voxels to evaluate (at most the width
+                 of the machine)
+@OUTPUT     : m - the output registers
+@RETURNS    : (nothing)
+@DESCRIPTION: Runs a compiled expression on width voxels at once.
+@METHOD     :
+@GLOBALS    :
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+void execute_program(machine_t m, int width){
+   program_t prog = m->prog;
+   instr_t *ip;
+   unsigned char *mask, *parent, *then_mask, *else_mask;
+   double *r, *cond, *then_val, *else_val;
+   double illegal = value_for_illegal_operations;
+   int pc, i, any;
+
+   pc = 0;
+   while (pc < prog->ncode) {
+      ip = &prog->code[pc++];
+      mask = (ip->mask == NO_MASK) ? NULL : m->mask[ip->mask];
+
+      switch (ip->op) {
+      case OP_ARITH:
+         exec_arith(ip->type, width, m->reg[ip->dst],
+                    m->reg[ip->a], m->reg[ip->b], m->reg[ip->c]);
+         break;
+
+      case OP_REDUCE:
+         exec_reduce(m, ip, width);
+         break;
+
+      case OP_INDEX:
+         exec_index(m, ip, width);
+         break;
+
+      case OP_COPY:
+         exec_copy(m->reg[ip->dst], m->reg[ip->a], mask, width);
+         break;
+
+      case OP_SPLIT:
+         parent = mask;
+         cond = m->reg[ip->a];
+         then_mask = m->mask[ip->dst];
+         else_mask = m->mask[ip->b];
+         for (i=0; i < width; i++) {
+            then_mask[i] = (parent == NULL || parent[i]) &&
+               cond[i] != 0.0 && cond[i] != INVALID_VALUE;
+            else_mask[i] = (parent == NULL || parent[i]) &&
+               cond[i] == 0.0;
+         }
+         break;
+
+      case OP_SKIP:
+         any = FALSE;
+         for (i=0; i < width && !any; i++)
+            any = mask[i];
+         if (!any) pc = ip->target;
+         break;
+
+      case OP_MERGE:
+         r = m->reg[ip->dst];
+         cond = m->reg[ip->a];
+         then_val = m->reg[ip->b];
+         else_val = (ip->c < 0) ? NULL : m->reg[ip->c];
+         for (i=0; i < width; i++) {
+            if (cond[i] == INVALID_VALUE)
+               r[i] = illegal;
+            else if (cond[i] != 0.0)
+               r[i] = then_val[i];
+            else
+               r[i] = (else_val == NULL) ? 0.0 : else_val[i];
+         }
+         break;
+
+      case OP_LOOP_START:
+         m->counter[ip->n] = 0;
+         break;
+
+      case OP_LOOP_SET:
+         exec_copy(m->reg[ip->dst], m->reg[ip->list[m->counter[ip->n]]],
+                   mask, width);
+         break;
+
+      case OP_LOOP_END:
+         if (++m->counter[ip->n] < ip->len) pc = ip->target;
+         break;
+      }
+   }
+}
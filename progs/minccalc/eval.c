@@ -25,6 +25,8 @@ vector_t   eval_vector(int, int *, node_t, sym_t);
 vector_t   gen_vector(int, int *, node_t, sym_t);
 vector_t   gen_range(int, int *, node_t, sym_t);
 scalar_t   for_loop(int, int *, node_t n, sym_t sym);
+static scalar_t scalar_unshare(int, scalar_t);
+static vector_t vector_unshare(int, vector_t);
 
 extern int debug;
 extern int propagate_nan;
@@ -383,18 +385,23 @@ scalar_t eval_scalar(int width, int *eval_flags, node_t n, sym_t sym){
       isnan_flags = malloc(sizeof(eval_flags[0]) * width);
       all_true = TRUE;
       all_false = TRUE;
+      found_invalid = FALSE;
       for (ivalue=0; ivalue < width; ivalue++) {
-         isnan_flags[ivalue] = (s->vals[ivalue] == INVALID_VALUE);
+         isnan_flags[ivalue] = ((eval_flags == NULL ? 1 : eval_flags[ivalue])
+                                && (s->vals[ivalue] == INVALID_VALUE));
          eval_flags2[ivalue] = ((eval_flags == NULL ? 1 : eval_flags[ivalue])
                                 && (s->vals[ivalue] != 0.0)
                                 && (!isnan_flags[ivalue]));
          if (eval_flags2[ivalue])
             all_false = FALSE;
-         else
+         else if (isnan_flags[ivalue] || 
+                  eval_flags == NULL || eval_flags[ivalue])
             all_true = FALSE;
+         if (isnan_flags[ivalue])
+            found_invalid = TRUE;
       }
       scalar_free(s);
-      if (all_true || all_false) {
+      if ((all_true || all_false) && eval_flags == NULL && !found_invalid) {
          free(eval_flags2);
          eval_flags2 = NULL;
       }
@@ -411,12 +418,14 @@ scalar_t eval_scalar(int width, int *eval_flags, node_t n, sym_t sym){
          if (eval_flags2 != NULL) {
             for (ivalue=0; ivalue < width; ivalue++) 
                eval_flags2[ivalue] = 
+                  (eval_flags == NULL ? 1 : eval_flags[ivalue]) &&
                   !eval_flags2[ivalue] && !isnan_flags[ivalue];
          }
          s2 = eval_scalar(width, eval_flags2, n->expr[2], sym);
          if (eval_flags2 != NULL) {
             for (ivalue=0; ivalue < width; ivalue++) 
                eval_flags2[ivalue] = 
+                  (eval_flags == NULL ? 1 : eval_flags[ivalue]) &&
                   !eval_flags2[ivalue] && !isnan_flags[ivalue];
          }
       }
@@ -434,8 +443,12 @@ scalar_t eval_scalar(int width, int *eval_flags, node_t n, sym_t sym){
          }
       }
 
-      /* Merge the results */
+      /* Merge the results, making sure that we do not write into a value
+         that is also used elsewhere (such as a symbol that was assigned) */
       if (eval_flags2 != NULL) {
+         s = scalar_unshare(width, s);
+      }
+      if (eval_flags2 != NULL && (s2 != NULL || n->numargs <= 2)) {
          for (ivalue=0; ivalue < width; ivalue++) {
             if (!eval_flags2[ivalue]) {
                s->vals[ivalue] = 
@@ -571,13 +584,51 @@ scalar_t eval_max(int width, int *eval_flags,
    return result;
 }
 
+/* Get a copy of a scalar that can be modified without changing anyone
+   else's values. The reference to the original is given up. */
+static scalar_t scalar_unshare(int width, scalar_t s){
+   scalar_t copy;
+   int ivalue;
+
+   if (s->refcnt <= 1) return s;
+   copy = new_scalar(width);
+   for (ivalue=0; ivalue < width; ivalue++)
+      copy->vals[ivalue] = s->vals[ivalue];
+   scalar_free(s);
+   return copy;
+}
+
+/* Get a copy of a vector (and its elements) that can be modified without
+   changing anyone else's values. The reference to the original is given 
+   up. */
+static vector_t vector_unshare(int width, vector_t v){
+   vector_t copy;
+   scalar_t s;
+   int iel, shared;
+
+   shared = (v->refcnt > 1);
+   for (iel=0; iel < v->len; iel++) {
+      if (v->el[iel]->refcnt > 1) shared = TRUE;
+   }
+   if (!shared) return v;
+   copy = new_vector();
+   for (iel=0; iel < v->len; iel++) {
+      scalar_incr_ref(v->el[iel]);
+      s = scalar_unshare(width, v->el[iel]);
+      vector_append(copy, s);
+      scalar_free(s);
+   }
+   vector_free(v);
+   return copy;
+}
+
 /* Evaluate an expression in a vector context */
 vector_t eval_vector(int width, int *eval_flags, node_t n, sym_t sym){
    vector_t v, v2;
    scalar_t s;
    int ivalue, iel;
    int *eval_flags2, *isnan_flags;
-   int all_true, all_false;
+   int found_invalid, all_true, all_false;
 
    /* Check that node is of correct type */
    if (node_is_scalar(n)) {
@@ -643,18 +694,23 @@ vector_t eval_vector(int width, int *eval_flags, node_t n, sym_t sym){
       isnan_flags = malloc(sizeof(eval_flags[0]) * width);
       all_true = TRUE;
       all_false = TRUE;
+      found_invalid = FALSE;
       for (ivalue=0; ivalue < width; ivalue++) {
-         isnan_flags[ivalue] = (s->vals[ivalue] == INVALID_VALUE);
+         isnan_flags[ivalue] = ((eval_flags == NULL ? 1 : eval_flags[ivalue])
+                                && (s->vals[ivalue] == INVALID_VALUE));
          eval_flags2[ivalue] = ((eval_flags == NULL ? 1 : eval_flags[ivalue])
                                 && (s->vals[ivalue] != 0.0)
                                 && (!isnan_flags[ivalue]));
          if (eval_flags2[ivalue])
             all_false = FALSE;
-         else
+         else if (isnan_flags[ivalue] || 
+                  eval_flags == NULL || eval_flags[ivalue])
             all_true = FALSE;
+         if (isnan_flags[ivalue])
+            found_invalid = TRUE;
       }
       scalar_free(s);
-      if (all_true || all_false) {
+      if ((all_true || all_false) && eval_flags == NULL && !found_invalid) {
          free(eval_flags2);
          eval_flags2 = NULL;
       }
@@ -671,12 +727,14 @@ vector_t eval_vector(int width, int *eval_flags, node_t n, sym_t sym){
          if (eval_flags2 != NULL) {
             for (ivalue=0; ivalue < width; ivalue++) 
                eval_flags2[ivalue] = 
+                  (eval_flags == NULL ? 1 : eval_flags[ivalue]) &&
                   !eval_flags2[ivalue] && !isnan_flags[ivalue];
          }
          v2 = eval_vector(width, eval_flags2, n->expr[2], sym);
          if (eval_flags2 != NULL) {
             for (ivalue=0; ivalue < width; ivalue++) 
                eval_flags2[ivalue] = 
+                  (eval_flags == NULL ? 1 : eval_flags[ivalue]) &&
                   !eval_flags2[ivalue] && !isnan_flags[ivalue];
          }
       }
@@ -692,11 +750,15 @@ vector_t eval_vector(int width, int *eval_flags, node_t n, sym_t sym){
          }
       }
 
-      /* Merge the results */
+      /* Merge the results, making sure that we do not write into values
+         that are also used elsewhere (such as a symbol that was assigned) */
       if (v2 != NULL && v->len != v2->len) {
          eval_error(n, "VIO_Vector expressions in if-else do not have the same length");
       }
       if (eval_flags2 != NULL) {
+         v = vector_unshare(width, v);
+      }
+      if (eval_flags2 != NULL && (v2 != NULL || n->numargs <= 2)) {
          for (ivalue=0; ivalue < width; ivalue++) {
             if (!eval_flags2[ivalue]) {
                for (iel=0; iel < v->len; iel++) {
@@ -804,12 +866,24 @@ scalar_t for_loop(int width, int *eval_flags, node_t n, sym_t sym){
 }
 
 vector_t gen_range(int width, int *eval_flags, node_t n, sym_t sym){
-   int i, ivalue;
+   int i, ivalue, first;
    scalar_t start;
    scalar_t stop;
    vector_t v;
    int length;
 
+   /* Find the first value being evaluated. If there is none (e.g. in an
+      if whose test is invalid everywhere) the vector must still have the
+      right length, so evaluate the range everywhere. */
+   first = 0;
+   if (eval_flags != NULL) {
+      while (first < width && !eval_flags[first]) first++;
+      if (first >= width) {
+         eval_flags = NULL;
+         first = 0;
+      }
+   }
+
    v = new_vector();
    start = eval_scalar(width, eval_flags, n->expr[0], sym);
    stop = eval_scalar(width, eval_flags, n->expr[1], sym);
@@ -826,7 +900,7 @@ vector_t gen_range(int width, int *eval_flags, node_t n, sym_t sym){
       if (!(n->flags & RANGE_EXACT_UPPER))
          stop->vals[ivalue]--;
 
-      if (ivalue == 0) {
+      if (ivalue == first) {
          length = stop->vals[ivalue] - start->vals[ivalue];
       }
       else if (length != (int) (stop->vals[ivalue] - start->vals[ivalue])) {
@@ -119,6 +119,7 @@ Mon May 21 01:01:01 EST 2000 - Original version "imgcalc" by David Leonard
 #include <math.h>
 #include <ParseArgv.h>
 #include <voxel_loop.h>
+#include <parallel_voxel_loop.h>
 #include <time_stamp.h>
 #include "node.h"
 
@@ -169,6 +170,8 @@ static char *filelist = NULL;
 static char *expr_file = NULL;
 char *expression = NULL;
 static int eval_width = 200;
+static int nthreads = 1;
+static int compile_expression = TRUE;
 #if MINC2
 static int minc2_format = FALSE;
 #endif /* MINC2 */
@@ -193,6 +196,13 @@ ArgvInfo argTable[] = {
        "Do not print out log messages."},
    {"-debug", ARGV_CONSTANT, (char *) TRUE, (char *) &debug,
        "Print out debugging messages."},
+   {"-threads", ARGV_INT, (char *) 1, (char *) &nthreads,
+       "Number of threads used to process each buffer (default 1)."},
+   {"-compile", ARGV_CONSTANT, (char *) TRUE, (char *) &compile_expression,
+       "Compile the expression when possible (default)."},
+   {"-nocompile", ARGV_CONSTANT, (char *) FALSE, 
+       (char *) &compile_expression,
+       "Always evaluate the expression from its parse tree."},
    {"-filelist", ARGV_STRING, (char *) 1, (char *) &filelist,
        "Specify the name of a file containing input file names (- for stdin)."},
    {"-copy_header", ARGV_CONSTANT, (char *) TRUE, (char *) &copy_all_header,
@@ -265,8 +275,10 @@ int main(int argc, char *argv[]){
    Loop_Options *loop_options;
    char *pname;
    int i;
-   ident_t ident;
+   ident_t ident, *output_idents;
    scalar_t scalar;
+   program_t program;
+   machine_t *machines;
 
    /* Save time stamp and args */
    arg_string = time_stamp(argc, argv);
@@ -349,6 +361,15 @@ int main(int argc, char *argv[]){
    if (debug) yydebug = 1; else yydebug = 0; 
    yyparse();
    lex_finalize();
+
+   /* Constants are folded with the same value for illegal operations
+      as is used when evaluating */
+   if (value_for_illegal_operations == DEFAULT_DBL) {
+      if (use_nan_for_illegal_values)
+         value_for_illegal_operations = INVALID_DATA;
+      else
+         value_for_illegal_operations = 0.0;
+   }
    
    /* Optimize the expression tree */
    root = optimize(root);
@@ -394,11 +415,34 @@ int main(int argc, char *argv[]){
    if (copy_all_header == DEFAULT_BOOL)
       copy_all_header = (nfiles == 1);
 
-   if (value_for_illegal_operations == DEFAULT_DBL) {
-      if (use_nan_for_illegal_values)
-         value_for_illegal_operations = INVALID_DATA;
-      else
-         value_for_illegal_operations = 0.0;
+   /* Compile the expression. When debugging, the tree is evaluated
+      instead so that each operation can be printed, and -nocompile does
+      the same so that the two can be checked against each other.
+      Expressions that cannot be compiled are also evaluated from the
+      tree, and since that uses the global symbol table it can only be
+      done in one thread. */
+   program = NULL;
+   if (compile_expression && !debug) {
+      output_idents = malloc((Output_list_size > 0 ? Output_list_size : 1) *
+                             sizeof(*output_idents));
+      for (i=0; i < Output_list_size; i++)
+         output_idents[i] = ident_lookup(Output_list[i].symbol);
+      program = compile_program(root, nfiles, Output_list_size,
+                                output_idents);
+      free(output_idents);
+   }
+   if (nthreads < 1) nthreads = 1;
+   machines = NULL;
+   if (program != NULL) {
+      machines = malloc(nthreads * sizeof(*machines));
+      for (i=0; i < nthreads; i++)
+         machines[i] = new_machine(program, eval_width);
+   }
+   else if (nthreads > 1) {
+      if (compile_expression && !debug)
+         (void) fprintf(stderr, 
+            "Warning: expression cannot be compiled, using a single thread.\n");
+      nthreads = 1;
    }
 
    /* Do math */
@@ -418,10 +462,17 @@ int main(int argc, char *argv[]){
       }
    
    set_loop_check_dim_info(loop_options, check_dim_info);
-   voxel_loop(nfiles, infiles, nout, outfiles, arg_string, loop_options,
-              do_math, NULL);
+   parallel_voxel_loop(nthreads, (void **) machines, 
+                       nfiles, infiles, nout, outfiles, arg_string,
+                       loop_options, do_math, NULL);
    free_loop_options(loop_options);
 
+   if (program != NULL) {
+      for (i=0; i < nthreads; i++)
+         free_machine(machines[i]);
+      free(machines);
+      free_program(program);
+   }
    
    /* Clean up */
    vector_free(A);
@@ -438,7 +489,9 @@ int main(int argc, char *argv[]){
 @INPUT      : Standard for voxel loop
 @OUTPUT     : Standard for voxel loop
 @RETURNS    : (nothing)
-@DESCRIPTION: Routine doing math operations.
+@DESCRIPTION: Routine doing math operations. caller_data is the machine
+              running the compiled expression for this thread, or NULL
+              if the expression tree is to be evaluated.
 @METHOD     : 
 @GLOBALS    : Output_values, A
 @CALLS      : 
@@ -451,6 +504,7 @@ static void do_math(void *caller_data, long num_voxels,
                     int output_num_buffers, int output_vector_length,
                     double *output_data[],
                     Loop_Info *loop_info){
+   machine_t machine = caller_data;
    long ivox, ibuff, ivalue, nvox;
    scalar_t scalar, *output_scalars;
    int num_output, iout;
@@ -472,6 +526,23 @@ static void do_math(void *caller_data, long num_voxels,
       nvox = eval_width;
       if (ivox + nvox > total_values) 
           nvox = total_values - ivox;
+
+      /* Run the compiled expression if there is one */
+      if (machine != NULL) {
+         for (ibuff=0; ibuff < input_num_buffers; ibuff++) {
+            (void) memcpy(machine_input(machine, (int) ibuff),
+                          &input_data[ibuff][ivox], 
+                          nvox * sizeof(input_data[0][0]));
+         }
+         execute_program(machine, (int) nvox);
+         num_output = (Output_values == NULL) ? 1 : Output_list_size;
+         for (iout=0; iout < num_output; iout++) {
+            (void) memcpy(&output_data[iout][ivox],
+                          machine_output(machine, iout),
+                          nvox * sizeof(output_data[0][0]));
+         }
+         continue;
+      }
       
       /* Copy the data into the A vector */
       for (ivalue=0; ivalue < nvox; ivalue++) {
@@ -4,12 +4,16 @@ struct node;
 struct scalar;
 struct vector;
 struct sym;
+struct program;
+struct machine;
 
 typedef int      ident_t;
 typedef struct node    *node_t;
 typedef struct scalar  *scalar_t;
 typedef struct vector  *vector_t;
 typedef struct sym     *sym_t;
+typedef struct program *program_t;
+typedef struct machine *machine_t;
 
 #define SCALAR_ROUND(s)   (floor(s + 0.5))
 
@@ -124,8 +128,17 @@ void       lex_init(const char *);
 void       lex_finalize(void);
 
 scalar_t   eval_scalar(int, int *, node_t, sym_t);
+void       eval_error(node_t, const char *);
 void       show_error(int, const char *);
 
+program_t  compile_program(node_t, int, int, ident_t *);
+void       free_program(program_t);
+machine_t  new_machine(program_t, int);
+void       free_machine(machine_t);
+double    *machine_input(machine_t, int);
+double    *machine_output(machine_t, int);
+void       execute_program(machine_t, int);
+
 int      yyparse(void);
 int      yylex(void);
 extern node_t   root;
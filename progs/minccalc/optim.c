@@ -1,5 +1,80 @@
+/* Copyright David Leonard & Andrew Janke, 2000. All rights reserved. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
 #include "node.h"
 
-node_t optimize(node_t root){
-   return root;
+#ifndef TRUE
+#  define TRUE 1
+#endif
+
+#ifndef FALSE
+#  define FALSE 0
+#endif
+
+#define INVALID_VALUE -DBL_MAX
+
+extern double value_for_illegal_operations;
+
+/* Turn a node into a constant */
+static node_t make_real(node_t n, double value){
+   n->type = NODETYPE_REAL;
+   n->real = value;
+   n->numargs = 0;
+   n->flags = NODE_IS_SCALAR;
+   return n;
+}
+
+/* Simplify an expression tree: operations on constants are replaced by
+   their values and ifs with constant conditions by the branch that would
+   be taken. Constants are worked out with eval_scalar so that they are
+   exactly what evaluating the tree would give, which means that
+   value_for_illegal_operations must be set before this is called. */
+node_t optimize(node_t n){
+   scalar_t s;
+   double value;
+   int iarg, all_real;
+
+   for (iarg=0; iarg < n->numargs; iarg++) {
+      n->expr[iarg] = optimize(n->expr[iarg]);
+   }
+
+   switch (n->type) {
+   case NODETYPE_IFELSE:
+      if (!node_is_scalar(n) || n->expr[0]->type != NODETYPE_REAL)
+         break;
+      value = n->expr[0]->real;
+      if (value == INVALID_VALUE)
+         return make_real(n, value_for_illegal_operations);
+      else if (value != 0.0)
+         return n->expr[1];
+      else if (n->numargs > 2)
+         return n->expr[2];
+      else
+         return make_real(n, 0.0);
+
+   case NODETYPE_EXPRLIST:
+      /* A constant on its own does nothing */
+      if (n->expr[0]->type == NODETYPE_REAL)
+         return n->expr[1];
+      break;
+
+   default:
+      if (!(n->flags & ALLARGS_SCALAR))
+         break;
+      all_real = TRUE;
+      for (iarg=0; iarg < n->numargs; iarg++) {
+         if (n->expr[iarg]->type != NODETYPE_REAL) all_real = FALSE;
+      }
+      if (all_real) {
+         s = eval_scalar(1, NULL, n, NULL);
+         value = s->vals[0];
+         scalar_free(s);
+         return make_real(n, value);
+      }
+      break;
+   }
+
+   return n;
 }
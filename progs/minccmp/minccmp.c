@@ -21,6 +21,8 @@
 /*                                                                           */
 /* Tue Jun 17 11:31:10 EST 2003 - initial version inspired by voldiff and    */
 /*                                   peter's compare_volumes                 */
+/* Fri Oct 16 2026 - keep voxel values from the first pass for the z-score,  */
+/*                   added -all_pairs and -threads                           */
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,6 +31,7 @@
 #include <float.h>
 #include <voxel_loop.h>
 #include <ParseArgv.h>
+#include <parallel_voxel_loop.h>
 
 #ifndef FALSE
 #  define FALSE 0
@@ -72,8 +75,31 @@ typedef struct {
 
    /* individual volume data */
    Vol_Data *vd;
+
+   /* values of the selected voxels from the first pass, n_datafiles */
+   /* per voxel, kept for the z-score. NULL if they do not fit        */
+   double  *cache;
+   long     cache_nvox;
+   long     cache_alloc;
+   long     max_cache_nvox;
    } Loop_Data;
 
+typedef struct {
+   int      n_datafiles;
+
+   int      mask;
+   int      mask_idx;
+
+   /* sums for each volume */
+   double   nvox;
+   double  *sum;
+   double  *ssum;
+
+   /* sums for each pair of volumes [i * n_datafiles + j] (i < j) */
+   double  *sum_prd;     /* sum of product of file[i] with file[j] */
+   double  *ssum_dif;    /* squared sum of difference of file[i] and file[j] */
+   } Pair_Data;
+
 /* Function prototypes */
 void     pass_0(void *caller_data, long num_voxels,
                 int input_num_buffers, int input_vector_length,
@@ -85,10 +111,21 @@ void     pass_1(void *caller_data, long num_voxels,
                 double *input_data[],
                 int output_num_buffers, int output_vector_length,
                 double *output_data[], Loop_Info * loop_info);
+void     pass_pairs(void *caller_data, long num_voxels,
+                    int input_num_buffers, int input_vector_length,
+                    double *input_data[],
+                    int output_num_buffers, int output_vector_length,
+                    double *output_data[], Loop_Info * loop_info);
 void     print_result(char *title, double result);
 void     dump_stats(Loop_Data * ld);
 void     do_int_calcs(Loop_Data * ld);
+void     cache_voxel(Loop_Data * ld, double *input_data[], long ivox);
+void     do_cached_zscore(Loop_Data * ld);
 void     do_final_calcs(Loop_Data * ld);
+void     do_all_pairs(int n_infiles, char **infiles, Loop_Options * loop_opt,
+                      int mask);
+void     init_pair_data(Pair_Data * pd, int n_datafiles, int mask);
+void     print_pair_matrix(char *title, Pair_Data * pd, int stat);
 
 /* Argument variables and table */
 static int verbose = FALSE;
@@ -97,6 +134,8 @@ static int quiet = FALSE;
 static int clobber = FALSE;
 static int max_buffer_size_in_kb = 4 * 1024;
 static int check_dim_info = TRUE;
+static int max_cache_size_in_kb = 256 * 1024;
+static int nthreads = 1;
 static char *mask_fname = NULL;
 static double valid_range[2] = { -DBL_MAX, DBL_MAX };
 
@@ -106,6 +145,12 @@ static int do_rmse = FALSE;
 static int do_xcorr = FALSE;
 static int do_zscore = FALSE;
 static int do_vratio = FALSE;
+static int do_pairs = FALSE;
+
+/* statistics in the all pairs matrices */
+#define PAIR_SSQ   0
+#define PAIR_RMSE  1
+#define PAIR_XCORR 2
 
 ArgvInfo argTable[] = {
    {"-verbose", ARGV_CONSTANT, (char *)TRUE, (char *)&verbose,
@@ -122,6 +167,10 @@ ArgvInfo argTable[] = {
     "Check that files have matching dimensions (default)."},
    {"-nocheck_dimensions", ARGV_CONSTANT, (char *) FALSE, (char *) &check_dim_info,
     "Do not check that files have matching dimensions."},
+   {"-max_cache_size_in_kb", ARGV_INT, (char *)1, (char *)&max_cache_size_in_kb,
+    "maximum memory for voxel values kept for the z-score (0 reads the files twice)."},
+   {"-threads", ARGV_INT, (char *)1, (char *)&nthreads,
+    "number of threads used for -all_pairs (default 1)."},
 
    {NULL, ARGV_HELP, (char *)NULL, (char *)NULL,
     "\nVoxel selection options (applies to first volume ONLY):"},
@@ -147,6 +196,8 @@ ArgvInfo argTable[] = {
     "cross correlation (2 volumes)"},
    {"-zscore", ARGV_CONSTANT, (char *)TRUE, (char *)&do_zscore,
     "z-score (2 volumes)"},
+   {"-all_pairs", ARGV_CONSTANT, (char *)TRUE, (char *)&do_pairs,
+    "print matrices of ssq, rmse and xcorr between every pair of volumes."},
 //   {"-vr", ARGV_CONSTANT, (char *)TRUE, (char *)&do_vratio,
 //    "variance ratio (2 volumes)"},
 
@@ -178,12 +229,19 @@ int main(int argc, char *argv[]){
    infiles = &argv[1];
 
    /* check arguments */
+   if(do_pairs && do_zscore){
+      fprintf(stderr, "%s: -zscore cannot be used with -all_pairs\n", argv[0]);
+      exit(EXIT_FAILURE);
+      }
    if(!do_rmse && !do_xcorr && !do_zscore && !do_vratio){
       do_all = TRUE;
       }
    if(do_all){
       do_ssq = do_rmse = do_xcorr = do_zscore = do_vratio = TRUE;
       }
+   if(do_pairs){
+      do_zscore = do_vratio = FALSE;
+      }
 
    /* check for infiles */
    if(verbose){
@@ -221,6 +279,27 @@ int main(int argc, char *argv[]){
       ld.mask_idx = 0;
       }
 
+   /* set up loop options */
+   loop_opt = create_loop_options();
+   set_loop_verbose(loop_opt, verbose);
+   set_loop_buffer_size(loop_opt, (long)1024 * max_buffer_size_in_kb);
+   set_loop_check_dim_info(loop_opt, check_dim_info);
+
+   /* compare every pair of volumes */
+   if(do_pairs){
+      for(i = 0; i < ld.n_datafiles; i++){
+         if(!quiet){
+            fprintf(stdout, "file[%02d]:     %s\n", i, infiles[i]);
+            }
+         }
+      if(!quiet){
+         fprintf(stdout, "mask file:    %s\n", mask_fname);
+         }
+      do_all_pairs(n_infiles, infiles, loop_opt, ld.mask);
+      free_loop_options(loop_opt);
+      return EXIT_SUCCESS;
+      }
+
    /* allocate space and initialise volume stats data */
    ld.vd = (Vol_Data *) malloc(sizeof(Vol_Data) * ld.n_datafiles);
    for(i = 0; i < ld.n_datafiles; i++){
@@ -234,6 +313,7 @@ int main(int argc, char *argv[]){
       ld.vd[i].ssum_add0 = 0;
       ld.vd[i].ssum_dif0 = 0;
       ld.vd[i].ssum_prd0 = 0;
+      ld.vd[i].sum_zdif0 = 0;
 
       ld.vd[i].mean = 0;
       ld.vd[i].var = 0;
@@ -245,11 +325,20 @@ int main(int argc, char *argv[]){
       ld.vd[i].vratio = 0.0;
       }
 
-   /* set up and do voxel_loop(s) */
-   loop_opt = create_loop_options();
-   set_loop_verbose(loop_opt, verbose);
-   set_loop_buffer_size(loop_opt, (long)1024 * max_buffer_size_in_kb);
-   set_loop_check_dim_info(loop_opt, check_dim_info);
+   /* keep the voxel values from the first pass for the z-score if */
+   /* they fit, rather than reading the files again                 */
+   ld.cache = NULL;
+   ld.cache_nvox = 0;
+   ld.cache_alloc = 0;
+   ld.max_cache_nvox = 0;
+   if(do_zscore){
+      ld.max_cache_nvox = ((long)1024 * max_cache_size_in_kb) /
+         ((long)sizeof(double) * ld.n_datafiles);
+      if(ld.max_cache_nvox > 0){
+         ld.cache_alloc = (ld.max_cache_nvox < 65536) ? ld.max_cache_nvox : 65536;
+         ld.cache = (double *) malloc(sizeof(double) * ld.n_datafiles * ld.cache_alloc);
+         }
+      }
 
    /* first pass */
    voxel_loop(n_infiles, infiles, 0, NULL, NULL, loop_opt, pass_0, (void *)&ld);
@@ -257,9 +346,18 @@ int main(int argc, char *argv[]){
    /* intermediate calculations */
    do_int_calcs(&ld);
 
-   /* run the second pass if we have to */
+   /* z-score from the kept values, or a second pass if we have to */
    if(do_zscore){
-      voxel_loop(n_infiles, infiles, 0, NULL, NULL, loop_opt, pass_1, (void *)&ld);
+      if(ld.cache != NULL){
+         do_cached_zscore(&ld);
+         free(ld.cache);
+         }
+      else{
+         if(verbose){
+            fprintf(stderr, "Reading files again for the z-score\n");
+            }
+         voxel_loop(n_infiles, infiles, 0, NULL, NULL, loop_opt, pass_1, (void *)&ld);
+         }
       }
 
    /* final calculations */
@@ -358,12 +456,49 @@ void pass_0(void *caller_data, long num_voxels,
                ld->vd[i].max = valuei;
                }
             }
+
+         /* keep the values for the z-score */
+         if(ld->cache != NULL){
+            cache_voxel(ld, input_data, ivox);
+            }
          }
       }
 
    return;
    }
 
+/* add the values of a voxel to the cache, giving up on the cache */
+/* if it would grow past its maximum size                         */
+void cache_voxel(Loop_Data * ld, double *input_data[], long ivox){
+   double  *new_cache;
+   long     new_alloc;
+   int      i;
+
+   if(ld->cache_nvox >= ld->cache_alloc){
+      new_alloc = 2 * ld->cache_alloc;
+      if(new_alloc > ld->max_cache_nvox){
+         new_alloc = ld->max_cache_nvox;
+         }
+      new_cache = NULL;
+      if(new_alloc > ld->cache_alloc){
+         new_cache = (double *) realloc(ld->cache,
+                                        sizeof(double) * ld->n_datafiles * new_alloc);
+         }
+      if(new_cache == NULL){
+         free(ld->cache);
+         ld->cache = NULL;
+         return;
+         }
+      ld->cache = new_cache;
+      ld->cache_alloc = new_alloc;
+      }
+
+   for(i = 0; i < ld->n_datafiles; i++){
+      ld->cache[ld->cache_nvox * ld->n_datafiles + i] = input_data[i][ivox];
+      }
+   ld->cache_nvox++;
+   }
+
 /* intermediate calculations */
 void do_int_calcs(Loop_Data * ld){
    int i;
@@ -445,6 +580,28 @@ void pass_1(void *caller_data, long num_voxels,
    return;
    }
 
+/* z-score totals from the values kept in the first pass, in the */
+/* same order as pass_1 would have visited them                  */
+void do_cached_zscore(Loop_Data * ld){
+   long ivox;
+   double valuei, value0, *values;
+   int i;
+
+   for(ivox = 0; ivox < ld->cache_nvox; ivox++){
+      values = &ld->cache[ivox * ld->n_datafiles];
+      value0 = values[0];
+
+      for(i = 1; i < ld->n_datafiles; i++){
+         valuei = values[i];
+
+         /* zscore total */
+         ld->vd[i].sum_zdif0 +=
+            fabs(((value0 - ld->vd[0].mean) / ld->vd[0].sd) -
+                 ((valuei - ld->vd[i].mean) / ld->vd[i].sd));
+         }
+      }
+   }
+
 /* final calculations */
 void do_final_calcs(Loop_Data * ld){
    int i;
@@ -495,3 +652,183 @@ void dump_stats(Loop_Data * ld){
       fprintf(stdout, " | [%02d] vratio       %.10g\n", i, ld->vd[i].vratio);
       }
    }
+
+/* compare every pair of volumes in one pass, each thread keeping */
+/* its own sums for its part of each buffer                       */
+void do_all_pairs(int n_infiles, char **infiles, Loop_Options * loop_opt,
+                  int mask){
+   Pair_Data *pd;
+   void   **thread_data;
+   int      n_datafiles, n_pairs;
+   int      i, t;
+
+   if(nthreads < 1){
+      nthreads = 1;
+      }
+   n_datafiles = (mask) ? n_infiles - 1 : n_infiles;
+   n_pairs = n_datafiles * n_datafiles;
+
+   /* set up the sums for each thread */
+   pd = (Pair_Data *) malloc(sizeof(Pair_Data) * nthreads);
+   thread_data = (void **)malloc(sizeof(void *) * nthreads);
+   for(t = 0; t < nthreads; t++){
+      init_pair_data(&pd[t], n_datafiles, mask);
+      thread_data[t] = (void *)&pd[t];
+      }
+
+   parallel_voxel_loop(nthreads, thread_data, n_infiles, infiles, 0, NULL, NULL,
+                       loop_opt, pass_pairs, (void *)&pd[0]);
+
+   /* add up the sums of the threads */
+   for(t = 1; t < nthreads; t++){
+      pd[0].nvox += pd[t].nvox;
+      for(i = 0; i < n_datafiles; i++){
+         pd[0].sum[i] += pd[t].sum[i];
+         pd[0].ssum[i] += pd[t].ssum[i];
+         }
+      for(i = 0; i < n_pairs; i++){
+         pd[0].sum_prd[i] += pd[t].sum_prd[i];
+         pd[0].ssum_dif[i] += pd[t].ssum_dif[i];
+         }
+      }
+
+   /* print the matrices */
+   if(do_ssq){
+      print_pair_matrix("ssq:", &pd[0], PAIR_SSQ);
+      }
+   if(do_rmse){
+      print_pair_matrix("rmse:", &pd[0], PAIR_RMSE);
+      }
+   if(do_xcorr){
+      print_pair_matrix("xcorr:", &pd[0], PAIR_XCORR);
+      }
+
+   for(t = 0; t < nthreads; t++){
+      free(pd[t].sum);
+      free(pd[t].ssum);
+      free(pd[t].sum_prd);
+      free(pd[t].ssum_dif);
+      }
+   free(pd);
+   free(thread_data);
+   }
+
+/* set up an empty set of pair sums */
+void init_pair_data(Pair_Data * pd, int n_datafiles, int mask){
+   int i;
+
+   pd->n_datafiles = n_datafiles;
+   pd->mask = mask;
+   pd->mask_idx = (mask) ? n_datafiles : 0;
+   pd->nvox = 0;
+   pd->sum = (double *) malloc(sizeof(double) * n_datafiles);
+   pd->ssum = (double *) malloc(sizeof(double) * n_datafiles);
+   pd->sum_prd = (double *) malloc(sizeof(double) * n_datafiles * n_datafiles);
+   pd->ssum_dif = (double *) malloc(sizeof(double) * n_datafiles * n_datafiles);
+   for(i = 0; i < n_datafiles; i++){
+      pd->sum[i] = 0;
+      pd->ssum[i] = 0;
+      }
+   for(i = 0; i < n_datafiles * n_datafiles; i++){
+      pd->sum_prd[i] = 0;
+      pd->ssum_dif[i] = 0;
+      }
+   }
+
+/* voxel loop function for the all pairs sums, voxels are selected */
+/* by the first volume and the mask as for pass_0                  */
+void pass_pairs(void *caller_data, long num_voxels,
+                int input_num_buffers, int input_vector_length,
+                double *input_data[],
+                int output_num_buffers, int output_vector_length,
+                double *output_data[], Loop_Info * loop_info){
+   long ivox;
+   double valuei, value0;
+   int i, j, n;
+
+   /* get pointer to this thread's sums */
+   Pair_Data *pd = (Pair_Data *)caller_data;
+
+   /* shut the compiler up - yes I _know_ I don't use these */
+   (void)output_num_buffers;
+   (void)output_vector_length;
+   (void)output_data;
+   (void)loop_info;
+
+   /* sanity check */
+   if((input_num_buffers < 2) || (output_num_buffers != 0)){
+      fprintf(stderr, "Bad arguments to pass_pairs\n");
+      exit(EXIT_FAILURE);
+      }
+
+   n = pd->n_datafiles;
+
+   /* for each voxel */
+   for(ivox = num_voxels * input_vector_length; ivox--;){
+
+      /* skip voxels out of the mask region */
+      if(pd->mask && !(int)input_data[pd->mask_idx][ivox]){
+         continue;
+         }
+
+      value0 = input_data[0][ivox];
+      if(value0 >= valid_range[0] && value0 <= valid_range[1]){
+         pd->nvox++;
+
+         /* for each pair of volumes */
+         for(i = 0; i < n; i++){
+            valuei = input_data[i][ivox];
+            pd->sum[i] += valuei;
+            pd->ssum[i] += SQR2(valuei);
+
+            for(j = i + 1; j < n; j++){
+               pd->sum_prd[i * n + j] += valuei * input_data[j][ivox];
+               pd->ssum_dif[i * n + j] += SQR2(valuei - input_data[j][ivox]);
+               }
+            }
+         }
+      }
+
+   return;
+   }
+
+/* print a matrix of a statistic for every pair of volumes */
+void print_pair_matrix(char *title, Pair_Data * pd, int stat){
+   int i, j, k, n;
+   double result, denom;
+
+   n = pd->n_datafiles;
+   if(!quiet){
+      fprintf(stdout, "%s\n", title);
+      }
+   for(i = 0; i < n; i++){
+      for(j = 0; j < n; j++){
+
+         /* sums are only kept for i < j */
+         k = (i < j) ? i * n + j : j * n + i;
+         switch (stat){
+         case PAIR_SSQ:
+            result = (i == j) ? 0.0 : pd->ssum_dif[k];
+            break;
+         case PAIR_RMSE:
+            result = (i == j) ? 0.0 : sqrt((1.0 / pd->nvox) * pd->ssum_dif[k]);
+            break;
+         case PAIR_XCORR:
+         default:
+            denom = sqrt(pd->ssum[i] * pd->ssum[j]);
+            if(denom == 0.0){
+               result = 0.0;
+               }
+            else if(i == j){
+               result = pd->ssum[i] / denom;
+               }
+            else{
+               result = pd->sum_prd[k] / denom;
+               }
+            break;
+            }
+         fprintf(stdout, (j == 0) ? "%.10g" : " %.10g", result);
+         }
+      fprintf(stdout, "\n");
+      }
+   }
@@ -147,6 +147,9 @@
 
 /* Macros */
 #define ABS(x) ( ((x) > 0) ? (x) : (-(x)) )
+#ifndef MIN
+#  define MIN(a, b) ( ((a) < (b)) ? (a) : (b) )
+#endif
 
 /* Double_Array structure */
 typedef struct {
@@ -184,8 +187,22 @@ typedef struct {
    double global_maximum;
    long max_memory_use_in_kb;
    int check_dim_info;
+   int raw_copy;
 } Concat_Info;
 
+/* Description of the image variable of an input file, used to decide
+   whether data can be copied without conversion */
+typedef struct {
+   nc_type datatype;
+   int is_signed;
+   double valid_range[2];
+   int ndims;
+   int nimgdims;
+   int concat_dim;              /* Index of concat dimension or -1 */
+   char dimname[MAX_VAR_DIMS][MAX_NC_NAME];
+   long dimlength[MAX_VAR_DIMS];
+} Raw_Image_Info;
+
 /* Sort structure */
 typedef struct {
    double coord;
@@ -209,6 +226,20 @@ static void do_concat(void *caller_data, long num_voxels,
                       int output_num_buffers, int output_vector_length,
                       double *output_data[],
                       Loop_Info *loop_info);
+static void copy_minmax_values(Concat_Info *concat_info, int input_mincid,
+                               long instart[], long outstart[]);
+static int can_copy_raw(Concat_Info *concat_info, 
+                        int num_input_files, char *input_files[]);
+static int get_raw_image_info(int mincid, char *dimension_name,
+                              Raw_Image_Info *image_info);
+static void copy_raw_data(Concat_Info *concat_info, int first_mincid,
+                          int num_input_files, char *input_files[]);
+static int open_raw_file(Concat_Info *concat_info, int ifile,
+                         char *filename, long dimlength[]);
+static void get_raw_output_start(Concat_Info *concat_info, int ifile,
+                                 int in_ndims, long instart[], 
+                                 long incount[],
+                                 long outstart[], long outcount[]);
 static void sort_coords(Concat_Info *concat_info);
 static int sort_function(const void *value1, const void *value2);
 static void create_concat_file(int inmincid, Concat_Info *concat_info);
@@ -238,27 +269,39 @@ int main(int argc, char *argv[])
    /* Look for the dimension in the input file */
    get_concat_dim_name(concat_info, input_files[0], &first_mincid);
 
-   /* Set up loop options */
-   loop_options = create_loop_options();
-   set_loop_verbose(loop_options, concat_info->verbose);
-   set_loop_first_input_mincid(loop_options, first_mincid);
-   set_loop_input_file_function(loop_options, get_input_file_info);
-   set_loop_accumulate(loop_options, TRUE, 0, NULL, NULL);
-   if (concat_info->dimension_in_input_file) {
-      set_loop_dimension(loop_options, concat_info->dimension_name);
-   }
-   set_loop_buffer_size(loop_options, 
-                        1024 * concat_info->max_memory_use_in_kb);
-   set_loop_check_dim_info(loop_options,
-                           concat_info->check_dim_info);
-
    /* Initialize global min and max */
    concat_info->global_minimum = DBL_MAX;
    concat_info->global_maximum = -DBL_MAX;
 
-   /* Loop over files */
-   voxel_loop(num_input_files, input_files, 0, NULL, NULL,
-              loop_options, do_concat, concat_info);
+   /* Copy the data directly if no conversion is needed */
+   if (concat_info->raw_copy && 
+       can_copy_raw(concat_info, num_input_files, input_files)) {
+      copy_raw_data(concat_info, first_mincid, 
+                    num_input_files, input_files);
+   }
+
+   /* Otherwise loop over files */
+   else {
+
+      /* Set up loop options */
+      loop_options = create_loop_options();
+      set_loop_verbose(loop_options, concat_info->verbose);
+      set_loop_first_input_mincid(loop_options, first_mincid);
+      set_loop_input_file_function(loop_options, get_input_file_info);
+      set_loop_accumulate(loop_options, TRUE, 0, NULL, NULL);
+      if (concat_info->dimension_in_input_file) {
+         set_loop_dimension(loop_options, concat_info->dimension_name);
+      }
+      set_loop_buffer_size(loop_options, 
+                           1024 * concat_info->max_memory_use_in_kb);
+      set_loop_check_dim_info(loop_options,
+                              concat_info->check_dim_info);
+
+      voxel_loop(num_input_files, input_files, 0, NULL, NULL,
+                 loop_options, do_concat, concat_info);
+
+      free_loop_options(loop_options);
+   }
 
    /* Close the output file */
    imgid = ncvarid(concat_info->output_mincid, MIimage);
@@ -281,7 +324,6 @@ int main(int argc, char *argv[])
    (void) miicv_free(concat_info->output_icvid);
 
    /* Free stuff */
-   free_loop_options(loop_options);
    free(concat_info);
 
    exit(EXIT_SUCCESS);
@@ -327,6 +369,7 @@ static void get_arginfo(int argc, char *argv[],
    static int max_chunk_size_in_kb = 4 * 1024;
    static int check_dim_info = TRUE;
    static char *filelist = NULL;
+   static int raw_copy = TRUE;
 
    /* Argument table */
    static ArgvInfo argTable[] = {
@@ -350,6 +393,10 @@ static void get_arginfo(int argc, char *argv[],
           "Specify the maximum size of the copy buffer (in kbytes)."},
       {"-filelist", ARGV_STRING, (char *) 1, (char *) &filelist,
        "Specify the name of a file containing input file names (- for stdin)."},
+      {"-raw_copy", ARGV_CONSTANT, (char *) TRUE, (char *) &raw_copy,
+          "Copy voxel values directly when no conversion is needed (default)."},
+      {"-noraw_copy", ARGV_CONSTANT, (char *) FALSE, (char *) &raw_copy,
+          "Always convert voxel values through real values."},
 
       {NULL, ARGV_HELP, (char *) NULL, (char *) NULL, 
           "Output type options:"},
@@ -545,6 +592,7 @@ static void get_arginfo(int argc, char *argv[],
    concat_info->verbose = verbose;
    concat_info->max_memory_use_in_kb = max_chunk_size_in_kb;
    concat_info->check_dim_info = check_dim_info;
+   concat_info->raw_copy = raw_copy;
    concat_info->output_datatype = datatype;
    concat_info->output_is_signed = is_signed;
    concat_info->output_valid_range[0] = valid_range[0];
@@ -754,6 +802,7 @@ static void get_concat_dim_name(Concat_Info *concat_info,
               input_mincid - id of input minc file
               input_curfile - number of current input file
               loop_info - pointer to structure containing loop information
+                 (NULL if the whole file is already available)
 @OUTPUT     : caller_data - updated concat_info structure
 @RETURNS    : (nothing)
 @DESCRIPTION: Routine to get information from each input file.
@@ -761,7 +810,7 @@ static void get_concat_dim_name(Concat_Info *concat_info,
 @GLOBALS    : 
 @CALLS      : 
 @CREATED    : March 9, 1995 (Peter Neelin)
-@MODIFIED   : 
+@MODIFIED   : October 16, 2026 - allow NULL loop_info for raw copying
 ---------------------------------------------------------------------------- */
 static void get_input_file_info(void *caller_data, int input_mincid,
                                 int input_curfile, Loop_Info *loop_info)
@@ -827,7 +876,7 @@ static void get_input_file_info(void *caller_data, int input_mincid,
          }
 
          /* Expand whole file if irregular dimension */
-         if (!regular) {
+         if (!regular && (loop_info != NULL)) {
             ncopts = NC_OPTS_VAL;
             input_mincid = get_info_whole_file(loop_info);
             ncopts = 0;
@@ -873,7 +922,7 @@ static void get_input_file_info(void *caller_data, int input_mincid,
          }
 
          /* Expand whole file if irregular dimension */
-         if (!regular) {
+         if (!regular && (loop_info != NULL)) {
             ncopts = NC_OPTS_VAL;
             input_mincid = get_info_whole_file(loop_info);
             ncopts = 0;
@@ -885,6 +934,7 @@ static void get_input_file_info(void *caller_data, int input_mincid,
          }
 
          /* Allocate space for widths */
+         free(concat_info->file_widths[input_curfile]);
          concat_info->file_widths[input_curfile] =
             malloc(sizeof(double) * dimlength);
 
@@ -961,7 +1011,8 @@ static int get_image_dimension_id(int input_mincid, char *dimension_name)
 @GLOBALS    : 
 @CALLS      : 
 @CREATED    : March 9, 1995 (Peter Neelin)
-@MODIFIED   : 
+@MODIFIED   : October 16, 2026 - moved image-min/max copy to 
+                 copy_minmax_values
 ---------------------------------------------------------------------------- */
 static void do_concat(void *caller_data, long num_voxels, 
                       int input_num_buffers, int input_vector_length,
@@ -972,18 +1023,15 @@ static void do_concat(void *caller_data, long num_voxels,
      /* ARGSUSED */
 {
    Concat_Info *concat_info;
-   int input_mincid, output_mincid, outimgid, inimgid, varid, invarid;
+   int input_mincid, output_mincid, inimgid, varid;
    int ifile;
    int icoord;
    long mindex;
    char dimname[MAX_NC_NAME];
    long instart[MAX_VAR_DIMS], incount[MAX_VAR_DIMS];
    long outstart[MAX_VAR_DIMS], outcount[MAX_VAR_DIMS];
-   long mmstart[MAX_VAR_DIMS];
    int inndims, indim[MAX_VAR_DIMS], dimid;
-   int idim, odim, imm;
-   char *varname;
-   double value;
+   int idim, odim;
 
    /* Check that the arguments are as expected */
    if ((input_num_buffers != 1) || (output_num_buffers != 0)) {
@@ -1013,7 +1061,6 @@ static void do_concat(void *caller_data, long num_voxels,
    /* Get output file info */
    output_mincid = concat_info->output_mincid;
    mindex = concat_info->file_to_dim_order[ifile][icoord];
-   outimgid = ncvarid(output_mincid, MIimage);
 
    /* Write out the coordinates info */
    varid = ncvarid(output_mincid, concat_info->dimension_name);
@@ -1046,6 +1093,44 @@ static void do_concat(void *caller_data, long num_voxels,
    }
 
    /* Copy the image max and min info from the input file */
+   copy_minmax_values(concat_info, input_mincid, instart, outstart);
+
+   /* Copy the data */
+   (void) miicv_put(concat_info->output_icvid, outstart, outcount, 
+                    input_data[0]);
+
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : copy_minmax_values
+@INPUT      : concat_info - pointer to concat_info structure
+              input_mincid - id of input minc file
+              instart - start of a slice in the input image
+              outstart - start of the same slice in the output image
+@OUTPUT     : (nothing)
+@RETURNS    : (nothing)
+@DESCRIPTION: Routine to copy the image-min and image-max values of a slice
+              from the input file to the output file, keeping track of the
+              global min and max.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : March 9, 1995 (Peter Neelin)
+@MODIFIED   : October 16, 2026 - split from do_concat
+---------------------------------------------------------------------------- */
+static void copy_minmax_values(Concat_Info *concat_info, int input_mincid,
+                               long instart[], long outstart[])
+{
+   int output_mincid, inimgid, outimgid, invarid, varid;
+   int imm;
+   long mmstart[MAX_VAR_DIMS];
+   char *varname;
+   double value;
+
+   output_mincid = concat_info->output_mincid;
+   inimgid = ncvarid(input_mincid, MIimage);
+   outimgid = ncvarid(output_mincid, MIimage);
+
    for (imm=0; imm < 2; imm++) {
       if (imm == 0) {
          varname = MIimagemin;
@@ -1078,10 +1163,394 @@ static void do_concat(void *caller_data, long num_voxels,
 
    }
 
-   /* Copy the data */
-   (void) miicv_put(concat_info->output_icvid, outstart, outcount, 
-                    input_data[0]);
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : can_copy_raw
+@INPUT      : concat_info - pointer to concat_info structure
+              num_input_files - number of input files
+              input_files - names of input files
+@OUTPUT     : concat_info - coordinate information filled in (as by
+                 get_input_file_info)
+@RETURNS    : TRUE if the voxel values of all files can be copied 
+              directly to the output file.
+@DESCRIPTION: Routine to check whether the concatenation is just a block
+              copy: all input files must be uncompressed, have the same 
+              datatype, sign and valid range as each other and as the 
+              output (the valid range is not needed for floating-point 
+              data since voxel values are real values), and have the same dimensions in the same order 
+              (apart from the length of the concatenation dimension, which
+              must be the first dimension if it is in the files).
+              Voxel values can then be copied along with the image-min 
+              and image-max values without changing the real values.
+@METHOD     : Only the file headers are read.
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static int can_copy_raw(Concat_Info *concat_info, 
+                        int num_input_files, char *input_files[])
+{
+   Raw_Image_Info first_info, image_info;
+   char *filename;
+   int created_tempfile;
+   int ifile, idim, mincid, matches, is_floating;
+   double default_range[2];
+
+   if (num_input_files < 1) return FALSE;
+   is_floating = FALSE;
+
+   for (ifile=0; ifile < num_input_files; ifile++) {
+
+      /* Open the file, giving up on compressed files */
+      filename = miexpand_file(input_files[ifile], NULL, TRUE, 
+                               &created_tempfile);
+      if (filename == NULL) return FALSE;
+      if (created_tempfile) {
+         (void) remove(filename);
+         free(filename);
+         return FALSE;
+      }
+      ncopts = 0;
+      mincid = miopen(filename, NC_NOWRITE);
+      ncopts = NC_OPTS_VAL;
+      if (mincid == MI_ERROR) {
+         free(filename);
+         return FALSE;
+      }
+
+      /* Check the image variable against the first file */
+      matches = get_raw_image_info(mincid, concat_info->dimension_name,
+                                   &image_info);
+      if (ifile == 0) {
+         first_info = image_info;
+         is_floating = ((first_info.datatype == NC_FLOAT) || 
+                        (first_info.datatype == NC_DOUBLE));
+      }
+      else if (matches) {
+         matches = ((image_info.datatype == first_info.datatype) &&
+                    (image_info.is_signed == first_info.is_signed) &&
+                    (is_floating || 
+                     ((image_info.valid_range[0] == 
+                       first_info.valid_range[0]) &&
+                      (image_info.valid_range[1] == 
+                       first_info.valid_range[1]))) &&
+                    (image_info.ndims == first_info.ndims) &&
+                    (image_info.concat_dim == first_info.concat_dim));
+         for (idim=0; matches && (idim < image_info.ndims); idim++) {
+            matches = 
+               ((strcmp(image_info.dimname[idim], 
+                        first_info.dimname[idim]) == 0) &&
+                ((idim == image_info.concat_dim) ||
+                 (image_info.dimlength[idim] == 
+                  first_info.dimlength[idim])));
+         }
+      }
+
+      /* Get the coordinates */
+      if (matches) {
+         get_input_file_info(concat_info, mincid, ifile, NULL);
+      }
+      (void) miclose(mincid);
+      free(filename);
+
+      if (!matches) return FALSE;
+   }
+
+   /* Check that the output type matches */
+   if (concat_info->output_datatype != MI_ORIGINAL_TYPE) {
+      if (concat_info->output_datatype != first_info.datatype) 
+         return FALSE;
+      if (!is_floating) {
+         if ((concat_info->output_is_signed != FALSE) != 
+             first_info.is_signed)
+            return FALSE;
+         if (concat_info->output_valid_range[1] > 
+             concat_info->output_valid_range[0]) {
+            default_range[0] = concat_info->output_valid_range[0];
+            default_range[1] = concat_info->output_valid_range[1];
+         }
+         else {
+            (void) miget_default_range(first_info.datatype, 
+                                       first_info.is_signed,
+                                       default_range);
+         }
+         if ((default_range[0] != first_info.valid_range[0]) ||
+             (default_range[1] != first_info.valid_range[1]))
+            return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : get_raw_image_info
+@INPUT      : mincid - id of input minc file
+              dimension_name - name of concatenation dimension
+@OUTPUT     : image_info - description of the image variable
+@RETURNS    : TRUE if the image variable can be copied directly along
+              the concatenation dimension, FALSE otherwise.
+@DESCRIPTION: Routine to get the type and shape of the image variable
+              of a file.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static int get_raw_image_info(int mincid, char *dimension_name,
+                              Raw_Image_Info *image_info)
+{
+   int imgid, idim, dim[MAX_VAR_DIMS];
+
+   ncopts = 0;
+   imgid = ncvarid(mincid, MIimage);
+   ncopts = NC_OPTS_VAL;
+   if (imgid == MI_ERROR) return FALSE;
+
+   (void) miget_datatype(mincid, imgid, &image_info->datatype, 
+                         &image_info->is_signed);
+   (void) miget_valid_range(mincid, imgid, image_info->valid_range);
+   (void) ncvarinq(mincid, imgid, NULL, NULL, &image_info->ndims, dim, 
+                   NULL);
+   image_info->concat_dim = -1;
+   for (idim=0; idim < image_info->ndims; idim++) {
+      (void) ncdiminq(mincid, dim[idim], image_info->dimname[idim], 
+                      &image_info->dimlength[idim]);
+      if (strcmp(image_info->dimname[idim], dimension_name) == 0)
+         image_info->concat_dim = idim;
+   }
+   image_info->nimgdims = 2;
+   if ((image_info->ndims > 0) &&
+       (strcmp(image_info->dimname[image_info->ndims-1], 
+               MIvector_dimension) == 0))
+      image_info->nimgdims++;
+   if (image_info->ndims < image_info->nimgdims) return FALSE;
+
+   /* The concatenation dimension must be the slowest-varying one and 
+      must not be an image dimension */
+   if ((image_info->concat_dim > 0) ||
+       ((image_info->concat_dim == 0) && 
+        (image_info->ndims <= image_info->nimgdims)))
+      return FALSE;
+
+   return TRUE;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : copy_raw_data
+@INPUT      : concat_info - pointer to concat_info structure (checked by 
+                 can_copy_raw)
+              first_mincid - id of first input file (header only)
+              num_input_files - number of input files
+              input_files - names of input files
+@OUTPUT     : (nothing)
+@RETURNS    : (nothing)
+@DESCRIPTION: Routine to concatenate files by copying the voxel values
+              of each file straight into its place in the output file.
+@METHOD     : Each file is copied in blocks of whole rows of at most
+              max_memory_use_in_kb, never spanning more than one position
+              along the concatenation dimension. All reads and writes
+              are done in this one thread since the MINC and netCDF 
+              libraries are not thread safe.
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void copy_raw_data(Concat_Info *concat_info, int first_mincid,
+                          int num_input_files, char *input_files[])
+{
+   int ndims, idim, ifile, outimgid, input_mincid, inimgid;
+   int dim[MAX_VAR_DIMS];
+   nc_type datatype;
+   void *data;
+   long dimlength[MAX_VAR_DIMS], block_count[MAX_VAR_DIMS];
+   long block_size, max_block_size;
+   long start[MAX_VAR_DIMS], count[MAX_VAR_DIMS];
+   long outstart[MAX_VAR_DIMS], outcount[MAX_VAR_DIMS];
+
+   /* Sort the coords and create the output file */
+   sort_coords(concat_info);
+   create_concat_file(first_mincid, concat_info);
+   (void) miclose(first_mincid);
+
+   /* Get the input image shape from the output image, leaving out the 
+      concatenation dimension */
+   outimgid = ncvarid(concat_info->output_mincid, MIimage);
+   (void) ncvarinq(concat_info->output_mincid, outimgid, NULL, &datatype,
+                   &ndims, dim, NULL);
+   if (!concat_info->dimension_in_input_file) {
+      ndims--;
+      for (idim=0; idim < ndims; idim++) dim[idim] = dim[idim+1];
+   }
+   for (idim=0; idim < ndims; idim++) {
+      (void) ncdiminq(concat_info->output_mincid, dim[idim], NULL, 
+                      &dimlength[idim]);
+   }
+   if (concat_info->dimension_in_input_file) dimlength[0] = 1;
+
+   /* Work out the block shape, taking whole dimensions from the fastest
+      varying one until the block is full */
+   max_block_size = 1024 * concat_info->max_memory_use_in_kb / 
+      nctypelen(datatype);
+   block_size = 1;
+   for (idim=ndims-1; idim >= 0; idim--) {
+      if (block_size * dimlength[idim] <= max_block_size) {
+         block_count[idim] = dimlength[idim];
+      }
+      else {
+         block_count[idim] = max_block_size / block_size;
+         if (block_count[idim] < 1) block_count[idim] = 1;
+         max_block_size = 0;
+      }
+      block_size *= block_count[idim];
+   }
+
+   data = malloc((size_t) block_size * nctypelen(datatype));
+
+   /* Loop over files */
+   for (ifile=0; ifile < num_input_files; ifile++) {
+
+      input_mincid = open_raw_file(concat_info, ifile, input_files[ifile],
+                                   dimlength);
+      inimgid = ncvarid(input_mincid, MIimage);
+
+      /* Loop over blocks, copying each one to its place in the output */
+      for (idim=0; idim < ndims; idim++) start[idim] = 0;
+      do {
+         for (idim=0; idim < ndims; idim++) {
+            count[idim] = MIN(block_count[idim], 
+                              dimlength[idim] - start[idim]);
+         }
+         (void) ncvarget(input_mincid, inimgid, start, count, data);
+         get_raw_output_start(concat_info, ifile, ndims, start, count,
+                              outstart, outcount);
+         (void) ncvarput(concat_info->output_mincid, outimgid, 
+                         outstart, outcount, data);
+
+         for (idim=ndims-1; idim >= 0; idim--) {
+            start[idim] += block_count[idim];
+            if (start[idim] < dimlength[idim]) break;
+            start[idim] = 0;
+         }
+      } while (idim >= 0);
 
+      (void) miclose(input_mincid);
+   }
+
+   /* Free the buffer */
+   free(data);
+
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : open_raw_file
+@INPUT      : concat_info - pointer to concat_info structure
+              ifile - number of the input file
+              filename - name of the input file
+@OUTPUT     : dimlength - lengths of the image dimensions of the file
+@RETURNS    : id of the opened input file
+@DESCRIPTION: Routine to open an input file for raw copying and write out 
+              its coordinates and image-min and image-max values.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static int open_raw_file(Concat_Info *concat_info, int ifile, 
+                         char *filename, long dimlength[])
+{
+   int input_mincid, output_mincid, varid, inimgid;
+   int ndims, dim[MAX_VAR_DIMS], nmmdims, idim, icoord;
+   long mindex, instart[MAX_VAR_DIMS], outstart[MAX_VAR_DIMS];
+   char dimname[MAX_NC_NAME];
+
+   if (concat_info->verbose) {
+      (void) fprintf(stderr, "Copying file %s\n", filename);
+   }
+
+   /* Open the file */
+   input_mincid = miopen(filename, NC_NOWRITE);
+   inimgid = ncvarid(input_mincid, MIimage);
+   (void) ncvarinq(input_mincid, inimgid, NULL, NULL, &ndims, dim, NULL);
+   for (idim=0; idim < ndims; idim++) {
+      (void) ncdiminq(input_mincid, dim[idim], dimname, &dimlength[idim]);
+   }
+
+   /* Write out the coordinates info */
+   output_mincid = concat_info->output_mincid;
+   for (icoord=0; icoord < concat_info->num_file_coords[ifile]; icoord++) {
+      mindex = concat_info->file_to_dim_order[ifile][icoord];
+      varid = ncvarid(output_mincid, concat_info->dimension_name);
+      (void) mivarput1(output_mincid, varid, &mindex, NC_DOUBLE, NULL,
+                       &concat_info->file_coords[ifile][icoord]);
+      if (concat_info->have_widths) {
+         (void) strcat(strcpy(dimname, concat_info->dimension_name), 
+                       DIM_WIDTH_SUFFIX);
+         varid = ncvarid(output_mincid, dimname);
+         (void) mivarput1(output_mincid, varid, &mindex, NC_DOUBLE, NULL,
+                          &concat_info->file_widths[ifile][icoord]);
+      }
+   }
+
+   /* Copy the image-min and image-max values for each slice, looping 
+      over the non-image dimensions */
+   nmmdims = ndims - 2;
+   (void) ncdiminq(input_mincid, dim[ndims-1], dimname, NULL);
+   if (strcmp(dimname, MIvector_dimension) == 0) nmmdims--;
+   for (idim=0; idim < ndims; idim++) instart[idim] = 0;
+   do {
+      get_raw_output_start(concat_info, ifile, ndims, instart, NULL,
+                           outstart, NULL);
+      copy_minmax_values(concat_info, input_mincid, instart, outstart);
+      for (idim=nmmdims-1; idim >= 0; idim--) {
+         instart[idim]++;
+         if (instart[idim] < dimlength[idim]) break;
+         instart[idim] = 0;
+      }
+   } while (idim >= 0);
+
+   return input_mincid;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : get_raw_output_start
+@INPUT      : concat_info - pointer to concat_info structure
+              ifile - number of the input file
+              in_ndims - number of input image dimensions
+              instart - start of hyperslab in input image
+              incount - size of hyperslab in input image (may be NULL)
+@OUTPUT     : outstart - start of hyperslab in output image
+              outcount - size of hyperslab in output image (may be NULL)
+@RETURNS    : (nothing)
+@DESCRIPTION: Routine to find where an input hyperslab goes in the output
+              image. The hyperslab must not span more than one position
+              along the concatenation dimension.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void get_raw_output_start(Concat_Info *concat_info, int ifile,
+                                 int in_ndims, long instart[], 
+                                 long incount[],
+                                 long outstart[], long outcount[])
+{
+   int idim, odim;
+
+   odim = (concat_info->dimension_in_input_file ? 0 : 1);
+   for (idim=0; idim < in_ndims; idim++) {
+      outstart[idim + odim] = instart[idim];
+      if (outcount != NULL) outcount[idim + odim] = incount[idim];
+   }
+   outstart[0] = concat_info->file_to_dim_order[ifile]
+      [(concat_info->dimension_in_input_file ? instart[0] : 0)];
+   if (outcount != NULL) outcount[0] = 1;
 }
 
 /* ----------------------------- MNI Header -----------------------------------
@@ -8,7 +8,7 @@
 @GLOBALS    : 
 @CALLS      : 
 @CREATED    : June 10, 1993 (Peter Neelin)
-@MODIFIED   : 
+@MODIFIED   : October 16, 2026 - added -batch extraction of many hyperslabs
  * $Log: mincextract.c,v $
  * Revision 6.9  2008-01-17 02:33:02  rotor
  *  * removed all rcsids
@@ -109,6 +109,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/types.h>
+#include <fcntl.h>
 #include <minc.h>
 #include <limits.h>
 #include <float.h>
@@ -129,12 +131,36 @@
 #define TYPE_FLOAT  4
 #define TYPE_DOUBLE 5
 #define TYPE_FILE   6
+#define DEFAULT_MAX_CHUNK_SIZE_IN_KB (64 * 1024)
+#define MAX_MERGE_WASTE 2   /* merged read size / size of its hyperslabs */
+#define MAX_BATCH_LINE 4096
 static nc_type nc_type_list[8] = {
    NC_DOUBLE, NC_BYTE, NC_SHORT, NC_INT, NC_FLOAT, NC_DOUBLE, NC_DOUBLE
 };
 
+/* Structure for one hyperslab of a batch. The start and count vectors
+   point into one array holding 2*ndims values per hyperslab. */
+typedef struct {
+   long *start;
+   long *count;
+   long nelements;
+   long offset;                 /* bytes from start of batch output */
+} Batch_Request;
+
 /* Function declarations */
 static int get_arg_vector(char *dst, char *key, char *nextArg);
+static Batch_Request *read_batch_requests(char *batch_file, int ndims,
+                                          long dim_size[], long *nrequests,
+                                          long **vectors);
+static int compare_requests(const void *request1, const void *request2);
+static int requests_touch(int ndims, long start[], long end[],
+                          Batch_Request *request);
+static void copy_patch(int ndims, int element_size, 
+                       long box_start[], long box_count[], char *box_data,
+                       Batch_Request *request, char *patch_data);
+static void extract_batch(int icvid, int ndims, long dim_size[],
+                          int element_size, char *batch_file,
+                          char *index_file, long max_chunk_size);
 
 /* Variables used for argument parsing */
 static int arg_odatatype = TYPE_ASCII;
@@ -149,6 +175,12 @@ static int xdirection = INT_MAX;
 static int ydirection = INT_MAX;
 static int zdirection = INT_MAX;
 static int default_direction = INT_MAX;
+static char *batch_file = NULL;
+static char *index_file = NULL;
+static int max_chunk_size_in_kb = DEFAULT_MAX_CHUNK_SIZE_IN_KB;
+
+/* Number of dimensions for sorting batch hyperslabs */
+static int batch_ndims = 0;
 
 /* Argument table */
 ArgvInfo argTable[] = {
@@ -188,6 +220,13 @@ ArgvInfo argTable[] = {
        "Specifies corner of hyperslab (C conventions for indices)"},
    {"-count", ARGV_FUNC, (char *) get_arg_vector, (char *) hs_count,
        "Specifies edge lengths of hyperslab to read"},
+   {"-batch", ARGV_STRING, (char *) 1, (char *) &batch_file,
+       "Read a list of hyperslabs (start and count vectors) from a file (- for stdin)"},
+   {"-index", ARGV_STRING, (char *) 1, (char *) &index_file,
+       "Write an index of the hyperslabs extracted with -batch to a file"},
+   {"-max_chunk_size_in_kb", ARGV_INT, (char *) 1, 
+       (char *) &max_chunk_size_in_kb,
+       "Specify the maximum size of merged reads for -batch (in kb)"},
    {"-positive_direction", ARGV_CONSTANT, (char *) MI_ICV_POSITIVE, 
        (char *) &default_direction,
        "Flip images to always have positive direction."},
@@ -279,8 +318,6 @@ int main(int argc, char *argv[])
    (void) ncvarinq(mincid, imgid, NULL, NULL, &ndims, dims, NULL);
    (void) miget_datatype(mincid, imgid, &datatype, &is_signed);
 
-   /* Check if arguments set */
-
    /* Check the start and count arguments */
    for (nstart=0; (nstart<MAX_VAR_DIMS) && (hs_start[nstart]!=LONG_MIN); 
         nstart++) {}
@@ -292,6 +329,18 @@ int main(int argc, char *argv[])
   "Dimensions of start or count vectors not equal to dimensions in file.\n");
       exit(EXIT_FAILURE);
    }
+   if ((batch_file != NULL) && ((nstart != 0) || (ncount != 0))) {
+      (void) fprintf(stderr, "Do not use -start or -count with -batch.\n");
+      exit(EXIT_FAILURE);
+   }
+   if ((batch_file != NULL) && (arg_odatatype == TYPE_ASCII)) {
+      (void) fprintf(stderr, "-batch needs a binary output type.\n");
+      exit(EXIT_FAILURE);
+   }
+   if ((index_file != NULL) && (batch_file == NULL)) {
+      (void) fprintf(stderr, "-index can only be used with -batch.\n");
+      exit(EXIT_FAILURE);
+   }
 
    /* Get output data type */
    output_datatype = nc_type_list[arg_odatatype];
@@ -355,6 +404,18 @@ int main(int argc, char *argv[])
    }
    (void) miicv_attach(icvid, mincid, imgid);
 
+   /* Extract all the hyperslabs of a batch with the file and icv open */
+   if (batch_file != NULL) {
+      for (idim=0; idim < ndims; idim++) {
+         (void) ncdiminq(mincid, dims[idim], NULL, &end[idim]);
+      }
+      extract_batch(icvid, ndims, end, nctypelen(output_datatype),
+                    batch_file, index_file, (long) max_chunk_size_in_kb * 1024);
+      (void) miclose(mincid);
+      (void) miicv_free(icvid);
+      exit(EXIT_SUCCESS);
+   }
+
    /* Set input file start, count and end vectors for reading a slice
       at a time */
    nelements = 1;
@@ -501,3 +562,409 @@ static int get_arg_vector(char *dst, char *key, char *nextArg)
 
    return TRUE;
 }
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : read_batch_requests
+@INPUT      : batch_file - name of file with one hyperslab per line
+                 (- for stdin)
+              ndims - number of image dimensions
+              dim_size - size of each image dimension
+@OUTPUT     : nrequests - number of hyperslabs read
+              vectors - array of start and count values pointed to by the
+                 hyperslabs (free it with them)
+@RETURNS    : array of hyperslabs, with nelements set
+@DESCRIPTION: Reads a list of hyperslabs. Each line gives the ndims start
+              values followed by the ndims count values, separated by
+              spaces or commas. Blank lines and lines starting with # are
+              skipped. Exits on error.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static Batch_Request *read_batch_requests(char *batch_file, int ndims,
+                                          long dim_size[], long *nrequests,
+                                          long **vectors)
+{
+   FILE *fp;
+   char line[MAX_BATCH_LINE];
+   char *cur, *prev;
+   long values[2*MAX_VAR_DIMS];
+   int nvals, idim, lineno;
+   long nalloc, ireq;
+   Batch_Request *requests, *request;
+   long *start, *count;
+
+   /* Open the file */
+   if (strcmp(batch_file, "-") == 0)
+      fp = stdin;
+   else if ((fp = fopen(batch_file, "r")) == NULL) {
+      (void) fprintf(stderr, "Error opening batch file %s.\n", batch_file);
+      exit(EXIT_FAILURE);
+   }
+
+   /* Loop over lines */
+   nalloc = 0;
+   *nrequests = 0;
+   requests = NULL;
+   *vectors = NULL;
+   lineno = 0;
+   while (fgets(line, sizeof(line), fp) != NULL) {
+      lineno++;
+
+      /* Get the values on the line */
+      cur = line;
+      nvals = 0;
+      while (TRUE) {
+         while (isspace(*cur) || (*cur == VECTOR_SEPARATOR)) cur++;
+         if ((*cur == '\0') || (*cur == '#')) break;
+         prev = cur;
+         if (nvals < 2*ndims)
+            values[nvals] = strtol(prev, &cur, 0);
+         else
+            (void) strtol(prev, &cur, 0);
+         if (cur == prev) {
+            nvals = -1;
+            break;
+         }
+         nvals++;
+      }
+      if (nvals == 0) continue;
+      if (nvals != 2*ndims) {
+         (void) fprintf(stderr, 
+            "Expected %d start and %d count values on line %d of %s.\n",
+                        ndims, ndims, lineno, batch_file);
+         exit(EXIT_FAILURE);
+      }
+
+      /* Add the hyperslab */
+      if (*nrequests >= nalloc) {
+         nalloc = (nalloc > 0) ? 2*nalloc : 1024;
+         requests = realloc(requests, sizeof(*requests) * nalloc);
+         *vectors = realloc(*vectors, sizeof(**vectors) * 2*ndims * nalloc);
+         if ((requests == NULL) || (*vectors == NULL)) {
+            (void) fprintf(stderr, "Out of memory reading batch file.\n");
+            exit(EXIT_FAILURE);
+         }
+      }
+      request = &requests[*nrequests];
+      request->nelements = 1;
+      start = &(*vectors)[2*ndims * *nrequests];
+      count = &start[ndims];
+      for (idim=0; idim < ndims; idim++) {
+         start[idim] = values[idim];
+         count[idim] = values[ndims + idim];
+         if ((start[idim] < 0) || (count[idim] <= 0) ||
+             (start[idim] + count[idim] > dim_size[idim])) {
+            (void) fprintf(stderr, 
+               "start or count out of range on line %d of %s\n",
+                           lineno, batch_file);
+            exit(EXIT_FAILURE);
+         }
+         request->nelements *= count[idim];
+      }
+      (*nrequests)++;
+   }
+
+   if (fp != stdin) (void) fclose(fp);
+
+   /* Point the hyperslabs at their vectors, now that the array has
+      stopped moving */
+   for (ireq=0; ireq < *nrequests; ireq++) {
+      requests[ireq].start = &(*vectors)[2*ndims * ireq];
+      requests[ireq].count = &requests[ireq].start[ndims];
+   }
+
+   return requests;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : compare_requests
+@INPUT      : request1, request2 - pointers to pointers to hyperslabs
+@OUTPUT     : (none)
+@RETURNS    : -1, 0 or 1
+@DESCRIPTION: qsort comparison of hyperslabs by start (slowest dimension
+              first), to put hyperslabs that could be merged together.
+@METHOD     : 
+@GLOBALS    : batch_ndims
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static int compare_requests(const void *request1, const void *request2)
+{
+   Batch_Request *r1 = *(Batch_Request **) request1;
+   Batch_Request *r2 = *(Batch_Request **) request2;
+   int idim;
+
+   for (idim=0; idim < batch_ndims; idim++) {
+      if (r1->start[idim] != r2->start[idim])
+         return (r1->start[idim] < r2->start[idim]) ? -1 : 1;
+   }
+   return (r1 < r2) ? -1 : ((r1 > r2) ? 1 : 0);
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : requests_touch
+@INPUT      : ndims - number of dimensions
+              start, end - box of a group of hyperslabs
+              request - hyperslab to check
+@OUTPUT     : (none)
+@RETURNS    : TRUE if the hyperslab overlaps or is adjacent to the box in
+              every dimension
+@DESCRIPTION: Checks whether a hyperslab can be merged into a read.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static int requests_touch(int ndims, long start[], long end[],
+                          Batch_Request *request)
+{
+   int idim;
+
+   for (idim=0; idim < ndims; idim++) {
+      if ((request->start[idim] > end[idim]) ||
+          (request->start[idim] + request->count[idim] < start[idim]))
+         return FALSE;
+   }
+   return TRUE;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : copy_patch
+@INPUT      : ndims - number of dimensions
+              element_size - size of a value in bytes
+              box_start, box_count - hyperslab held in box_data
+              box_data - values read for the box
+              request - hyperslab to copy (must lie inside the box)
+@OUTPUT     : patch_data - values of the hyperslab
+@RETURNS    : (nothing)
+@DESCRIPTION: Copies a hyperslab out of a larger one that was read, a row
+              (fastest dimension) at a time.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void copy_patch(int ndims, int element_size, 
+                       long box_start[], long box_count[], char *box_data,
+                       Batch_Request *request, char *patch_data)
+{
+   long box_stride[MAX_VAR_DIMS], cur[MAX_VAR_DIMS];
+   long offset;
+   size_t row_size;
+   int idim;
+
+   /* Get the strides of the box in bytes */
+   box_stride[ndims-1] = element_size;
+   for (idim=ndims-1; idim > 0; idim--) {
+      box_stride[idim-1] = box_stride[idim] * box_count[idim];
+   }
+   row_size = (size_t) request->count[ndims-1] * element_size;
+
+   /* Loop over rows */
+   for (idim=0; idim < ndims; idim++) cur[idim] = 0;
+   while (cur[0] < request->count[0]) {
+
+      offset = 0;
+      for (idim=0; idim < ndims; idim++) {
+         offset += (request->start[idim] + cur[idim] - box_start[idim]) *
+            box_stride[idim];
+      }
+      (void) memcpy(patch_data, &box_data[offset], row_size);
+      patch_data += row_size;
+
+      /* Increment the row counter (fastest dimension is done by memcpy) */
+      idim = ndims-2;
+      if (idim < 0) break;
+      cur[idim]++;
+      while ((idim > 0) && (cur[idim] >= request->count[idim])) {
+         cur[idim] = 0;
+         idim--;
+         cur[idim]++;
+      }
+   }
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : extract_batch
+@INPUT      : icvid - attached image conversion variable
+              ndims - number of image dimensions
+              dim_size - size of each image dimension
+              element_size - size of an output value in bytes
+              batch_file - file with the list of hyperslabs
+              index_file - file for the index of the output (or NULL)
+              max_chunk_size - maximum size of a merged read in bytes
+@OUTPUT     : (none)
+@RETURNS    : (nothing)
+@DESCRIPTION: Writes a list of hyperslabs to stdout, packed one after the
+              other in the order they were given. Overlapping or adjacent
+              hyperslabs are read together with one miicv_get, as long as
+              the merged read is no more than MAX_MERGE_WASTE times the
+              size of the hyperslabs in it. The index
+              has one line per hyperslab giving its number, byte offset,
+              byte length, start and count.
+@METHOD     : When stdout can seek (and is not opened for appending, which
+              would send every write to the end of the file), the 
+              hyperslabs are sorted by start so that hyperslabs anywhere
+              in the list can be merged and each is written at its own
+              offset. Otherwise only consecutive hyperslabs are merged.
+@GLOBALS    : batch_ndims
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void extract_batch(int icvid, int ndims, long dim_size[],
+                          int element_size, char *batch_file,
+                          char *index_file, long max_chunk_size)
+{
+   Batch_Request *requests, **order;
+   long *vectors;
+   long nrequests, ireq, jreq, kreq;
+   long box_start[MAX_VAR_DIMS], box_end[MAX_VAR_DIMS];
+   long box_count[MAX_VAR_DIMS], new_start, new_end;
+   long box_nelements, new_nelements, offset, max_patch;
+   long member_nelements;
+   off_t base;
+   int can_seek, flags, idim;
+   char *box_data, *patch_data;
+   size_t box_alloc;
+   FILE *fp;
+
+   /* Get the hyperslabs and their place in the output */
+   requests = read_batch_requests(batch_file, ndims, dim_size, &nrequests,
+                                  &vectors);
+   order = malloc(sizeof(*order) * (nrequests + 1));
+   offset = 0;
+   max_patch = 0;
+   for (ireq=0; ireq < nrequests; ireq++) {
+      requests[ireq].offset = offset;
+      offset += requests[ireq].nelements * element_size;
+      if (requests[ireq].nelements > max_patch)
+         max_patch = requests[ireq].nelements;
+      order[ireq] = &requests[ireq];
+   }
+
+   /* Sort the hyperslabs if we can write them anywhere in the output */
+   base = ftello(stdout);
+   flags = fcntl(fileno(stdout), F_GETFL);
+   can_seek = ((base >= 0) && (flags != -1) && !(flags & O_APPEND) &&
+               (fseeko(stdout, base, SEEK_SET) == 0));
+   if (can_seek) {
+      batch_ndims = ndims;
+      qsort(order, nrequests, sizeof(*order), compare_requests);
+   }
+
+   patch_data = malloc((size_t) max_patch * element_size + 1);
+   box_data = NULL;
+   box_alloc = 0;
+
+   /* Loop over groups of hyperslabs */
+   for (ireq=0; ireq < nrequests; ireq=jreq) {
+
+      /* Start with the first hyperslab */
+      box_nelements = order[ireq]->nelements;
+      member_nelements = box_nelements;
+      for (idim=0; idim < ndims; idim++) {
+         box_start[idim] = order[ireq]->start[idim];
+         box_end[idim] = box_start[idim] + order[ireq]->count[idim];
+      }
+
+      /* Merge following hyperslabs while the read does not get too big
+         or hold too much data that was not asked for */
+      for (jreq=ireq+1; jreq < nrequests; jreq++) {
+         if (!requests_touch(ndims, box_start, box_end, order[jreq]))
+            break;
+         new_nelements = 1;
+         for (idim=0; idim < ndims; idim++) {
+            new_start = order[jreq]->start[idim];
+            new_end = new_start + order[jreq]->count[idim];
+            if (new_start > box_start[idim]) new_start = box_start[idim];
+            if (new_end < box_end[idim]) new_end = box_end[idim];
+            new_nelements *= new_end - new_start;
+         }
+         if ((new_nelements * element_size > max_chunk_size) ||
+             (new_nelements > MAX_MERGE_WASTE *
+              (member_nelements + order[jreq]->nelements)))
+            break;
+         box_nelements = new_nelements;
+         member_nelements += order[jreq]->nelements;
+         for (idim=0; idim < ndims; idim++) {
+            new_end = order[jreq]->start[idim] + order[jreq]->count[idim];
+            if (order[jreq]->start[idim] < box_start[idim])
+               box_start[idim] = order[jreq]->start[idim];
+            if (new_end > box_end[idim])
+               box_end[idim] = new_end;
+         }
+      }
+
+      /* Read the merged hyperslab */
+      for (idim=0; idim < ndims; idim++) {
+         box_count[idim] = box_end[idim] - box_start[idim];
+      }
+      if ((size_t) box_nelements * element_size > box_alloc) {
+         box_alloc = (size_t) box_nelements * element_size;
+         free(box_data);
+         box_data = malloc(box_alloc);
+         if (box_data == NULL) {
+            (void) fprintf(stderr, "Out of memory reading hyperslabs.\n");
+            exit(EXIT_FAILURE);
+         }
+      }
+      (void) miicv_get(icvid, box_start, box_count, box_data);
+
+      /* Write out each of its hyperslabs */
+      for (kreq=ireq; kreq < jreq; kreq++) {
+         copy_patch(ndims, element_size, box_start, box_count, box_data,
+                    order[kreq], patch_data);
+         if (can_seek && 
+             (fseeko(stdout, base + (off_t) order[kreq]->offset, 
+                     SEEK_SET) != 0)) {
+            (void) fprintf(stderr, "Error writing data.\n");
+            exit(EXIT_FAILURE);
+         }
+         if (fwrite(patch_data, (size_t) element_size, 
+                    (size_t) order[kreq]->nelements, stdout)
+             != order[kreq]->nelements) {
+            (void) fprintf(stderr, "Error writing data.\n");
+            exit(EXIT_FAILURE);
+         }
+      }
+   }
+   if (can_seek) (void) fseeko(stdout, base + (off_t) offset, SEEK_SET);
+   (void) fflush(stdout);
+
+   /* Write out the index */
+   if (index_file != NULL) {
+      if ((fp = fopen(index_file, "w")) == NULL) {
+         (void) fprintf(stderr, "Error opening index file %s.\n", index_file);
+         exit(EXIT_FAILURE);
+      }
+      for (ireq=0; ireq < nrequests; ireq++) {
+         (void) fprintf(fp, "%ld %ld %ld", ireq, requests[ireq].offset,
+                        requests[ireq].nelements * element_size);
+         for (idim=0; idim < ndims; idim++)
+            (void) fprintf(fp, "%c%ld", (idim == 0) ? ' ' : VECTOR_SEPARATOR,
+                           requests[ireq].start[idim]);
+         for (idim=0; idim < ndims; idim++)
+            (void) fprintf(fp, "%c%ld", (idim == 0) ? ' ' : VECTOR_SEPARATOR,
+                           requests[ireq].count[idim]);
+         (void) fprintf(fp, "\n");
+      }
+      if (fclose(fp) != 0) {
+         (void) fprintf(stderr, "Error writing index file %s.\n", index_file);
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   /* Clean up */
+   free(box_data);
+   free(patch_data);
+   free(order);
+   free(requests);
+   free(vectors);
+}
@@ -99,6 +99,7 @@
 #include <ParseArgv.h>
 #include <time_stamp.h>
 #include <voxel_loop.h>
+#include <parallel_voxel_loop.h>
 
 #ifndef TRUE
 #  define TRUE 1
@@ -108,6 +109,11 @@
 #define DEFAULT_RANGE DBL_MAX
 #define NCOPTS_DEFAULT NC_VERBOSE | NC_FATAL
 
+/* Largest range of integer keys given a direct index for a discrete 
+   table, and number of index buckets per entry for a continuous table */
+#define MAX_DIRECT_INDEX_SIZE (16L * 1024L * 1024L)
+#define BUCKETS_PER_ENTRY 4
+
 /* Types */
 typedef enum {LU_TABLE, LU_GRAY, LU_HOTMETAL, LU_SPECTRAL} Lookup_Type;
 
@@ -119,9 +125,23 @@ typedef struct {
    int free_data;
 } Lookup_Table;
 
+/* Index into a lookup table. For a discrete table, entry[i] is the 
+   table entry for key first_key + i (-1 if none). For a continuous table,
+   the range of keys is cut into nbuckets equal buckets and entry[i] is 
+   the table entry found for the start of bucket i. */
+typedef struct {
+   int discrete;
+   long nbuckets;
+   double first_key;
+   double last_key;
+   double scale;
+   int *entry;
+} Lookup_Index;
+
 /* Structure for lookup information */
 typedef struct {
    Lookup_Table *lookup_table;
+   Lookup_Index *lookup_index;
    double *null_value;
    int invert;
    int discrete;
@@ -146,8 +166,15 @@ static void do_lookup(void *caller_data, long num_voxels,
                       int output_num_buffers, int output_vector_length,
                       double *output_data[], Loop_Info *loop_info);
 static void lookup_in_table(double index, Lookup_Table *lookup_table,
+                            Lookup_Index *lookup_index,
                             int discrete_values, double null_value[],
                             double output_value[]);
+static Lookup_Index *create_lookup_index(Lookup_Table *lookup_table,
+                                         int discrete_values);
+static void free_lookup_index(Lookup_Index *lookup_index);
+static int search_table(double index, Lookup_Table *lookup_table);
+static int find_table_entry(double index, Lookup_Table *lookup_table,
+                            Lookup_Index *lookup_index);
 static char *get_next_line(char *line, int linelen, FILE *fp, char **string);
 static int sorting_function(const void *value1, const void *value2);
 
@@ -210,6 +237,7 @@ static Lookup_Table hotmetal_lookup = {
 /* Argument variables */
 static int clobber = FALSE;
 static int verbose = TRUE;
+static int nthreads = 1;
 static nc_type datatype = MI_ORIGINAL_TYPE;
 static int is_signed = FALSE;
 static double valid_range[2] = {0.0, 0.0};
@@ -241,6 +269,8 @@ ArgvInfo argTable[] = {
        "Print out log messages (default)."},
    {"-quiet", ARGV_CONSTANT, (char *) FALSE, (char *) &verbose,
        "Do not print out log messages."},
+   {"-threads", ARGV_INT, (char *) 1, (char *) &nthreads,
+       "Number of threads used to process each buffer (default 1)."},
    {"-buffer_size", ARGV_INT, (char *) 1, (char *) &buffer_size,
        "Set the internal buffer size (in kb)."},
    {"-filetype", ARGV_CONSTANT, (char *) MI_ORIGINAL_TYPE, (char *) &datatype,
@@ -335,6 +365,17 @@ int main(int argc, char *argv[])
       }
    }
 
+   /* Check the table and index it */
+   if ((lookup_data.lookup_table->nentries < 1) || 
+       (lookup_data.lookup_table->vector_length < 1)) {
+      (void) fprintf(stderr, "Bad table size %d x %d\n", 
+                     lookup_data.lookup_table->nentries, 
+                     lookup_data.lookup_table->vector_length);
+      exit(EXIT_FAILURE);
+   }
+   lookup_data.lookup_index = 
+      create_lookup_index(lookup_data.lookup_table, discrete_lookup);
+
    /* Get the null value */
    lookup_data.null_value = 
       get_null_value(lookup_data.lookup_table->vector_length, 
@@ -372,11 +413,12 @@ int main(int argc, char *argv[])
    set_loop_first_input_mincid(loop_options, inmincid);
 
    /* Do loop */
-   voxel_loop(1, &infile, 1, &outfile, arg_string, loop_options,
-              do_lookup, (void *) &lookup_data);
+   parallel_voxel_loop(nthreads, NULL, 1, &infile, 1, &outfile, 
+                       arg_string, loop_options, do_lookup, (void *) &lookup_data);
 
    /* Free stuff */
    if (lookup_data.null_value != NULL) free(lookup_data.null_value);
+   free_lookup_index(lookup_data.lookup_index);
    if (lookup_data.lookup_table->free_data) {
       free(lookup_data.lookup_table->table);
       free(lookup_data.lookup_table);
@@ -876,6 +918,7 @@ static void do_lookup(void *caller_data, long num_voxels,
 
       /* Look it up */
       lookup_in_table(lookup_value, lookup_data->lookup_table,
+                      lookup_data->lookup_index,
                       lookup_data->discrete, lookup_data->null_value,
                       &output_data[0][ivoxel*output_vector_length]);
    }
@@ -888,6 +931,7 @@ static void do_lookup(void *caller_data, long num_voxels,
 @NAME       : lookup_in_table
 @INPUT      : index - value to look up in table
               lookup_table - the lookup table (big surprise!)
+              lookup_index - index into the table (may be NULL)
               discrete_values - flag indicating whether the table should
                  be considered continuous in the range 0 to 1 (FALSE) or 
                  discrete, with integer values that should be rounded (TRUE).
@@ -905,59 +949,31 @@ static void do_lookup(void *caller_data, long num_voxels,
 @GLOBALS    : 
 @CALLS      : 
 @CREATED    : December 8, 1994 (Peter Neelin)
-@MODIFIED   : 
+@MODIFIED   : October 16, 2026 - use the lookup index
 ---------------------------------------------------------------------------- */
 static void lookup_in_table(double index, Lookup_Table *lookup_table,
+                            Lookup_Index *lookup_index,
                             int discrete_values, double null_value[],
                             double output_value[])
 {
    int vector_length, nentries;
-   int start, length, mid;
+   int start;
    int offset, offset1, offset2, ivalue;
    double value1, value2, *result, frac, rfrac, denom;
 
-   /* Check for bad lookup table */
    nentries = lookup_table->nentries;
    vector_length = lookup_table->vector_length;
-   if ((nentries < 1) || (vector_length < 1)) {
-      (void) fprintf(stderr, "Bad table size %d x %d\n", 
-                     nentries, vector_length);
-      exit(EXIT_FAILURE);
-   }
 
    /* Round values if needed */
    if (discrete_values) index = rint(index);
 
-   /* Search the table for the value */
-   start = 0;
-   length = nentries;
-   while (length > 1) {
-      mid = start + length / 2;
-      offset = mid*(vector_length+1);
-      if (index < lookup_table->table[offset]) {
-         length = mid - start;
-      }
-      else {
-         length = start + length - mid;
-         start = mid;
-      }
-   }
-
-   /* Add a special check for the end of the table */
-   if (nentries > 1) {
-      offset1 = vector_length+1;
-      offset2 = (nentries-2) * (vector_length+1);
-      if ((start == 0) && (index == lookup_table->table[offset1]))
-         start = 1;
-      else if ((start == nentries-1) && 
-               (index == lookup_table->table[offset2]))
-         start = nentries-2;
-   }
+   /* Find the table entry */
+   start = find_table_entry(index, lookup_table, lookup_index);
 
    /* Save the value */
    offset = start*(vector_length+1);
    if (discrete_values) {
-      if (index == lookup_table->table[offset])
+      if ((start >= 0) && (index == lookup_table->table[offset]))
          result = &lookup_table->table[offset+1];
       else
          result = null_value;
@@ -992,3 +1008,222 @@ static void lookup_in_table(double index, Lookup_Table *lookup_table,
    }
 }
 
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : search_table
+@INPUT      : index - value to look up in table
+              lookup_table - the lookup table
+@OUTPUT     : (nothing)
+@RETURNS    : Number of the table entry to use for index
+@DESCRIPTION: Binary search of the (sorted) table for the last entry with
+              a key not greater than index (or the first entry).
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : December 8, 1994 (Peter Neelin)
+@MODIFIED   : October 16, 2026 - split from lookup_in_table
+---------------------------------------------------------------------------- */
+static int search_table(double index, Lookup_Table *lookup_table)
+{
+   int vector_length, nentries;
+   int start, length, mid;
+   int offset, offset1, offset2;
+
+   nentries = lookup_table->nentries;
+   vector_length = lookup_table->vector_length;
+
+   /* Search the table for the value */
+   start = 0;
+   length = nentries;
+   while (length > 1) {
+      mid = start + length / 2;
+      offset = mid*(vector_length+1);
+      if (index < lookup_table->table[offset]) {
+         length = mid - start;
+      }
+      else {
+         length = start + length - mid;
+         start = mid;
+      }
+   }
+
+   /* Add a special check for the end of the table */
+   if (nentries > 1) {
+      offset1 = vector_length+1;
+      offset2 = (nentries-2) * (vector_length+1);
+      if ((start == 0) && (index == lookup_table->table[offset1]))
+         start = 1;
+      else if ((start == nentries-1) && 
+               (index == lookup_table->table[offset2]))
+         start = nentries-2;
+   }
+
+   return start;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : find_table_entry
+@INPUT      : index - value to look up in table
+              lookup_table - the lookup table
+              lookup_index - index into the table (may be NULL)
+@OUTPUT     : (nothing)
+@RETURNS    : Number of the table entry to use for index, as given by 
+              search_table. For a discrete table -1 may be returned if
+              the key is not in the table.
+@DESCRIPTION: Finds the table entry for a value in constant time using
+              the lookup index, falling back to search_table for values
+              outside the indexed range.
+@METHOD     : For a continuous table the last key not greater than
+              index is found by a binary search between the entries
+              found for the start of the bucket and the start of the
+              next one (widened to the whole table in case of rounding).
+              Keys equal to the second or second last key are left to
+              search_table to keep its special handling of the ends of
+              the table.
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static int find_table_entry(double index, Lookup_Table *lookup_table,
+                            Lookup_Index *lookup_index)
+{
+   double *table;
+   int stride, nentries, start, end, mid;
+   long ibucket;
+
+   /* Check that the value is in the indexed range (this also excludes
+      NaNs) */
+   if ((lookup_index == NULL) || 
+       !((index >= lookup_index->first_key) && 
+         (index <= lookup_index->last_key))) {
+      return search_table(index, lookup_table);
+   }
+
+   /* Discrete tables give the entry directly */
+   ibucket = (long) ((index - lookup_index->first_key) * lookup_index->scale);
+   if (ibucket >= lookup_index->nbuckets) 
+      ibucket = lookup_index->nbuckets - 1;
+   if (lookup_index->discrete)
+      return lookup_index->entry[ibucket];
+
+   /* Search the entries between the start of this bucket and the start
+      of the next one */
+   table = lookup_table->table;
+   stride = lookup_table->vector_length + 1;
+   nentries = lookup_table->nentries;
+   start = lookup_index->entry[ibucket];
+   end = (ibucket < lookup_index->nbuckets-1) ? 
+      lookup_index->entry[ibucket+1] : nentries-1;
+   if (table[start*stride] > index)
+      start = 0;
+   if ((end < nentries-1) && (table[(end+1)*stride] <= index))
+      end = nentries-1;
+   while (start < end) {
+      mid = start + (end - start + 1) / 2;
+      if (table[mid*stride] <= index)
+         start = mid;
+      else
+         end = mid - 1;
+   }
+
+   /* Leave the ends of the table to the search */
+   if ((nentries > 1) && ((start <= 1) || (start >= nentries-2)))
+      return search_table(index, lookup_table);
+
+   return start;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : create_lookup_index
+@INPUT      : lookup_table - the lookup table
+              discrete_values - TRUE if the table is discrete
+@OUTPUT     : (nothing)
+@RETURNS    : Pointer to the index, or NULL if the table is not worth 
+              indexing
+@DESCRIPTION: Builds an index into a sorted lookup table so that values
+              can be looked up in constant time. For a discrete table 
+              with integer keys over a range no bigger than 
+              MAX_DIRECT_INDEX_SIZE, the entry for each integer in the 
+              range is found once. For a continuous table, the range of
+              keys is cut into BUCKETS_PER_ENTRY buckets for each entry 
+              and the entry for the start of each bucket is found.
+@METHOD     : The entries are found with search_table, so that the
+              results are the same as searching for every value.
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static Lookup_Index *create_lookup_index(Lookup_Table *lookup_table,
+                                         int discrete_values)
+{
+   Lookup_Index *lookup_index;
+   double first_key, last_key, key;
+   int stride, nentries, entry;
+   long ibucket, nbuckets;
+
+   nentries = lookup_table->nentries;
+   stride = lookup_table->vector_length + 1;
+   if (nentries < 4) return NULL;
+   first_key = lookup_table->table[0];
+   last_key = lookup_table->table[(nentries-1)*stride];
+
+   /* Work out the buckets */
+   if (discrete_values) {
+      first_key = ceil(first_key);
+      last_key = floor(last_key);
+      if (!(last_key >= first_key) || 
+          (last_key - first_key >= MAX_DIRECT_INDEX_SIZE))
+         return NULL;
+      nbuckets = (long) (last_key - first_key) + 1;
+   }
+   else {
+      if (!(last_key > first_key)) return NULL;
+      nbuckets = (long) nentries * BUCKETS_PER_ENTRY;
+   }
+
+   lookup_index = malloc(sizeof(*lookup_index));
+   lookup_index->discrete = discrete_values;
+   lookup_index->nbuckets = nbuckets;
+   lookup_index->first_key = first_key;
+   lookup_index->last_key = last_key;
+   lookup_index->scale = (discrete_values ? 1.0 : 
+                          nbuckets / (last_key - first_key));
+   lookup_index->entry = malloc(sizeof(*lookup_index->entry) * nbuckets);
+
+   /* Find the entry for each bucket */
+   for (ibucket=0; ibucket < nbuckets; ibucket++) {
+      if (discrete_values) {
+         key = first_key + ibucket;
+         entry = search_table(key, lookup_table);
+         if (lookup_table->table[entry*stride] != key)
+            entry = -1;
+      }
+      else {
+         key = first_key + ibucket / lookup_index->scale;
+         entry = search_table(key, lookup_table);
+      }
+      lookup_index->entry[ibucket] = entry;
+   }
+
+   return lookup_index;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : free_lookup_index
+@INPUT      : lookup_index - index to free (may be NULL)
+@OUTPUT     : (nothing)
+@RETURNS    : (nothing)
+@DESCRIPTION: Frees an index created by create_lookup_index.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void free_lookup_index(Lookup_Index *lookup_index)
+{
+   if (lookup_index == NULL) return;
+   free(lookup_index->entry);
+   free(lookup_index);
+}
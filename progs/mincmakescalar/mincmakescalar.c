@@ -74,6 +74,7 @@
 #include <ParseArgv.h>
 #include <time_stamp.h>
 #include <voxel_loop.h>
+#include <parallel_voxel_loop.h>
 
 #ifndef TRUE
 #  define TRUE 1
@@ -117,6 +118,7 @@ static int clobber = FALSE;
 static int v2format = FALSE;
 #endif /* MINC2 */
 static int verbose = TRUE;
+static int nthreads = 1;
 static nc_type datatype = MI_ORIGINAL_TYPE;
 static int is_signed = FALSE;
 static double valid_range[2] = {0.0, 0.0};
@@ -138,6 +140,8 @@ static ArgvInfo argTable[] = {
        "Print out log messages (default)."},
    {"-quiet", ARGV_CONSTANT, (char *) FALSE, (char *) &verbose,
        "Do not print out log messages."},
+   {"-threads", ARGV_INT, (char *) 1, (char *) &nthreads,
+       "Number of threads used to process each buffer (default 1)."},
    {"-buffer_size", ARGV_INT, (char *) 1, (char *) &buffer_size,
        "Set the internal buffer size (in kb)."},
    {"-filetype", ARGV_CONSTANT, (char *) MI_ORIGINAL_TYPE, (char *) &datatype,
@@ -274,8 +278,8 @@ int main(int argc, char *argv[])
    set_loop_first_input_mincid(loop_options, inmincid);
 
    /* Do loop */
-   voxel_loop(1, &infile, 1, &outfile, arg_string, loop_options,
-              do_makescalar, (void *) &program_data);
+   parallel_voxel_loop(nthreads, NULL, 1, &infile, 1, &outfile, 
+                       arg_string, loop_options, do_makescalar, (void *) &program_data);
 
    /* Free stuff */
    if (program_data.linear_coefficients != NULL) {
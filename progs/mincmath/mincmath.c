@@ -123,6 +123,7 @@
 #include <ParseArgv.h>
 #include <time_stamp.h>
 #include <voxel_loop.h>
+#include <parallel_voxel_loop.h>
 
 /* Constants */
 
@@ -198,6 +199,26 @@ typedef struct {
    double illegal_value;
 } Math_Data;
 
+/* Arguments for the math kernels */
+typedef struct {
+   double value2;             /* Second operand if there is no 2nd buffer */
+   double constants[2];
+   double illegal_value;
+} Kernel_Args;
+
+/* A kernel does one operation on nvalues values. If check_invalid is
+   FALSE then the input is known to hold no invalid data. in2 is NULL
+   when the second operand is args->value2. */
+typedef void (*Math_Kernel)(long nvalues, double *out, 
+                            double *in1, double *in2, 
+                            Kernel_Args *args, int check_invalid);
+
+/* An accumulation kernel combines nvalues input values into the output.
+   If check_invalid is FALSE then neither the input nor the output holds
+   invalid or uninitialized data. */
+typedef void (*Accum_Kernel)(long nvalues, double *out, double *in,
+                             int propagate_nan, int check_invalid);
+
 /* Function prototypes */
 static void do_math(void *caller_data, long num_voxels, 
                     int input_num_buffers, int input_vector_length,
@@ -219,10 +240,15 @@ static void end_math(void *caller_data, long num_voxels,
                      int output_num_buffers, int output_vector_length,
                      double *output_data[],
                      Loop_Info *loop_info);
+static Math_Kernel get_math_kernel(Operation operation);
+static Accum_Kernel get_accum_kernel(Operation operation);
+static int has_invalid_data(long nvalues, double *data);
+static int has_unset_data(long nvalues, double *data);
 
 /* Argument variables */
 static int clobber = FALSE;
 static int verbose = TRUE;
+static int nthreads = 1;
 static int debug = FALSE;
 static nc_type datatype = MI_ORIGINAL_TYPE;
 static int is_signed = FALSE;
@@ -291,6 +317,8 @@ static ArgvInfo argTable[] = {
    {"-max_buffer_size_in_kb", ARGV_INT, (char *) 1, 
        (char *) &max_buffer_size_in_kb,
        "Specify the maximum size of the internal buffers (in kbytes)."},
+   {"-threads", ARGV_INT, (char *) 1, (char *) &nthreads,
+       "Number of threads used to process each buffer (default 1)."},
    {"-dimension", ARGV_STRING, (char *) 1, (char *) &loop_dimension,
        "Specify a dimension along which we wish to perform a calculation."},
    {"-check_dimensions", ARGV_CONSTANT, (char *) TRUE, 
@@ -535,20 +563,274 @@ int main(int argc, char *argv[])
    set_loop_dimension(loop_options, loop_dimension);
    set_loop_buffer_size(loop_options, (long) 1024 * max_buffer_size_in_kb);
    set_loop_check_dim_info(loop_options, check_dim_info);
-   voxel_loop(nfiles, infiles, nout, outfiles, arg_string, loop_options,
-              math_function, (void *) &math_data);
+   parallel_voxel_loop(nthreads, NULL, nfiles, infiles, nout, outfiles, 
+                       arg_string, loop_options,
+                       math_function, (void *) &math_data);
    free_loop_options(loop_options);
 
    exit(EXIT_SUCCESS);
 }
 
+/* Number of values given to a kernel at a time. Each block is checked
+   for invalid data while it is in cache, so that the faster loop for
+   valid data can be used for most of the volume. */
+#define KERNEL_BLOCK 1024
+
+/* Define a kernel computing expr from the values x and y (and the 
+   constants c0 and c1). invalid_result is the result when either value
+   is invalid. The loops have no function calls or tests on the 
+   operation so that the compiler can vectorize them. */
+#define MATH_KERNEL(name, invalid_result, expr)                         \
+static void name(long nvalues, double *out, double *in1, double *in2,  \
+                 Kernel_Args *args, int check_invalid)                  \
+{                                                                       \
+   long ivox;                                                           \
+   double x, y;                                                         \
+   double y0 = args->value2;                                            \
+   double c0 = args->constants[0];                                      \
+   double c1 = args->constants[1];                                      \
+   double illegal = args->illegal_value;                                \
+                                                                        \
+   (void) c0; (void) c1; (void) illegal;                                \
+   if (!check_invalid && (in2 == NULL)) {                               \
+      for (ivox=0; ivox < nvalues; ivox++) {                            \
+         x = in1[ivox]; y = y0;                                         \
+         out[ivox] = (expr);                                            \
+      }                                                                 \
+   }                                                                    \
+   else if (!check_invalid) {                                           \
+      for (ivox=0; ivox < nvalues; ivox++) {                            \
+         x = in1[ivox]; y = in2[ivox];                                  \
+         out[ivox] = (expr);                                            \
+      }                                                                 \
+   }                                                                    \
+   else if (in2 == NULL) {                                              \
+      for (ivox=0; ivox < nvalues; ivox++) {                            \
+         x = in1[ivox]; y = y0;                                         \
+         out[ivox] = ((x == INVALID_DATA) || (y == INVALID_DATA)) ?     \
+            (invalid_result) : (expr);                                  \
+      }                                                                 \
+   }                                                                    \
+   else {                                                               \
+      for (ivox=0; ivox < nvalues; ivox++) {                            \
+         x = in1[ivox]; y = in2[ivox];                                  \
+         out[ivox] = ((x == INVALID_DATA) || (y == INVALID_DATA)) ?     \
+            (invalid_result) : (expr);                                  \
+      }                                                                 \
+   }                                                                    \
+}
+
+MATH_KERNEL(add_kernel, INVALID_DATA, x + y)
+MATH_KERNEL(sub_kernel, INVALID_DATA, x - y)
+MATH_KERNEL(mult_kernel, INVALID_DATA, x * y)
+MATH_KERNEL(div_kernel, INVALID_DATA, (y != 0.0) ? x / y : illegal)
+MATH_KERNEL(invert_kernel, INVALID_DATA, (x == 0.0) ? illegal : y / x)
+MATH_KERNEL(sqrt_kernel, INVALID_DATA, (x < 0.0) ? illegal : sqrt(x))
+MATH_KERNEL(square_kernel, INVALID_DATA, x * x)
+MATH_KERNEL(abs_kernel, INVALID_DATA, (x < 0.0) ? -x : x)
+MATH_KERNEL(exp_kernel, INVALID_DATA, c1 * exp(x * c0))
+MATH_KERNEL(log_kernel, INVALID_DATA, 
+            ((x <= 0.0) || (c1 <= 0.0) || (c0 == 0.0)) ? 
+            illegal : log(x / c1) / c0)
+MATH_KERNEL(scale_kernel, INVALID_DATA, x * c0 + c1)
+MATH_KERNEL(clamp_kernel, INVALID_DATA, 
+            (x < c0) ? c0 : ((x > c1) ? c1 : x))
+MATH_KERNEL(segment_kernel, INVALID_DATA, 
+            ((x < c0) || (x > c1)) ? 0.0 : 1.0)
+MATH_KERNEL(nsegment_kernel, INVALID_DATA, 
+            ((x < c0) || (x > c1)) ? 1.0 : 0.0)
+MATH_KERNEL(percentdiff_kernel, INVALID_DATA, 
+            ((x < c0) || (x == 0.0)) ? illegal : 100.0 * (x - y) / x)
+MATH_KERNEL(eq_kernel, INVALID_DATA, 
+            ((rint(x) - rint(y)) == 0.0) ? 1.0 : 0.0)
+MATH_KERNEL(ne_kernel, INVALID_DATA, 
+            ((rint(x) - rint(y)) != 0.0) ? 1.0 : 0.0)
+MATH_KERNEL(gt_kernel, INVALID_DATA, (x > y) ? 1.0 : 0.0)
+MATH_KERNEL(ge_kernel, INVALID_DATA, (x >= y) ? 1.0 : 0.0)
+MATH_KERNEL(lt_kernel, INVALID_DATA, (x < y) ? 1.0 : 0.0)
+MATH_KERNEL(le_kernel, INVALID_DATA, (x <= y) ? 1.0 : 0.0)
+MATH_KERNEL(and_kernel, INVALID_DATA, 
+            ((rint(x) != 0.0) && (rint(y) != 0.0)) ? 1.0 : 0.0)
+MATH_KERNEL(or_kernel, INVALID_DATA, 
+            ((rint(x) != 0.0) || (rint(y) != 0.0)) ? 1.0 : 0.0)
+MATH_KERNEL(not_kernel, INVALID_DATA, (rint(x) == 0.0) ? 1.0 : 0.0)
+MATH_KERNEL(isnan_kernel, 1.0, 0.0)
+MATH_KERNEL(nisnan_kernel, 0.0, 1.0)
+
+/* Define an accumulation kernel combining the previous output value old
+   with the new value v. */
+#define ACCUM_KERNEL(name, expr)                                        \
+static void name(long nvalues, double *out, double *in,                \
+                 int propagate_nan, int check_invalid)                  \
+{                                                                       \
+   long ivox;                                                           \
+   double old, v;                                                       \
+                                                                        \
+   if (!check_invalid) {                                                \
+      for (ivox=0; ivox < nvalues; ivox++) {                            \
+         old = out[ivox]; v = in[ivox];                                 \
+         out[ivox] = (expr);                                            \
+      }                                                                 \
+      return;                                                           \
+   }                                                                    \
+   for (ivox=0; ivox < nvalues; ivox++) {                               \
+      old = out[ivox]; v = in[ivox];                                    \
+      if (v == INVALID_DATA) {                                          \
+         if (propagate_nan) out[ivox] = INVALID_DATA;                   \
+      }                                                                 \
+      else if (old == UNINITIALIZED_DATA)                               \
+         out[ivox] = v;                                                 \
+      else if (old != INVALID_DATA)                                     \
+         out[ivox] = (expr);                                            \
+   }                                                                    \
+}
+
+ACCUM_KERNEL(add_accum_kernel, old + v)
+ACCUM_KERNEL(mult_accum_kernel, old * v)
+ACCUM_KERNEL(and_accum_kernel, 
+             ((old != 0.0) && (rint(v) != 0.0)) ? 1.0 : 0.0)
+ACCUM_KERNEL(or_accum_kernel, 
+             ((old != 0.0) || (rint(v) != 0.0)) ? 1.0 : 0.0)
+ACCUM_KERNEL(max_accum_kernel, (v > old) ? v : old)
+ACCUM_KERNEL(min_accum_kernel, (v < old) ? v : old)
+ACCUM_KERNEL(count_accum_kernel, old + 1.0)
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : get_math_kernel
+@INPUT      : operation - math operation
+@OUTPUT     : (none)
+@RETURNS    : Kernel doing operation
+@DESCRIPTION: Picks the kernel for a unary or binary operation.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static Math_Kernel get_math_kernel(Operation operation)
+{
+   switch (operation) {
+   case ADD_OP:         return add_kernel;
+   case SUB_OP:         return sub_kernel;
+   case MULT_OP:        return mult_kernel;
+   case DIV_OP:         return div_kernel;
+   case INVERT_OP:      return invert_kernel;
+   case SQRT_OP:        return sqrt_kernel;
+   case SQUARE_OP:      return square_kernel;
+   case ABS_OP:         return abs_kernel;
+   case EXP_OP:         return exp_kernel;
+   case LOG_OP:         return log_kernel;
+   case SCALE_OP:       return scale_kernel;
+   case CLAMP_OP:       return clamp_kernel;
+   case SEGMENT_OP:     return segment_kernel;
+   case NSEGMENT_OP:    return nsegment_kernel;
+   case PERCENTDIFF_OP: return percentdiff_kernel;
+   case EQ_OP:          return eq_kernel;
+   case NE_OP:          return ne_kernel;
+   case GT_OP:          return gt_kernel;
+   case GE_OP:          return ge_kernel;
+   case LT_OP:          return lt_kernel;
+   case LE_OP:          return le_kernel;
+   case AND_OP:         return and_kernel;
+   case OR_OP:          return or_kernel;
+   case NOT_OP:         return not_kernel;
+   case ISNAN_OP:       return isnan_kernel;
+   case NISNAN_OP:      return nisnan_kernel;
+   default:
+      (void) fprintf(stderr, "Bad op in do_math!\n");
+      exit(EXIT_FAILURE);
+   }
+   return NULL;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : get_accum_kernel
+@INPUT      : operation - math operation
+@OUTPUT     : (none)
+@RETURNS    : Kernel doing operation
+@DESCRIPTION: Picks the kernel for an accumulating operation.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static Accum_Kernel get_accum_kernel(Operation operation)
+{
+   switch (operation) {
+   case ADD_OP:         return add_accum_kernel;
+   case MULT_OP:        return mult_accum_kernel;
+   case AND_OP:         return and_accum_kernel;
+   case OR_OP:          return or_accum_kernel;
+   case MAX_OP:         return max_accum_kernel;
+   case MIN_OP:         return min_accum_kernel;
+   case COUNT_OP:       return count_accum_kernel;
+   default:
+      (void) fprintf(stderr, "Bad op in accum_math!\n");
+      exit(EXIT_FAILURE);
+   }
+   return NULL;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : has_invalid_data
+@INPUT      : nvalues - number of values
+              data - values to check
+@OUTPUT     : (none)
+@RETURNS    : TRUE if any value is INVALID_DATA
+@DESCRIPTION: Checks a block of data for invalid values.
+@METHOD     : No early exit, so that the loop can be vectorized.
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static int has_invalid_data(long nvalues, double *data)
+{
+   long ivox;
+   int found = FALSE;
+
+   for (ivox=0; ivox < nvalues; ivox++)
+      found |= (data[ivox] == INVALID_DATA);
+
+   return found;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : has_unset_data
+@INPUT      : nvalues - number of values
+              data - values to check
+@OUTPUT     : (none)
+@RETURNS    : TRUE if any value is INVALID_DATA or UNINITIALIZED_DATA
+@DESCRIPTION: Checks a block of accumulated data for values that are not
+              simply combined with new data.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static int has_unset_data(long nvalues, double *data)
+{
+   long ivox;
+   int found = FALSE;
+
+   for (ivox=0; ivox < nvalues; ivox++)
+      found |= ((data[ivox] == INVALID_DATA) || 
+                (data[ivox] == UNINITIALIZED_DATA));
+
+   return found;
+}
+
 /* ----------------------------- MNI Header -----------------------------------
 @NAME       : do_math
 @INPUT      : Standard for voxel loop
 @OUTPUT     : Standard for voxel loop
 @RETURNS    : (nothing)
 @DESCRIPTION: Routine doing math operations.
-@METHOD     : 
+@METHOD     : The kernel for the operation is chosen once and then run 
+              on blocks of voxels, using the loop without checks for
+              invalid data on blocks that have none.
 @GLOBALS    : 
 @CALLS      : 
 @CREATED    : April 25, 1995 (Peter Neelin)
@@ -563,12 +845,12 @@ static void do_math(void *caller_data, long num_voxels,
      /* ARGSUSED */
 {
    Math_Data *math_data;
-   long ivox;
-   double value1, value2;
-   double illegal_value;
+   Math_Kernel kernel;
+   Kernel_Args args;
+   long ivox, nvalues, nblock;
+   double *in2;
    Operation operation;
-   int num_constants, iconst;
-   double constants[2];
+   int num_constants, iconst, check_invalid;
 
    /* Get pointer to window info */
    math_data = (Math_Data *) caller_data;
@@ -583,149 +865,40 @@ static void do_math(void *caller_data, long num_voxels,
    /* Get info */
    operation = math_data->operation;
    num_constants = math_data->num_constants;
-   for (iconst=0; iconst < sizeof(constants)/sizeof(constants[0]); iconst++) {
+   for (iconst=0; iconst < sizeof(args.constants)/sizeof(args.constants[0]);
+        iconst++) {
       if (iconst < num_constants)
-         constants[iconst] = math_data->constants[iconst];
+         args.constants[iconst] = math_data->constants[iconst];
       else if ((operation == INVERT_OP) ||
                (operation == EXP_OP) ||
                (operation == LOG_OP))
-         constants[iconst] = 1.0;
+         args.constants[iconst] = 1.0;
       else
-         constants[iconst] = 0.0;
+         args.constants[iconst] = 0.0;
    }
-   illegal_value = math_data->illegal_value;
+   args.illegal_value = math_data->illegal_value;
+   kernel = get_math_kernel(operation);
 
    /* Set default second value */
-   value2 = constants[0];
+   args.value2 = args.constants[0];
+   in2 = NULL;
 
    /* Loop through the voxels */
-   for (ivox=0; ivox < num_voxels*input_vector_length; ivox++) {
-      value1 = input_data[0][ivox];
-      if (input_num_buffers == 2) 
-         value2 = input_data[1][ivox];
-      if ((value1 == INVALID_DATA) || (value2 == INVALID_DATA)) {
-         switch(operation) {
-         case ISNAN_OP:
-            output_data[0][ivox] = 1.0;
-            break;
-         case NISNAN_OP:
-            output_data[0][ivox] = 0.0;
-            break;
-         default:
-            output_data[0][ivox] = INVALID_DATA;
-            break;
-         }
+   nvalues = num_voxels * input_vector_length;
+   for (ivox=0; ivox < nvalues; ivox += KERNEL_BLOCK) {
+      nblock = nvalues - ivox;
+      if (nblock > KERNEL_BLOCK) nblock = KERNEL_BLOCK;
+      if (input_num_buffers == 2) {
+         in2 = &input_data[1][ivox];
+         check_invalid = has_invalid_data(nblock, in2);
       }
       else {
-         switch (operation) {
-         case ADD_OP:
-            output_data[0][ivox] = value1 + value2; break;
-         case SUB_OP:
-            output_data[0][ivox] = value1 - value2; break;
-         case MULT_OP:
-            output_data[0][ivox] = value1 * value2; break;
-         case DIV_OP:
-            if (value2 != 0.0)
-               output_data[0][ivox] = value1 / value2;
-            else
-               output_data[0][ivox] = illegal_value;
-            break;
-         case INVERT_OP:
-            if (value1 == 0.0)
-               output_data[0][ivox] = illegal_value;
-            else
-               output_data[0][ivox] = value2 / value1;
-            break;
-         case SQRT_OP:
-            if (value1 < 0.0)
-               output_data[0][ivox] = illegal_value;
-            else
-               output_data[0][ivox] = sqrt(value1);
-            break;
-         case SQUARE_OP:
-            output_data[0][ivox] = value1 * value1; break;
-         case ABS_OP:
-            if (value1 < 0.0)
-               output_data[0][ivox] = -value1;
-            else
-               output_data[0][ivox] = value1;
-            break;
-         case EXP_OP:
-            output_data[0][ivox] = constants[1] * exp(value1 * constants[0]);
-            break;
-         case LOG_OP:
-            if ((value1 <= 0.0) || (constants[1] <= 0.0) || 
-                (constants[0] == 0.0))
-               output_data[0][ivox] = illegal_value;
-            else
-               output_data[0][ivox] = log(value1/constants[1])/constants[0];
-            break;
-         case SCALE_OP:
-            output_data[0][ivox] = value1 * constants[0] + constants[1]; break;
-         case CLAMP_OP:
-            if (value1 < constants[0])
-               value1 = constants[0];
-            else if (value1 > constants[1])
-               value1 = constants[1];
-            output_data[0][ivox] = value1;
-            break;
-         case SEGMENT_OP:
-            if ((value1 < constants[0]) || (value1 > constants[1]))
-               output_data[0][ivox] = 0.0;
-            else
-               output_data[0][ivox] = 1.0;
-            break;
-         case NSEGMENT_OP:
-            if ((value1 < constants[0]) || (value1 > constants[1]))
-               output_data[0][ivox] = 1.0;
-            else
-               output_data[0][ivox] = 0.0;
-            break;
-         case PERCENTDIFF_OP:
-            if ((value1 < constants[0]) || (value1 == 0.0))
-               output_data[0][ivox] = illegal_value;
-            else {
-               output_data[0][ivox] = 100.0 * (value1 - value2) / value1;
-            }
-            break;
-         case EQ_OP:
-            output_data[0][ivox] = (((rint(value1)-rint(value2)) == 0.0)
-                                    ? 1.0 : 0.0);
-            break;
-         case NE_OP:
-            output_data[0][ivox] = (((rint(value1)-rint(value2)) != 0.0)
-                                    ? 1.0 : 0.0);
-            break;
-         case GT_OP:
-            output_data[0][ivox] = value1 > value2; break;
-         case GE_OP:
-            output_data[0][ivox] = value1 >= value2; break;
-         case LT_OP:
-            output_data[0][ivox] = value1 < value2; break;
-         case LE_OP:
-            output_data[0][ivox] = value1 <= value2; break;
-         case AND_OP:
-            output_data[0][ivox] = 
-               (((rint(value1) != 0.0) && (rint(value2) != 0.0)) ? 1.0 : 0.0);
-            break;
-         case OR_OP:
-            output_data[0][ivox] = 
-               (((rint(value1) != 0.0) || (rint(value2) != 0.0)) ? 1.0 : 0.0);
-            break;
-         case NOT_OP:
-            output_data[0][ivox] = ((rint(value1) == 0.0) ? 1.0 : 0.0);
-            break;
-         case ISNAN_OP:
-            output_data[0][ivox] = 0.0;     /* To get here, value is not nan */
-            break;
-         case NISNAN_OP:
-            output_data[0][ivox] = 1.0;
-            break;
-         default:
-            (void) fprintf(stderr, "Bad op in do_math!\n");
-            exit(EXIT_FAILURE);
-         }
+         check_invalid = (args.value2 == INVALID_DATA);
       }
+      if (!check_invalid)
+         check_invalid = has_invalid_data(nblock, &input_data[0][ivox]);
+      kernel(nblock, &output_data[0][ivox], &input_data[0][ivox], in2, 
+             &args, check_invalid);
    }
 
    return;
@@ -737,7 +910,8 @@ static void do_math(void *caller_data, long num_voxels,
 @OUTPUT     : Standard for voxel loop
 @RETURNS    : (nothing)
 @DESCRIPTION: Routine for doing accumulation math operations.
-@METHOD     : 
+@METHOD     : As for do_math, blocks with no invalid input and no invalid
+              or uninitialized output are combined without checks.
 @GLOBALS    : 
 @CALLS      : 
 @CREATED    : April 25, 1995 (Peter Neelin)
@@ -752,10 +926,9 @@ static void accum_math(void *caller_data, long num_voxels,
      /* ARGSUSED */
 {
    Math_Data *math_data;
-   long ivox;
-   double value, oldvalue;
-   Operation operation;
-   int propagate_nan;
+   Accum_Kernel kernel;
+   long ivox, nvalues, nblock;
+   int check_invalid;
 
    /* Get pointer to window info */
    math_data = (Math_Data *) caller_data;
@@ -768,64 +941,19 @@ static void accum_math(void *caller_data, long num_voxels,
    }
 
    /* Get info */
-   operation = math_data->operation;
-   propagate_nan = math_data->propagate_nan;
+   kernel = get_accum_kernel(math_data->operation);
 
    /* Loop through the voxels */
-   for (ivox=0; ivox < num_voxels*input_vector_length; ivox++) {
-
-      /* Get previous value and the next value */
-      oldvalue = output_data[0][ivox];
-      value = input_data[0][ivox];
-
-      /* If the new data is invalid, then either mark the output as invalid
-         or ignore it */
-      if (value == INVALID_DATA) {
-         if (propagate_nan) {
-            output_data[0][ivox] = INVALID_DATA;
-         }
-      }
-
-      /* If we haven't set anything yet, then just copy the new value */
-      else if (oldvalue == UNINITIALIZED_DATA) {
-         output_data[0][ivox] = input_data[0][ivox];
-      }
-
-      /* Do the operation if the old data and the new data are valid */
-      else if (oldvalue != INVALID_DATA) {
-         switch (operation) {
-         case ADD_OP:
-            output_data[0][ivox] = oldvalue + value;
-            break;
-         case MULT_OP:
-            output_data[0][ivox] = oldvalue * value;
-            break;
-         case AND_OP:
-            output_data[0][ivox] = 
-               (((oldvalue != 0.0) && (rint(value) != 0.0)) ? 1.0 : 0.0);
-            break;
-         case OR_OP:
-            output_data[0][ivox] = 
-               (((oldvalue != 0.0) || (rint(value) != 0.0)) ? 1.0 : 0.0);
-            break;
-         case MAX_OP:
-            if (value > oldvalue)
-               output_data[0][ivox] = value;
-            break;
-         case MIN_OP:
-            if (value < oldvalue)
-               output_data[0][ivox] = value;
-            break;
-         case COUNT_OP:
-            output_data[0][ivox]++;
-            break;
-         default:
-            (void) fprintf(stderr, "Bad op in accum_math!\n");
-            exit(EXIT_FAILURE);
-         }
-      }
-
-   }              /* Loop over voxels */
+   nvalues = num_voxels * input_vector_length;
+   for (ivox=0; ivox < nvalues; ivox += KERNEL_BLOCK) {
+      nblock = nvalues - ivox;
+      if (nblock > KERNEL_BLOCK) nblock = KERNEL_BLOCK;
+      check_invalid = 
+         has_invalid_data(nblock, &input_data[0][ivox]) ||
+         has_unset_data(nblock, &output_data[0][ivox]);
+      kernel(nblock, &output_data[0][ivox], &input_data[0][ivox],
+             math_data->propagate_nan, check_invalid);
+   }
 
    return;
 }
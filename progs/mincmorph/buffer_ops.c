@@ -0,0 +1,1403 @@
+/* buffer_ops.c - kernel operations on a padded raw buffer */
+
+#include <config.h>
+#include <float.h>
+#include <limits.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include "buffer_ops.h"
+
+/* squared distance of voxels with no feature yet */
+#define EDT_INF 1e30
+
+extern int verbose;
+extern int nthreads;
+
+/* structure for the lines of one pass of the distance transform */
+typedef struct {
+   Morph_Buffer *buf;
+   int      axis;                      /* 0, 1, 2 = z, y, x        */
+   double   spacing;                   /* voxel separation (mm)    */
+   int     *index;                     /* nearest features or NULL */
+   } Distance_Pass;
+
+/* kernels smaller than this are faster done directly than as a box */
+#define BOX_MIN_ELEMS 27
+
+/* voxels that are not part of a group */
+#define NO_GROUP UINT_MAX
+
+/* structure for the slabs of the group labelling */
+typedef struct {
+   Morph_Buffer *buf;
+   double   bg;
+   int      nelems;                    /* backward kernel elements */
+   int     *dz;                        /* z offset of each element */
+   long    *offsets;                   /* offset of each element   */
+   int      lo[3], hi[3];              /* box of voxels to label   */
+   int     *zstart;                    /* first slice of each slab */
+   unsigned int *parent;               /* union-find forest        */
+   unsigned int *trans;                /* final label of each group */
+   } Group_Pass;
+
+/* structure for the lines of one pass of a box min/max filter */
+typedef struct {
+   Morph_Buffer *buf;
+   float   *array;
+   int      axis;                      /* 0, 1, 2 = z, y, x          */
+   int      first;                     /* window is [first, last]    */
+   int      last;                      /* voxels from each voxel     */
+   int      is_max;                    /* max (dilate) or min (erode) */
+   } Box_Pass;
+
+/* structure for the lines of one pass of the local correlation sums */
+typedef struct {
+   int      sizes[3];
+   double  *sums[3];                   /* v1*v1, v2*v2 and v1*v2     */
+   int      axis;
+   int      first;                     /* window is [first, last]    */
+   int      last;                      /* voxels from each voxel     */
+   } Sum_Pass;
+
+/* structure for each thread of run_lines() */
+typedef struct {
+   Line_Function function;
+   void    *caller_data;
+   long     first;
+   long     last;
+   } Line_Range;
+
+/* function prototypes */
+static int compare_uints(const void *a, const void *b);
+static int compare_group_stats(const void *a, const void *b);
+static unsigned int find_group(unsigned int *parent, unsigned int v);
+static void label_slabs(void *caller_data, long first, long last);
+static void relabel_slabs(void *caller_data, long first, long last);
+static void box_lines(void *caller_data, long first, long last);
+static void box_filter(Morph_Buffer * buf, float *array, int box_lo[3],
+                       int box_hi[3], int is_max);
+static void sum_lines(void *caller_data, long first, long last);
+static void distance_lines(void *caller_data, long first, long last);
+static void distance_transform(Morph_Buffer * buf, double sep[3], int *index);
+#ifdef HAVE_PTHREAD
+static void *line_thread(void *arg);
+#endif
+
+static int compare_uints(const void *a, const void *b)
+{
+   unsigned int ua = *(unsigned int *)a;
+   unsigned int ub = *(unsigned int *)b;
+
+   return (ua > ub) - (ua < ub);
+   }
+
+/* larger groups first, then in order of first appearance */
+static int compare_group_stats(const void *a, const void *b)
+{
+   Group_Stats *ga = (Group_Stats *) a;
+   Group_Stats *gb = (Group_Stats *) b;
+
+   if(ga->count != gb->count){
+      return (ga->count < gb->count) ? 1 : -1;
+      }
+   return (ga->label > gb->label) - (ga->label < gb->label);
+   }
+
+/* allocate a buffer with a border of pad voxels and read a volume into it */
+Morph_Buffer *new_morph_buffer(VIO_Volume * vol, int pad)
+{
+   Morph_Buffer *buf;
+   int      sizes[MAX_VAR_DIMS];
+
+   get_volume_sizes(*vol, sizes);
+
+   buf = (Morph_Buffer *) malloc(sizeof(Morph_Buffer));
+   buf->sizes[0] = sizes[0];
+   buf->sizes[1] = sizes[1];
+   buf->sizes[2] = sizes[2];
+   buf->pad = pad;
+   buf->stride[2] = 1;
+   buf->stride[1] = sizes[2] + 2 * pad;
+   buf->stride[0] = buf->stride[1] * (sizes[1] + 2 * pad);
+   buf->nvoxels = buf->stride[0] * (sizes[0] + 2 * pad);
+
+   buf->data = (float *)calloc(buf->nvoxels, sizeof(float));
+   buf->work = (float *)calloc(buf->nvoxels, sizeof(float));
+   if(buf->data == NULL || buf->work == NULL){
+      fprintf(stderr, "new_morph_buffer(): out of memory for %ld voxels\n",
+              buf->nvoxels);
+      exit(EXIT_FAILURE);
+      }
+
+   if(verbose){
+      fprintf(stdout, "Raw buffer: %dx%dx%d with a border of %d\n",
+              sizes[0], sizes[1], sizes[2], pad);
+      }
+
+   volume_to_buffer(vol, buf);
+   return (buf);
+   }
+
+void delete_morph_buffer(Morph_Buffer * buf)
+{
+   free(buf->data);
+   free(buf->work);
+   free(buf);
+   }
+
+/* copy the values of a volume into a buffer */
+void volume_to_buffer(VIO_Volume * vol, Morph_Buffer * buf)
+{
+   int      x, y, z;
+   float   *row;
+
+   for(z = 0; z < buf->sizes[0]; z++){
+      for(y = 0; y < buf->sizes[1]; y++){
+         row = &buf->data[BUFFER_INDEX(buf, z, y, 0)];
+         for(x = 0; x < buf->sizes[2]; x++){
+            row[x] = get_volume_real_value(*vol, z, y, x, 0, 0);
+            }
+         }
+      }
+   }
+
+/* copy the values of a buffer back into a volume */
+void buffer_to_volume(Morph_Buffer * buf, VIO_Volume * vol)
+{
+   int      x, y, z;
+   float   *row;
+
+   for(z = 0; z < buf->sizes[0]; z++){
+      for(y = 0; y < buf->sizes[1]; y++){
+         row = &buf->data[BUFFER_INDEX(buf, z, y, 0)];
+         for(x = 0; x < buf->sizes[2]; x++){
+            set_volume_real_value(*vol, z, y, x, 0, 0, row[x]);
+            }
+         }
+      }
+   }
+
+/* make the work array the current data */
+void swap_buffer(Morph_Buffer * buf)
+{
+   float   *tmp;
+
+   tmp = buf->data;
+   buf->data = buf->work;
+   buf->work = tmp;
+   }
+
+/* border width needed for a kernel */
+int kernel_buffer_pad(Kernel * K)
+{
+   int      n, pad;
+
+   pad = 0;
+   for(n = 0; n < 3; n++){
+      if(-K->pre_pad[n] > pad){
+         pad = -K->pre_pad[n];
+         }
+      if(K->post_pad[n] > pad){
+         pad = K->post_pad[n];
+         }
+      }
+
+   return (pad);
+   }
+
+/* check that a kernel can be used on a buffer - it must be spatial */
+/* only and, if unit_coeffs is set, have all coefficients of 1      */
+int buffer_kernel_ok(Kernel * K, int unit_coeffs)
+{
+   int      c;
+
+   for(c = 0; c < K->nelems; c++){
+      if(K->K[c][3] != 0.0 || K->K[c][4] != 0.0){
+         return (FALSE);
+         }
+      if(unit_coeffs && K->K[c][5] != 1.0){
+         return (FALSE);
+         }
+      }
+
+   return (TRUE);
+   }
+
+/* check whether a kernel fills a box and if so get the z, y, x     */
+/* extent of the box [lo, hi] relative to the centre. If with_centre */
+/* is set the centre voxel counts as part of the kernel, otherwise   */
+/* every voxel of the box must be an element exactly once            */
+int kernel_box(Kernel * K, int with_centre, int lo[3], int hi[3])
+{
+   int      c, n, x, y, z;
+   int      size[3];
+   long     nbox, idx;
+   char    *filled;
+
+   for(n = 0; n < 3; n++){
+      lo[n] = hi[n] = 0;
+      }
+   for(c = 0; c < K->nelems; c++){
+      for(n = 0; n < 3; n++){
+         if(K->K[c][2 - n] != (int)K->K[c][2 - n]){
+            return (FALSE);
+            }
+         if((int)K->K[c][2 - n] < lo[n]){
+            lo[n] = (int)K->K[c][2 - n];
+            }
+         if((int)K->K[c][2 - n] > hi[n]){
+            hi[n] = (int)K->K[c][2 - n];
+            }
+         }
+      }
+
+   /* a box of one voxel is no use to anyone */
+   nbox = 1;
+   for(n = 0; n < 3; n++){
+      size[n] = hi[n] - lo[n] + 1;
+      nbox *= size[n];
+      }
+   if(nbox == 1 || K->nelems < nbox - 1 || (!with_centre && K->nelems != nbox)){
+      return (FALSE);
+      }
+
+   /* mark the elements, then look for holes */
+   filled = (char *)calloc(nbox, sizeof(char));
+   if(with_centre){
+      filled[((long)-lo[0] * size[1] - lo[1]) * size[2] - lo[2]] = TRUE;
+      }
+   for(c = 0; c < K->nelems; c++){
+      z = (int)K->K[c][2] - lo[0];
+      y = (int)K->K[c][1] - lo[1];
+      x = (int)K->K[c][0] - lo[2];
+      filled[((long)z * size[1] + y) * size[2] + x] = TRUE;
+      }
+   for(idx = 0; idx < nbox; idx++){
+      if(!filled[idx]){
+         break;
+         }
+      }
+   free(filled);
+
+   return (idx == nbox);
+   }
+
+/* get the array offset of each kernel element (times sign) */
+long    *get_kernel_offsets(Kernel * K, Morph_Buffer * buf, int sign)
+{
+   int      c;
+   long    *offsets;
+
+   offsets = (long *)malloc((K->nelems + 1) * sizeof(long));
+   for(c = 0; c < K->nelems; c++){
+      offsets[c] = sign * ((int)K->K[c][2] * buf->stride[0] +
+                           (int)K->K[c][1] * buf->stride[1] +
+                           (int)K->K[c][0] * buf->stride[2]);
+      }
+
+   return (offsets);
+   }
+
+/* get the box [lo, hi) of voxels (z, y, x) where the whole kernel */
+/* lies within the volume, as used by the volume kernel functions  */
+void get_centre_box(Kernel * K, Morph_Buffer * buf, int lo[3], int hi[3])
+{
+   int      n;
+
+   for(n = 0; n < 3; n++){
+      lo[n] = -K->pre_pad[2 - n];
+      hi[n] = buf->sizes[n] - K->post_pad[2 - n];
+      if(hi[n] < lo[n]){
+         hi[n] = lo[n];
+         }
+      }
+   }
+
+/* set every element of a buffer array outside the box [lo, hi) to value */
+void fill_outside_box(Morph_Buffer * buf, float *array, int lo[3], int hi[3],
+                      float value)
+{
+   int      x, y, z;
+   int      pad = buf->pad;
+   float   *row;
+
+   for(z = -pad; z < buf->sizes[0] + pad; z++){
+      for(y = -pad; y < buf->sizes[1] + pad; y++){
+         row = &array[BUFFER_INDEX(buf, z, y, 0)];
+         if(z < lo[0] || z >= hi[0] || y < lo[1] || y >= hi[1]){
+            for(x = -pad; x < buf->sizes[2] + pad; x++){
+               row[x] = value;
+               }
+            }
+         else {
+            for(x = -pad; x < lo[2]; x++){
+               row[x] = value;
+               }
+            for(x = hi[2]; x < buf->sizes[2] + pad; x++){
+               row[x] = value;
+               }
+            }
+         }
+      }
+   }
+
+/* binarise a buffer between a range */
+Morph_Buffer *buffer_binarise(Morph_Buffer * buf, double floor, double ceil,
+                              double fg, double bg)
+{
+   int      x, y, z;
+   float   *row;
+
+   if(verbose){
+      fprintf(stdout, "Binarising, range: [%g:%g] fg/bg: [%g:%g]\n", floor, ceil, fg, bg);
+      }
+
+   for(z = 0; z < buf->sizes[0]; z++){
+      for(y = 0; y < buf->sizes[1]; y++){
+         row = &buf->data[BUFFER_INDEX(buf, z, y, 0)];
+         for(x = 0; x < buf->sizes[2]; x++){
+            row[x] = (row[x] >= floor && row[x] <= ceil) ? fg : bg;
+            }
+         }
+      }
+
+   return (buf);
+   }
+
+/* clamp a buffer between a range */
+Morph_Buffer *buffer_clamp(Morph_Buffer * buf, double floor, double ceil, double bg)
+{
+   int      x, y, z;
+   float   *row;
+
+   if(verbose){
+      fprintf(stdout, "Clamping, range: [%g:%g] bg: %g\n", floor, ceil, bg);
+      }
+
+   for(z = 0; z < buf->sizes[0]; z++){
+      for(y = 0; y < buf->sizes[1]; y++){
+         row = &buf->data[BUFFER_INDEX(buf, z, y, 0)];
+         for(x = 0; x < buf->sizes[2]; x++){
+            if(row[x] < floor || row[x] > ceil){
+               row[x] = bg;
+               }
+            }
+         }
+      }
+
+   return (buf);
+   }
+
+/* perform a dilation on a buffer                                   */
+/* Each voxel takes the maximum of itself and the kernel centres     */
+/* that reach it. Only voxels where the whole kernel fits are used   */
+/* as centres, as in dilation_kernel(), so the others are set to the */
+/* lowest value in the source array                                  */
+Morph_Buffer *buffer_dilation(Kernel * K, Morph_Buffer * buf)
+{
+   int      x, y, z, c;
+   int      lo[3], hi[3];
+   int      box_lo[3], box_hi[3];
+   long     idx;
+   long    *offsets;
+   float    value;
+   float   *src = buf->work;
+   float   *dst = buf->data;
+   VIO_progress_struct progress;
+
+   if(verbose){
+      fprintf(stdout, "Dilation kernel (buffer)\n");
+      }
+   initialize_progress_report(&progress, FALSE, buf->sizes[0], "Dilation");
+
+   memcpy(src, dst, buf->nvoxels * sizeof(float));
+   get_centre_box(K, buf, lo, hi);
+   fill_outside_box(buf, src, lo, hi, -FLT_MAX);
+
+   /* box and line kernels need only a running max along each axis */
+   if(K->nelems >= BOX_MIN_ELEMS && kernel_box(K, TRUE, box_lo, box_hi)){
+      if(verbose){
+         fprintf(stdout, "  using a separable %dx%dx%d box\n",
+                 box_hi[0] - box_lo[0] + 1, box_hi[1] - box_lo[1] + 1,
+                 box_hi[2] - box_lo[2] + 1);
+         }
+      box_filter(buf, src, box_lo, box_hi, TRUE);
+      for(z = 0; z < buf->sizes[0]; z++){
+         for(y = 0; y < buf->sizes[1]; y++){
+            idx = BUFFER_INDEX(buf, z, y, 0);
+            for(x = 0; x < buf->sizes[2]; x++, idx++){
+               if(src[idx] > dst[idx]){
+                  dst[idx] = src[idx];
+                  }
+               }
+            }
+         }
+      terminate_progress_report(&progress);
+      return (buf);
+      }
+
+   offsets = get_kernel_offsets(K, buf, -1);
+
+   for(z = 0; z < buf->sizes[0]; z++){
+      for(y = 0; y < buf->sizes[1]; y++){
+         idx = BUFFER_INDEX(buf, z, y, 0);
+         for(x = 0; x < buf->sizes[2]; x++, idx++){
+            value = dst[idx];
+            for(c = 0; c < K->nelems; c++){
+               if(src[idx + offsets[c]] > value){
+                  value = src[idx + offsets[c]];
+                  }
+               }
+            dst[idx] = value;
+            }
+         }
+      update_progress_report(&progress, z + 1);
+      }
+
+   free(offsets);
+   terminate_progress_report(&progress);
+   return (buf);
+   }
+
+/* perform an erosion on a buffer (see buffer_dilation) */
+Morph_Buffer *buffer_erosion(Kernel * K, Morph_Buffer * buf)
+{
+   int      x, y, z, c;
+   int      lo[3], hi[3];
+   int      box_lo[3], box_hi[3];
+   long     idx;
+   long    *offsets;
+   float    value;
+   float   *src = buf->work;
+   float   *dst = buf->data;
+   VIO_progress_struct progress;
+
+   if(verbose){
+      fprintf(stdout, "Erosion kernel (buffer)\n");
+      }
+   initialize_progress_report(&progress, FALSE, buf->sizes[0], "Erosion");
+
+   memcpy(src, dst, buf->nvoxels * sizeof(float));
+   get_centre_box(K, buf, lo, hi);
+   fill_outside_box(buf, src, lo, hi, FLT_MAX);
+
+   /* box and line kernels need only a running min along each axis */
+   if(K->nelems >= BOX_MIN_ELEMS && kernel_box(K, TRUE, box_lo, box_hi)){
+      if(verbose){
+         fprintf(stdout, "  using a separable %dx%dx%d box\n",
+                 box_hi[0] - box_lo[0] + 1, box_hi[1] - box_lo[1] + 1,
+                 box_hi[2] - box_lo[2] + 1);
+         }
+      box_filter(buf, src, box_lo, box_hi, FALSE);
+      for(z = 0; z < buf->sizes[0]; z++){
+         for(y = 0; y < buf->sizes[1]; y++){
+            idx = BUFFER_INDEX(buf, z, y, 0);
+            for(x = 0; x < buf->sizes[2]; x++, idx++){
+               if(src[idx] < dst[idx]){
+                  dst[idx] = src[idx];
+                  }
+               }
+            }
+         }
+      terminate_progress_report(&progress);
+      return (buf);
+      }
+
+   offsets = get_kernel_offsets(K, buf, -1);
+
+   for(z = 0; z < buf->sizes[0]; z++){
+      for(y = 0; y < buf->sizes[1]; y++){
+         idx = BUFFER_INDEX(buf, z, y, 0);
+         for(x = 0; x < buf->sizes[2]; x++, idx++){
+            value = dst[idx];
+            for(c = 0; c < K->nelems; c++){
+               if(src[idx + offsets[c]] < value){
+                  value = src[idx + offsets[c]];
+                  }
+               }
+            dst[idx] = value;
+            }
+         }
+      update_progress_report(&progress, z + 1);
+      }
+
+   free(offsets);
+   terminate_progress_report(&progress);
+   return (buf);
+   }
+
+/* perform a median dilation on a buffer */
+Morph_Buffer *buffer_median_dilation(Kernel * K, Morph_Buffer * buf)
+{
+   int      x, y, z, c, i;
+   int      lo[3], hi[3];
+   long     idx;
+   long    *offsets;
+   float   *src = buf->data;
+   float   *dst = buf->work;
+   unsigned int kvalue;
+   unsigned int neighbours[K->nelems + 1];
+   VIO_progress_struct progress;
+
+   if(verbose){
+      fprintf(stdout, "Median Dilation kernel (buffer)\n");
+      }
+   initialize_progress_report(&progress, FALSE, buf->sizes[0], "Median Dilation");
+
+   get_centre_box(K, buf, lo, hi);
+   offsets = get_kernel_offsets(K, buf, 1);
+   memcpy(dst, src, buf->nvoxels * sizeof(float));
+
+   for(z = lo[0]; z < hi[0]; z++){
+      for(y = lo[1]; y < hi[1]; y++){
+         idx = BUFFER_INDEX(buf, z, y, lo[2]);
+         for(x = lo[2]; x < hi[2]; x++, idx++){
+
+            /* only modify background voxels */
+            if(src[idx] != 0.0){
+               continue;
+               }
+
+            i = 0;
+            for(c = 0; c < K->nelems; c++){
+               kvalue = (unsigned int)src[idx + offsets[c]];
+               if(kvalue != 0){
+                  neighbours[i] = kvalue;
+                  i++;
+                  }
+               }
+
+            /* store the median of the adjacent labels */
+            if(i > 0){
+               qsort(&neighbours[0], (size_t) i, sizeof(unsigned int), &compare_uints);
+               dst[idx] = (float)neighbours[(i - 1) / 2];
+               }
+            }
+         }
+      update_progress_report(&progress, z + 1);
+      }
+
+   swap_buffer(buf);
+   free(offsets);
+   terminate_progress_report(&progress);
+   return (buf);
+   }
+
+/* convolve a buffer with a input kernel */
+Morph_Buffer *buffer_convolve(Kernel * K, Morph_Buffer * buf)
+{
+   int      x, y, z, c;
+   int      lo[3], hi[3];
+   long     idx;
+   long    *offsets;
+   double   value;
+   double   coeffs[K->nelems + 1];
+   float   *src = buf->data;
+   float   *dst = buf->work;
+   VIO_progress_struct progress;
+
+   if(verbose){
+      fprintf(stdout, "Convolve kernel (buffer)\n");
+      }
+   initialize_progress_report(&progress, FALSE, buf->sizes[0], "Convolve");
+
+   get_centre_box(K, buf, lo, hi);
+   offsets = get_kernel_offsets(K, buf, 1);
+   for(c = 0; c < K->nelems; c++){
+      coeffs[c] = K->K[c][5];
+      }
+
+   /* voxels where the kernel does not fit are left as they are */
+   memcpy(dst, src, buf->nvoxels * sizeof(float));
+
+   for(z = lo[0]; z < hi[0]; z++){
+      for(y = lo[1]; y < hi[1]; y++){
+         idx = BUFFER_INDEX(buf, z, y, lo[2]);
+         for(x = lo[2]; x < hi[2]; x++, idx++){
+            value = 0;
+            for(c = 0; c < K->nelems; c++){
+               value += src[idx + offsets[c]] * coeffs[c];
+               }
+            dst[idx] = value;
+            }
+         }
+      update_progress_report(&progress, z + 1);
+      }
+
+   swap_buffer(buf);
+   free(offsets);
+   terminate_progress_report(&progress);
+   return (buf);
+   }
+
+#ifdef HAVE_PTHREAD
+static void *line_thread(void *arg)
+{
+   Line_Range *range = (Line_Range *) arg;
+
+   range->function(range->caller_data, range->first, range->last);
+   return (NULL);
+   }
+#endif
+
+/* run a function over nlines lines, split between nthreads threads */
+void run_lines(Line_Function function, void *caller_data, long nlines)
+{
+#ifdef HAVE_PTHREAD
+   int      i, n;
+   pthread_t *threads;
+   Line_Range *ranges;
+
+   n = (nthreads < nlines) ? nthreads : nlines;
+   if(n > 1){
+      threads = (pthread_t *) malloc(n * sizeof(pthread_t));
+      ranges = (Line_Range *) malloc(n * sizeof(Line_Range));
+      for(i = 0; i < n; i++){
+         ranges[i].function = function;
+         ranges[i].caller_data = caller_data;
+         ranges[i].first = nlines * i / n;
+         ranges[i].last = nlines * (i + 1) / n;
+         if(pthread_create(&threads[i], NULL, line_thread, &ranges[i]) != 0){
+            fprintf(stderr, "run_lines(): could not create thread\n");
+            exit(EXIT_FAILURE);
+            }
+         }
+      for(i = 0; i < n; i++){
+         pthread_join(threads[i], NULL);
+         }
+      free(threads);
+      free(ranges);
+      return;
+      }
+#endif
+
+   function(caller_data, 0, nlines);
+   }
+
+/* running min or max over a window of each line along one axis,   */
+/* using the van Herk/Gil-Werman algorithm: within blocks of the   */
+/* window length keep prefix (g) and suffix (h) maxima, so that any */
+/* window is covered by one suffix and one prefix                  */
+static void box_lines(void *caller_data, long first, long last)
+{
+   Box_Pass *pass = (Box_Pass *) caller_data;
+   Morph_Buffer *buf = pass->buf;
+   int      axis = pass->axis;
+   int      a1, a2, n, w, len, i;
+   long     line, start, stride;
+   float   *array = pass->array;
+   float   *f, *g, *h;
+
+   /* the two other axes, in order */
+   a1 = (axis == 0) ? 1 : 0;
+   a2 = (axis == 2) ? 1 : 2;
+   n = buf->sizes[axis];
+   stride = buf->stride[axis];
+   w = pass->last - pass->first + 1;
+   len = n + w - 1;
+
+   f = (float *)malloc(len * sizeof(float));
+   g = (float *)malloc(len * sizeof(float));
+   h = (float *)malloc(len * sizeof(float));
+
+   for(line = first; line < last; line++){
+      start = (line / buf->sizes[a2] + buf->pad) * buf->stride[a1] +
+         (line % buf->sizes[a2] + buf->pad) * buf->stride[a2] +
+         (buf->pad + pass->first) * stride;
+
+      /* the windows of the line reach into the border */
+      for(i = 0; i < len; i++){
+         f[i] = array[start + i * stride];
+         }
+
+      if(pass->is_max){
+         for(i = 0; i < len; i++){
+            g[i] = (i % w == 0 || f[i] > g[i - 1]) ? f[i] : g[i - 1];
+            }
+         for(i = len - 1; i >= 0; i--){
+            h[i] = (i % w == w - 1 || i == len - 1 || f[i] > h[i + 1]) ? f[i] : h[i + 1];
+            }
+         for(i = 0; i < n; i++){
+            array[start + (i - pass->first) * stride] =
+               (h[i] > g[i + w - 1]) ? h[i] : g[i + w - 1];
+            }
+         }
+      else {
+         for(i = 0; i < len; i++){
+            g[i] = (i % w == 0 || f[i] < g[i - 1]) ? f[i] : g[i - 1];
+            }
+         for(i = len - 1; i >= 0; i--){
+            h[i] = (i % w == w - 1 || i == len - 1 || f[i] < h[i + 1]) ? f[i] : h[i + 1];
+            }
+         for(i = 0; i < n; i++){
+            array[start + (i - pass->first) * stride] =
+               (h[i] < g[i + w - 1]) ? h[i] : g[i + w - 1];
+            }
+         }
+      }
+
+   free(f);
+   free(g);
+   free(h);
+   }
+
+/* max (or min) of an array over the box [box_lo, box_hi] reflected  */
+/* about each voxel, as the kernel functions use it, done one axis at */
+/* a time. The border must hold the -FLT_MAX (or FLT_MAX) fill value  */
+static void box_filter(Morph_Buffer * buf, float *array, int box_lo[3],
+                       int box_hi[3], int is_max)
+{
+   int      axis;
+   Box_Pass pass;
+
+   pass.buf = buf;
+   pass.array = array;
+   pass.is_max = is_max;
+   for(axis = 2; axis >= 0; axis--){
+      if(box_lo[axis] == box_hi[axis]){
+         continue;
+         }
+      pass.axis = axis;
+      pass.first = -box_hi[axis];
+      pass.last = -box_lo[axis];
+      run_lines(box_lines, &pass,
+                (long)buf->sizes[(axis == 0) ? 1 : 0] *
+                buf->sizes[(axis == 2) ? 1 : 2]);
+      }
+   }
+
+/* sums over a window of each line along one axis of the (unpadded) */
+/* local correlation arrays, taken as differences of running sums.  */
+/* Voxels whose window leaves the volume are set to 0               */
+static void sum_lines(void *caller_data, long first, long last)
+{
+   Sum_Pass *pass = (Sum_Pass *) caller_data;
+   int      axis = pass->axis;
+   int      a1, a2, n, i, lo, hi, s;
+   long     line, start, stride;
+   long     strides[3];
+   double  *run, *array;
+
+   /* the two other axes, in order */
+   a1 = (axis == 0) ? 1 : 0;
+   a2 = (axis == 2) ? 1 : 2;
+   n = pass->sizes[axis];
+   strides[2] = 1;
+   strides[1] = pass->sizes[2];
+   strides[0] = (long)pass->sizes[1] * pass->sizes[2];
+   stride = strides[axis];
+
+   /* voxels whose window fits in the line */
+   lo = (pass->first < 0) ? -pass->first : 0;
+   hi = (pass->last > 0) ? n - pass->last : n;
+
+   run = (double *)malloc((n + 1) * sizeof(double));
+
+   for(line = first; line < last; line++){
+      start = (line / pass->sizes[a2]) * strides[a1] +
+         (line % pass->sizes[a2]) * strides[a2];
+
+      for(s = 0; s < 3; s++){
+         array = pass->sums[s];
+
+         run[0] = 0.0;
+         for(i = 0; i < n; i++){
+            run[i + 1] = run[i] + array[start + i * stride];
+            }
+         for(i = 0; i < n; i++){
+            array[start + i * stride] = (i < lo || i >= hi) ? 0.0 :
+               run[i + pass->last + 1] - run[i + pass->first];
+            }
+         }
+      }
+
+   free(run);
+   }
+
+/* 1D squared distance transform of lines along one axis of the work */
+/* array, using the lower envelope of parabolas (Felzenszwalb and    */
+/* Huttenlocher, "Distance Transforms of Sampled Functions", 2004)   */
+static void distance_lines(void *caller_data, long first, long last)
+{
+   Distance_Pass *pass = (Distance_Pass *) caller_data;
+   Morph_Buffer *buf = pass->buf;
+   int      axis = pass->axis;
+   int      a1, a2, n, q, k;
+   long     line, start, stride;
+   long     istart, istride;
+   long     isizes[3];
+   double   s, pq, pv, dist;
+   double   spacing = pass->spacing;
+   float   *work = buf->work;
+   double  *f, *z;
+   int     *v, *fi;
+
+   /* the two other axes, in order */
+   a1 = (axis == 0) ? 1 : 0;
+   a2 = (axis == 2) ? 1 : 2;
+   n = buf->sizes[axis];
+   stride = buf->stride[axis];
+   isizes[2] = 1;
+   isizes[1] = buf->sizes[2];
+   isizes[0] = (long)buf->sizes[1] * buf->sizes[2];
+   istride = isizes[axis];
+
+   f = (double *)malloc(n * sizeof(double));
+   z = (double *)malloc((n + 1) * sizeof(double));
+   v = (int *)malloc(n * sizeof(int));
+   fi = (int *)malloc(n * sizeof(int));
+
+   for(line = first; line < last; line++){
+      start = (line / buf->sizes[a2] + buf->pad) * buf->stride[a1] +
+         (line % buf->sizes[a2] + buf->pad) * buf->stride[a2] + buf->pad * stride;
+      istart = (line / buf->sizes[a2]) * isizes[a1] +
+         (line % buf->sizes[a2]) * isizes[a2];
+
+      for(q = 0; q < n; q++){
+         f[q] = work[start + q * stride];
+         if(pass->index != NULL){
+            fi[q] = pass->index[istart + q * istride];
+            }
+         }
+
+      /* build the lower envelope of the parabolas from feature voxels */
+      k = -1;
+      for(q = 0; q < n; q++){
+         if(f[q] >= EDT_INF){
+            continue;
+            }
+         pq = q * spacing;
+         while(k >= 0){
+            pv = v[k] * spacing;
+            s = ((f[q] + pq * pq) - (f[v[k]] + pv * pv)) / (2.0 * (pq - pv));
+            if(s > z[k]){
+               break;
+               }
+            k--;
+            }
+         k++;
+         v[k] = q;
+         z[k] = (k == 0) ? -DBL_MAX : s;
+         z[k + 1] = DBL_MAX;
+         }
+
+      /* no features on this line, leave it as it is */
+      if(k < 0){
+         continue;
+         }
+
+      /* fill in the distances from the envelope */
+      k = 0;
+      for(q = 0; q < n; q++){
+         while(z[k + 1] < q * spacing){
+            k++;
+            }
+         dist = (q - v[k]) * spacing;
+         work[start + q * stride] = dist * dist + f[v[k]];
+         if(pass->index != NULL){
+            pass->index[istart + q * istride] = fi[v[k]];
+            }
+         }
+      }
+
+   free(f);
+   free(z);
+   free(v);
+   free(fi);
+   }
+
+/* separable squared Euclidean distance transform of the work array, */
+/* in which features are 0 and all other voxels EDT_INF              */
+static void distance_transform(Morph_Buffer * buf, double sep[3], int *index)
+{
+   int      axis;
+   Distance_Pass pass;
+
+   pass.buf = buf;
+   pass.index = index;
+   for(axis = 2; axis >= 0; axis--){
+      pass.axis = axis;
+      pass.spacing = fabs(sep[axis]);
+      run_lines(distance_lines, &pass,
+                (long)buf->sizes[(axis == 0) ? 1 : 0] *
+                buf->sizes[(axis == 2) ? 1 : 2]);
+      }
+   }
+
+/* exact Euclidean distance transform of a buffer                    */
+/* Voxels that are not bg get their distance (in mm, using the voxel */
+/* separations) to the nearest bg voxel. If signed_dist is set, bg   */
+/* voxels get minus their distance to the nearest other voxel. If    */
+/* feature is not NULL it is filled with the file order index of the */
+/* nearest voxel used for each distance (-1 if there is none)        */
+Morph_Buffer *buffer_distance(Morph_Buffer * buf, double bg, double sep[3],
+                              int signed_dist, int *feature)
+{
+   int      x, y, z, pass;
+   long     idx, fidx;
+   int     *index, *outside_index;
+   unsigned char *is_bg;
+   float    dist;
+   VIO_progress_struct progress;
+
+   if(verbose){
+      fprintf(stdout, "Euclidean distance transform - background %g%s\n", bg,
+              (signed_dist) ? " (signed)" : "");
+      }
+   initialize_progress_report(&progress, FALSE, 2, "Distance");
+
+   /* keep a note of the background voxels */
+   is_bg = (unsigned char *)malloc(buf->nvoxels * sizeof(unsigned char));
+   for(idx = 0; idx < buf->nvoxels; idx++){
+      is_bg[idx] = (buf->data[idx] == bg);
+      }
+
+   /* the nearest features of bg voxels need a second array */
+   outside_index = NULL;
+   if(signed_dist && feature != NULL){
+      outside_index = (int *)malloc((long)buf->sizes[0] * buf->sizes[1] *
+                                    buf->sizes[2] * sizeof(int));
+      }
+
+   /* pass 0: distance of the other voxels to bg                    */
+   /* pass 1: (signed only) distance of bg voxels to the other ones */
+   for(pass = 0; pass < ((signed_dist) ? 2 : 1); pass++){
+
+      /* features are 0, everything else to be found */
+      index = (pass == 0) ? feature : outside_index;
+      fidx = 0;
+      for(z = 0; z < buf->sizes[0]; z++){
+         for(y = 0; y < buf->sizes[1]; y++){
+            idx = BUFFER_INDEX(buf, z, y, 0);
+            for(x = 0; x < buf->sizes[2]; x++, idx++, fidx++){
+               if(is_bg[idx] == (pass == 0)){
+                  buf->work[idx] = 0.0;
+                  if(index != NULL){
+                     index[fidx] = fidx;
+                     }
+                  }
+               else {
+                  buf->work[idx] = EDT_INF;
+                  if(index != NULL){
+                     index[fidx] = -1;
+                     }
+                  }
+               }
+            }
+         }
+
+      distance_transform(buf, sep, index);
+
+      /* store the distances for the voxels found in this pass */
+      fidx = 0;
+      for(z = 0; z < buf->sizes[0]; z++){
+         for(y = 0; y < buf->sizes[1]; y++){
+            idx = BUFFER_INDEX(buf, z, y, 0);
+            for(x = 0; x < buf->sizes[2]; x++, idx++, fidx++){
+               if(is_bg[idx] == (pass == 0)){
+                  if(pass == 0 && !signed_dist){
+                     buf->data[idx] = 0.0;
+                     }
+                  continue;
+                  }
+               dist = (buf->work[idx] >= EDT_INF) ? 0.0 : sqrt(buf->work[idx]);
+               buf->data[idx] = (pass == 0) ? dist : -dist;
+               if(pass == 1 && outside_index != NULL){
+                  feature[fidx] = outside_index[fidx];
+                  }
+               }
+            }
+         }
+
+      update_progress_report(&progress, pass + 1);
+      }
+
+   free(is_bg);
+   if(outside_index != NULL){
+      free(outside_index);
+      }
+   terminate_progress_report(&progress);
+   return (buf);
+   }
+
+/* find the root of a voxel, halving the path as we go */
+static unsigned int find_group(unsigned int *parent, unsigned int v)
+{
+   while(parent[v] != v){
+      parent[v] = parent[parent[v]];
+      v = parent[v];
+      }
+   return (v);
+   }
+
+/* label the voxels of a range of slabs, looking only at neighbours */
+/* in the same slab. The smaller root always wins a union, so every */
+/* voxel's parent comes before it in raster order                   */
+static void label_slabs(void *caller_data, long first, long last)
+{
+   Group_Pass *pass = (Group_Pass *) caller_data;
+   Morph_Buffer *buf = pass->buf;
+   unsigned int *parent = pass->parent;
+   unsigned int root, r, n, v;
+   long     slab;
+   int      x, y, z, c, in_box;
+   float    bg = pass->bg;
+   float   *row;
+
+   for(slab = first; slab < last; slab++){
+      for(z = pass->zstart[slab]; z < pass->zstart[slab + 1]; z++){
+         for(y = 0; y < buf->sizes[1]; y++){
+            v = ((unsigned int)z * buf->sizes[1] + y) * buf->sizes[2];
+            row = &buf->data[BUFFER_INDEX(buf, z, y, 0)];
+            in_box = (z >= pass->lo[0] && z < pass->hi[0] &&
+                      y >= pass->lo[1] && y < pass->hi[1]);
+            for(x = 0; x < buf->sizes[2]; x++, v++){
+               parent[v] = NO_GROUP;
+               if(!in_box || x < pass->lo[2] || x >= pass->hi[2] || row[x] == bg){
+                  continue;
+                  }
+
+               /* join the groups of the neighbours in this slab */
+               root = NO_GROUP;
+               for(c = 0; c < pass->nelems; c++){
+                  if(z + pass->dz[c] < pass->zstart[slab]){
+                     continue;
+                     }
+                  n = v + pass->offsets[c];
+                  if(parent[n] == NO_GROUP){
+                     continue;
+                     }
+                  r = find_group(parent, n);
+                  if(root == NO_GROUP){
+                     root = r;
+                     }
+                  else if(r < root){
+                     parent[root] = r;
+                     root = r;
+                     }
+                  else if(r > root){
+                     parent[r] = root;
+                     }
+                  }
+
+               parent[v] = (root == NO_GROUP) ? v : root;
+               }
+            }
+         }
+      }
+   }
+
+/* write the final labels of a range of slabs into the buffer */
+static void relabel_slabs(void *caller_data, long first, long last)
+{
+   Group_Pass *pass = (Group_Pass *) caller_data;
+   Morph_Buffer *buf = pass->buf;
+   unsigned int v;
+   int      x, y, z;
+   float   *row;
+
+   for(z = pass->zstart[first]; z < pass->zstart[last]; z++){
+      for(y = 0; y < buf->sizes[1]; y++){
+         v = ((unsigned int)z * buf->sizes[1] + y) * buf->sizes[2];
+         row = &buf->data[BUFFER_INDEX(buf, z, y, 0)];
+         for(x = 0; x < buf->sizes[2]; x++, v++){
+            row[x] = (pass->parent[v] == NO_GROUP) ? 0 : pass->trans[pass->parent[v]];
+            }
+         }
+      }
+   }
+
+/* label the groups of a buffer in order of decreasing size using the  */
+/* backward half of a (symmetric) kernel. The volume is split into one */
+/* slab per thread, each labelled with its own union-find forest, and  */
+/* the groups that touch across slab boundaries are then merged. If    */
+/* stats is not NULL it is set to an array of num_groups Group_Stats   */
+/* in label order, which the caller must free                          */
+Morph_Buffer *buffer_group(Kernel * K, Morph_Buffer * buf, double bg,
+                           Group_Stats ** stats, int *num_groups)
+{
+   int      x, y, z, c, n;
+   int      pre[3], post[3];
+   int      nslabs, slab;
+   unsigned int v, nb, ra, rb;
+   int      ngroups;
+   Group_Pass pass;
+   Group_Stats *group_data, *g;
+   VIO_progress_struct progress;
+
+   if(verbose){
+      fprintf(stdout, "Group kernel (buffer) - background %g\n", bg);
+      }
+   initialize_progress_report(&progress, FALSE, 4, "Groups");
+
+   /* get the backward half of the kernel as split_kernel() does */
+   pass.buf = buf;
+   pass.bg = bg;
+   pass.dz = (int *)malloc(K->nelems * sizeof(int));
+   pass.offsets = (long *)malloc(K->nelems * sizeof(long));
+   pass.nelems = 0;
+   for(n = 0; n < 3; n++){
+      pre[n] = post[n] = 0;
+      }
+   for(c = 0; c < K->nelems; c++){
+      if((K->K[c][2] < 0) ||
+         (K->K[c][1] < 0 && K->K[c][2] <= 0) ||
+         (K->K[c][0] < 0 && K->K[c][1] <= 0 && K->K[c][2] <= 0)){
+
+         pass.dz[pass.nelems] = (int)K->K[c][2];
+         pass.offsets[pass.nelems] =
+            ((long)K->K[c][2] * buf->sizes[1] + (long)K->K[c][1]) * buf->sizes[2] +
+            (long)K->K[c][0];
+         pass.nelems++;
+
+         for(n = 0; n < 3; n++){
+            if((int)K->K[c][2 - n] < pre[n]){
+               pre[n] = (int)K->K[c][2 - n];
+               }
+            if((int)K->K[c][2 - n] > post[n]){
+               post[n] = (int)K->K[c][2 - n];
+               }
+            }
+         }
+      }
+
+   /* only voxels whose neighbours all lie in the volume are labelled */
+   for(n = 0; n < 3; n++){
+      pass.lo[n] = -pre[n];
+      pass.hi[n] = buf->sizes[n] - post[n];
+      }
+
+   /* one slab per thread */
+   nslabs = (nthreads < buf->sizes[0]) ? nthreads : buf->sizes[0];
+   if(nslabs < 1){
+      nslabs = 1;
+      }
+   pass.zstart = (int *)malloc((nslabs + 1) * sizeof(int));
+   for(slab = 0; slab <= nslabs; slab++){
+      pass.zstart[slab] = (long)buf->sizes[0] * slab / nslabs;
+      }
+
+   pass.parent = (unsigned int *)malloc((long)buf->sizes[0] * buf->sizes[1] *
+                                        buf->sizes[2] * sizeof(unsigned int));
+   if(pass.parent == NULL){
+      fprintf(stderr, "buffer_group(): out of memory\n");
+      exit(EXIT_FAILURE);
+      }
+
+   /* pass 1 - label each slab */
+   run_lines(label_slabs, &pass, nslabs);
+   update_progress_report(&progress, 1);
+
+   /* pass 2 - merge groups across the slab boundaries */
+   for(slab = 1; slab < nslabs; slab++){
+      for(z = pass.zstart[slab]; z < pass.zstart[slab + 1] && z < pass.zstart[slab] - pre[0];
+          z++){
+         for(y = 0; y < buf->sizes[1]; y++){
+            v = ((unsigned int)z * buf->sizes[1] + y) * buf->sizes[2];
+            for(x = 0; x < buf->sizes[2]; x++, v++){
+               if(pass.parent[v] == NO_GROUP){
+                  continue;
+                  }
+               for(c = 0; c < pass.nelems; c++){
+                  if(z + pass.dz[c] >= pass.zstart[slab]){
+                     continue;
+                     }
+                  nb = v + pass.offsets[c];
+                  if(pass.parent[nb] == NO_GROUP){
+                     continue;
+                     }
+                  ra = find_group(pass.parent, v);
+                  rb = find_group(pass.parent, nb);
+                  if(ra != rb){
+
+                     /* the larger root joins the smaller one */
+                     if(rb < ra){
+                        nb = ra;
+                        ra = rb;
+                        rb = nb;
+                        }
+                     pass.parent[rb] = ra;
+                     }
+                  }
+               }
+            }
+         }
+      }
+   update_progress_report(&progress, 2);
+
+   /* pass 3 - number the groups in raster order and gather their  */
+   /* stats. Parents come first so they already hold group numbers */
+   ngroups = 0;
+   group_data = NULL;
+   v = 0;
+   for(z = 0; z < buf->sizes[0]; z++){
+      for(y = 0; y < buf->sizes[1]; y++){
+         for(x = 0; x < buf->sizes[2]; x++, v++){
+            if(pass.parent[v] == NO_GROUP){
+               continue;
+               }
+
+            if(pass.parent[v] == v){
+               SET_ARRAY_SIZE(group_data, ngroups, ngroups + 1, 500);
+               g = &group_data[ngroups];
+               g->label = ngroups;
+               g->count = 0;
+               g->min[0] = g->max[0] = z;
+               g->min[1] = g->max[1] = y;
+               g->min[2] = g->max[2] = x;
+               g->centroid[0] = g->centroid[1] = g->centroid[2] = 0.0;
+               pass.parent[v] = ngroups++;
+               }
+            else {
+               pass.parent[v] = pass.parent[pass.parent[v]];
+               }
+
+            g = &group_data[pass.parent[v]];
+            g->count++;
+            if(y < g->min[1]){
+               g->min[1] = y;
+               }
+            if(y > g->max[1]){
+               g->max[1] = y;
+               }
+            if(x < g->min[2]){
+               g->min[2] = x;
+               }
+            if(x > g->max[2]){
+               g->max[2] = x;
+               }
+            g->max[0] = z;
+            g->centroid[0] += z;
+            g->centroid[1] += y;
+            g->centroid[2] += x;
+            }
+         }
+      }
+   update_progress_report(&progress, 3);
+
+   /* sort the groups by size */
+   if(verbose){
+      fprintf(stdout, "Found %d unique groups, sorting...\n", ngroups);
+      }
+   if(ngroups > 0){
+      qsort(group_data, ngroups, sizeof(Group_Stats), &compare_group_stats);
+      }
+
+   pass.trans = (unsigned int *)malloc((ngroups + 1) * sizeof(unsigned int));
+   for(c = 0; c < ngroups; c++){
+      pass.trans[group_data[c].label] = c + 1;
+      group_data[c].label = c + 1;
+      for(n = 0; n < 3; n++){
+         group_data[c].centroid[n] /= group_data[c].count;
+         }
+      }
+
+   /* pass 4 - write out the new labels */
+   run_lines(relabel_slabs, &pass, nslabs);
+   update_progress_report(&progress, 4);
+
+   /* tidy up */
+   free(pass.trans);
+   free(pass.parent);
+   free(pass.zstart);
+   free(pass.offsets);
+   free(pass.dz);
+   if(stats != NULL){
+      *stats = group_data;
+      }
+   else if(group_data != NULL){
+      FREE(group_data);
+      }
+   if(num_groups != NULL){
+      *num_groups = ngroups;
+      }
+
+   terminate_progress_report(&progress);
+   return (buf);
+   }
+
+/* local correlation of a buffer with another volume of the same size */
+/* over a box kernel of unit coefficients, from separable box sums of */
+/* v1*v1, v2*v2 and v1*v2 so the cost per voxel does not depend on   */
+/* the kernel size (see lcorr_kernel)                                 */
+Morph_Buffer *buffer_lcorr(Kernel * K, Morph_Buffer * buf, VIO_Volume * cmp)
+{
+   int      x, y, z, n;
+   int      lo[3], hi[3];
+   long     idx, sidx;
+   double   v1, v2, denom;
+   Sum_Pass pass;
+   VIO_progress_struct progress;
+
+   if(verbose){
+      fprintf(stdout, "Local Correlation kernel (buffer)\n");
+      }
+   initialize_progress_report(&progress, FALSE, 4, "Local Correlation");
+
+   if(!kernel_box(K, FALSE, lo, hi)){
+      fprintf(stderr, "buffer_lcorr(): kernel is not a box\n");
+      exit(EXIT_FAILURE);
+      }
+
+   for(n = 0; n < 3; n++){
+      pass.sizes[n] = buf->sizes[n];
+      pass.sums[n] = (double *)malloc((long)buf->sizes[0] * buf->sizes[1] *
+                                      buf->sizes[2] * sizeof(double));
+      if(pass.sums[n] == NULL){
+         fprintf(stderr, "buffer_lcorr(): out of memory\n");
+         exit(EXIT_FAILURE);
+         }
+      }
+
+   /* the products to be summed */
+   sidx = 0;
+   for(z = 0; z < buf->sizes[0]; z++){
+      for(y = 0; y < buf->sizes[1]; y++){
+         idx = BUFFER_INDEX(buf, z, y, 0);
+         for(x = 0; x < buf->sizes[2]; x++, idx++, sidx++){
+            v1 = buf->data[idx];
+            v2 = get_volume_real_value(*cmp, z, y, x, 0, 0);
+            pass.sums[0][sidx] = v1 * v1;
+            pass.sums[1][sidx] = v2 * v2;
+            pass.sums[2][sidx] = v1 * v2;
+            }
+         }
+      }
+   update_progress_report(&progress, 1);
+
+   /* box sums, one axis at a time */
+   for(pass.axis = 2; pass.axis >= 0; pass.axis--){
+      pass.first = lo[pass.axis];
+      pass.last = hi[pass.axis];
+      run_lines(sum_lines, &pass,
+                (long)buf->sizes[(pass.axis == 0) ? 1 : 0] *
+                buf->sizes[(pass.axis == 2) ? 1 : 2]);
+      update_progress_report(&progress, 4 - pass.axis);
+      }
+
+   /* the correlation, 0 where the kernel leaves the volume */
+   sidx = 0;
+   for(z = 0; z < buf->sizes[0]; z++){
+      for(y = 0; y < buf->sizes[1]; y++){
+         idx = BUFFER_INDEX(buf, z, y, 0);
+         for(x = 0; x < buf->sizes[2]; x++, idx++, sidx++){
+            /* sums of squares can round to just below 0 */
+            if(pass.sums[0][sidx] <= 0.0 || pass.sums[1][sidx] <= 0.0){
+               buf->data[idx] = 0.0;
+               }
+            else {
+               denom = sqrt(pass.sums[0][sidx] * pass.sums[1][sidx]);
+               buf->data[idx] = pass.sums[2][sidx] / denom;
+               }
+            }
+         }
+      }
+
+   for(n = 0; n < 3; n++){
+      free(pass.sums[n]);
+      }
+   terminate_progress_report(&progress);
+   return (buf);
+   }
@@ -0,0 +1,68 @@
+/* buffer_ops.h */
+
+#ifndef BUFFER_OPS
+#define BUFFER_OPS
+
+#include <volume_io.h>
+#include "kernel_io.h"
+
+/* Structure for a volume held in a contiguous float array with a   */
+/* border of pad voxels on every side. Kernel elements become plain */
+/* offsets into the array and need no bounds checks. Operations     */
+/* write to work and then swap it with data                         */
+typedef struct {
+   int      sizes[3];                  /* z, y, x sizes of the volume */
+   int      pad;                       /* border width                */
+   long     stride[3];                 /* z, y, x steps in the array  */
+   long     nvoxels;                   /* size of the padded array    */
+   float   *data;
+   float   *work;
+   } Morph_Buffer;
+
+/* index of voxel (z, y, x) of the volume in a buffer array */
+#define BUFFER_INDEX(buf, z, y, x) \
+   (((z) + (buf)->pad) * (buf)->stride[0] + \
+    ((y) + (buf)->pad) * (buf)->stride[1] + ((x) + (buf)->pad))
+
+/* structure for the statistics of a group */
+typedef struct {
+   unsigned int label;
+   unsigned int count;                 /* number of voxels          */
+   int      min[3];                    /* z, y, x bounding box      */
+   int      max[3];
+   double   centroid[3];               /* z, y, x voxel coordinates */
+   } Group_Stats;
+
+/* function run by each thread on a range of lines [first, last) */
+typedef void (*Line_Function)(void *caller_data, long first, long last);
+
+/* buffer set up */
+Morph_Buffer *new_morph_buffer(VIO_Volume * vol, int pad);
+void     delete_morph_buffer(Morph_Buffer * buf);
+void     volume_to_buffer(VIO_Volume * vol, Morph_Buffer * buf);
+void     buffer_to_volume(Morph_Buffer * buf, VIO_Volume * vol);
+void     swap_buffer(Morph_Buffer * buf);
+int      kernel_buffer_pad(Kernel * K);
+int      buffer_kernel_ok(Kernel * K, int unit_coeffs);
+int      kernel_box(Kernel * K, int with_centre, int lo[3], int hi[3]);
+long    *get_kernel_offsets(Kernel * K, Morph_Buffer * buf, int sign);
+void     get_centre_box(Kernel * K, Morph_Buffer * buf, int lo[3], int hi[3]);
+void     fill_outside_box(Morph_Buffer * buf, float *array, int lo[3], int hi[3],
+                          float value);
+void     run_lines(Line_Function function, void *caller_data, long nlines);
+
+/* buffer versions of the kernel functions */
+Morph_Buffer *buffer_binarise(Morph_Buffer * buf, double floor, double ceil,
+                              double fg, double bg);
+Morph_Buffer *buffer_clamp(Morph_Buffer * buf, double floor, double ceil, double bg);
+Morph_Buffer *buffer_erosion(Kernel * K, Morph_Buffer * buf);
+Morph_Buffer *buffer_dilation(Kernel * K, Morph_Buffer * buf);
+Morph_Buffer *buffer_median_dilation(Kernel * K, Morph_Buffer * buf);
+Morph_Buffer *buffer_convolve(Kernel * K, Morph_Buffer * buf);
+Morph_Buffer *buffer_distance(Morph_Buffer * buf, double bg, double sep[3],
+                              int signed_dist, int *feature);
+Morph_Buffer *buffer_lcorr(Kernel * K, Morph_Buffer * buf, VIO_Volume * cmp);
+Morph_Buffer *buffer_group(Kernel * K, Morph_Buffer * buf, double bg,
+                           Group_Stats ** stats, int *num_groups);
+
+#endif
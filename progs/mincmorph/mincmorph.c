@@ -26,6 +26,7 @@
 #include <time_stamp.h>
 #include "kernel_io.h"
 #include "kernel_ops.h"
+#include "buffer_ops.h"
 
 #define INTERNAL_PREC NC_FLOAT         /* should be NC_FLOAT or NC_DOUBLE */
 #define DEF_DOUBLE -DBL_MAX
@@ -34,6 +35,10 @@
 char    *get_real_from_string(char *string, double *value);
 char    *get_string_from_string(char *string, char **value);
 void     calc_volume_range(VIO_Volume * vol, double *min, double *max);
+void     write_feature_index(char *outfile, VIO_Volume * vol, int *feature,
+                             char *infile, char *arg_string);
+void     write_group_stats(char *outfile, VIO_Volume * vol, Group_Stats * stats,
+                           int num_groups);
 
 /* kernel names for pretty output */
 char    *KERN_names[] = { "NULL", "2D04", "2D08", "3D06", "3D26" };
@@ -43,7 +48,7 @@ typedef enum {
    UNDEF = 0,
    BINARISE, CLAMP, PAD, ERODE, DILATE, MDILATE,
    OPEN, CLOSE, LPASS, HPASS, CONVOLVE, DISTANCE,
-   GROUP, READ_KERNEL, WRITE, LCORR
+   GROUP, READ_KERNEL, WRITE, LCORR, EDT
    } op_types;
 
 typedef struct {
@@ -58,6 +63,8 @@ typedef struct {
    double   background;
    } Operation;
 
+int      is_buffer_op(Operation * op, Kernel * kernel);
+
 /* Argument variables */
 int      verbose = FALSE;
 int      clobber = FALSE;
@@ -69,6 +76,10 @@ double   background = 0.0;
 kern_types kernel_id = K_NULL;
 char    *kernel_fn = NULL;
 char    *succ_txt = "B";
+int      use_buffer = TRUE;
+int      nthreads = 1;
+int      signed_distance = FALSE;
+char    *group_stats_fn = NULL;
 
 char     successive_help[] = "Successive operations (Maximum: 100) \
 \n\tB[floor:ceil:fg:bg] - binarise in the range, using foreground and background \
@@ -83,6 +94,7 @@ char     successive_help[] = "Successive operations (Maximum: 100) \
 \n\tH - highpass filter \
 \n\tX - convolve \
 \n\tF - distance transform (binary input only - not checked) \
+\n\tT[index.mnc] - exact euclidean distance transform, optionally write nearest feature index \
 \n\tG - Label the groups in the volume in ascending order \
 \n\tR[TYPE|file.kern] - (2D04|2D08|3D06|3D26) or read in a kernel file \
 \n\tW[file.mnc] - write out current results \
@@ -97,6 +109,10 @@ ArgvInfo argTable[] = {
     "be verbose"},
    {"-clobber", ARGV_CONSTANT, (char *)TRUE, (char *)&clobber,
     "clobber existing files"},
+   {"-no_buffer", ARGV_CONSTANT, (char *)FALSE, (char *)&use_buffer,
+    "do all operations on the volume rather than a raw buffer (slow)"},
+   {"-threads", ARGV_INT, (char *)1, (char *)&nthreads,
+    "number of threads to use for operations that support them"},
 
    {NULL, ARGV_HELP, NULL, NULL,
     "\nOutfile Options"},
@@ -140,6 +156,10 @@ ArgvInfo argTable[] = {
     "foreground value"},
    {"-background", ARGV_FLOAT, (char *)1, (char *)&background,
     "background value"},
+   {"-signed_distance", ARGV_CONSTANT, (char *)TRUE, (char *)&signed_distance,
+    "exact distance transform gives negative distances inside the background"},
+   {"-group_stats", ARGV_STRING, (char *)1, (char *)&group_stats_fn,
+    "<stats.txt> write the size, bounding box and centroid of each group"},
 
    {NULL, ARGV_HELP, (char *)NULL, (char *)NULL, "\nSingle morphological operations:"},
    {"-binarise", ARGV_CONSTANT, (char *)"B", (char *)&succ_txt,
@@ -166,6 +186,8 @@ ArgvInfo argTable[] = {
     "convolve file with kernel"},
    {"-distance", ARGV_CONSTANT, (char *)"F", (char *)&succ_txt,
     "distance transform"},
+   {"-edt", ARGV_CONSTANT, (char *)"T", (char *)&succ_txt,
+    "exact euclidean distance transform (uses voxel separations)"},
    {"-group", ARGV_CONSTANT, (char *)"G", (char *)&succ_txt,
     "label groups in ascending order"},
 
@@ -186,6 +208,8 @@ int main(int argc, char *argv[])
 
    VIO_Volume *volume;
    VIO_Volume *cmpvol;
+   Morph_Buffer *buffer;
+   int      buffer_current, volume_current;
    Kernel  *kernel;
    int      num_ops;
    Operation operation[100];
@@ -195,6 +219,11 @@ int main(int argc, char *argv[])
    char     tmp_filename[MAXPATHLEN];
    double   tmp_double[4];
    double   min, max;
+   double   sep[3];
+   int     *feature;
+   Group_Stats *group_stats;
+   int      num_groups;
+   int      sizes[MAX_VAR_DIMS], cmp_sizes[MAX_VAR_DIMS];
    char    *ptr;
 
    char    *axis_order[3] = { MIzspace, MIyspace, MIxspace };
@@ -223,6 +252,13 @@ int main(int argc, char *argv[])
       exit(EXIT_FAILURE);
       }
 
+   /* check for the group stats file */
+   if(group_stats_fn != NULL && access(group_stats_fn, F_OK) == 0 && !clobber){
+      fprintf(stderr, "%s: %s exists! (use -clobber to overwrite)\n\n", argv[0],
+              group_stats_fn);
+      exit(EXIT_FAILURE);
+      }
+
    /* check kernel args */
    if(kernel_fn != NULL && kernel_id != K_NULL){
       fprintf(stderr, "%s: specify either a kernel file or a set kernel (not both)\n\n",
@@ -342,6 +378,26 @@ int main(int argc, char *argv[])
          op->type = GROUP;
          break;
 
+      case 'T':
+         op->type = EDT;
+         op->background = background;
+
+         /* get the optional nearest feature index filename */
+         ptr = get_string_from_string(ptr, &op->outfile);
+
+         if(op->outfile != NULL){
+            if(access(op->outfile, F_OK) == 0 && !clobber){
+               fprintf(stderr, "%s: %s exists! (use -clobber to overwrite)\n\n", argv[0],
+                       op->outfile);
+               exit(EXIT_FAILURE);
+               }
+            sprintf(ext_txt, "bg: %g index filename: %s", op->background, op->outfile);
+            }
+         else {
+            sprintf(ext_txt, "bg: %g", op->background);
+            }
+         break;
+
       case 'R':
          op->type = READ_KERNEL;
 
@@ -447,6 +503,24 @@ int main(int argc, char *argv[])
    get_type_range(get_volume_data_type(*volume), &min, &max);
    set_volume_real_range(*volume, min, max);
 
+   /* the raw buffer is only used for 3D volumes */
+   if(get_volume_n_dimensions(*volume) != 3){
+      for(c = 0; c < num_ops; c++){
+         if(operation[c].type == EDT){
+            fprintf(stderr, "%s: T (exact distance transform) needs a 3D volume\n\n",
+                    argv[0]);
+            exit(EXIT_FAILURE);
+            }
+         }
+      use_buffer = FALSE;
+      }
+   if(nthreads < 1){
+      nthreads = 1;
+      }
+   buffer = NULL;
+   buffer_current = FALSE;
+   volume_current = TRUE;
+
    /* init and then do some operations */
    kernel = new_kernel(0);
 
@@ -456,6 +530,144 @@ int main(int argc, char *argv[])
    for(c = 0; c < num_ops; c++){
       op = &operation[c];
 
+      /* do the operation on the raw buffer if possible (EDT always is) */
+      if((use_buffer || op->type == EDT) && is_buffer_op(op, kernel)){
+
+         /* get a buffer with a wide enough border for the kernel */
+         if(buffer != NULL && buffer->pad < kernel_buffer_pad(kernel)){
+            if(!volume_current){
+               buffer_to_volume(buffer, volume);
+               volume_current = TRUE;
+               }
+            delete_morph_buffer(buffer);
+            buffer = NULL;
+            }
+         if(buffer == NULL){
+            buffer = new_morph_buffer(volume, kernel_buffer_pad(kernel));
+            buffer_current = TRUE;
+            }
+         else if(!buffer_current){
+            volume_to_buffer(volume, buffer);
+            buffer_current = TRUE;
+            }
+
+         switch (op->type){
+         case BINARISE:
+            buffer = buffer_binarise(buffer, op->range[0], op->range[1],
+                                     op->foreground, op->background);
+            break;
+
+         case CLAMP:
+            buffer = buffer_clamp(buffer, op->range[0], op->range[1], op->background);
+            break;
+
+         case ERODE:
+            buffer = buffer_erosion(kernel, buffer);
+            break;
+
+         case DILATE:
+            buffer = buffer_dilation(kernel, buffer);
+            break;
+
+         case MDILATE:
+            buffer = buffer_median_dilation(kernel, buffer);
+            break;
+
+         case OPEN:
+            buffer = buffer_erosion(kernel, buffer);
+            buffer = buffer_dilation(kernel, buffer);
+            break;
+
+         case CLOSE:
+            buffer = buffer_dilation(kernel, buffer);
+            buffer = buffer_erosion(kernel, buffer);
+            break;
+
+         case LPASS:
+            buffer = buffer_erosion(kernel, buffer);
+            buffer = buffer_dilation(kernel, buffer);
+            buffer = buffer_dilation(kernel, buffer);
+            buffer = buffer_erosion(kernel, buffer);
+            break;
+
+         case CONVOLVE:
+            buffer = buffer_convolve(kernel, buffer);
+            break;
+
+         case EDT:
+            get_volume_separations(*volume, sep);
+            feature = NULL;
+            if(op->outfile != NULL){
+               feature = (int *)malloc(sizeof(int) * buffer->sizes[0] *
+                                       buffer->sizes[1] * buffer->sizes[2]);
+               }
+
+            buffer = buffer_distance(buffer, op->background, sep, signed_distance,
+                                     feature);
+
+            if(feature != NULL){
+               if(verbose){
+                  fprintf(stdout, "Outputting feature index to %s\n", op->outfile);
+                  }
+               write_feature_index(op->outfile, volume, feature, infile, arg_string);
+               free(feature);
+               }
+            break;
+
+         case LCORR:
+            if(verbose){
+               fprintf(stdout, "Comparing to %s\n", op->cmpfile);
+               }
+
+            cmpvol = (VIO_Volume *) malloc(sizeof(VIO_Volume));
+            input_volume(op->cmpfile, MAX_VAR_DIMS, axis_order,
+                         INTERNAL_PREC, TRUE, 0.0, 0.0, TRUE, cmpvol, NULL);
+
+            get_volume_sizes(*volume, sizes);
+            get_volume_sizes(*cmpvol, cmp_sizes);
+            if(get_volume_n_dimensions(*cmpvol) != 3 || sizes[0] != cmp_sizes[0] ||
+               sizes[1] != cmp_sizes[1] || sizes[2] != cmp_sizes[2]){
+               fprintf(stderr, "%s: %s does not have the same sizes as %s\n\n",
+                       argv[0], op->cmpfile, infile);
+               exit(EXIT_FAILURE);
+               }
+
+            buffer = buffer_lcorr(kernel, buffer, cmpvol);
+
+            delete_volume(*cmpvol);
+            free(cmpvol);
+            break;
+
+         case GROUP:
+            if(group_stats_fn != NULL){
+               buffer = buffer_group(kernel, buffer, background, &group_stats,
+                                     &num_groups);
+               write_group_stats(group_stats_fn, volume, group_stats, num_groups);
+               free(group_stats);
+               }
+            else {
+               buffer = buffer_group(kernel, buffer, background, NULL, NULL);
+               }
+            break;
+
+         default:
+            fprintf(stderr, "%s: This shouldn't happen -- much bad\n\n", argv[0]);
+            exit(EXIT_FAILURE);
+            }
+
+         volume_current = FALSE;
+         continue;
+         }
+
+      /* otherwise make sure that the volume is up to date */
+      if(!volume_current && op->type != READ_KERNEL){
+         buffer_to_volume(buffer, volume);
+         volume_current = TRUE;
+         }
+      if(op->type != READ_KERNEL && op->type != WRITE){
+         buffer_current = FALSE;
+         }
+
       switch (op->type){
       case BINARISE:
          volume = binarise(volume, op->range[0], op->range[1],
@@ -512,6 +724,10 @@ int main(int argc, char *argv[])
          break;
 
       case GROUP:
+         if(group_stats_fn != NULL){
+            fprintf(stderr, "%s: -group_stats needs the raw buffer, ignoring it\n",
+                    argv[0]);
+            }
          volume = group_kernel(kernel, volume, background);
          break;
 
@@ -622,6 +838,9 @@ int main(int argc, char *argv[])
 
    /* jump through operations freeing stuff */
    // free(op.kernel);
+   if(buffer != NULL){
+      delete_morph_buffer(buffer);
+      }
 
    delete_volume(*volume);
    return (EXIT_SUCCESS);
@@ -695,6 +914,102 @@ char    *get_string_from_string(char *string, char **value)
    return string;
    }
 
+/* check whether an operation can be done on the raw buffer */
+int is_buffer_op(Operation * op, Kernel * kernel)
+{
+   int      box_lo[3], box_hi[3];
+
+   switch (op->type){
+   case BINARISE:
+   case CLAMP:
+      return (TRUE);
+
+   case ERODE:
+   case DILATE:
+   case OPEN:
+   case CLOSE:
+   case LPASS:
+      return (buffer_kernel_ok(kernel, TRUE));
+
+   case MDILATE:
+   case CONVOLVE:
+   case GROUP:
+      return (buffer_kernel_ok(kernel, FALSE));
+
+   case EDT:
+      return (TRUE);
+
+   case LCORR:
+      return (buffer_kernel_ok(kernel, TRUE) && kernel_box(kernel, FALSE, box_lo, box_hi));
+
+   default:
+      return (FALSE);
+      }
+   }
+
+/* write the index of the nearest feature voxel (z*ny*nx + y*nx + x) */
+/* of each voxel as an int volume, -1 where there is no feature       */
+void write_feature_index(char *outfile, VIO_Volume * vol, int *feature,
+                         char *infile, char *arg_string)
+{
+   int      x, y, z;
+   int      sizes[MAX_VAR_DIMS];
+   long     i;
+   double   min, max;
+   VIO_Volume index_vol;
+
+   /* an int volume with a 1:1 voxel to real mapping */
+   index_vol = copy_volume_definition(*vol, NC_INT, TRUE, 0.0, 0.0);
+   get_volume_voxel_range(index_vol, &min, &max);
+   set_volume_real_range(index_vol, min, max);
+
+   get_volume_sizes(index_vol, sizes);
+   i = 0;
+   for(z = 0; z < sizes[0]; z++){
+      for(y = 0; y < sizes[1]; y++){
+         for(x = 0; x < sizes[2]; x++){
+            set_volume_voxel_value(index_vol, z, y, x, 0, 0, (double)feature[i++]);
+            }
+         }
+      }
+
+   output_modified_volume(outfile, NC_INT, TRUE, 0.0, 0.0, index_vol, infile,
+                          arg_string, NULL);
+   delete_volume(index_vol);
+   }
+
+/* write a table of group statistics, one line per group, with the */
+/* bounding box in voxels and the centroid in world coordinates     */
+void write_group_stats(char *outfile, VIO_Volume * vol, Group_Stats * stats,
+                       int num_groups)
+{
+   int      c;
+   double   wx, wy, wz;
+   FILE    *fp;
+
+   if(verbose){
+      fprintf(stdout, "Outputting group stats to %s\n", outfile);
+      }
+
+   fp = fopen(outfile, "w");
+   if(fp == NULL){
+      fprintf(stderr, "write_group_stats(): could not open %s\n", outfile);
+      exit(EXIT_FAILURE);
+      }
+
+   fprintf(fp, "# label count xmin xmax ymin ymax zmin zmax"
+           " centroid_x centroid_y centroid_z\n");
+   for(c = 0; c < num_groups; c++){
+      convert_3D_voxel_to_world(*vol, stats[c].centroid[0], stats[c].centroid[1],
+                                stats[c].centroid[2], &wx, &wy, &wz);
+      fprintf(fp, "%u %u %d %d %d %d %d %d %g %g %g\n", stats[c].label, stats[c].count,
+              stats[c].min[2], stats[c].max[2], stats[c].min[1], stats[c].max[1],
+              stats[c].min[0], stats[c].max[0], wx, wy, wz);
+      }
+
+   fclose(fp);
+   }
+
 void calc_volume_range(VIO_Volume * vol, double *min, double *max)
 {
 
@@ -330,7 +330,7 @@ static void get_arginfo(int argc, char *argv[],
       {-DBL_MAX, -DBL_MAX},   /* Flag that range not set */
       FILL_DEFAULT,           /* Flag indicating that fillvalue not set */
       {NO_VALUE, NO_VALUE, NO_VALUE}, /* Flag indicating that origin not set */
-      {TRUE},                 /* Verbose */
+      {TRUE, 1},              /* Verbose, single thread */
       TRILINEAR,              /* use trilinear interpolation by default */
       {FALSE, NULL, NULL, 0, NULL}, /* Transformation info is empty at start.
                                  Transformation must be set before invoking
@@ -347,7 +347,8 @@ static void get_arginfo(int argc, char *argv[],
           {"", "", ""},       /* units */
           {"", "", ""}        /* spacetype */
       },
-      FALSE			/* MINC 2.0 format? */
+      FALSE,			/* MINC 2.0 format? */
+      0                       /* No limit on input buffer size */
    };
 
    static ArgvInfo argTable[] = {
@@ -368,6 +369,12 @@ static void get_arginfo(int argc, char *argv[],
       {"-quiet", ARGV_CONSTANT, (char *) FALSE,
           (char *) &args.flags.verbose,
           "Do not print out any log messages.\n"},
+      {"-threads", ARGV_INT, (char *) 1,
+          (char *) &args.flags.nthreads,
+          "Number of threads used to compute output slices (default 1).\n"},
+      {"-max_buffer_size_in_kb", ARGV_INT, (char *) 1,
+          (char *) &args.max_buffer_size_in_kb,
+          "Maximum size of the input volume buffer (in kbytes). Larger\n\t\tvolumes are read in slabs (default: no limit)."},
       {"-transformation", ARGV_FUNC, (char *) get_transformation, 
           (char *) &args.transform_info,
           "File giving world transformation. (Default = identity)."},
@@ -528,6 +535,14 @@ static void get_arginfo(int argc, char *argv[],
        (char *) SINC_WINDOW_HAMMING,
        (char *) &sinc_window_type,
        "Set sinc window type to Hamming"},
+      {"-transform_step", ARGV_INT,
+       (char *) 1,
+       (char *) &transform_step,
+       "Evaluate non-linear transforms every n voxels along a row (1-64)"},
+      {"-transform_tolerance", ARGV_FLOAT,
+       (char *) 1,
+       (char *) &transform_tolerance,
+       "Max. error (in input voxels) for interpolated transform positions"},
       {NULL, ARGV_END, NULL, NULL, NULL}
    };
 
@@ -535,7 +550,7 @@ static void get_arginfo(int argc, char *argv[],
    int idim, index;
    int out_vindex;              /* Volume indices (0, 1 or 2) */
    int out_findex;              /* File indices (0 to ndims-1) */
-   long size, total_size;
+   long size, total_size, slice_size;
    char *infile, *outfile;
    File_Info *fp;
    char *tm_stamp, *pname;
@@ -646,19 +661,13 @@ static void get_arginfo(int argc, char *argv[],
       in_vol->volume->use_fill = (args.fillvalue != -DBL_MAX);
    }
 
-   /* set the function pointer defining the type of interpolation */
+   /* Check the type of interpolation */
    switch (args.interpolant_type ) {
    case TRICUBIC:
-     in_vol->volume->interpolant = tricubic_interpolant;
-     break;
    case TRILINEAR:
-     in_vol->volume->interpolant = trilinear_interpolant;
-     break;
    case N_NEIGHBOUR:
-     in_vol->volume->interpolant = nearest_neighbour_interpolant;
      break;
    case WINDOWED_SINC:
-     in_vol->volume->interpolant = windowed_sinc_interpolant;
      if (sinc_half_width < SINC_HALF_WIDTH_MIN ||
          sinc_half_width > SINC_HALF_WIDTH_MAX) {
          fprintf(stderr, "Invalid sinc half-window size %d\n", 
@@ -671,6 +680,17 @@ static void get_arginfo(int argc, char *argv[],
      exit(EXIT_FAILURE);
    }
 
+   /* Check the non-linear transform sampling */
+   if (transform_step < 1 || transform_step > TRANSFORM_STEP_MAX) {
+      (void) fprintf(stderr, "Invalid transform step %d\n", transform_step);
+      exit(EXIT_FAILURE);
+   }
+   if (transform_tolerance < 0.0) {
+      (void) fprintf(stderr, "Invalid transform tolerance %g\n", 
+                     transform_tolerance);
+      exit(EXIT_FAILURE);
+   }
+
    /* Check min/max variables */
    fp = in_vol->file;
    fp->using_icv=FALSE;
@@ -679,7 +699,13 @@ static void get_arginfo(int argc, char *argv[],
       check_imageminmax(fp, in_vol->volume);
    }
 
-   /* Get space for volume data */
+   /* Set the functions defining the type of interpolation, now that the
+      type of the volume data in memory is known */
+   set_volume_interpolant(in_vol->volume, args.interpolant_type);
+
+   /* Get space for volume data. If the whole volume does not fit in the
+      buffer size limit, get enough space for a slab of slices - the
+      volume will be read a slab at a time */
    total_size = 1;
    for (idim=0; idim < WORLD_NDIMS; idim++) {
       index = input_volume_def.axes[idim];
@@ -687,8 +713,21 @@ static void get_arginfo(int argc, char *argv[],
       total_size *= size;
       in_vol->volume->size[index] = size;
    }
-   in_vol->volume->data = malloc((size_t) total_size * 
-                                 nctypelen(in_vol->volume->datatype));
+   slice_size = (total_size / in_vol->volume->size[SLC_AXIS]) * 
+      nctypelen(in_vol->volume->datatype);
+   in_vol->volume->max_slices = in_vol->volume->size[SLC_AXIS];
+   if ((args.max_buffer_size_in_kb > 0) &&
+       ((double) args.max_buffer_size_in_kb * 1024.0 < 
+        (double) slice_size * in_vol->volume->max_slices)) {
+      in_vol->volume->max_slices = 
+         ((long) args.max_buffer_size_in_kb * 1024) / slice_size;
+      if (in_vol->volume->max_slices < 1)
+         in_vol->volume->max_slices = 1;
+   }
+   in_vol->volume->first_slice = 0;
+   in_vol->volume->nslices = 0;
+   in_vol->volume->data = malloc((size_t) in_vol->volume->max_slices * 
+                                 slice_size);
 
    /* Get space for slice scale and offset */
    in_vol->volume->scale = 
@@ -696,6 +735,19 @@ static void get_arginfo(int argc, char *argv[],
    in_vol->volume->offset = 
       malloc(sizeof(double) * in_vol->volume->size[SLC_AXIS]);
 
+   /* Check the number of threads */
+   if (args.flags.nthreads < 1) {
+      (void) fprintf(stderr, "Number of threads must be at least 1.\n");
+      exit(EXIT_FAILURE);
+   }
+#ifndef HAVE_PTHREAD
+   if (args.flags.nthreads > 1) {
+      (void) fprintf(stderr, 
+                     "Thread support not available - using one thread.\n");
+      args.flags.nthreads = 1;
+   }
+#endif
+
    /* Save the program flags */
    *program_flags = args.flags;
 
@@ -197,6 +197,9 @@ typedef struct {
 typedef struct Volume_Data_Struct Volume_Data;
 typedef int (*Interpolating_Function) 
      (Volume_Data *volume, Coord_Vector coord, double *result);
+typedef void (*Row_Interpolating_Function)
+     (Volume_Data *volume, long ncols, Coord_Vector coords[], 
+      double result[], double *minimum, double *maximum);
 struct Volume_Data_Struct {
    nc_type datatype;         /* Type of data in volume */
    int is_signed;            /* Sign of data (TRUE if signed) */
@@ -207,9 +210,16 @@ struct Volume_Data_Struct {
    double real_range[2];     /* Real min and max for current volume */
    int size[VOL_NDIMS];      /* Size of each dimension */
    void *data;               /* Pointer to volume data */
+   int first_slice;          /* First slice held in data */
+   int nslices;              /* Number of slices held in data */
+   int max_slices;           /* Number of slices that data has room for */
+   int kernel_reach;         /* Number of slices on either side of a point
+                                that the interpolant may look at */
    double *scale;            /* Pointer to array of scales for slices */
    double *offset;           /* Pointer to array of offsets for slices */
    Interpolating_Function interpolant; /* Function Pointer */
+   Row_Interpolating_Function row_interpolant; /* Interpolates a whole row,
+                                                  updating min and max */
 };
 
 typedef struct {
@@ -234,6 +244,7 @@ typedef struct {
 
 typedef struct {
    int verbose;
+   int nthreads;             /* Number of threads used to compute slices */
 } Program_Flags;
 
 typedef struct {
@@ -257,6 +268,7 @@ typedef struct {
    Transform_Info transform_info;
    Volume_Definition volume_def;
    int v2format;                /* If non-zero, create a MINC 2.0 output */
+   int max_buffer_size_in_kb;   /* Limit on input volume buffer (0 = none) */
 } Arg_Data;
 
 typedef struct {
@@ -325,7 +337,7 @@ typedef struct {
 { \
    long offset; \
  \
-   offset = ((slcind)*volume->size[ROW_AXIS] + \
+   offset = (((slcind) - volume->first_slice)*volume->size[ROW_AXIS] + \
              (rowind))*volume->size[COL_AXIS] + (colind); \
    switch (volume->datatype) { \
    case NC_BYTE: \
@@ -368,6 +380,8 @@ extern int nearest_neighbour_interpolant(Volume_Data *volume,
                                          Coord_Vector coord, double *result);
 extern int windowed_sinc_interpolant(Volume_Data *volume,
                                      Coord_Vector coord, double *result);
+extern void set_volume_interpolant(Volume_Data *volume,
+                                   enum Interpolant_type interpolant_type);
 
 #define SINC_HALF_WIDTH_MAX 10
 #define SINC_HALF_WIDTH_MIN 1
@@ -380,3 +394,11 @@ enum sinc_interpolant_window_t {
 
 extern enum sinc_interpolant_window_t sinc_window_type;
 extern int sinc_half_width;
+
+/* Non-linear transforms are evaluated exactly every transform_step voxels
+   along a row and interpolated in between, as long as the interpolation
+   error stays below transform_tolerance (in input voxels) */
+#define TRANSFORM_STEP_MAX 64
+
+extern int transform_step;
+extern double transform_tolerance;
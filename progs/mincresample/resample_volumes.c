@@ -126,19 +126,103 @@
 #include <math.h>
 #include <minc.h>
 #include <volume_io.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include "mincresample.h"
 
+/* Pool of worker threads computing output slices for the writer */
+#ifdef HAVE_PTHREAD
+typedef struct {
+   Volume_Data *volume;          /* Input volume (shared, read-only) */
+   VIO_General_transform *total_transf;
+   VIO_Real *separations;
+   long end_slice;               /* One past last slice to compute */
+   long next_slice;              /* Next slice to be claimed by a worker */
+   int nbuffers;                 /* Number of slice buffers */
+   Slice_Data *buffers;          /* Slice buffers */
+   long *buffer_slice;           /* Slice held by each buffer (-1 = free) */
+   int *buffer_ready;            /* TRUE when buffer slice is computed */
+   double *buffer_min;           /* Minimum of each computed slice */
+   double *buffer_max;           /* Maximum of each computed slice */
+   int *buffer_ok;               /* FALSE if the slab was too small */
+   long *buffer_need_first;      /* Input slices needed by each slice */
+   long *buffer_need_last;
+   int stopping;                 /* TRUE when the band is abandoned */
+   int nthreads;
+   pthread_t *threads;
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+} Slice_Pool;
+
+static void create_slice_pool(Slice_Pool *pool, int nthreads,
+                              Slice_Data *model_slice);
+static void start_slice_pool(Slice_Pool *pool, long first_slice,
+                             long end_slice, Volume_Data *volume,
+                             VIO_General_transform *total_transf,
+                             VIO_Real separations[]);
+static Slice_Data *wait_for_slice(Slice_Pool *pool, long islice,
+                                  double *minimum, double *maximum,
+                                  int *slab_ok, 
+                                  long *need_first, long *need_last);
+static void release_slice(Slice_Pool *pool, long islice);
+static void finish_slice_pool(Slice_Pool *pool);
+static void stop_slice_pool(Slice_Pool *pool);
+static void delete_slice_pool(Slice_Pool *pool);
+static void *slice_worker(void *arg);
+#endif
+
 static void load_volume(File_Info *file, long start[], long count[],
                         Volume_Data *volume);
-static void get_slice(long slice_num, VVolume *in_vol, VVolume *out_vol,
-                      VIO_General_transform *transformation,
-                      double *minimum, double *maximum);
+static void load_slice_scales(File_Info *file, long start[], long count[],
+                              Volume_Data *volume);
+static void read_slices(File_Info *file, long start[], long count[],
+                        Volume_Data *volume, long first, long nread, 
+                        long dest);
+static void get_slab_ranges(Volume_Data *volume, Slice_Data *slice, 
+                            long nslice, VIO_General_transform *total_transf,
+                            VIO_Real separations[], 
+                            long slab_first[], long slab_last[]);
+static void get_slice_extent(Volume_Data *volume, double zmin, double zmax,
+                             int margin, long *first, long *last);
+static long load_slab(File_Info *file, long start[], long count[],
+                      Volume_Data *volume, long first_out, long nslice,
+                      long slab_first[], long slab_last[]);
+static int check_slab(Volume_Data *volume, long ncols, 
+                      Coord_Vector row_coords[], 
+                      long *need_first, long *need_last);
+static void get_input_separations(File_Info *file, VIO_Real separations[]);
+static int get_slice(long slice_num, Volume_Data *volume, Slice_Data *slice,
+                     VIO_General_transform *total_transf,
+                     VIO_Real separations[],
+                     double *minimum, double *maximum,
+                     long *need_first, long *need_last);
+static void transform_row(VIO_General_transform *total_transf,
+                          VIO_Real separations[],
+                          Coord_Vector row_start, Coord_Vector column,
+                          long ncols, Coord_Vector *row_coords);
 static void renormalize_slices(Program_Flags *program_flags, VVolume *out_vol,
                                double slice_min[], double slice_max[]);
-static int do_Ncubic_interpolation(Volume_Data *volume, 
-                                   long index[], int cur_dim, 
-                                   double frac[], double *result);
+static int get_voxel_type(Volume_Data *volume);
+static void init_sinc_table(void);
+static void get_sinc_weights(double frac, double weights[], double *sum);
+static double sinc_dot(const double values[], const double weights[], int n);
 
+/* Sampling of non-linear transforms along output rows (see transform_row) */
+int transform_step = 1;
+double transform_tolerance = 0.05;
+
+/* Spacing (in output voxels) of the points used to estimate the input 
+   slab needed by an output slice under a non-linear transformation, and 
+   the extra margin (in input slices) added to allow for curvature 
+   between them */
+#define SLAB_LATTICE_STEP     8
+#define SLAB_NONLINEAR_MARGIN 4
 
 
 /* ----------------------------- MNI Header -----------------------------------
@@ -164,16 +248,43 @@ void resample_volumes(Program_Flags *program_flags,
    long in_start[MAX_VAR_DIMS], in_count[MAX_VAR_DIMS], in_end[MAX_VAR_DIMS];
    long out_start[MAX_VAR_DIMS], out_count[MAX_VAR_DIMS];
    long mm_start[MAX_VAR_DIMS];   /* VIO_Vector for min/max variables */
-   long nslice, islice, slice_count;
-   int idim, index, slice_index;
+   long nslice, islice, slice_count, band_end;
+   long *slab_first = NULL, *slab_last = NULL, need_first, need_last;
+   int idim, index, slice_index, streaming, slab_ok;
    double maximum, minimum, valid_range[2];
    double *slice_max, *slice_min;
    File_Info *ifp,*ofp;
+   Slice_Data *slice;
+   VIO_General_transform temp_transf, total_transf;
+   VIO_Real separations[WORLD_NDIMS];
+#ifdef HAVE_PTHREAD
+   Slice_Pool pool_struct;
+   Slice_Pool *pool = NULL;
+   int pool_running = FALSE;
+#endif
 
    /* Set pointers to file information */
    ifp = in_vol->file;
    ofp = out_vol->file;
 
+   /* Concatenate transforms to get output voxel to input voxel */
+   concat_general_transforms(out_vol->voxel_to_world, 
+                             transformation, &temp_transf);
+   concat_general_transforms(&temp_transf, in_vol->world_to_voxel,
+                             &total_transf);
+   delete_general_transform(&temp_transf);
+
+   /* Get the input step sizes for inverting non-linear transforms */
+   get_input_separations(ifp, separations);
+
+#ifdef HAVE_PTHREAD
+   /* Set up worker threads if we need them */
+   if (program_flags->nthreads > 1) {
+      pool = &pool_struct;
+      create_slice_pool(pool, program_flags->nthreads, out_vol->slice);
+   }
+#endif
+
    /* Allocate slice min/max arrays if needed */
    if (ofp->do_slice_renormalization) {
       slice_min = malloc(ofp->images_per_file * ofp->slices_per_image *
@@ -208,6 +319,18 @@ void resample_volumes(Program_Flags *program_flags,
       }
    }
 
+   /* If the input volume does not fit in its buffer, then work out which
+      input slices each output slice needs so that we can read the input
+      in slabs */
+   streaming = (in_vol->volume->max_slices < 
+                in_vol->volume->size[SLC_AXIS]);
+   if (streaming) {
+      slab_first = malloc(nslice * sizeof(long));
+      slab_last = malloc(nslice * sizeof(long));
+      get_slab_ranges(in_vol->volume, out_vol->slice, nslice, 
+                      &total_transf, separations, slab_first, slab_last);
+   }
+
    /* Initialize global max and min */
    valid_range[0] =  DBL_MAX;
    valid_range[1] = -DBL_MAX;
@@ -229,24 +352,90 @@ void resample_volumes(Program_Flags *program_flags,
       for (idim=0; idim < ifp->ndims; idim++)
          out_start[idim] = in_start[idim];
 
-      /* Read in the volume */
-      load_volume(ifp, in_start, in_count, in_vol->volume);
+      /* Read in the volume, or just its scales if it is read in slabs */
+      if (streaming) {
+         load_slice_scales(ifp, in_start, in_count, in_vol->volume);
+         in_vol->volume->nslices = 0;
+      }
+      else {
+         load_volume(ifp, in_start, in_count, in_vol->volume);
+      }
 
       /* Loop over slices */
+      band_end = 0;
       for (islice=0; islice < nslice; islice++) {
 
-         /* Print log message */
-         if (program_flags->verbose) {
-            (void) fprintf(stderr, ".");
-            (void) fflush(stderr);
+         /* Get the input data for the next band of output slices - the
+            whole volume is one band unless we are reading slabs */
+         if (islice >= band_end) {
+#ifdef HAVE_PTHREAD
+            /* Wait for the workers before the slab is overwritten */
+            if (pool_running) {
+               finish_slice_pool(pool);
+               pool_running = FALSE;
+            }
+#endif
+            if (streaming) {
+               band_end = load_slab(ifp, in_start, in_count, in_vol->volume,
+                                    islice, nslice, slab_first, slab_last);
+            }
+            else {
+               band_end = nslice;
+            }
+#ifdef HAVE_PTHREAD
+            /* Let the workers start on this band */
+            if (pool != NULL) {
+               start_slice_pool(pool, islice, band_end, in_vol->volume, 
+                                &total_transf, separations);
+               pool_running = TRUE;
+            }
+#endif
          }
 
          /* Set slice number in out_start */
          out_start[slice_index] = islice;
 
-         /* Get the slice */
-         get_slice(islice, in_vol, out_vol, transformation, 
-                   &minimum, &maximum);
+         /* Get the slice, either from the workers (in slice order) or
+            by computing it ourselves */
+#ifdef HAVE_PTHREAD
+         if (pool != NULL) {
+            slice = wait_for_slice(pool, islice, &minimum, &maximum,
+                                   &slab_ok, &need_first, &need_last);
+         }
+         else
+#endif
+         {
+            slice = out_vol->slice;
+            slab_ok = get_slice(islice, in_vol->volume, slice, 
+                                &total_transf, separations, 
+                                &minimum, &maximum, 
+                                &need_first, &need_last);
+         }
+
+         /* If the estimate of the input slices needed by a non-linear
+            transformation was too small, then widen it to what the slice
+            really needs and start a new band (and slab) at this slice */
+         if (!slab_ok) {
+            if (need_first < slab_first[islice]) 
+               slab_first[islice] = need_first;
+            if (need_last > slab_last[islice]) 
+               slab_last[islice] = need_last;
+#ifdef HAVE_PTHREAD
+            if (pool_running) {
+               stop_slice_pool(pool);
+               pool_running = FALSE;
+            }
+#endif
+            band_end = islice;
+            islice--;
+            continue;
+         }
+
+         /* Print log message */
+         if (program_flags->verbose) {
+            (void) fprintf(stderr, ".");
+            (void) fflush(stderr);
+         }
 
          /* Check whether we are keep the input range */
          if (ofp->keep_real_range) {
@@ -270,7 +459,14 @@ void resample_volumes(Program_Flags *program_flags,
                                              ofp->minid, mm_start),
                           NC_DOUBLE, NULL, &minimum);
          (void) miicv_put(ofp->icvid, out_start, out_count,
-                          out_vol->slice->data);
+                          slice->data);
+
+#ifdef HAVE_PTHREAD
+         /* Give the buffer back to the workers */
+         if (pool != NULL) {
+            release_slice(pool, islice);
+         }
+#endif
 
          /* Save the max, min if needed */
          if (ofp->do_slice_renormalization) {
@@ -283,6 +479,14 @@ void resample_volumes(Program_Flags *program_flags,
 
       }    /* End loop over slices */
 
+#ifdef HAVE_PTHREAD
+      /* Wait for the workers before the volume is overwritten */
+      if (pool_running) {
+         finish_slice_pool(pool);
+         pool_running = FALSE;
+      }
+#endif
+
       /* Increment in_start counter */
       idim = ofp->ndims-1;
       in_start[idim] += in_count[idim];
@@ -300,6 +504,20 @@ void resample_volumes(Program_Flags *program_flags,
       (void) fflush(stderr);
    }
 
+#ifdef HAVE_PTHREAD
+   if (pool != NULL) {
+      delete_slice_pool(pool);
+   }
+#endif
+
+   if (streaming) {
+      free(slab_first);
+      free(slab_last);
+   }
+
+   /* Delete the transformation */
+   delete_general_transform(&total_transf);
+
    /* If output volume is floating point, write out global max and min */
    if ((ofp->datatype == NC_FLOAT) || (ofp->datatype == NC_DOUBLE)) {
       (void) miset_valid_range(ofp->mincid, ofp->imgid, valid_range);
@@ -327,15 +545,11 @@ void resample_volumes(Program_Flags *program_flags,
 @GLOBALS    : 
 @CALLS      : 
 @CREATED    : February 10, 1993 (Peter Neelin)
-@MODIFIED   : 
+@MODIFIED   : Scales and offsets moved to load_slice_scales.
 ---------------------------------------------------------------------------- */
-void load_volume(File_Info *file, long start[], long count[], 
-                 Volume_Data *volume)
+static void load_volume(File_Info *file, long start[], long count[], 
+                        Volume_Data *volume)
 {
-   long nread, islice, mm_start[MAX_VAR_DIMS], mm_count[MAX_VAR_DIMS];
-   int varid, ivar, idim, ndims;
-   double *values, maximum, minimum, denom;
-
    /* Load the file */
    if (file->using_icv) {
       (void) miicv_get(file->icvid, start, count, volume->data);
@@ -344,6 +558,36 @@ void load_volume(File_Info *file, long start[], long count[],
       (void) ncvarget(file->mincid, file->imgid, 
                       start, count, volume->data);
    }
+   volume->first_slice = 0;
+   volume->nslices = volume->size[SLC_AXIS];
+
+   /* Get the scales and offsets */
+   load_slice_scales(file, start, count, volume);
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : load_slice_scales
+@INPUT      : file - description of input file
+              start - index of start of volume in minc file
+              count - vector size of volume in minc file
+              volume - description of volume data
+@OUTPUT     : volume - contains new scales, offsets and real range
+@RETURNS    : (none)
+@DESCRIPTION: Reads the slice scales and offsets of a volume from a minc 
+              file. This does not need the volume data, so it can be 
+              done for the whole volume before it is read in slabs.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : February 10, 1993 (Peter Neelin)
+@MODIFIED   : Split out of load_volume.
+---------------------------------------------------------------------------- */
+static void load_slice_scales(File_Info *file, long start[], long count[],
+                              Volume_Data *volume)
+{
+   long nread, islice, mm_start[MAX_VAR_DIMS], mm_count[MAX_VAR_DIMS];
+   int varid, ivar, idim, ndims;
+   double *values, maximum, minimum, denom;
 
    /* Read the max and min from the file into the scale and offset variables 
       (maxima into scale and minima into offset) if datatype is not
@@ -447,40 +691,370 @@ void load_volume(File_Info *file, long start[], long count[],
    }        /* End of loop through slices */
 }
 
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : read_slices
+@INPUT      : file - description of input file
+              start - index of start of volume in minc file
+              count - vector size of volume in minc file
+              volume - description of volume data
+              first - first input slice to read
+              nread - number of slices to read
+              dest - position in the volume buffer of the first slice read
+@OUTPUT     : volume - contains the slices read
+@RETURNS    : (none)
+@DESCRIPTION: Reads a run of consecutive slices of a volume into the 
+              volume buffer.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void read_slices(File_Info *file, long start[], long count[],
+                        Volume_Data *volume, long first, long nread, 
+                        long dest)
+{
+   long slab_start[MAX_VAR_DIMS], slab_count[MAX_VAR_DIMS];
+   int idim;
+   char *data;
+
+   if (nread <= 0) return;
+
+   for (idim=0; idim < file->ndims; idim++) {
+      slab_start[idim] = start[idim];
+      slab_count[idim] = count[idim];
+   }
+   slab_start[file->indices[SLC_AXIS]] = first;
+   slab_count[file->indices[SLC_AXIS]] = nread;
+
+   data = (char *) volume->data + dest * volume->size[ROW_AXIS] * 
+      volume->size[COL_AXIS] * nctypelen(volume->datatype);
+   if (file->using_icv) {
+      (void) miicv_get(file->icvid, slab_start, slab_count, data);
+   }
+   else {
+      (void) ncvarget(file->mincid, file->imgid, 
+                      slab_start, slab_count, data);
+   }
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : get_slice_extent
+@INPUT      : volume - input volume data
+              zmin - smallest input slice coordinate of a set of points
+              zmax - largest input slice coordinate of a set of points
+              margin - number of extra slices to add on each side
+@OUTPUT     : first - first input slice needed to interpolate the points
+              last - last input slice needed to interpolate the points
+@RETURNS    : (none)
+@DESCRIPTION: Works out the range of input slices that the interpolant 
+              may look at for points within a range of slice coordinates,
+              clamped to the volume.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void get_slice_extent(Volume_Data *volume, double zmin, double zmax,
+                             int margin, long *first, long *last)
+{
+   long slcmax;
+
+   slcmax = volume->size[SLC_AXIS] - 1;
+   *first = (long) floor(zmin) - volume->kernel_reach - margin;
+   *last = (long) floor(zmax) + volume->kernel_reach + 1 + margin;
+   if (*first < 0) *first = 0;
+   if (*first > slcmax) *first = slcmax;
+   if (*last < 0) *last = 0;
+   if (*last > slcmax) *last = slcmax;
+   if (*last < *first) *last = *first;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : get_slab_ranges
+@INPUT      : volume - input volume data
+              slice - output slice buffer (for its size)
+              nslice - number of output slices
+              total_transf - output voxel to input voxel transformation
+              separations - input volume step sizes
+@OUTPUT     : slab_first - first input slice needed by each output slice
+              slab_last - last input slice needed by each output slice
+@RETURNS    : (none)
+@DESCRIPTION: Works out the slab of input slices needed to compute each 
+              output slice. For linear transformations the slab is found
+              exactly from the corners of the output slice. For non-linear
+              transformations it is estimated from a lattice of points
+              every SLAB_LATTICE_STEP voxels, with an extra margin of
+              SLAB_NONLINEAR_MARGIN slices. If the estimate for a slice
+              turns out to be too small, get_slice says so and 
+              resample_volumes widens it and reloads the slab.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void get_slab_ranges(Volume_Data *volume, Slice_Data *slice, 
+                            long nslice, VIO_General_transform *total_transf,
+                            VIO_Real separations[], 
+                            long slab_first[], long slab_last[])
+{
+   long islice, irow, icol, nrows, ncols, rowstep, colstep;
+   int all_linear, margin;
+   double zmin, zmax;
+   Coord_Vector coord;
+
+   all_linear = (get_transform_type(total_transf) == LINEAR);
+   nrows = slice->size[SLICE_ROW];
+   ncols = slice->size[SLICE_COL];
+
+   /* A linear transformation reaches its extremes at the corners */
+   if (all_linear) {
+      rowstep = (nrows > 1) ? nrows - 1 : 1;
+      colstep = (ncols > 1) ? ncols - 1 : 1;
+      margin = 0;
+   }
+   else {
+      rowstep = colstep = SLAB_LATTICE_STEP;
+      margin = SLAB_NONLINEAR_MARGIN;
+   }
+
+   for (islice=0; islice < nslice; islice++) {
+      zmin =  DBL_MAX;
+      zmax = -DBL_MAX;
+      for (irow=0; irow < nrows + rowstep - 1; irow += rowstep) {
+         for (icol=0; icol < ncols + colstep - 1; icol += colstep) {
+            coord[SLICE] = islice;
+            coord[ROW] = (irow < nrows) ? irow : nrows - 1;
+            coord[COLUMN] = (icol < ncols) ? icol : ncols - 1;
+            if (all_linear) {
+               DO_TRANSFORM(coord, total_transf, coord);
+            }
+            else {
+               DO_TRANSFORM_WITH_INPUT_STEPS(coord, total_transf, coord,
+                                             separations);
+            }
+            if (coord[SLICE] < zmin) zmin = coord[SLICE];
+            if (coord[SLICE] > zmax) zmax = coord[SLICE];
+         }
+      }
+      get_slice_extent(volume, zmin, zmax, margin, 
+                       &slab_first[islice], &slab_last[islice]);
+   }
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : load_slab
+@INPUT      : file - description of input file
+              start - index of start of volume in minc file
+              count - vector size of volume in minc file
+              volume - description of volume data
+              first_out - first output slice of the band
+              nslice - number of output slices
+              slab_first - first input slice needed by each output slice
+              slab_last - last input slice needed by each output slice
+@OUTPUT     : volume - contains the slab of input slices for the band
+@RETURNS    : One past the last output slice of the band
+@DESCRIPTION: Finds the longest band of output slices, starting at 
+              first_out, whose input slices fit in the volume buffer and
+              loads them. Slices already in the buffer are kept and only
+              the missing ones are read. If a single output slice needs
+              more slices than the buffer holds, the buffer is enlarged.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static long load_slab(File_Info *file, long start[], long count[],
+                      Volume_Data *volume, long first_out, long nslice,
+                      long slab_first[], long slab_last[])
+{
+   long first, last, new_first, new_last, keep_first, keep_last;
+   long old_first, old_last, band_end;
+   size_t slice_bytes;
+
+   slice_bytes = (size_t) volume->size[ROW_AXIS] * volume->size[COL_AXIS] *
+      nctypelen(volume->datatype);
+
+   /* Make sure that the buffer can hold the slab of the first slice */
+   first = slab_first[first_out];
+   last = slab_last[first_out];
+   if (last - first + 1 > volume->max_slices) {
+      (void) fprintf(stderr, 
+         "\nWarning: increasing input buffer to %ld slices.\n",
+                     last - first + 1);
+      volume->max_slices = last - first + 1;
+      volume->data = realloc(volume->data, volume->max_slices * slice_bytes);
+      if (volume->data == NULL) {
+         (void) fprintf(stderr, "Unable to allocate input buffer.\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   /* Add output slices to the band while their slabs still fit */
+   for (band_end=first_out+1; band_end < nslice; band_end++) {
+      new_first = MIN(first, slab_first[band_end]);
+      new_last = MAX(last, slab_last[band_end]);
+      if (new_last - new_first + 1 > volume->max_slices) break;
+      first = new_first;
+      last = new_last;
+   }
+
+   /* Keep the slices that are already loaded and read the rest */
+   old_first = volume->first_slice;
+   old_last = volume->first_slice + volume->nslices - 1;
+   keep_first = MAX(first, old_first);
+   keep_last = MIN(last, old_last);
+   if (keep_first <= keep_last) {
+      (void) memmove((char *) volume->data + (keep_first-first)*slice_bytes,
+                     (char *) volume->data + 
+                     (keep_first-old_first)*slice_bytes,
+                     (keep_last - keep_first + 1) * slice_bytes);
+      read_slices(file, start, count, volume, 
+                  first, keep_first - first, 0);
+      read_slices(file, start, count, volume, 
+                  keep_last + 1, last - keep_last, keep_last + 1 - first);
+   }
+   else {
+      read_slices(file, start, count, volume, first, last - first + 1, 0);
+   }
+   volume->first_slice = first;
+   volume->nslices = last - first + 1;
+
+   return band_end;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : check_slab
+@INPUT      : volume - input volume data
+              ncols - number of points
+              row_coords - input voxel coordinates of points
+              need_first - first input slice needed so far
+              need_last - last input slice needed so far
+@OUTPUT     : need_first - widened to the first slice needed by the row
+              need_last - widened to the last slice needed by the row
+@RETURNS    : TRUE if the row can be interpolated from the loaded slab
+@DESCRIPTION: Checks that the input slices needed to interpolate a row
+              of points are in the loaded slab, and keeps track of the
+              slices needed so that a slab can be widened if they are not.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static int check_slab(Volume_Data *volume, long ncols, 
+                      Coord_Vector row_coords[], 
+                      long *need_first, long *need_last)
+{
+   long icol, first, last;
+   double zmin, zmax;
+
+   /* Points more than a voxel outside the volume are not interpolated */
+   zmin =  DBL_MAX;
+   zmax = -DBL_MAX;
+   for (icol=0; icol < ncols; icol++) {
+      if ((row_coords[icol][SLICE] < -1.0) ||
+          (row_coords[icol][SLICE] > volume->size[SLC_AXIS])) continue;
+      if (row_coords[icol][SLICE] < zmin) zmin = row_coords[icol][SLICE];
+      if (row_coords[icol][SLICE] > zmax) zmax = row_coords[icol][SLICE];
+   }
+   if (zmin > zmax) return TRUE;
+
+   get_slice_extent(volume, zmin, zmax, 0, &first, &last);
+   if (first < *need_first) *need_first = first;
+   if (last > *need_last) *need_last = last;
+
+   return ((first >= volume->first_slice) &&
+           (last < volume->first_slice + volume->nslices));
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : get_input_separations
+@INPUT      : file - description of input file
+@OUTPUT     : separations - step sizes of the input volume, subscripted
+                 by world axis
+@RETURNS    : (none)
+@DESCRIPTION: Gets the step sizes (separations) of the input volume in order
+              to get an appropriate error margin (ftol) for the function
+              grid_inverse_transform_point.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : February 8, 1993 (Peter Neelin)
+@MODIFIED   : Moved out of get_slice so that it is only done once.
+---------------------------------------------------------------------------- */
+static void get_input_separations(File_Info *file, VIO_Real separations[])
+{
+   char dimname[MAX_NC_NAME];
+   int  dim[MAX_VAR_DIMS], dimid;
+   int  idim_in, world_axis;
+
+   for (world_axis=0; world_axis < WORLD_NDIMS; world_axis++)
+      separations[world_axis] = 1.0;
+
+   (void) ncvarinq(file->mincid, file->imgid, NULL, NULL, NULL, dim, NULL);
+
+   for (idim_in=0; idim_in < file->ndims; idim_in++) {
+
+      /* Only spatial dimensions are of interest */
+      world_axis = file->world_axes[idim_in];
+      if (world_axis == NO_AXIS) continue;
+
+      /* Check for existence of variable */
+      (void) ncdiminq(file->mincid, dim[idim_in], dimname, NULL);
+      dimid = ncvarid(file->mincid, dimname);
+      if (dimid == MI_ERROR) continue;
+
+      /* Get attributes from variable */
+      (void) miattget1(file->mincid, dimid, MIstep, 
+                       NC_DOUBLE, &separations[world_axis]);
+
+      if (separations[world_axis] == 0.0)
+          separations[world_axis] = 1.0;
+   }
+}
+
 /* ----------------------------- MNI Header -----------------------------------
 @NAME       : get_slice
-@INPUT      : in_vol - description of input volume
-              out_vol - description of output volume
-              transformation - description of world transformation
-@OUTPUT     : out_vol - slice field contains new slice
+@INPUT      : slice_num - number of output slice to compute
+              volume - input volume data
+              slice - output slice buffer
+              total_transf - transformation from output voxel to input
+                 voxel coordinates
+              separations - input volume step sizes
+@OUTPUT     : slice - contains new slice
               minimum - slice minimum (excluding data from outside volume)
               maximum - slice maximum (excluding data from outside volume)
-@RETURNS    : (none)
-@DESCRIPTION: Resamples current volume of in_vol into slice in out_vol 
-              using given world transformation.
+              need_first - first input slice needed (when reading slabs)
+              need_last - last input slice needed (when reading slabs)
+@RETURNS    : TRUE if the slice was computed, FALSE if the loaded slab 
+              does not hold all of the input slices that it needs. In that
+              case need_first and need_last give the slices to load.
+@DESCRIPTION: Resamples current volume of in_vol into an output slice 
+              using given voxel to voxel transformation. Only reads
+              shared data, so it can be called from several threads
+              at once with different slice buffers.
 @METHOD     : 
 @GLOBALS    : 
 @CALLS      : 
 @CREATED    : February 8, 1993 (Peter Neelin)
-@MODIFIED   : 
+@MODIFIED   : October 16, 2026 - report missing slab slices to the caller
 ---------------------------------------------------------------------------- */
-void get_slice(long slice_num, VVolume *in_vol, VVolume *out_vol, 
-               VIO_General_transform *transformation, 
-               double *minimum, double *maximum)
+static int get_slice(long slice_num, Volume_Data *volume, Slice_Data *slice,
+                     VIO_General_transform *total_transf,
+                     VIO_Real separations[],
+                     double *minimum, double *maximum,
+                     long *need_first, long *need_last)
 {
-   Slice_Data *slice;
-   Volume_Data *volume;
    double *dptr;
    long irow, icol;
-   int all_linear;
+   int all_linear, slab_ok;
    int idim;
+   Coord_Vector *row_coords;
    
-   VIO_Real separations[WORLD_NDIMS];
-   int  idim_in;
-   char dimname[MAX_NC_NAME];
-   int  dim[MAX_VAR_DIMS], dimid;
-   int  imgid;
-   int  ndims;
    /* Coordinate vectors for stepping through slice */
    Coord_Vector zero = {0, 0, 0};
    Coord_Vector column = {0, 0, 1};
@@ -488,30 +1062,16 @@ void get_slice(long slice_num, VVolume *in_vol, VVolume *out_vol,
    Coord_Vector start = {0, 0, 0};    /* start[SLICE] set later to slice_num */
    Coord_Vector coord, transf_coord;
 
-   /* Transformation stuff */
-   VIO_General_transform total_transf, temp_transf;
-
-   /* Get slice and volume pointers */
-   volume = in_vol->volume;
-   slice = out_vol->slice;
-
-   /* Concatenate transforms */
-   concat_general_transforms(out_vol->voxel_to_world, 
-                             transformation, &temp_transf);
-   concat_general_transforms(&temp_transf, in_vol->world_to_voxel,
-                             &total_transf);
-   delete_general_transform(&temp_transf);
-
    /* Check for complete linear transformation */
-   all_linear = (get_transform_type(&total_transf) == LINEAR);
+   all_linear = (get_transform_type(total_transf) == LINEAR);
 
    /* VIO_Transform vectors for linear transformation */
    start[SLICE] = slice_num;
    if (all_linear) {
-      DO_TRANSFORM(zero, &total_transf, zero);
-      DO_TRANSFORM(column, &total_transf, column);
-      DO_TRANSFORM(row, &total_transf, row);
-      DO_TRANSFORM(start, &total_transf, start);
+      DO_TRANSFORM(zero, total_transf, zero);
+      DO_TRANSFORM(column, total_transf, column);
+      DO_TRANSFORM(row, total_transf, row);
+      DO_TRANSFORM(start, total_transf, start);
    }
 
    /* Make sure that row and column are vectors and not points */
@@ -522,29 +1082,11 @@ void get_slice(long slice_num, VVolume *in_vol, VVolume *out_vol,
    *maximum = -DBL_MAX;
    *minimum =  DBL_MAX;
    
-   imgid = ncvarid(in_vol->file->mincid, MIimage);
-   ncvarinq(in_vol->file->mincid, imgid, NULL, NULL, &ndims, dim, NULL);
-
-   /* Get the steps sizes (separations) of the input volume in order
-      to get an appropriate error margin (ftol) for the function
-      grid_inverse_transform_point */
-   for (idim_in=0; idim_in < in_vol->file->ndims; idim_in++) {
-           
-      /* Get size of dimension */
-      (void) ncdiminq(in_vol->file->mincid, dim[idim_in], dimname, 
-                      &in_vol->file->nelements[idim]);
-
-      /* Check for existence of variable */
-      dimid = ncvarid(in_vol->file->mincid, dimname);
-      if (dimid == MI_ERROR) continue;
-
-      /* Get attributes from variget_file_infoable */
-      (void) miattget1(in_vol->file->mincid, dimid, MIstep, 
-                       NC_DOUBLE, &separations[in_vol->file->world_axes[idim_in]]);
-
-      if (separations[in_vol->file->world_axes[idim_in]] == 0.0)
-          separations[in_vol->file->world_axes[idim_in]] = 1.0;
-   }
+   /* Get space for the input voxel coordinates of a row */
+   row_coords = malloc(sizeof(Coord_Vector) * slice->size[SLICE_COL]);
+   slab_ok = TRUE;
+   *need_first = volume->size[SLC_AXIS];
+   *need_last = -1;
 
    /* Loop over rows of slice */
 
@@ -554,32 +1096,46 @@ void get_slice(long slice_num, VVolume *in_vol, VVolume *out_vol,
       VECTOR_SCALAR_MULT(coord, row, irow);
       VECTOR_ADD(coord, coord, start);
 
-      /* Loop over columns */
+      /* Transform the whole row at once if we can */
+      if (!all_linear && (transform_step > 1)) {
+         transform_row(total_transf, separations, coord, column,
+                       slice->size[SLICE_COL], row_coords);
+      }
 
-      dptr = slice->data + irow*slice->size[SLICE_COL];
-      for (icol=0; icol < slice->size[SLICE_COL]; icol++) {
-
-         /* If transformation is not completely linear, then transform 
-            voxel to world, world to world and world to voxel, as needed */
-         for (idim=0; idim<WORLD_NDIMS; idim++) 
-            transf_coord[idim]=coord[idim];
-         if (!all_linear) {
-            DO_TRANSFORM_WITH_INPUT_STEPS(transf_coord, &total_transf, transf_coord, separations);
-         }
+      /* Otherwise loop over columns */
+      else {
+         for (icol=0; icol < slice->size[SLICE_COL]; icol++) {
+
+            /* If transformation is not completely linear, then transform 
+               voxel to world, world to world and world to voxel, as 
+               needed */
+            for (idim=0; idim<WORLD_NDIMS; idim++) 
+               transf_coord[idim]=coord[idim];
+            if (!all_linear) {
+               DO_TRANSFORM_WITH_INPUT_STEPS(transf_coord, total_transf, transf_coord, separations);
+            }
+            VECTOR_COPY(row_coords[icol], transf_coord);
 
-         /* Do interpolation */
-         if (INTERPOLATE(volume, transf_coord, dptr) || volume->use_fill) {
-            if (*dptr > *maximum) *maximum = *dptr;
-            if (*dptr < *minimum) *minimum = *dptr;
-         }
+            /* Increment coordinate */
+            VECTOR_ADD(coord, coord, column);
+
+         }  /* Loop over columns */
+      }
 
-         /* Increment coordinate */
-         VECTOR_ADD(coord, coord, column);
+      /* Make sure that a slab holds what we need. If it does not, keep
+         going only to find all the slices that the slice needs */
+      if (volume->nslices < volume->size[SLC_AXIS]) {
+         if (!check_slab(volume, slice->size[SLICE_COL], row_coords,
+                         need_first, need_last))
+            slab_ok = FALSE;
+      }
+      if (!slab_ok) continue;
 
-         /* Increment slice pointer */
-         dptr++;
+      /* Do interpolation */
+      dptr = slice->data + irow*slice->size[SLICE_COL];
+      (*volume->row_interpolant)(volume, slice->size[SLICE_COL], row_coords,
+                                 dptr, minimum, maximum);
 
-      }     /* Loop over columns */
    }        /* Loop over rows */
 
    if ((*maximum == -DBL_MAX) && (*minimum ==  DBL_MAX)) {
@@ -595,322 +1151,394 @@ void get_slice(long slice_num, VVolume *in_vol, VVolume *out_vol,
          *maximum = 2.0 * (*minimum);
    }
 
-   /* Delete the transformation */
-   delete_general_transform(&total_transf);
+   free(row_coords);
 
+   return slab_ok;
 }
 
 /* ----------------------------- MNI Header -----------------------------------
-@NAME       : trilinear_interpolant
-@INPUT      : volume - pointer to volume data
-              coord - point at which volume should be interpolated in voxel 
-                 units (with 0 being first point of the volume).
-@OUTPUT     : result - interpolated value.
-@RETURNS    : TRUE if coord is within the volume, FALSE otherwise.
-@DESCRIPTION: Routine to interpolate a volume at a point with tri-linear
-              interpolation.
+@NAME       : transform_row
+@INPUT      : total_transf - output voxel to input voxel transformation
+              separations - input volume step sizes
+              row_start - output voxel coordinate of first voxel in row
+              column - output voxel step between columns
+              ncols - number of columns in row
+@OUTPUT     : row_coords - input voxel coordinate of each column
+@RETURNS    : (none)
+@DESCRIPTION: Transforms a row of output voxels through a non-linear 
+              transformation. The transformation is evaluated exactly
+              every transform_step voxels and at the end of the row. 
+              Within each interval, the midpoint is also evaluated exactly
+              and compared with its linearly interpolated position: if 
+              they agree to within transform_tolerance, the remaining 
+              voxels of the interval are interpolated, otherwise they are
+              all transformed exactly.
 @METHOD     : 
-@GLOBALS    : 
+@GLOBALS    : transform_step, transform_tolerance
 @CALLS      : 
-@CREATED    : February 10, 1993 (Peter Neelin)
+@CREATED    : October 16, 2026
 @MODIFIED   : 
 ---------------------------------------------------------------------------- */
-int trilinear_interpolant(Volume_Data *volume, 
-                          Coord_Vector coord, double *result)
+static void transform_row(VIO_General_transform *total_transf,
+                          VIO_Real separations[],
+                          Coord_Vector row_start, Coord_Vector column,
+                          long ncols, Coord_Vector *row_coords)
 {
-   long slcind, rowind, colind, slcmax, rowmax, colmax;
-   long slcnext, rownext, colnext;
-   static double f0, f1, f2, r0, r1, r2, r1r2, r1f2, f1r2, f1f2;
-   static double v000, v001, v010, v011, v100, v101, v110, v111;
-
-   /* Check that the coordinate is inside the volume */
-   slcmax = volume->size[SLC_AXIS] - 1;
-   rowmax = volume->size[ROW_AXIS] - 1;
-   colmax = volume->size[COL_AXIS] - 1;
-   if ((coord[SLICE]  < -VOXEL_COORD_EPS) || 
-       (coord[SLICE]  > slcmax+VOXEL_COORD_EPS) ||
-       (coord[ROW]    < -VOXEL_COORD_EPS) || 
-       (coord[ROW]    > rowmax+VOXEL_COORD_EPS) ||
-       (coord[COLUMN] < -VOXEL_COORD_EPS) || 
-       (coord[COLUMN] > colmax+VOXEL_COORD_EPS)) {
-      *result = volume->fillvalue;
-      return FALSE;
-   }
-
-   /* Get the whole part of the coordinate */ 
-   slcind = (long) coord[SLICE];
-   rowind = (long) coord[ROW];
-   colind = (long) coord[COLUMN];
-   if (slcind >= slcmax-1) slcind = slcmax-1;
-   if (rowind >= rowmax-1) rowind = rowmax-1;
-   if (colind >= colmax-1) colind = colmax-1;
-
-   /* Get the next voxel up */
-   slcnext = slcind+1;
-   rownext = rowind+1;
-   colnext = colind+1;
-
-   /* Check for case of dimension of length one */
-   if (slcmax == 0) {
-      slcind = 0;
-      slcnext = 0;
-   }
-   if (rowmax == 0) {
-      rowind = 0;
-      rownext = 0;
+   long first, last, mid, icol;
+   int idim, interpolate;
+   double frac;
+   Coord_Vector coord;
+
+   /* Evaluate the lattice points */
+   for (icol=0; icol < ncols; icol += transform_step) {
+      VECTOR_SCALAR_MULT(coord, column, icol);
+      VECTOR_ADD(coord, coord, row_start);
+      DO_TRANSFORM_WITH_INPUT_STEPS(row_coords[icol], total_transf, 
+                                    coord, separations);
    }
-   if (colmax == 0) {
-      colind = 0;
-      colnext = 0;
+   last = ncols - 1;
+   if ((last % transform_step) != 0) {
+      VECTOR_SCALAR_MULT(coord, column, last);
+      VECTOR_ADD(coord, coord, row_start);
+      DO_TRANSFORM_WITH_INPUT_STEPS(row_coords[last], total_transf, 
+                                    coord, separations);
    }
 
-   /* Get the relevant voxels */
-   VOLUME_VALUE(volume, slcind , rowind , colind , v000);
-   VOLUME_VALUE(volume, slcind , rowind , colnext, v001);
-   VOLUME_VALUE(volume, slcind , rownext, colind , v010);
-   VOLUME_VALUE(volume, slcind , rownext, colnext, v011);
-   VOLUME_VALUE(volume, slcnext, rowind , colind , v100);
-   VOLUME_VALUE(volume, slcnext, rowind , colnext, v101);
-   VOLUME_VALUE(volume, slcnext, rownext, colind , v110);
-   VOLUME_VALUE(volume, slcnext, rownext, colnext, v111);
-
-   /* Check that the values are not fill values */
-   if ((v000 < volume->vrange[0]) || (v000 > volume->vrange[1]) ||
-       (v001 < volume->vrange[0]) || (v001 > volume->vrange[1]) ||
-       (v010 < volume->vrange[0]) || (v010 > volume->vrange[1]) ||
-       (v011 < volume->vrange[0]) || (v011 > volume->vrange[1]) ||
-       (v100 < volume->vrange[0]) || (v100 > volume->vrange[1]) ||
-       (v101 < volume->vrange[0]) || (v101 > volume->vrange[1]) ||
-       (v110 < volume->vrange[0]) || (v110 > volume->vrange[1]) ||
-       (v111 < volume->vrange[0]) || (v111 > volume->vrange[1])) {
-      *result = volume->fillvalue;
-      return FALSE;
-   }
+   /* Fill in each interval */
+   for (first=0; first < ncols - 1; first = last) {
+      last = first + transform_step;
+      if (last > ncols - 1) last = ncols - 1;
+      if (last - first < 2) continue;
+
+      /* Check the midpoint of the interval */
+      mid = (first + last) / 2;
+      VECTOR_SCALAR_MULT(coord, column, mid);
+      VECTOR_ADD(coord, coord, row_start);
+      DO_TRANSFORM_WITH_INPUT_STEPS(row_coords[mid], total_transf, 
+                                    coord, separations);
+      frac = (double) (mid - first) / (double) (last - first);
+      interpolate = TRUE;
+      for (idim=0; idim < WORLD_NDIMS; idim++) {
+         if (fabs(row_coords[first][idim] + 
+                  frac * (row_coords[last][idim] - row_coords[first][idim]) -
+                  row_coords[mid][idim]) > transform_tolerance) {
+            interpolate = FALSE;
+         }
+      }
 
-   /* Get the fraction parts */
-   f0 = coord[SLICE]  - slcind;
-   f1 = coord[ROW]    - rowind;
-   f2 = coord[COLUMN] - colind;
-   r0 = 1.0 - f0;
-   r1 = 1.0 - f1;
-   r2 = 1.0 - f2;
-
-   /* Do the interpolation */
-   r1r2 = r1 * r2;
-   r1f2 = r1 * f2;
-   f1r2 = f1 * r2;
-   f1f2 = f1 * f2;
-   *result =
-      r0 * (volume->scale[slcind] *
-            (r1r2 * v000 +
-             r1f2 * v001 +
-             f1r2 * v010 +
-             f1f2 * v011) + volume->offset[slcind]);
-   *result +=
-      f0 * (volume->scale[slcind+1] *
-            (r1r2 * v100 +
-             r1f2 * v101 +
-             f1r2 * v110 +
-             f1f2 * v111) + volume->offset[slcind+1]);
-   
-   return TRUE;
+      /* Interpolate or transform the rest of the interval */
+      for (icol=first+1; icol < last; icol++) {
+         if (icol == mid) continue;
+         if (interpolate) {
+            frac = (double) (icol - first) / (double) (last - first);
+            for (idim=0; idim < WORLD_NDIMS; idim++) {
+               row_coords[icol][idim] = row_coords[first][idim] + 
+                  frac * (row_coords[last][idim] - row_coords[first][idim]);
+            }
+         }
+         else {
+            VECTOR_SCALAR_MULT(coord, column, icol);
+            VECTOR_ADD(coord, coord, row_start);
+            DO_TRANSFORM_WITH_INPUT_STEPS(row_coords[icol], total_transf, 
+                                          coord, separations);
+         }
+      }
+   }
 
 }
 
+#ifdef HAVE_PTHREAD
+
 /* ----------------------------- MNI Header -----------------------------------
-@NAME       : tricubic_interpolant
-@INPUT      : volume - pointer to volume data
-              coord - point at which volume should be interpolated in voxel 
-                 units (with 0 being first point of the volume).
-@OUTPUT     : result - interpolated value.
-@RETURNS    : TRUE if coord is within the volume, FALSE otherwise.
-@DESCRIPTION: Routine to interpolate a volume at a point with tri-cubic
-              interpolation.
+@NAME       : create_slice_pool
+@INPUT      : nthreads - number of worker threads
+              model_slice - output slice giving the slice size
+@OUTPUT     : pool - slice pool
+@RETURNS    : (none)
+@DESCRIPTION: Allocates the slice buffers and synchronization objects for
+              a pool of threads that compute output slices. Two buffers
+              are kept per thread so that workers can run ahead of the
+              writer.
 @METHOD     : 
 @GLOBALS    : 
 @CALLS      : 
-@CREATED    : February 12, 1993 (Peter Neelin)
+@CREATED    : October 16, 2026
 @MODIFIED   : 
 ---------------------------------------------------------------------------- */
-int tricubic_interpolant(Volume_Data *volume, 
-                         Coord_Vector coord, double *result)
+static void create_slice_pool(Slice_Pool *pool, int nthreads,
+                              Slice_Data *model_slice)
 {
-   long slcind, rowind, colind, slcmax, rowmax, colmax, index[VOL_NDIMS];
-   double frac[VOL_NDIMS];
+   int ibuf;
+   long slice_size;
+
+   pool->nthreads = nthreads;
+   pool->nbuffers = 2 * nthreads;
+   pool->threads = malloc(sizeof(pthread_t) * nthreads);
+   pool->buffers = malloc(sizeof(Slice_Data) * pool->nbuffers);
+   pool->buffer_slice = malloc(sizeof(long) * pool->nbuffers);
+   pool->buffer_ready = malloc(sizeof(int) * pool->nbuffers);
+   pool->buffer_min = malloc(sizeof(double) * pool->nbuffers);
+   pool->buffer_max = malloc(sizeof(double) * pool->nbuffers);
+   pool->buffer_ok = malloc(sizeof(int) * pool->nbuffers);
+   pool->buffer_need_first = malloc(sizeof(long) * pool->nbuffers);
+   pool->buffer_need_last = malloc(sizeof(long) * pool->nbuffers);
+
+   slice_size = model_slice->size[SLICE_ROW] * model_slice->size[SLICE_COL];
+   for (ibuf=0; ibuf < pool->nbuffers; ibuf++) {
+      pool->buffers[ibuf].size[SLICE_ROW] = model_slice->size[SLICE_ROW];
+      pool->buffers[ibuf].size[SLICE_COL] = model_slice->size[SLICE_COL];
+      pool->buffers[ibuf].data = malloc(sizeof(double) * slice_size);
+   }
 
-   /* Check that the coordinate is inside the volume */
-   slcmax = volume->size[SLC_AXIS] - 1;
-   rowmax = volume->size[ROW_AXIS] - 1;
-   colmax = volume->size[COL_AXIS] - 1;
-
-   /* Identify a slice or a volume. Slice must be in x-y. */
-   if( slcmax == 0 ) {
-     /* 2-d slice */
-     if( (coord[ROW] < 0) || (coord[ROW] > rowmax) ||
-         (coord[COLUMN] < 0) || (coord[COLUMN] > colmax) ) {
-       *result = volume->fillvalue;
-       return FALSE;
-     }
-   } else {
-     /* 3-d volume */
-     if( (coord[SLICE]  < 0) || (coord[SLICE]  > slcmax) ||
-         (coord[ROW]    < 0) || (coord[ROW]    > rowmax) ||
-         (coord[COLUMN] < 0) || (coord[COLUMN] > colmax) ) {
-       *result = volume->fillvalue;
-       return FALSE;
-     }
+   (void) pthread_mutex_init(&pool->mutex, NULL);
+   (void) pthread_cond_init(&pool->cond, NULL);
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : start_slice_pool
+@INPUT      : pool - slice pool
+              first_slice - first output slice to compute
+              end_slice - one past the last output slice to compute
+              volume - input volume data
+              total_transf - output voxel to input voxel transformation
+              separations - input volume step sizes
+@OUTPUT     : (none)
+@RETURNS    : (none)
+@DESCRIPTION: Starts the worker threads on a range of output slices of the
+              currently loaded volume (or slab).
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void start_slice_pool(Slice_Pool *pool, long first_slice,
+                             long end_slice, Volume_Data *volume,
+                             VIO_General_transform *total_transf,
+                             VIO_Real separations[])
+{
+   int ibuf, ithread;
+
+   pool->volume = volume;
+   pool->total_transf = total_transf;
+   pool->separations = separations;
+   pool->end_slice = end_slice;
+   pool->next_slice = first_slice;
+   pool->stopping = FALSE;
+   for (ibuf=0; ibuf < pool->nbuffers; ibuf++) {
+      pool->buffer_slice[ibuf] = -1;
+      pool->buffer_ready[ibuf] = FALSE;
    }
 
-   /* Get the whole and fractional part of the coordinate */
-   slcind = (long)coord[SLICE];
-   rowind = (long)coord[ROW];
-   colind = (long)coord[COLUMN];
-   frac[0] = coord[SLICE]  - slcind;
-   frac[1] = coord[ROW]    - rowind;
-   frac[2] = coord[COLUMN] - colind;
-   slcind--;
-   rowind--;
-   colind--;
-
-   /* Check for dimension of image. */
-
-   /* Check for edges in the 2-d plane - do linear interpolation at edges */
-   /* Note: Spline stencil is right-sided, so ok to start at 0. */
-   if( slcmax == 0 && rowmax > 0 && colmax > 0 ) {
-     if( (rowind > rowmax-3) || (rowind < 0) ||
-         (colind > colmax-3) || (colind < 0)) {
-       return trilinear_interpolant(volume, coord, result);
-     } else {
-       slcind = 0;  /* there is only slice 0 */
-       index[0]=slcind; index[1]=rowind; index[2]=colind;
-       if( do_Ncubic_interpolation(volume, index, 1, frac, result) ) {
-         /* scaling not done for a slice in do_Ncubic_interpolation, */
-         /* only done for a volume */
-         *result = (*result) * volume->scale[slcind] + volume->offset[slcind];
-         return TRUE;
-       } else {
-         return FALSE;
-       }
-     }
+   for (ithread=0; ithread < pool->nthreads; ithread++) {
+      if (pthread_create(&pool->threads[ithread], NULL, 
+                         slice_worker, pool) != 0) {
+         (void) fprintf(stderr, "Error creating worker thread.\n");
+         exit(EXIT_FAILURE);
+      }
    }
+}
 
-   /* Check for edges in the 3-d volume - do linear interpolation at edges */
-   /* Note: Spline stencil is right-sided, so ok to start at 0. */
-   if ((slcind > slcmax-3) || (slcind < 0) ||
-       (rowind > rowmax-3) || (rowind < 0) ||
-       (colind > colmax-3) || (colind < 0)) {
-      return trilinear_interpolant(volume, coord, result);
-   } else {
-     index[0]=slcind; index[1]=rowind; index[2]=colind;
-     /* Do the interpolation and return its value */
-     return do_Ncubic_interpolation(volume, index, 0, frac, result);
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : slice_worker
+@INPUT      : arg - pointer to slice pool
+@OUTPUT     : (none)
+@RETURNS    : NULL
+@DESCRIPTION: Worker thread routine. Claims the next uncomputed slice, 
+              waits for its buffer to be released by the writer and
+              computes the slice into it.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void *slice_worker(void *arg)
+{
+   Slice_Pool *pool = arg;
+   long islice, need_first, need_last;
+   int ibuf, slab_ok;
+   double minimum, maximum;
+
+   (void) pthread_mutex_lock(&pool->mutex);
+   while (pool->next_slice < pool->end_slice) {
+
+      /* Claim a slice and wait for its buffer */
+      islice = pool->next_slice++;
+      ibuf = islice % pool->nbuffers;
+      while ((pool->buffer_slice[ibuf] != -1) && !pool->stopping) {
+         (void) pthread_cond_wait(&pool->cond, &pool->mutex);
+      }
+      if (pool->stopping) break;
+      pool->buffer_slice[ibuf] = islice;
+      pool->buffer_ready[ibuf] = FALSE;
+      (void) pthread_mutex_unlock(&pool->mutex);
+
+      /* Compute it */
+      slab_ok = get_slice(islice, pool->volume, &pool->buffers[ibuf],
+                          pool->total_transf, pool->separations, 
+                          &minimum, &maximum, &need_first, &need_last);
+
+      /* Hand it over to the writer */
+      (void) pthread_mutex_lock(&pool->mutex);
+      pool->buffer_min[ibuf] = minimum;
+      pool->buffer_max[ibuf] = maximum;
+      pool->buffer_ok[ibuf] = slab_ok;
+      pool->buffer_need_first[ibuf] = need_first;
+      pool->buffer_need_last[ibuf] = need_last;
+      pool->buffer_ready[ibuf] = TRUE;
+      (void) pthread_cond_broadcast(&pool->cond);
    }
+   (void) pthread_mutex_unlock(&pool->mutex);
 
+   return NULL;
 }
 
 /* ----------------------------- MNI Header -----------------------------------
-@NAME       : do_Ncubic_interpolation
-@INPUT      : volume - pointer to volume data
-              index - indices to start point in volume
-                 (bottom of 4x4x4 cube for interpolation)
-              cur_dim - dimension to be interpolated (0 = volume, 1 = slice,
-                 2 = line)
-@OUTPUT     : result - interpolated value.
-@RETURNS    : TRUE if coord is within the volume, FALSE otherwise.
-@DESCRIPTION: Routine to interpolate a volume, slice or line (specified by
-              cur_dim).
+@NAME       : wait_for_slice
+@INPUT      : pool - slice pool
+              islice - slice wanted
+@OUTPUT     : minimum - slice minimum
+              maximum - slice maximum
+              slab_ok - FALSE if the slab did not hold the input slices
+                 needed (see get_slice)
+              need_first - first input slice needed
+              need_last - last input slice needed
+@RETURNS    : Pointer to computed slice. The buffer must be given back 
+              with release_slice unless slab_ok is FALSE, in which case
+              the pool must be stopped with stop_slice_pool.
+@DESCRIPTION: Waits until a worker has computed the given slice.
 @METHOD     : 
 @GLOBALS    : 
 @CALLS      : 
-@CREATED    : February 12, 1993 (Peter Neelin)
+@CREATED    : October 16, 2026
 @MODIFIED   : 
 ---------------------------------------------------------------------------- */
-int do_Ncubic_interpolation(Volume_Data *volume, 
-                            long index[], int cur_dim, 
-                            double frac[], double *result)
+static Slice_Data *wait_for_slice(Slice_Pool *pool, long islice,
+                                  double *minimum, double *maximum,
+                                  int *slab_ok, 
+                                  long *need_first, long *need_last)
 {
-   long base_index;
-   double v0, v1, v2, v3, u;
-   int found_fillvalue;
-
-   /* Save index that we will change */
-   base_index = index[cur_dim];
-
-   /* If last dimension, then just get the values */
-   found_fillvalue = FALSE;
-   if (cur_dim == VOL_NDIMS-1) {
-      VOLUME_VALUE(volume, index[0] ,index[1], index[2], v0);
-      index[cur_dim]++;
-      VOLUME_VALUE(volume, index[0] ,index[1], index[2], v1);
-      index[cur_dim]++;
-      VOLUME_VALUE(volume, index[0] ,index[1], index[2], v2);
-      index[cur_dim]++;
-      VOLUME_VALUE(volume, index[0] ,index[1], index[2], v3);
-
-      /* Check for fillvalues */
-      if ((v0 < volume->vrange[0]) || (v0 > volume->vrange[1]) ||
-          (v1 < volume->vrange[0]) || (v1 > volume->vrange[1]) ||
-          (v2 < volume->vrange[0]) || (v2 > volume->vrange[1]) ||
-          (v3 < volume->vrange[0]) || (v3 > volume->vrange[1])) {
-         found_fillvalue = TRUE;
-      }
+   int ibuf;
 
+   ibuf = islice % pool->nbuffers;
+   (void) pthread_mutex_lock(&pool->mutex);
+   while ((pool->buffer_slice[ibuf] != islice) || 
+          !pool->buffer_ready[ibuf]) {
+      (void) pthread_cond_wait(&pool->cond, &pool->mutex);
    }
+   *minimum = pool->buffer_min[ibuf];
+   *maximum = pool->buffer_max[ibuf];
+   *slab_ok = pool->buffer_ok[ibuf];
+   *need_first = pool->buffer_need_first[ibuf];
+   *need_last = pool->buffer_need_last[ibuf];
+   (void) pthread_mutex_unlock(&pool->mutex);
+
+   return &pool->buffers[ibuf];
+}
 
-   /* Otherwise, recurse */
-   else {
-      if (!do_Ncubic_interpolation(volume, index, cur_dim+1, frac, &v0)) {
-         found_fillvalue = TRUE;
-      }
-      index[cur_dim]++;
-      if (!do_Ncubic_interpolation(volume, index, cur_dim+1, frac, &v1)) {
-         found_fillvalue = TRUE;
-      }
-      index[cur_dim]++;
-      if (!do_Ncubic_interpolation(volume, index, cur_dim+1, frac, &v2)) {
-         found_fillvalue = TRUE;
-      }
-      index[cur_dim]++;
-      if (!do_Ncubic_interpolation(volume, index, cur_dim+1, frac, &v3)) {
-         found_fillvalue = TRUE;
-      }
-   }
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : release_slice
+@INPUT      : pool - slice pool
+              islice - slice that has been written
+@OUTPUT     : (none)
+@RETURNS    : (none)
+@DESCRIPTION: Marks the buffer of a written slice as free for the workers.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void release_slice(Slice_Pool *pool, long islice)
+{
+   (void) pthread_mutex_lock(&pool->mutex);
+   pool->buffer_slice[islice % pool->nbuffers] = -1;
+   pool->buffer_ready[islice % pool->nbuffers] = FALSE;
+   (void) pthread_cond_broadcast(&pool->cond);
+   (void) pthread_mutex_unlock(&pool->mutex);
+}
 
-   /* Restore index */
-   index[cur_dim] = base_index;
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : finish_slice_pool
+@INPUT      : pool - slice pool
+@OUTPUT     : (none)
+@RETURNS    : (none)
+@DESCRIPTION: Waits for all worker threads to finish the current volume.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void finish_slice_pool(Slice_Pool *pool)
+{
+   int ithread;
 
-   /* Check for fill value found */
-   if (found_fillvalue) {
-      *result = volume->fillvalue;
-      return FALSE;
+   for (ithread=0; ithread < pool->nthreads; ithread++) {
+      (void) pthread_join(pool->threads[ithread], NULL);
    }
+}
 
-   /* Scale values for slices */
-   if (cur_dim==0) {
-      v0 = v0 * volume->scale[base_index  ] + volume->offset[base_index  ];
-      v1 = v1 * volume->scale[base_index+1] + volume->offset[base_index+1];
-      v2 = v2 * volume->scale[base_index+2] + volume->offset[base_index+2];
-      v3 = v3 * volume->scale[base_index+3] + volume->offset[base_index+3];
-   }
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : stop_slice_pool
+@INPUT      : pool - slice pool
+@OUTPUT     : (none)
+@RETURNS    : (none)
+@DESCRIPTION: Abandons the rest of the current band: no more slices are
+              started, workers waiting for a buffer give up and the 
+              threads are joined. Slices already computed are dropped.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void stop_slice_pool(Slice_Pool *pool)
+{
+   (void) pthread_mutex_lock(&pool->mutex);
+   pool->end_slice = pool->next_slice;
+   pool->stopping = TRUE;
+   (void) pthread_cond_broadcast(&pool->cond);
+   (void) pthread_mutex_unlock(&pool->mutex);
+
+   finish_slice_pool(pool);
+}
 
-   /* Get fraction */
-   u = frac[cur_dim];
-
-   /* Do tricubic interpolation (code from Dave MacDonald).
-      Gives v1 and v2 at u = 0 and 1 and gives continuity of intensity
-      and first derivative. */
-   *result =
-     ( (v1) + (u) * (
-       0.5 * ((v2)-(v0)) + (u) * (
-       (v0) - 2.5 * (v1) + 2.0 * (v2) - 0.5 * (v3) + (u) * (
-       -0.5 * (v0) + 1.5 * (v1) - 1.5 * (v2) + 0.5 * (v3)  )
-                                 )
-                    )
-     );
-
-   return TRUE;
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : delete_slice_pool
+@INPUT      : pool - slice pool
+@OUTPUT     : (none)
+@RETURNS    : (none)
+@DESCRIPTION: Frees the buffers of a slice pool.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static void delete_slice_pool(Slice_Pool *pool)
+{
+   int ibuf;
+
+   for (ibuf=0; ibuf < pool->nbuffers; ibuf++) {
+      free(pool->buffers[ibuf].data);
+   }
+   free(pool->buffers);
+   free(pool->buffer_slice);
+   free(pool->buffer_ready);
+   free(pool->buffer_min);
+   free(pool->buffer_max);
+   free(pool->buffer_ok);
+   free(pool->buffer_need_first);
+   free(pool->buffer_need_last);
+   free(pool->threads);
+   (void) pthread_mutex_destroy(&pool->mutex);
+   (void) pthread_cond_destroy(&pool->cond);
 }
 
+#endif /* HAVE_PTHREAD */
+
 /************************************************************************
  * Windowed Sinc Interpolant
  *  
@@ -922,12 +1550,26 @@ int do_Ncubic_interpolation(Volume_Data *volume,
  * Any bugs are of course my own fault!
  *
  *     -bert
+ *
+ * The window weights are no longer computed for every sample: they are
+ * tabulated once for SINC_TABLE_SIZE+1 fractional offsets and linearly
+ * interpolated from the table, and the kernel is applied as three 1D
+ * passes (x, then y, then z) built on a vectorized dot product.
  */
 
 int sinc_half_width = SINC_HALF_WIDTH_MAX / 2;
 
 enum sinc_interpolant_window_t sinc_window_type = SINC_WINDOW_HANNING;
 
+/* Number of intervals in the table of sinc weights. The error of a 
+   weight interpolated from the table is below 1e-6. */
+#define SINC_TABLE_SIZE 1024
+
+/* Table of weights, SINC_TABLE_SIZE+1 rows of 2*sinc_half_width+1 
+   weights. Row t holds the weights for a fractional offset of 
+   t/SINC_TABLE_SIZE. */
+static double *sinc_table = NULL;
+
 /* basic windowed sinc function */
 
 static double 
@@ -968,184 +1610,344 @@ windowed_sinc(double delta)
     return (sinc * window);
 }
 
-/* Floating-point (unscaled) multiply/accumulate operations */
-#define SINC_FRND result += *pix_ptr++ * *win_ptr++
-
-/* Unroll those loops!! */     
-#define SINC_FMAC \
-    result = 0.0; \
-    switch (sinc_half_width) { \
-    case 10: SINC_FRND; SINC_FRND; \
-    case 9:  SINC_FRND; SINC_FRND; \
-    case 8:  SINC_FRND; SINC_FRND; \
-    case 7:  SINC_FRND; SINC_FRND; \
-    case 6:  SINC_FRND; SINC_FRND; \
-    case 5:  SINC_FRND; SINC_FRND; \
-    case 4:  SINC_FRND; SINC_FRND; \
-    case 3:  SINC_FRND; SINC_FRND; \
-    case 2:  SINC_FRND; SINC_FRND; \
-    case 1:  SINC_FRND; SINC_FRND; \
-    SINC_FRND; /* Do the leftover */ \
-    }
+/* Build the table of sinc weights for the current half-width and window.
+   Must be called before any sinc interpolation is done. */
 
-/* Integer (scaled) multiply/accumulate operations */
-#define SINC_IRND result += ((slope * *pix_ptr++) + intercept) * *win_ptr++
-
-/* Unroll the loops!! */
-#define SINC_IMAC \
-    result = 0.0; \
-    switch (sinc_half_width) { \
-    case 10: SINC_IRND; SINC_IRND; \
-    case 9:  SINC_IRND; SINC_IRND; \
-    case 8:  SINC_IRND; SINC_IRND; \
-    case 7:  SINC_IRND; SINC_IRND; \
-    case 6:  SINC_IRND; SINC_IRND; \
-    case 5:  SINC_IRND; SINC_IRND; \
-    case 4:  SINC_IRND; SINC_IRND; \
-    case 3:  SINC_IRND; SINC_IRND; \
-    case 2:  SINC_IRND; SINC_IRND; \
-    case 1:  SINC_IRND; SINC_IRND; \
-    SINC_IRND; /* Do the leftover */ \
-    }
-
-static double 
-sinc_mac_d(Volume_Data *volume, int z, int y, int x, double *win_ptr)
+static void
+init_sinc_table(void)
 {
-    double result;
-    long offset;
-    double *pix_ptr;
+    int t, i, width;
 
-    offset = (z * volume->size[ROW_AXIS] + y) * volume->size[COL_AXIS] + x;
-
-    pix_ptr = (double *) volume->data + offset;
-
-    SINC_FMAC;
+    width = 2 * sinc_half_width + 1;
+    if (sinc_table != NULL) {
+        free(sinc_table);
+    }
+    sinc_table = malloc(sizeof(double) * width * (SINC_TABLE_SIZE + 1));
 
-    return (result);
+    for (t = 0; t <= SINC_TABLE_SIZE; t++) {
+        for (i = -sinc_half_width; i <= sinc_half_width; i++) {
+            sinc_table[t * width + i + sinc_half_width] = 
+                windowed_sinc((double) t / SINC_TABLE_SIZE - i);
+        }
+    }
 }
 
-static double 
-sinc_mac_f(Volume_Data *volume, int z, int y, int x, double *win_ptr)
-{
-    double result;
-    long offset;
-    float *pix_ptr;
-
-    offset = (z * volume->size[ROW_AXIS] + y) * volume->size[COL_AXIS] + x;
-
-    pix_ptr = (float *) volume->data + offset;
+/* Get the 2*sinc_half_width+1 weights for a fractional offset in [0,1),
+   and their sum. */
 
-    SINC_FMAC;
-
-    return (result);
-}
-
-static double 
-sinc_mac_uc(Volume_Data *volume, int z, int y, int x, double *win_ptr)
+static void
+get_sinc_weights(double frac, double weights[], double *sum)
 {
-    double result;
-    double slope = volume->scale[z];
-    double intercept = volume->offset[z];
-    long offset;
-    unsigned char *pix_ptr;
-
-    offset = (z * volume->size[ROW_AXIS] + y) * volume->size[COL_AXIS] + x;
-
-    pix_ptr = (unsigned char *) volume->data + offset;
-
-    SINC_IMAC;
-
-    return (result);
+    int t, i, width;
+    double pos, a;
+    double *lo, *hi;
+
+    width = 2 * sinc_half_width + 1;
+    pos = frac * SINC_TABLE_SIZE;
+    t = (int) pos;
+    if (t >= SINC_TABLE_SIZE) t = SINC_TABLE_SIZE - 1;
+    a = pos - t;
+
+    lo = sinc_table + t * width;
+    hi = lo + width;
+    *sum = 0.0;
+    for (i = 0; i < width; i++) {
+        weights[i] = lo[i] + a * (hi[i] - lo[i]);
+        *sum += weights[i];
+    }
 }
 
+/* Dot product of two vectors of doubles. This is where nearly all of the
+   time of sinc interpolation goes, so use SIMD instructions where the
+   compiler supports them. */
+
 static double 
-sinc_mac_sc(Volume_Data *volume, int z, int y, int x, double *win_ptr)
+sinc_dot(const double values[], const double weights[], int n)
 {
+    int i = 0;
     double result;
-    double slope = volume->scale[z];
-    double intercept = volume->offset[z];
-    long offset;
-    char *pix_ptr;
-
-    offset = (z * volume->size[ROW_AXIS] + y) * volume->size[COL_AXIS] + x;
 
-    pix_ptr = (char *) volume->data + offset;
+#if defined(__AVX__)
+    __m256d acc4 = _mm256_setzero_pd();
+    __m128d acc2;
+    double sum2[2];
 
-    SINC_IMAC;
+    for (; i + 4 <= n; i += 4) {
+        acc4 = _mm256_add_pd(acc4, 
+                             _mm256_mul_pd(_mm256_loadu_pd(values + i),
+                                           _mm256_loadu_pd(weights + i)));
+    }
+    acc2 = _mm_add_pd(_mm256_castpd256_pd128(acc4),
+                      _mm256_extractf128_pd(acc4, 1));
+    _mm_storeu_pd(sum2, acc2);
+    result = sum2[0] + sum2[1];
+#elif defined(__SSE2__)
+    __m128d acc2 = _mm_setzero_pd();
+    double sum2[2];
+
+    for (; i + 2 <= n; i += 2) {
+        acc2 = _mm_add_pd(acc2, _mm_mul_pd(_mm_loadu_pd(values + i),
+                                           _mm_loadu_pd(weights + i)));
+    }
+    _mm_storeu_pd(sum2, acc2);
+    result = sum2[0] + sum2[1];
+#else
+    result = 0.0;
+#endif
 
+    /* Do the leftover */
+    for (; i < n; i++) {
+        result += values[i] * weights[i];
+    }
     return (result);
 }
 
-static double 
-sinc_mac_us(Volume_Data *volume, int z, int y, int x, double *win_ptr)
-{
-    double result;
-    double slope = volume->scale[z];
-    double intercept = volume->offset[z];
-    long offset;
-    unsigned short *pix_ptr;
-
-    offset = (z * volume->size[ROW_AXIS] + y) * volume->size[COL_AXIS] + x;
-
-    pix_ptr = (unsigned short *) volume->data + offset;
+/* Define a function that interpolates a row of points with a given 
+   point interpolant, keeping track of the minimum and maximum of the 
+   values inside the volume (or of all values if fill values are used) */
+#define ROW_INTERPOLANT(row_function, point_function) \
+static void row_function(Volume_Data *volume, long ncols, \
+                         Coord_Vector coords[], double result[], \
+                         double *minimum, double *maximum) \
+{ \
+   long icol; \
+ \
+   for (icol=0; icol < ncols; icol++) { \
+      if (point_function(volume, coords[icol], &result[icol]) || \
+          volume->use_fill) { \
+         if (result[icol] > *maximum) *maximum = result[icol]; \
+         if (result[icol] < *minimum) *minimum = result[icol]; \
+      } \
+   } \
+}
 
-    SINC_IMAC;
+/* Interpolants specialized for each type of voxel */
+#define VOXEL_TYPE unsigned char
+#define VOXEL_SUFFIX uc
+#include "typed_interpolants.h"
+#undef VOXEL_TYPE
+#undef VOXEL_SUFFIX
+
+#define VOXEL_TYPE signed char
+#define VOXEL_SUFFIX sc
+#include "typed_interpolants.h"
+#undef VOXEL_TYPE
+#undef VOXEL_SUFFIX
+
+#define VOXEL_TYPE unsigned short
+#define VOXEL_SUFFIX us
+#include "typed_interpolants.h"
+#undef VOXEL_TYPE
+#undef VOXEL_SUFFIX
+
+#define VOXEL_TYPE signed short
+#define VOXEL_SUFFIX ss
+#include "typed_interpolants.h"
+#undef VOXEL_TYPE
+#undef VOXEL_SUFFIX
+
+#define VOXEL_TYPE unsigned int
+#define VOXEL_SUFFIX ui
+#include "typed_interpolants.h"
+#undef VOXEL_TYPE
+#undef VOXEL_SUFFIX
+
+#define VOXEL_TYPE signed int
+#define VOXEL_SUFFIX si
+#include "typed_interpolants.h"
+#undef VOXEL_TYPE
+#undef VOXEL_SUFFIX
+
+#define VOXEL_TYPE float
+#define VOXEL_SUFFIX f
+#include "typed_interpolants.h"
+#undef VOXEL_TYPE
+#undef VOXEL_SUFFIX
+
+#define VOXEL_TYPE double
+#define VOXEL_SUFFIX d
+#include "typed_interpolants.h"
+#undef VOXEL_TYPE
+#undef VOXEL_SUFFIX
+
+/* Interpolants for each voxel type, indexed by get_voxel_type */
+#define NUM_VOXEL_TYPES 8
+
+static struct {
+   Interpolating_Function trilinear;
+   Interpolating_Function tricubic;
+   Interpolating_Function nearest_neighbour;
+   Interpolating_Function windowed_sinc;
+   Row_Interpolating_Function trilinear_row;
+   Row_Interpolating_Function tricubic_row;
+   Row_Interpolating_Function nearest_neighbour_row;
+   Row_Interpolating_Function windowed_sinc_row;
+} typed_interpolants[NUM_VOXEL_TYPES] = {
+   {trilinear_interpolant_uc, tricubic_interpolant_uc,
+    nearest_neighbour_interpolant_uc, windowed_sinc_interpolant_uc,
+    trilinear_row_interpolant_uc, tricubic_row_interpolant_uc,
+    nearest_neighbour_row_interpolant_uc, windowed_sinc_row_interpolant_uc},
+   {trilinear_interpolant_sc, tricubic_interpolant_sc,
+    nearest_neighbour_interpolant_sc, windowed_sinc_interpolant_sc,
+    trilinear_row_interpolant_sc, tricubic_row_interpolant_sc,
+    nearest_neighbour_row_interpolant_sc, windowed_sinc_row_interpolant_sc},
+   {trilinear_interpolant_us, tricubic_interpolant_us,
+    nearest_neighbour_interpolant_us, windowed_sinc_interpolant_us,
+    trilinear_row_interpolant_us, tricubic_row_interpolant_us,
+    nearest_neighbour_row_interpolant_us, windowed_sinc_row_interpolant_us},
+   {trilinear_interpolant_ss, tricubic_interpolant_ss,
+    nearest_neighbour_interpolant_ss, windowed_sinc_interpolant_ss,
+    trilinear_row_interpolant_ss, tricubic_row_interpolant_ss,
+    nearest_neighbour_row_interpolant_ss, windowed_sinc_row_interpolant_ss},
+   {trilinear_interpolant_ui, tricubic_interpolant_ui,
+    nearest_neighbour_interpolant_ui, windowed_sinc_interpolant_ui,
+    trilinear_row_interpolant_ui, tricubic_row_interpolant_ui,
+    nearest_neighbour_row_interpolant_ui, windowed_sinc_row_interpolant_ui},
+   {trilinear_interpolant_si, tricubic_interpolant_si,
+    nearest_neighbour_interpolant_si, windowed_sinc_interpolant_si,
+    trilinear_row_interpolant_si, tricubic_row_interpolant_si,
+    nearest_neighbour_row_interpolant_si, windowed_sinc_row_interpolant_si},
+   {trilinear_interpolant_f, tricubic_interpolant_f,
+    nearest_neighbour_interpolant_f, windowed_sinc_interpolant_f,
+    trilinear_row_interpolant_f, tricubic_row_interpolant_f,
+    nearest_neighbour_row_interpolant_f, windowed_sinc_row_interpolant_f},
+   {trilinear_interpolant_d, tricubic_interpolant_d,
+    nearest_neighbour_interpolant_d, windowed_sinc_interpolant_d,
+    trilinear_row_interpolant_d, tricubic_row_interpolant_d,
+    nearest_neighbour_row_interpolant_d, windowed_sinc_row_interpolant_d}
+};
 
-    return (result);
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : get_voxel_type
+@INPUT      : volume - pointer to volume data
+@OUTPUT     : (none)
+@RETURNS    : Index of the volume's voxel type in typed_interpolants.
+@DESCRIPTION: Maps the datatype and sign of a volume to an index into the
+              table of type-specialized interpolants.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+static int get_voxel_type(Volume_Data *volume)
+{
+   switch (volume->datatype) {
+   case NC_BYTE:
+      return (volume->is_signed ? 1 : 0);
+   case NC_SHORT:
+      return (volume->is_signed ? 3 : 2);
+   case NC_INT:
+      return (volume->is_signed ? 5 : 4);
+   case NC_FLOAT:
+      return 6;
+   case NC_DOUBLE:
+      return 7;
+   default:
+      (void) fprintf(stderr, "Unsupported volume data type %d\n", 
+                     (int) volume->datatype);
+      exit(EXIT_FAILURE);
+   }
+   return 0;
 }
 
-static double 
-sinc_mac_ss(Volume_Data *volume, int z, int y, int x, double *win_ptr)
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : set_volume_interpolant
+@INPUT      : volume - pointer to volume data
+              interpolant_type - type of interpolation
+@OUTPUT     : volume - interpolant, row_interpolant and kernel_reach are set
+@RETURNS    : (none)
+@DESCRIPTION: Chooses the interpolation functions for a volume. Where 
+              possible, the versions specialized for the volume's 
+              datatype are used so that the type is only looked at once.
+              Must be called after the datatype of the volume is final.
+@METHOD     : 
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : October 16, 2026
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+void set_volume_interpolant(Volume_Data *volume, 
+                            enum Interpolant_type interpolant_type)
 {
-    double result;
-    double slope = volume->scale[z];
-    double intercept = volume->offset[z];
-    long offset;
-    short *pix_ptr;
-
-    offset = (z * volume->size[ROW_AXIS] + y) * volume->size[COL_AXIS] + x;
-
-    pix_ptr = (short *) volume->data + offset;
-
-    SINC_IMAC;
-
-    return (result);
+   int voxel_type;
+
+   voxel_type = get_voxel_type(volume);
+
+   switch (interpolant_type) {
+   case TRICUBIC:
+      volume->interpolant = typed_interpolants[voxel_type].tricubic;
+      volume->row_interpolant = typed_interpolants[voxel_type].tricubic_row;
+      volume->kernel_reach = 2;
+      break;
+   case TRILINEAR:
+      volume->interpolant = typed_interpolants[voxel_type].trilinear;
+      volume->row_interpolant = typed_interpolants[voxel_type].trilinear_row;
+      volume->kernel_reach = 1;
+      break;
+   case N_NEIGHBOUR:
+      volume->interpolant = typed_interpolants[voxel_type].nearest_neighbour;
+      volume->row_interpolant = 
+         typed_interpolants[voxel_type].nearest_neighbour_row;
+      volume->kernel_reach = 1;
+      break;
+   case WINDOWED_SINC:
+      init_sinc_table();
+      volume->interpolant = typed_interpolants[voxel_type].windowed_sinc;
+      volume->row_interpolant = 
+         typed_interpolants[voxel_type].windowed_sinc_row;
+      volume->kernel_reach = sinc_half_width + 1;
+      break;
+   default:
+      (void) fprintf(stderr, "Error determining interpolation type\n");
+      exit(EXIT_FAILURE);
+   }
 }
 
-static double 
-sinc_mac_ui(Volume_Data *volume, int z, int y, int x, double *win_ptr)
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : trilinear_interpolant
+@INPUT      : volume - pointer to volume data
+              coord - point at which volume should be interpolated in voxel 
+                 units (with 0 being first point of the volume).
+@OUTPUT     : result - interpolated value.
+@RETURNS    : TRUE if coord is within the volume, FALSE otherwise.
+@DESCRIPTION: Routine to interpolate a volume at a point with tri-linear
+              interpolation.
+@METHOD     : Calls the version specialized for the volume's datatype
+              (see typed_interpolants.h).
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : February 10, 1993 (Peter Neelin)
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+int trilinear_interpolant(Volume_Data *volume, 
+                          Coord_Vector coord, double *result)
 {
-    double result;
-    double slope = volume->scale[z];
-    double intercept = volume->offset[z];
-    long offset;
-    unsigned int *pix_ptr;
-
-    offset = (z * volume->size[ROW_AXIS] + y) * volume->size[COL_AXIS] + x;
-
-    pix_ptr = (unsigned int *) volume->data + offset;
-
-    SINC_IMAC;
-
-    return (result);
+   return (*typed_interpolants[get_voxel_type(volume)].trilinear)
+      (volume, coord, result);
 }
 
-static double 
-sinc_mac_si(Volume_Data *volume, int z, int y, int x, double *win_ptr)
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : tricubic_interpolant
+@INPUT      : volume - pointer to volume data
+              coord - point at which volume should be interpolated in voxel 
+                 units (with 0 being first point of the volume).
+@OUTPUT     : result - interpolated value.
+@RETURNS    : TRUE if coord is within the volume, FALSE otherwise.
+@DESCRIPTION: Routine to interpolate a volume at a point with tri-cubic
+              interpolation.
+@METHOD     : Calls the version specialized for the volume's datatype
+              (see typed_interpolants.h).
+@GLOBALS    : 
+@CALLS      : 
+@CREATED    : February 12, 1993 (Peter Neelin)
+@MODIFIED   : 
+---------------------------------------------------------------------------- */
+int tricubic_interpolant(Volume_Data *volume, 
+                         Coord_Vector coord, double *result)
 {
-    double result;
-    double slope = volume->scale[z];
-    double intercept = volume->offset[z];
-    long offset;
-    int *pix_ptr;
-
-    offset = (z * volume->size[ROW_AXIS] + y) * volume->size[COL_AXIS] + x;
-
-    pix_ptr = (int *) volume->data + offset;
-
-    SINC_IMAC;
-
-    return (result);
+   return (*typed_interpolants[get_voxel_type(volume)].tricubic)
+      (volume, coord, result);
 }
 
 /* ----------------------------- MNI Header -----------------------------------
@@ -1156,8 +1958,10 @@ sinc_mac_si(Volume_Data *volume, int z, int y, int x, double *win_ptr)
 @OUTPUT     : result - interpolated value.
 @RETURNS    : TRUE if coord is within the volume, FALSE otherwise.
 @DESCRIPTION: Routine to interpolate a volume at a point with windowed
-              sinc interpolation.
-@METHOD     : 
+              sinc interpolation. The sinc table must have been set up
+              by set_volume_interpolant.
+@METHOD     : Calls the version specialized for the volume's datatype
+              (see typed_interpolants.h).
 @GLOBALS    : 
 @CALLS      : 
 @CREATED    : July 11 2005 (Robert Vincent)
@@ -1167,148 +1971,10 @@ int
 windowed_sinc_interpolant(Volume_Data *volume, Coord_Vector coord, 
                           double *result)
 {
-    double zt, yt, xt;
-    double zf, yf, xf;
-    int zi, yi, xi;
-    int i, j;
-    double new;
-    double tmp;
-    long slcmax, rowmax, colmax;
-    double zw[SINC_HALF_WIDTH_MAX * 2 + 1];
-    double yw[SINC_HALF_WIDTH_MAX * 2 + 1];
-    double xw[SINC_HALF_WIDTH_MAX * 2 + 1];
-
-    slcmax = volume->size[SLC_AXIS] - 1;
-    rowmax = volume->size[ROW_AXIS] - 1;
-    colmax = volume->size[COL_AXIS] - 1;
-
-    if ((coord[SLICE]  < 0) || (coord[SLICE]  > slcmax) ||
-        (coord[ROW]    < 0) || (coord[ROW]    > rowmax) ||
-        (coord[COLUMN] < 0) || (coord[COLUMN] > colmax)) {
-        *result = volume->fillvalue;
-        return FALSE;
-    }
-
-    zi = (int) coord[SLICE];
-    yi = (int) coord[ROW];
-    xi = (int) coord[COLUMN];
-
-    /* Check for edges - do linear interpolation at edges */
-    if ((zi > slcmax-sinc_half_width) || (zi < sinc_half_width) ||
-        (yi > rowmax-sinc_half_width) || (yi < sinc_half_width) ||
-        (xi > colmax-sinc_half_width) || (xi < sinc_half_width)) {
-        return trilinear_interpolant(volume, coord, result);
-    }
-
-    /* Calculate fractional part of the coordinate.
-     */
-    zf = coord[SLICE] - zi;
-    yf = coord[ROW] - yi;
-    xf = coord[COLUMN] - xi;
-    
-    /* Initialize the totals.
-     */
-    zt = 0.0;
-    yt = 0.0;
-    xt = 0.0;
-
-    /* Generate the three windowed sinc functions.
-     */
-    for (i = -sinc_half_width; i <= sinc_half_width; i++) {
-        tmp = windowed_sinc(zf - i);
-        zw[i + sinc_half_width] = tmp;
-        zt += tmp;
-        
-        tmp = windowed_sinc(yf - i);
-        yw[i + sinc_half_width] = tmp;
-        yt += tmp;
-        
-        tmp = windowed_sinc(xf - i);
-        xw[i + sinc_half_width] = tmp;
-        xt += tmp;
-    }
-
-    /* Now calculate the new value.
-     */
-    new = 0.0;
-    for (i = -sinc_half_width; i <= sinc_half_width; i++) {
-        for (j = -sinc_half_width; j <= sinc_half_width; j++) {
-            switch (volume->datatype) {
-            case NC_BYTE:
-                if (volume->is_signed) {
-                    tmp = sinc_mac_sc(volume, 
-                                      zi + i, 
-                                      yi + j, 
-                                      xi - sinc_half_width, 
-                                      xw);
-                }
-                else {
-                    tmp = sinc_mac_uc(volume, 
-                                      zi + i, 
-                                      yi + j, 
-                                      xi - sinc_half_width, 
-                                      xw);
-                }
-                break;
-            case NC_SHORT:
-                if (volume->is_signed) {
-                    tmp = sinc_mac_ss(volume, 
-                                      zi + i, 
-                                      yi + j, 
-                                      xi - sinc_half_width, 
-                                      xw);
-                }
-                else {
-                    tmp = sinc_mac_us(volume, 
-                                      zi + i, 
-                                      yi + j, 
-                                      xi - sinc_half_width, 
-                                      xw);
-                }
-                break;
-            case NC_INT:
-                if (volume->is_signed) {
-                    tmp = sinc_mac_si(volume, 
-                                      zi + i, 
-                                      yi + j, 
-                                      xi - sinc_half_width, 
-                                      xw);
-                }
-                else {
-                    tmp = sinc_mac_ui(volume, 
-                                      zi + i, 
-                                      yi + j, 
-                                      xi - sinc_half_width, 
-                                      xw);
-                }
-                break;
-            case NC_FLOAT:
-                tmp = sinc_mac_f(volume, 
-                                 zi + i, 
-                                 yi + j, 
-                                 xi - sinc_half_width,
-                                 xw);
-                break;
-            case NC_DOUBLE:
-                tmp = sinc_mac_d(volume,
-                                 zi + i,
-                                 yi + j,
-                                 xi - sinc_half_width,
-                                 xw);
-                break;
-
-            default:
-                fprintf(stderr, "UNHANDLED TYPE!!!\n");
-                break;
-            }
-            new += zw[i + sinc_half_width] * yw[j + sinc_half_width] * tmp;
-        }
-    }
-    *result = (new / (zt * yt * xt));
-    return TRUE;
+   return (*typed_interpolants[get_voxel_type(volume)].windowed_sinc)
+      (volume, coord, result);
 }
 
-
 /* ----------------------------- MNI Header -----------------------------------
 @NAME       : nearest_neighbour_interpolant
 @INPUT      : volume - pointer to volume data
@@ -1319,7 +1985,8 @@ windowed_sinc_interpolant(Volume_Data *volume, Coord_Vector coord,
 @DESCRIPTION: Routine to interpolate a volume at a point with nearest
               neighbour interpolation. Allows the coord to be outside
               the volume by up to 1/2 a pixel.
-@METHOD     : 
+@METHOD     : Calls the version specialized for the volume's datatype
+              (see typed_interpolants.h).
 @GLOBALS    : 
 @CALLS      : 
 @CREATED    : February 12, 1993 (Peter Neelin)
@@ -1328,35 +1995,8 @@ windowed_sinc_interpolant(Volume_Data *volume, Coord_Vector coord,
 int nearest_neighbour_interpolant(Volume_Data *volume, 
                                   Coord_Vector coord, double *result)
 {
-   long slcind, rowind, colind, slcmax, rowmax, colmax;
-
-   /* Check that the coordinate is inside the volume */
-   slcmax = volume->size[SLC_AXIS] - 1;
-   rowmax = volume->size[ROW_AXIS] - 1;
-   colmax = volume->size[COL_AXIS] - 1;
-   slcind = VIO_ROUND(coord[SLICE]);
-   rowind = VIO_ROUND(coord[ROW]);
-   colind = VIO_ROUND(coord[COLUMN]);
-   if ((slcind < 0) || (slcind > slcmax) ||
-       (rowind < 0) || (rowind > rowmax) ||
-       (colind < 0) || (colind > colmax)) {
-      *result = volume->fillvalue;
-      return FALSE;
-   }
-
-   /* Get the value */
-   VOLUME_VALUE(volume, slcind  , rowind  , colind  , *result);
-
-   /* Check for fillvalue on input */
-   if ((*result < volume->vrange[0]) || (*result > volume->vrange[1])) {
-      *result = volume->fillvalue;
-      return FALSE;
-   }
-
-   *result = volume->scale[slcind] * (*result) + volume->offset[slcind];
-
-   return TRUE;
-
+   return (*typed_interpolants[get_voxel_type(volume)].nearest_neighbour)
+      (volume, coord, result);
 }
 
 /* ----------------------------- MNI Header -----------------------------------
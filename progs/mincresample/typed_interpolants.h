@@ -0,0 +1,435 @@
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : typed_interpolants.h
+@DESCRIPTION: Template for the interpolation routines of one voxel type.
+              This file is included by resample_volumes.c once for each
+              type of volume data, with VOXEL_TYPE defined as the C type
+              of the voxels and VOXEL_SUFFIX as the suffix to append to
+              the function names. The voxels are then fetched directly
+              instead of going through the datatype switch of VOLUME_VALUE.
+@METHOD     :
+@GLOBALS    :
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+@COPYRIGHT  :
+              Copyright 1993 Peter Neelin, McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+---------------------------------------------------------------------------- */
+
+#if !defined(VOXEL_TYPE) || !defined(VOXEL_SUFFIX)
+#  error "VOXEL_TYPE and VOXEL_SUFFIX must be defined"
+#endif
+
+#define TYPED_PASTE2(name, suffix) name ## _ ## suffix
+#define TYPED_PASTE(name, suffix) TYPED_PASTE2(name, suffix)
+#define TYPED(name) TYPED_PASTE(name, VOXEL_SUFFIX)
+
+/* Get a voxel value given its slice, row and column. Only slices from
+   first_slice onwards are held in memory. */
+#define TYPED_VALUE(volume, slcind, rowind, colind) \
+   ((double) *((VOXEL_TYPE *) (volume)->data + \
+               (((slcind) - (volume)->first_slice) * \
+                (volume)->size[ROW_AXIS] + (rowind)) * \
+               (volume)->size[COL_AXIS] + (colind)))
+
+/* Trilinear interpolation (see trilinear_interpolant) */
+static int TYPED(trilinear_interpolant)(Volume_Data *volume,
+                                        Coord_Vector coord, double *result)
+{
+   long slcind, rowind, colind, slcmax, rowmax, colmax;
+   long slcnext, rownext, colnext;
+   double f0, f1, f2, r0, r1, r2, r1r2, r1f2, f1r2, f1f2;
+   double v000, v001, v010, v011, v100, v101, v110, v111;
+
+   /* Check that the coordinate is inside the volume */
+   slcmax = volume->size[SLC_AXIS] - 1;
+   rowmax = volume->size[ROW_AXIS] - 1;
+   colmax = volume->size[COL_AXIS] - 1;
+   if ((coord[SLICE]  < -VOXEL_COORD_EPS) ||
+       (coord[SLICE]  > slcmax+VOXEL_COORD_EPS) ||
+       (coord[ROW]    < -VOXEL_COORD_EPS) ||
+       (coord[ROW]    > rowmax+VOXEL_COORD_EPS) ||
+       (coord[COLUMN] < -VOXEL_COORD_EPS) ||
+       (coord[COLUMN] > colmax+VOXEL_COORD_EPS)) {
+      *result = volume->fillvalue;
+      return FALSE;
+   }
+
+   /* Get the whole part of the coordinate */
+   slcind = (long) coord[SLICE];
+   rowind = (long) coord[ROW];
+   colind = (long) coord[COLUMN];
+   if (slcind >= slcmax-1) slcind = slcmax-1;
+   if (rowind >= rowmax-1) rowind = rowmax-1;
+   if (colind >= colmax-1) colind = colmax-1;
+
+   /* Get the next voxel up */
+   slcnext = slcind+1;
+   rownext = rowind+1;
+   colnext = colind+1;
+
+   /* Check for case of dimension of length one */
+   if (slcmax == 0) {
+      slcind = 0;
+      slcnext = 0;
+   }
+   if (rowmax == 0) {
+      rowind = 0;
+      rownext = 0;
+   }
+   if (colmax == 0) {
+      colind = 0;
+      colnext = 0;
+   }
+
+   /* Get the relevant voxels */
+   v000 = TYPED_VALUE(volume, slcind , rowind , colind );
+   v001 = TYPED_VALUE(volume, slcind , rowind , colnext);
+   v010 = TYPED_VALUE(volume, slcind , rownext, colind );
+   v011 = TYPED_VALUE(volume, slcind , rownext, colnext);
+   v100 = TYPED_VALUE(volume, slcnext, rowind , colind );
+   v101 = TYPED_VALUE(volume, slcnext, rowind , colnext);
+   v110 = TYPED_VALUE(volume, slcnext, rownext, colind );
+   v111 = TYPED_VALUE(volume, slcnext, rownext, colnext);
+
+   /* Check that the values are not fill values */
+   if ((v000 < volume->vrange[0]) || (v000 > volume->vrange[1]) ||
+       (v001 < volume->vrange[0]) || (v001 > volume->vrange[1]) ||
+       (v010 < volume->vrange[0]) || (v010 > volume->vrange[1]) ||
+       (v011 < volume->vrange[0]) || (v011 > volume->vrange[1]) ||
+       (v100 < volume->vrange[0]) || (v100 > volume->vrange[1]) ||
+       (v101 < volume->vrange[0]) || (v101 > volume->vrange[1]) ||
+       (v110 < volume->vrange[0]) || (v110 > volume->vrange[1]) ||
+       (v111 < volume->vrange[0]) || (v111 > volume->vrange[1])) {
+      *result = volume->fillvalue;
+      return FALSE;
+   }
+
+   /* Get the fraction parts */
+   f0 = coord[SLICE]  - slcind;
+   f1 = coord[ROW]    - rowind;
+   f2 = coord[COLUMN] - colind;
+   r0 = 1.0 - f0;
+   r1 = 1.0 - f1;
+   r2 = 1.0 - f2;
+
+   /* Do the interpolation */
+   r1r2 = r1 * r2;
+   r1f2 = r1 * f2;
+   f1r2 = f1 * r2;
+   f1f2 = f1 * f2;
+   *result =
+      r0 * (volume->scale[slcind] *
+            (r1r2 * v000 +
+             r1f2 * v001 +
+             f1r2 * v010 +
+             f1f2 * v011) + volume->offset[slcind]);
+   *result +=
+      f0 * (volume->scale[slcind+1] *
+            (r1r2 * v100 +
+             r1f2 * v101 +
+             f1r2 * v110 +
+             f1f2 * v111) + volume->offset[slcind+1]);
+
+   return TRUE;
+
+}
+
+/* Recursive cubic interpolation (see do_Ncubic_interpolation) */
+static int TYPED(do_Ncubic_interpolation)(Volume_Data *volume,
+                                          long index[], int cur_dim,
+                                          double frac[], double *result)
+{
+   long base_index;
+   double v0, v1, v2, v3, u;
+   int found_fillvalue;
+
+   /* Save index that we will change */
+   base_index = index[cur_dim];
+
+   /* If last dimension, then just get the values */
+   found_fillvalue = FALSE;
+   if (cur_dim == VOL_NDIMS-1) {
+      v0 = TYPED_VALUE(volume, index[0], index[1], base_index  );
+      v1 = TYPED_VALUE(volume, index[0], index[1], base_index+1);
+      v2 = TYPED_VALUE(volume, index[0], index[1], base_index+2);
+      v3 = TYPED_VALUE(volume, index[0], index[1], base_index+3);
+
+      /* Check for fillvalues */
+      if ((v0 < volume->vrange[0]) || (v0 > volume->vrange[1]) ||
+          (v1 < volume->vrange[0]) || (v1 > volume->vrange[1]) ||
+          (v2 < volume->vrange[0]) || (v2 > volume->vrange[1]) ||
+          (v3 < volume->vrange[0]) || (v3 > volume->vrange[1])) {
+         found_fillvalue = TRUE;
+      }
+
+   }
+
+   /* Otherwise, recurse */
+   else {
+      if (!TYPED(do_Ncubic_interpolation)(volume, index, cur_dim+1,
+                                          frac, &v0)) {
+         found_fillvalue = TRUE;
+      }
+      index[cur_dim]++;
+      if (!TYPED(do_Ncubic_interpolation)(volume, index, cur_dim+1,
+                                          frac, &v1)) {
+         found_fillvalue = TRUE;
+      }
+      index[cur_dim]++;
+      if (!TYPED(do_Ncubic_interpolation)(volume, index, cur_dim+1,
+                                          frac, &v2)) {
+         found_fillvalue = TRUE;
+      }
+      index[cur_dim]++;
+      if (!TYPED(do_Ncubic_interpolation)(volume, index, cur_dim+1,
+                                          frac, &v3)) {
+         found_fillvalue = TRUE;
+      }
+   }
+
+   /* Restore index */
+   index[cur_dim] = base_index;
+
+   /* Check for fill value found */
+   if (found_fillvalue) {
+      *result = volume->fillvalue;
+      return FALSE;
+   }
+
+   /* Scale values for slices */
+   if (cur_dim==0) {
+      v0 = v0 * volume->scale[base_index  ] + volume->offset[base_index  ];
+      v1 = v1 * volume->scale[base_index+1] + volume->offset[base_index+1];
+      v2 = v2 * volume->scale[base_index+2] + volume->offset[base_index+2];
+      v3 = v3 * volume->scale[base_index+3] + volume->offset[base_index+3];
+   }
+
+   /* Get fraction */
+   u = frac[cur_dim];
+
+   /* Do tricubic interpolation (code from Dave MacDonald).
+      Gives v1 and v2 at u = 0 and 1 and gives continuity of intensity
+      and first derivative. */
+   *result =
+     ( (v1) + (u) * (
+       0.5 * ((v2)-(v0)) + (u) * (
+       (v0) - 2.5 * (v1) + 2.0 * (v2) - 0.5 * (v3) + (u) * (
+       -0.5 * (v0) + 1.5 * (v1) - 1.5 * (v2) + 0.5 * (v3)  )
+                                 )
+                    )
+     );
+
+   return TRUE;
+}
+
+/* Tricubic interpolation (see tricubic_interpolant) */
+static int TYPED(tricubic_interpolant)(Volume_Data *volume,
+                                       Coord_Vector coord, double *result)
+{
+   long slcind, rowind, colind, slcmax, rowmax, colmax, index[VOL_NDIMS];
+   double frac[VOL_NDIMS];
+
+   /* Check that the coordinate is inside the volume */
+   slcmax = volume->size[SLC_AXIS] - 1;
+   rowmax = volume->size[ROW_AXIS] - 1;
+   colmax = volume->size[COL_AXIS] - 1;
+
+   /* Identify a slice or a volume. Slice must be in x-y. */
+   if( slcmax == 0 ) {
+     /* 2-d slice */
+     if( (coord[ROW] < 0) || (coord[ROW] > rowmax) ||
+         (coord[COLUMN] < 0) || (coord[COLUMN] > colmax) ) {
+       *result = volume->fillvalue;
+       return FALSE;
+     }
+   } else {
+     /* 3-d volume */
+     if( (coord[SLICE]  < 0) || (coord[SLICE]  > slcmax) ||
+         (coord[ROW]    < 0) || (coord[ROW]    > rowmax) ||
+         (coord[COLUMN] < 0) || (coord[COLUMN] > colmax) ) {
+       *result = volume->fillvalue;
+       return FALSE;
+     }
+   }
+
+   /* Get the whole and fractional part of the coordinate */
+   slcind = (long)coord[SLICE];
+   rowind = (long)coord[ROW];
+   colind = (long)coord[COLUMN];
+   frac[0] = coord[SLICE]  - slcind;
+   frac[1] = coord[ROW]    - rowind;
+   frac[2] = coord[COLUMN] - colind;
+   slcind--;
+   rowind--;
+   colind--;
+
+   /* Check for edges in the 2-d plane - do linear interpolation at edges */
+   /* Note: Spline stencil is right-sided, so ok to start at 0. */
+   if( slcmax == 0 && rowmax > 0 && colmax > 0 ) {
+     if( (rowind > rowmax-3) || (rowind < 0) ||
+         (colind > colmax-3) || (colind < 0)) {
+       return TYPED(trilinear_interpolant)(volume, coord, result);
+     } else {
+       slcind = 0;  /* there is only slice 0 */
+       index[0]=slcind; index[1]=rowind; index[2]=colind;
+       if( TYPED(do_Ncubic_interpolation)(volume, index, 1, frac, result) ) {
+         /* scaling not done for a slice in do_Ncubic_interpolation, */
+         /* only done for a volume */
+         *result = (*result) * volume->scale[slcind] + volume->offset[slcind];
+         return TRUE;
+       } else {
+         return FALSE;
+       }
+     }
+   }
+
+   /* Check for edges in the 3-d volume - do linear interpolation at edges */
+   /* Note: Spline stencil is right-sided, so ok to start at 0. */
+   if ((slcind > slcmax-3) || (slcind < 0) ||
+       (rowind > rowmax-3) || (rowind < 0) ||
+       (colind > colmax-3) || (colind < 0)) {
+      return TYPED(trilinear_interpolant)(volume, coord, result);
+   } else {
+     index[0]=slcind; index[1]=rowind; index[2]=colind;
+     /* Do the interpolation and return its value */
+     return TYPED(do_Ncubic_interpolation)(volume, index, 0, frac, result);
+   }
+
+}
+
+/* Nearest neighbour interpolation (see nearest_neighbour_interpolant) */
+static int TYPED(nearest_neighbour_interpolant)(Volume_Data *volume,
+                                                Coord_Vector coord,
+                                                double *result)
+{
+   long slcind, rowind, colind, slcmax, rowmax, colmax;
+
+   /* Check that the coordinate is inside the volume */
+   slcmax = volume->size[SLC_AXIS] - 1;
+   rowmax = volume->size[ROW_AXIS] - 1;
+   colmax = volume->size[COL_AXIS] - 1;
+   slcind = VIO_ROUND(coord[SLICE]);
+   rowind = VIO_ROUND(coord[ROW]);
+   colind = VIO_ROUND(coord[COLUMN]);
+   if ((slcind < 0) || (slcind > slcmax) ||
+       (rowind < 0) || (rowind > rowmax) ||
+       (colind < 0) || (colind > colmax)) {
+      *result = volume->fillvalue;
+      return FALSE;
+   }
+
+   /* Get the value */
+   *result = TYPED_VALUE(volume, slcind, rowind, colind);
+
+   /* Check for fillvalue on input */
+   if ((*result < volume->vrange[0]) || (*result > volume->vrange[1])) {
+      *result = volume->fillvalue;
+      return FALSE;
+   }
+
+   *result = volume->scale[slcind] * (*result) + volume->offset[slcind];
+
+   return TRUE;
+
+}
+
+/* Windowed sinc interpolation (see windowed_sinc_interpolant). The 
+   kernel is separable, so it is applied along x for each of the 
+   (2w+1)^2 rows of the neighbourhood, then along y and then along z. */
+static int TYPED(windowed_sinc_interpolant)(Volume_Data *volume,
+                                            Coord_Vector coord,
+                                            double *result)
+{
+   double zt, yt, xt;
+   double zf, yf, xf;
+   double scale, offset;
+   int zi, yi, xi;
+   int i, j, k, width;
+   long slcmax, rowmax, colmax;
+   VOXEL_TYPE *pix_ptr;
+   double zw[SINC_HALF_WIDTH_MAX * 2 + 1];
+   double yw[SINC_HALF_WIDTH_MAX * 2 + 1];
+   double xw[SINC_HALF_WIDTH_MAX * 2 + 1];
+   double row[SINC_HALF_WIDTH_MAX * 2 + 1];
+   double xsum[SINC_HALF_WIDTH_MAX * 2 + 1];
+   double ysum[SINC_HALF_WIDTH_MAX * 2 + 1];
+
+   slcmax = volume->size[SLC_AXIS] - 1;
+   rowmax = volume->size[ROW_AXIS] - 1;
+   colmax = volume->size[COL_AXIS] - 1;
+
+   if ((coord[SLICE]  < 0) || (coord[SLICE]  > slcmax) ||
+       (coord[ROW]    < 0) || (coord[ROW]    > rowmax) ||
+       (coord[COLUMN] < 0) || (coord[COLUMN] > colmax)) {
+      *result = volume->fillvalue;
+      return FALSE;
+   }
+
+   zi = (int) coord[SLICE];
+   yi = (int) coord[ROW];
+   xi = (int) coord[COLUMN];
+
+   /* Check for edges - do linear interpolation at edges */
+   if ((zi > slcmax-sinc_half_width) || (zi < sinc_half_width) ||
+       (yi > rowmax-sinc_half_width) || (yi < sinc_half_width) ||
+       (xi > colmax-sinc_half_width) || (xi < sinc_half_width)) {
+      return TYPED(trilinear_interpolant)(volume, coord, result);
+   }
+
+   /* Get the three sets of weights from the fractional part of the 
+      coordinate */
+   zf = coord[SLICE] - zi;
+   yf = coord[ROW] - yi;
+   xf = coord[COLUMN] - xi;
+   get_sinc_weights(zf, zw, &zt);
+   get_sinc_weights(yf, yw, &yt);
+   get_sinc_weights(xf, xw, &xt);
+
+   width = 2 * sinc_half_width + 1;
+   for (i = 0; i < width; i++) {
+
+      /* Real values are voxel * scale + offset, so the scaling can be
+         applied to the weighted sum of each row */
+      scale = volume->scale[zi - sinc_half_width + i];
+      offset = volume->offset[zi - sinc_half_width + i];
+
+      for (j = 0; j < width; j++) {
+         pix_ptr = (VOXEL_TYPE *) volume->data + 
+            ((long) (zi - sinc_half_width + i - volume->first_slice) * 
+             volume->size[ROW_AXIS] + 
+             (yi - sinc_half_width + j)) * volume->size[COL_AXIS] + 
+            (xi - sinc_half_width);
+         for (k = 0; k < width; k++) {
+            row[k] = pix_ptr[k];
+         }
+         xsum[j] = scale * sinc_dot(row, xw, width) + offset * xt;
+      }
+      ysum[i] = sinc_dot(xsum, yw, width);
+   }
+
+   *result = sinc_dot(ysum, zw, width) / (zt * yt * xt);
+   return TRUE;
+}
+
+/* Whole-row entry points */
+ROW_INTERPOLANT(TYPED(trilinear_row_interpolant),
+                TYPED(trilinear_interpolant))
+ROW_INTERPOLANT(TYPED(tricubic_row_interpolant),
+                TYPED(tricubic_interpolant))
+ROW_INTERPOLANT(TYPED(nearest_neighbour_row_interpolant),
+                TYPED(nearest_neighbour_interpolant))
+ROW_INTERPOLANT(TYPED(windowed_sinc_row_interpolant),
+                TYPED(windowed_sinc_interpolant))
+
+#undef TYPED_VALUE
+#undef TYPED
+#undef TYPED_PASTE
+#undef TYPED_PASTE2
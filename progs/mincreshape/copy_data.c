@@ -92,12 +92,40 @@
 #include <limits.h>
 #include <string.h>
 #include <math.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include <minc.h>
 #include <nd_loop.h>
 #include "mincreshape.h"
 
 #define VIO_ROUND( x ) ((long) ((x) + ( ((x) >= 0) ? 0.5 : (-0.5) ) ))
 
+/* Side of the square tiles used when transposing a chunk */
+#define TRANSPOSE_TILE 32
+
+/* Structure describing the copy of one chunk */
+typedef struct {
+   Reshape_info *reshape_info;
+   long chunk_start[MAX_VAR_DIMS];   /* Output hyperslab of the chunk */
+   long chunk_count[MAX_VAR_DIMS];
+   long input_start[MAX_VAR_DIMS];   /* Legal part of the input hyperslab */
+   long input_count[MAX_VAR_DIMS];
+   long output_start[MAX_VAR_DIMS];  /* Output hyperslab for input part */
+   long output_count[MAX_VAR_DIMS];
+   long output_imap[MAX_VAR_DIMS];
+   void *chunk_data;
+   void *output_origin;
+   void *output_data;                /* Chunk in output order */
+   int datatype_size;
+   int zero_data;
+   int really_copy_the_data;
+#ifdef HAVE_PTHREAD
+   pthread_t transposer;             /* Thread re-ordering the chunk */
+   int transposing;
+#endif
+} Chunk_Copy;
+
 static void get_num_minmax_values(Reshape_info *reshape_info,
                                   long *block_start, long *block_count,
                                   long *num_min_values, long *num_max_values);
@@ -125,11 +153,20 @@ static void translate_input_to_output(Reshape_info *reshape_info,
                                       long *input_count,
                                       long *output_start,
                                       long *output_count);
-static void copy_the_chunk(Reshape_info *reshape_info,
-                           long chunk_start[],
-                           long chunk_count[],
-                           void *chunk_data,
-                           double fillvalue);
+static void setup_chunk_copy(Reshape_info *reshape_info,
+                             long chunk_start[],
+                             long chunk_count[],
+                             void *chunk_data,
+                             void *output_data,
+                             Chunk_Copy *chunk_copy);
+static void read_the_chunk(Chunk_Copy *chunk_copy);
+static void start_chunk_transpose(Chunk_Copy *chunk_copy);
+static void finish_chunk_transpose(Chunk_Copy *chunk_copy);
+static void *transpose_the_chunk(void *arg);
+static void write_the_chunk(Chunk_Copy *chunk_copy, void *fill_data);
+static int transpose_chunk(Chunk_Copy *chunk_copy, void *output_data);
+static void fill_buffer(void *buffer, long nvalues, 
+                        void *value, int value_size);
 static void convert_value_from_double(double dvalue,
                                       nc_type datatype, int is_signed,
                                       void *ptr);
@@ -143,11 +180,17 @@ static void convert_value_from_double(double dvalue,
 @RETURNS    : (none)
 @DESCRIPTION: Copies data from one input volume to another, reorganizing
               it according to the reshaping info.
-@METHOD     :
+@METHOD     : Each chunk is put in output order in memory after it is
+              read so that it can be written as a plain hyperslab. If
+              reshape_info->pipeline is set, this is done in a separate
+              thread while the next chunk is read and the previous one
+              is written, using two chunk buffers. The MINC and netCDF
+              libraries are not thread safe, so all reads and writes 
+              stay in the calling thread.
 @GLOBALS    :
 @CALLS      :
 @CREATED    : October 25, 1994 (Peter Neelin)
-@MODIFIED   :
+@MODIFIED   : October 16, 2026 - re-order chunks while reading and writing
 ---------------------------------------------------------------------------- */
 void copy_data(Reshape_info *reshape_info)
 {
@@ -161,7 +204,13 @@ void copy_data(Reshape_info *reshape_info)
    long total_size;
    long num_min_values, num_max_values, num_values;
    double fillvalue, *minmax_buffer;
-   void *chunk_data;
+   void *chunk_data[2], *output_data[2], *fill_data;
+   Chunk_Copy chunk_copies[2], *chunk_copy, *pending_copy;
+   int icopy, fill_ready, datatype_size;
+   double fill_used;
+   union {
+      char c; short s; long l; float f; double d;
+   } value_buffer;
 
    /* Get number of dimensions */
    out_ndims = reshape_info->output_ndims;
@@ -177,12 +226,21 @@ void copy_data(Reshape_info *reshape_info)
          block_count[odim] = 1;
    }
 
-   /* Figure out size of chunks and allocate space */
-   total_size = nctypelen(reshape_info->output_datatype);
+   /* Figure out size of chunks and allocate space. A second buffer is
+      needed to pipeline, and a buffer of fill values is made when 
+      first needed. */
+   datatype_size = nctypelen(reshape_info->output_datatype);
+   total_size = datatype_size;
    for (odim=0; odim < out_ndims; odim++) {
       total_size *= reshape_info->chunk_count[odim];
    }
-   chunk_data = malloc(total_size);
+   chunk_data[0] = malloc(total_size);
+   chunk_data[1] = (reshape_info->pipeline ? malloc(total_size) : NULL);
+   output_data[0] = malloc(total_size);
+   output_data[1] = (reshape_info->pipeline ? malloc(total_size) : NULL);
+   fill_data = NULL;
+   fill_ready = FALSE;
+   fill_used = 0.0;
 
    /* Get enough space for image-min and max values for a block */
    get_num_minmax_values(reshape_info, NULL, block_count, 
@@ -221,8 +279,11 @@ void copy_data(Reshape_info *reshape_info)
       handle_normalization(reshape_info, block_cur_start, block_cur_count,
                            minmax_buffer, &fillvalue);
 
-      /* Loop through chunks */
+      /* Loop through chunks. When pipelining, each chunk is re-ordered
+         while the previous one is written and the next one read. */
 
+      icopy = 0;
+      pending_copy = NULL;
       nd_begin_looping(chunk_begin, chunk_cur_start, out_ndims);
       while (!nd_end_of_loop(chunk_cur_start, chunk_end, out_ndims)) {
 
@@ -236,10 +297,41 @@ void copy_data(Reshape_info *reshape_info)
             (void) fflush(stderr);
          }
 
+         /* Work out what to copy */
+         chunk_copy = &chunk_copies[icopy];
+         setup_chunk_copy(reshape_info, chunk_cur_start, chunk_cur_count,
+                          chunk_data[icopy], output_data[icopy], chunk_copy);
+
+         /* Get the fill values for the block if needed */
+         if (chunk_copy->zero_data && 
+             (!fill_ready || (fill_used != fillvalue))) {
+            if (fill_data == NULL) 
+               fill_data = malloc(total_size);
+            convert_value_from_double(fillvalue, 
+                                      reshape_info->output_datatype,
+                                      reshape_info->output_is_signed,
+                                      &value_buffer);
+            fill_buffer(fill_data, total_size / datatype_size,
+                        &value_buffer, datatype_size);
+            fill_ready = TRUE;
+            fill_used = fillvalue;
+         }
+
          /* Copy the chunk */
-         copy_the_chunk(reshape_info, 
-                        chunk_cur_start, chunk_cur_count, chunk_data,
-                        fillvalue);
+         read_the_chunk(chunk_copy);
+         if (pending_copy != NULL)
+            finish_chunk_transpose(pending_copy);
+         start_chunk_transpose(chunk_copy);
+         if (pending_copy != NULL)
+            write_the_chunk(pending_copy, fill_data);
+         if (reshape_info->pipeline) {
+            pending_copy = chunk_copy;
+            icopy = 1 - icopy;
+         }
+         else {
+            finish_chunk_transpose(chunk_copy);
+            write_the_chunk(chunk_copy, fill_data);
+         }
 
          /* Increment chunk loop count */
          nd_increment_loop(chunk_cur_start, chunk_begin, chunk_count,
@@ -247,6 +339,12 @@ void copy_data(Reshape_info *reshape_info)
 
       }
 
+      /* Write the last chunk of the block before the icv is changed */
+      if (pending_copy != NULL) {
+         finish_chunk_transpose(pending_copy);
+         write_the_chunk(pending_copy, fill_data);
+      }
+
       /* Increment block loop count */
       nd_increment_loop(block_cur_start, block_begin, block_count,
                         block_end, out_ndims);
@@ -254,7 +352,11 @@ void copy_data(Reshape_info *reshape_info)
    }
 
    /* Free the chunk space */
-   free(chunk_data);
+   free(chunk_data[0]);
+   if (chunk_data[1] != NULL) free(chunk_data[1]);
+   free(output_data[0]);
+   if (output_data[1] != NULL) free(output_data[1]);
+   if (fill_data != NULL) free(fill_data);
 
    /* Free minmax buffer */
    if (minmax_buffer != NULL) {
@@ -698,38 +800,35 @@ static void translate_input_to_output(Reshape_info *reshape_info,
 }
 
 /* ----------------------------- MNI Header -----------------------------------
-@NAME       : copy_the_chunk
+@NAME       : setup_chunk_copy
 @INPUT      : reshape_info - information for reshaping volume
-              chunk_start - start of current block
-              chunk_count - count for current block
+              chunk_start - start of current chunk
+              chunk_count - count for current chunk
               chunk_data - pointer to enough space for chunk
-              fillvalue - pixel value to zero volume, if necessary.
-@OUTPUT     : (none)
+              output_data - pointer to enough space for chunk in output
+                 order
+@OUTPUT     : chunk_copy - description of the copy
 @RETURNS    : (nothing)
-@DESCRIPTION: Copies the chunk from the input file to the output file.
+@DESCRIPTION: Works out the input hyperslab for a chunk and how to write
+              it to the output file.
 @METHOD     :
 @GLOBALS    :
 @CALLS      :
 @CREATED    : October 25, 1994 (Peter Neelin)
-@MODIFIED   :
+@MODIFIED   : October 16, 2026 - split from copy_the_chunk
 ---------------------------------------------------------------------------- */
-static void copy_the_chunk(Reshape_info *reshape_info,
-                           long chunk_start[],
-                           long chunk_count[],
-                           void *chunk_data,
-                           double fillvalue)
+static void setup_chunk_copy(Reshape_info *reshape_info,
+                             long chunk_start[],
+                             long chunk_count[],
+                             void *chunk_data,
+                             void *output_data,
+                             Chunk_Copy *chunk_copy)
 {
    int idim, odim, in_ndims, out_ndims;
-   long input_start[MAX_VAR_DIMS], input_count[MAX_VAR_DIMS];
-   long output_start[MAX_VAR_DIMS], output_count[MAX_VAR_DIMS];
-   long input_imap[MAX_VAR_DIMS], output_imap[MAX_VAR_DIMS];
-   void *output_origin;
+   long input_imap[MAX_VAR_DIMS];
+   long *input_start, *input_count, *output_count, *output_imap;
    int datatype_size;
-   long total_size, ipix, first, last;
-   int zero_data, really_copy_the_data;
-   union {
-      char c; short s; long l; float f; double d;
-   } value_buffer;
+   long first, last;
 
    /* Get number of dimensions */
    out_ndims = reshape_info->output_ndims;
@@ -738,44 +837,42 @@ static void copy_the_chunk(Reshape_info *reshape_info,
    /* Get size of output datatype */
    datatype_size = nctypelen(reshape_info->output_datatype);
 
+   /* Save the chunk */
+   chunk_copy->reshape_info = reshape_info;
+   chunk_copy->datatype_size = datatype_size;
+   chunk_copy->chunk_data = chunk_data;
+   chunk_copy->output_data = output_data;
+   for (odim=0; odim < out_ndims; odim++) {
+      chunk_copy->chunk_start[odim] = chunk_start[odim];
+      chunk_copy->chunk_count[odim] = chunk_count[odim];
+   }
+   input_start = chunk_copy->input_start;
+   input_count = chunk_copy->input_count;
+   output_count = chunk_copy->output_count;
+   output_imap = chunk_copy->output_imap;
+
    /* Create input start and count */
    translate_output_to_input(reshape_info, chunk_start, chunk_count,
                              input_start, input_count);
 
    /* Find out if we need to zero the volume and if we need to copy any
       data */
-   zero_data = FALSE;
-   really_copy_the_data = TRUE;
-   total_size = 1;
+   chunk_copy->zero_data = FALSE;
+   chunk_copy->really_copy_the_data = TRUE;
    for (idim=0; idim < in_ndims; idim++) {
       first = input_start[idim];
       last = input_start[idim] + input_count[idim] - 1;
       if ((first < 0) || (last >= reshape_info->input_size[idim]))
-         zero_data = TRUE;
+         chunk_copy->zero_data = TRUE;
       if ((last < 0) || (first >= reshape_info->input_size[idim]))
-         really_copy_the_data = FALSE;
-      total_size *= input_count[idim];
+         chunk_copy->really_copy_the_data = FALSE;
    }
 
    /* Make sure that input vectors are legal and translate them back 
       to output */
    truncate_input_vectors(reshape_info, input_start, input_count);
    translate_input_to_output(reshape_info, input_start, input_count,
-                             output_start, output_count);
-
-   /* Write out zero data if needed */
-   if (zero_data) {
-      convert_value_from_double(fillvalue, 
-                                reshape_info->output_datatype,
-                                reshape_info->output_is_signed,
-                                &value_buffer);
-      for (ipix=0; ipix < total_size; ipix++) {
-         (void) memcpy((char *)chunk_data + ipix*datatype_size,
-                       &value_buffer, datatype_size);
-      }
-      (void) ncvarput(reshape_info->outmincid, reshape_info->outimgid,
-                      chunk_start, chunk_count, chunk_data);
-   }
+                             chunk_copy->output_start, output_count);
 
    /* Set up hypothetical imap variable for input */
    for (idim=in_ndims-1; idim >= 0; idim--) {
@@ -787,7 +884,7 @@ static void copy_the_chunk(Reshape_info *reshape_info,
    /* Create output imap variable from input one (re-ordering dimensions and
       flipping). Also work out the chunk origin (point to byte for output
       [0,0,0...]). */
-   output_origin = chunk_data;
+   chunk_copy->output_origin = chunk_data;
    for (odim=0; odim < out_ndims; odim++) {
       idim = reshape_info->map_out_to_in[odim];
       if (reshape_info->input_count[idim] > 0) {
@@ -795,26 +892,319 @@ static void copy_the_chunk(Reshape_info *reshape_info,
       }
       else {
          output_imap[odim] = -input_imap[idim];
-         output_origin = 
-            (void *) ((char *)output_origin - 
+         chunk_copy->output_origin = 
+            (void *) ((char *)chunk_copy->output_origin - 
                       (output_count[odim] - 1) * output_imap[odim]);
       }
    }
 
-   /* Should we really copy the data? */
-   if (really_copy_the_data) {
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : read_the_chunk
+@INPUT      : chunk_copy - description of the copy
+@OUTPUT     : (none)
+@RETURNS    : (nothing)
+@DESCRIPTION: Reads the input data for a chunk (if any) into the chunk 
+              buffer. Must be called from the thread that does all of
+              the MINC and netCDF calls.
+@METHOD     :
+@GLOBALS    :
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+static void read_the_chunk(Chunk_Copy *chunk_copy)
+{
+   if (chunk_copy->really_copy_the_data) {
+      (void) miicv_get(chunk_copy->reshape_info->icvid, 
+                       chunk_copy->input_start, chunk_copy->input_count, 
+                       chunk_copy->chunk_data);
+   }
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : start_chunk_transpose
+@INPUT      : chunk_copy - description of the copy, with the data read
+@OUTPUT     : (none)
+@RETURNS    : (nothing)
+@DESCRIPTION: Starts putting a chunk in output order. If pipelining, 
+              this is done in a separate thread and finish_chunk_transpose
+              must be called before the data is written, otherwise it is
+              done before returning.
+@METHOD     :
+@GLOBALS    :
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+static void start_chunk_transpose(Chunk_Copy *chunk_copy)
+{
+#ifdef HAVE_PTHREAD
+   chunk_copy->transposing = FALSE;
+   if (chunk_copy->reshape_info->pipeline && 
+       chunk_copy->really_copy_the_data) {
+      if (pthread_create(&chunk_copy->transposer, NULL, 
+                         transpose_the_chunk, chunk_copy) == 0) {
+         chunk_copy->transposing = TRUE;
+         return;
+      }
+   }
+#endif
+
+   (void) transpose_the_chunk(chunk_copy);
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : finish_chunk_transpose
+@INPUT      : chunk_copy - description of the copy
+@OUTPUT     : (none)
+@RETURNS    : (nothing)
+@DESCRIPTION: Waits for a re-ordering started by start_chunk_transpose
+              to finish.
+@METHOD     :
+@GLOBALS    :
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+static void finish_chunk_transpose(Chunk_Copy *chunk_copy)
+{
+#ifdef HAVE_PTHREAD
+   if (chunk_copy->transposing) {
+      (void) pthread_join(chunk_copy->transposer, NULL);
+      chunk_copy->transposing = FALSE;
+   }
+#endif
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : transpose_the_chunk
+@INPUT      : arg - pointer to description of the copy
+@OUTPUT     : (none)
+@RETURNS    : NULL
+@DESCRIPTION: Puts the data of a chunk (if any) in output order, or points
+              output_data at the chunk buffer if it is already in order.
+              Only touches memory, so it can run in its own thread.
+@METHOD     :
+@GLOBALS    :
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+static void *transpose_the_chunk(void *arg)
+{
+   Chunk_Copy *chunk_copy = arg;
+
+   if (chunk_copy->really_copy_the_data) {
+      if (!transpose_chunk(chunk_copy, chunk_copy->output_data))
+         chunk_copy->output_data = chunk_copy->output_origin;
+   }
+
+   return NULL;
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : write_the_chunk
+@INPUT      : chunk_copy - description of the copy
+              fill_data - buffer of fill values at least as big as the
+                 chunk (only used if the chunk needs filling)
+@OUTPUT     : (none)
+@RETURNS    : (nothing)
+@DESCRIPTION: Writes a chunk that has been read to the output file, 
+              writing fill values first if the chunk goes beyond the 
+              input volume.
+@METHOD     :
+@GLOBALS    :
+@CALLS      :
+@CREATED    : October 25, 1994 (Peter Neelin)
+@MODIFIED   : October 16, 2026 - split from copy_the_chunk
+---------------------------------------------------------------------------- */
+static void write_the_chunk(Chunk_Copy *chunk_copy, void *fill_data)
+{
+   Reshape_info *reshape_info;
+
+   reshape_info = chunk_copy->reshape_info;
+
+   /* Write out zero data if needed */
+   if (chunk_copy->zero_data) {
+      (void) ncvarput(reshape_info->outmincid, reshape_info->outimgid,
+                      chunk_copy->chunk_start, chunk_copy->chunk_count, 
+                      fill_data);
+   }
+
+   /* Write out the data (already in output order) */
+   if (chunk_copy->really_copy_the_data) {
+      (void) ncvarput(reshape_info->outmincid, reshape_info->outimgid,
+                      chunk_copy->output_start, chunk_copy->output_count, 
+                      chunk_copy->output_data);
+   }
+
+}
+
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : transpose_chunk
+@INPUT      : chunk_copy - description of the copy, with the data read
+@OUTPUT     : output_data - chunk data in output order
+@RETURNS    : TRUE if the data was copied to output_data, FALSE if the
+              chunk is already in output order.
+@DESCRIPTION: Re-orders and flips the dimensions of a chunk in memory
+              according to the output imap so that it can be written as 
+              a contiguous hyperslab rather than value by value.
+@METHOD     : The output dimension that is fastest varying in the input
+              and the fastest output dimension are copied in square tiles,
+              so that both the reads and the writes stay in cache. All 
+              other dimensions are looped over outside the tiles.
+@GLOBALS    :
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+static int transpose_chunk(Chunk_Copy *chunk_copy, void *output_data)
+{
+   int ndims, odim, fast, last, datatype_size, in_order;
+   long in_step[MAX_VAR_DIMS], out_step[MAX_VAR_DIMS];
+   long index[MAX_VAR_DIMS], *count;
+   long in_offset, out_offset;
+   long a, b, a0, b0, a1, b1, na, nb;
+   long in_a, in_b, out_a, out_b;
+   char *in_base, *out_base;
+
+   ndims = chunk_copy->reshape_info->output_ndims;
+   count = chunk_copy->output_count;
+   datatype_size = chunk_copy->datatype_size;
+   if (ndims <= 0) return FALSE;
+   last = ndims - 1;
+
+   /* Get steps in values for input and output, and check whether the 
+      chunk is already in output order */
+   in_order = TRUE;
+   for (odim=last; odim >= 0; odim--) {
+      in_step[odim] = chunk_copy->output_imap[odim] / datatype_size;
+      out_step[odim] = ((odim == last) ? 1 : 
+                        out_step[odim+1] * count[odim+1]);
+      if ((count[odim] > 1) && (in_step[odim] != out_step[odim]))
+         in_order = FALSE;
+   }
+   if (in_order) return FALSE;
+
+   /* Find the output dimension that varies fastest in the input */
+   fast = last;
+   for (odim=0; odim < last; odim++) {
+      if ((count[odim] > 1) && 
+          ((count[fast] <= 1) || (ABS(in_step[odim]) < ABS(in_step[fast]))))
+         fast = odim;
+   }
+   na = ((fast != last) ? count[fast] : 1);
+   nb = count[last];
+   in_a = in_step[fast];
+   out_a = out_step[fast];
+   in_b = in_step[last];
+   out_b = out_step[last];
+
+   /* Loop over the other dimensions */
+   for (odim=0; odim < ndims; odim++) index[odim] = 0;
+   for (;;) {
+      in_offset = 0;
+      out_offset = 0;
+      for (odim=0; odim < last; odim++) {
+         if (odim == fast) continue;
+         in_offset += index[odim] * in_step[odim];
+         out_offset += index[odim] * out_step[odim];
+      }
+      in_base = (char *) chunk_copy->output_origin + 
+         in_offset * datatype_size;
+      out_base = (char *) output_data + out_offset * datatype_size;
+
+      /* Copy a plane in tiles */
+      for (a0=0; a0 < na; a0 += TRANSPOSE_TILE) {
+         a1 = MIN(a0 + TRANSPOSE_TILE, na);
+         for (b0=0; b0 < nb; b0 += TRANSPOSE_TILE) {
+            b1 = MIN(b0 + TRANSPOSE_TILE, nb);
+
+#define COPY_TILE(type) \
+            for (a=a0; a < a1; a++) { \
+               type *in_line = (type *) in_base + a * in_a; \
+               type *out_line = (type *) out_base + a * out_a; \
+               for (b=b0; b < b1; b++) \
+                  out_line[b * out_b] = in_line[b * in_b]; \
+            }
+
+            switch (datatype_size) {
+            case 1: COPY_TILE(unsigned char); break;
+            case 2: COPY_TILE(unsigned short); break;
+            case 4: COPY_TILE(unsigned int); break;
+            case 8: COPY_TILE(double); break;
+            default:
+               for (a=a0; a < a1; a++) {
+                  for (b=b0; b < b1; b++) {
+                     (void) memcpy(out_base + 
+                                   (a * out_a + b * out_b) * datatype_size,
+                                   in_base + 
+                                   (a * in_a + b * in_b) * datatype_size,
+                                   datatype_size);
+                  }
+               }
+               break;
+            }
+#undef COPY_TILE
+
+         }
+      }
+
+      /* Go to the next plane */
+      for (odim=last-1; odim >= 0; odim--) {
+         if (odim == fast) continue;
+         index[odim]++;
+         if (index[odim] < count[odim]) break;
+         index[odim] = 0;
+      }
+      if (odim < 0) break;
+   }
+
+   return TRUE;
+}
 
-      /* Read in the data */
-      (void) miicv_get(reshape_info->icvid, input_start, input_count, 
-                       chunk_data);
-   
-      /* Write it out */
-      (void) ncvarputg(reshape_info->outmincid, reshape_info->outimgid,
-                       output_start, output_count, NULL, output_imap, 
-                       output_origin);
+/* ----------------------------- MNI Header -----------------------------------
+@NAME       : fill_buffer
+@INPUT      : nvalues - number of values in buffer
+              value - pointer to the value to fill with
+              value_size - size of the value in bytes
+@OUTPUT     : buffer - buffer to fill
+@RETURNS    : (nothing)
+@DESCRIPTION: Fills a buffer with copies of a value.
+@METHOD     : A value that is all zero bytes is set with memset, otherwise
+              the filled part of the buffer is doubled with each memcpy.
+@GLOBALS    :
+@CALLS      :
+@CREATED    : October 16, 2026
+@MODIFIED   :
+---------------------------------------------------------------------------- */
+static void fill_buffer(void *buffer, long nvalues, 
+                        void *value, int value_size)
+{
+   long total_bytes, done_bytes, nbytes;
+   int ibyte, is_zero;
 
+   if (nvalues <= 0) return;
+   total_bytes = nvalues * value_size;
+
+   is_zero = TRUE;
+   for (ibyte=0; ibyte < value_size; ibyte++) {
+      if (((char *) value)[ibyte] != 0) is_zero = FALSE;
+   }
+   if (is_zero) {
+      (void) memset(buffer, 0, total_bytes);
+      return;
    }
 
+   (void) memcpy(buffer, value, value_size);
+   done_bytes = value_size;
+   while (done_bytes < total_bytes) {
+      nbytes = MIN(done_bytes, total_bytes - done_bytes);
+      (void) memcpy((char *) buffer + done_bytes, buffer, nbytes);
+      done_bytes += nbytes;
+   }
 }
 
 /* ----------------------------- MNI Header -----------------------------------
@@ -219,6 +219,7 @@ static void get_arginfo(int argc, char *argv[],
    static long hs_count[MAX_VAR_DIMS] = {LONG_MIN};
    static double fillvalue = NOFILL;
    static int max_chunk_size_in_kb = DEFAULT_MAX_CHUNK_SIZE_IN_KB;
+   static int pipeline = FALSE;
 #if MINC2
    static int minc2_format = 0;
 #endif /* MINC2 */
@@ -239,6 +240,10 @@ static void get_arginfo(int argc, char *argv[],
       {"-max_chunk_size_in_kb", ARGV_INT, (char *) 0, 
           (char *) &max_chunk_size_in_kb,
           "Specify the maximum size of the copy buffer (in kbytes)."},
+      {"-pipeline", ARGV_CONSTANT, (char *) TRUE, (char *) &pipeline,
+          "Re-order each chunk in a separate thread while the next one\n\t\tis read and the previous one written."},
+      {"-nopipeline", ARGV_CONSTANT, (char *) FALSE, (char *) &pipeline,
+          "Read, re-order and write chunks in turn (default)."},
 #if MINC2
       {"-2", ARGV_CONSTANT, (char *) TRUE, (char *)&minc2_format,
        "Produce a MINC 2.0 format output file."},
@@ -499,6 +504,14 @@ static void get_arginfo(int argc, char *argv[],
    reshape_info->outmincid = micreate(outfile, cflags);
    setup_output_file(reshape_info->outmincid, history, reshape_info);
 
+   /* Only the in-memory re-ordering of chunks is done in a separate 
+      thread; all reading and writing stays in this one */
+#ifdef HAVE_PTHREAD
+   reshape_info->pipeline = pipeline;
+#else
+   reshape_info->pipeline = FALSE;
+#endif
+
    return;
 }
 
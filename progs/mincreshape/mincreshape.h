@@ -94,6 +94,7 @@ typedef struct {
                                         means fill with real value zero) */
    int do_block_normalization;       /* Normalize slices to block max/min */
    int do_icv_normalization;         /* Use icv for normalization */
+   int pipeline;                     /* Re-order chunks in a thread */
 
    /* Note that a block is a hyperslab of the output volume in which all
       values are normalized the same way. A chunk is a hyperslab that is
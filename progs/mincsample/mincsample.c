@@ -37,9 +37,34 @@
 #define WORLD_NDIMS 3
 #define DEFAULT_INT -1
 
+/* most characters written for a value in ascii ("%.20g\t") */
+#define MAX_ASCII_VALUE_LENGTH 32
+
 /* typedefs */
 typedef enum { SAMPLE_ALL, SAMPLE_RND } Sample_enum;
-typedef enum { OUTPUT_ASCII, OUTPUT_DOUBLE } Output_enum;
+typedef enum { OUTPUT_ASCII, OUTPUT_DOUBLE, OUTPUT_FLOAT } Output_enum;
+
+/* an output stream of samples, for the voxels of one mask value */
+typedef struct {
+   double   label;
+   char    *fname;
+   FILE    *outFP;
+
+   /* output buffer */
+   char    *buffer;
+   size_t   buffer_used;
+
+   /* kept samples (n_cols values each) and the voxels they came from */
+   long     n_kept;
+   long     n_alloc;
+   double  *samples;
+   long    *sample_vox;
+
+   /* random sampling state (Algorithm L) */
+   double   n_seen;
+   double   next_sample;
+   double   w;
+   } Sample_Stream;
 
 typedef struct {
    Sample_enum sample_type;
@@ -51,7 +76,6 @@ typedef struct {
 
    /* sampling */
    int      rand_samples;
-   int      max_samples;
 
    /* output parameters */
    int      sample_mask;
@@ -59,19 +83,56 @@ typedef struct {
 
    Output_enum output_type;
    int      output_coords;
-   FILE    *outFP;
+   int      output_columns;
+
+   /* output streams */
+   int      n_streams;
+   Sample_Stream *streams;
+   int      n_cols;
+   size_t   buffer_size;
+   double  *record;
+
+   /* running voxel count and sorted list of chosen voxels */
+   long     n_vox;
+   long    *chosen;
+   long     n_chosen;
+   long     next_chosen;
    } Loop_Data;
 
+/* a label and output file given on the command line */
+typedef struct {
+   double   label;
+   char    *fname;
+   } Label_Outfile;
+
+/* kept sample and the voxel it came from, for sorting */
+typedef struct {
+   long     vox;
+   long     slot;
+   } Sample_Order;
+
 /* function prototypes */
-void     count_points(void *caller_data, long num_voxels, int input_num_buffers,
-                      int input_vector_length, double *input_data[],
-                      int output_num_buffers, int output_vector_length,
-                      double *output_data[], Loop_Info * loop_info);
 void     get_points(void *caller_data, long num_voxels, int input_num_buffers,
                     int input_vector_length, double *input_data[], int output_num_buffers,
                     int output_vector_length, double *output_data[],
                     Loop_Info * loop_info);
-void     write_data(FILE * fp, double value, Output_enum ot);
+void     mark_points(void *caller_data, long num_voxels, int input_num_buffers,
+                     int input_vector_length, double *input_data[],
+                     int output_num_buffers, int output_vector_length,
+                     double *output_data[], Loop_Info * loop_info);
+int      get_label_outfile(char *dst, char *key, int argc, char **argv);
+void     open_stream(Loop_Data * md, Sample_Stream * stream, char *prog);
+void     open_stream_file(Sample_Stream * stream, char *prog);
+void     make_record(Loop_Data * md, double *input_data[], int n_infiles, long ivox,
+                     Loop_Info * loop_info);
+long     reservoir_slot(Loop_Data * md, Sample_Stream * stream);
+void     keep_sample(Loop_Data * md, Sample_Stream * stream, long slot, long vox);
+void     put_value(Loop_Data * md, Sample_Stream * stream, double value);
+void     write_sample(Loop_Data * md, Sample_Stream * stream, double *record);
+void     flush_stream(Sample_Stream * stream);
+void     finish_stream(Loop_Data * md, Sample_Stream * stream, char *prog);
+int      compare_samples(const void *a, const void *b);
+int      compare_voxels(const void *a, const void *b);
 void     get_minc_attribute(int mincid, char *varname, char *attname,
                             int maxvals, double vals[]);
 int      get_minc_ndims(int mincid);
@@ -99,13 +160,16 @@ static char *sample_fname = NULL;
 static char *out_fname = NULL;
 static int append_output = FALSE;
 static int rand_seed = DEFAULT_INT;
+static Label_Outfile *label_outfiles = NULL;
+static int n_label_outfiles = 0;
 static Loop_Data md = {
    SAMPLE_ALL,
    FALSE, 1.0, 0,
-   0, 0,
+   0,
    FALSE, 0,
-   OUTPUT_ASCII, FALSE,
-   NULL
+   OUTPUT_ASCII, FALSE, FALSE,
+   0, NULL, 0, 0, NULL,
+   0, NULL, 0, 0
    };
 
 static ArgvInfo argTable[] = {
@@ -139,12 +203,18 @@ static ArgvInfo argTable[] = {
     "Output a <mask.mnc> file of chosen points"},
    {"-outfile", ARGV_STRING, (char *)1, (char *)&out_fname,
     "<file> for output data (Default: stdout)"},
+   {"-label_outfile", ARGV_GENFUNC, (char *)get_label_outfile, (char *)NULL,
+    "<value> <file>: output data for mask value <value> to <file> (can be repeated)"},
    {"-append", ARGV_CONSTANT, (char *)TRUE, (char *)&append_output,
     "append output data to existing file"},
    {"-ascii", ARGV_CONSTANT, (char *)OUTPUT_ASCII, (char *)&md.output_type,
     "Write out data as ascii strings (default)"},
    {"-double", ARGV_CONSTANT, (char *)OUTPUT_DOUBLE, (char *)&md.output_type,
     "Write out data as double precision floating-point values"},
+   {"-float", ARGV_CONSTANT, (char *)OUTPUT_FLOAT, (char *)&md.output_type,
+    "Write out data as single precision floating-point values"},
+   {"-columns", ARGV_CONSTANT, (char *)TRUE, (char *)&md.output_columns,
+    "Write out binary data a column at a time (all of each file in turn)"},
    {"-coords", ARGV_CONSTANT, (char *)TRUE, (char *)&md.output_coords,
     "Write out world co-ordinates as well as values"},
 
@@ -162,6 +232,7 @@ int main(int argc, char *argv[])
    int      mincid;
    struct timeval timer;
    int      i;
+   long     j;
 
    /* Save time stamp and args */
    arg_string = time_stamp(argc, argv);
@@ -188,6 +259,24 @@ int main(int argc, char *argv[])
       fprintf(stderr, "%s: -rand_seed (%d) must be 0 or greater\n\n", argv[0], rand_seed);
       exit(EXIT_FAILURE);
       }
+   if(md.output_columns && md.output_type == OUTPUT_ASCII){
+      fprintf(stderr, "%s: -columns needs -double or -float output\n\n", argv[0]);
+      exit(EXIT_FAILURE);
+      }
+   if(n_label_outfiles > 0 && (mask_fname == NULL || out_fname != NULL)){
+      fprintf(stderr, "%s: -label_outfile needs -mask and cannot be used with -outfile\n\n",
+              argv[0]);
+      exit(EXIT_FAILURE);
+      }
+   for(i = 0, j = 0; i < n_label_outfiles; i++){
+      if(strcmp(label_outfiles[i].fname, "-") == 0){
+         j++;
+         }
+      }
+   if(j > 1){
+      fprintf(stderr, "%s: only one -label_outfile can be written to stdout\n\n", argv[0]);
+      exit(EXIT_FAILURE);
+      }
 
    /* get infile names */
    n_infiles = argc - 1;
@@ -226,22 +315,31 @@ int main(int argc, char *argv[])
       n_outfiles = 0;
       }
 
-   /* set up data outfile */
-   if(out_fname == NULL || strcmp(out_fname, "-") == 0){
-      md.outFP = stdout;
+   /* set up the data outfile(s), one for each label or just the one */
+   md.n_cols = ((md.masking) ? n_infiles - 1 : n_infiles) +
+      ((md.output_coords) ? WORLD_NDIMS : 0);
+   md.buffer_size = (size_t)1024 * max_buffer;
+   if(md.buffer_size < (size_t)(md.n_cols + 1) * MAX_ASCII_VALUE_LENGTH){
+      md.buffer_size = (size_t)(md.n_cols + 1) * MAX_ASCII_VALUE_LENGTH;
       }
-   else {
-      if(!append_output && access(out_fname, F_OK) == 0 && !clobber){
-         fprintf(stderr, "%s: %s exists, use -clobber to overwrite\n\n", argv[0],
-                 out_fname);
-         exit(EXIT_FAILURE);
-         }
-
-      if((md.outFP = fopen(out_fname, (append_output) ? "a" : "w")) == NULL){
-         fprintf(stderr, "%s:  problems opening %s\n", argv[0], out_fname);
-         exit(EXIT_FAILURE);
+   md.record = (double *)malloc(sizeof(double) * md.n_cols);
+   if(n_label_outfiles > 0){
+      md.n_streams = n_label_outfiles;
+      md.streams = (Sample_Stream *) malloc(sizeof(Sample_Stream) * md.n_streams);
+      for(i = 0; i < md.n_streams; i++){
+         md.streams[i].label = label_outfiles[i].label;
+         md.streams[i].fname = label_outfiles[i].fname;
          }
       }
+   else {
+      md.n_streams = 1;
+      md.streams = (Sample_Stream *) malloc(sizeof(Sample_Stream));
+      md.streams[0].label = md.mask_val;
+      md.streams[0].fname = out_fname;
+      }
+   for(i = 0; i < md.n_streams; i++){
+      open_stream(&md, &md.streams[i], argv[0]);
+      }
 
    /* Get some information from the first file for printing co-ordinates */
    mincid = miopen(infiles[0], NC_NOWRITE | 0x8000);
@@ -259,19 +357,6 @@ int main(int argc, char *argv[])
    if(md.sample_type == SAMPLE_RND){
       void    *tmp = NULL;             /* for gettimeofday */
 
-      /* get max number of samples */
-      voxel_loop(1, (md.masking) ? &mask_fname : infiles, 0, NULL, NULL,
-                 loop_opts, count_points, (void *)&md);
-      if(verbose){
-         fprintf(stderr, " | Got max # of points: %d\n", md.max_samples);
-         }
-
-      if(md.rand_samples > md.max_samples){
-         fprintf(stderr, "%s: -rand_samples (%d) must be less than max samples (%d)\n\n",
-                 argv[0], md.rand_samples, md.max_samples);
-         exit(EXIT_FAILURE);
-         }
-
       /* initialise random number generator */
       if(rand_seed == DEFAULT_INT){
          gettimeofday(&timer, tmp);
@@ -285,174 +370,459 @@ int main(int argc, char *argv[])
       init_genrand((unsigned long)rand_seed);
       }
 
-   /* do the sampling */
-   voxel_loop(n_infiles, infiles, n_outfiles, outfiles, arg_string,
-              loop_opts, get_points, (void *)&md);
+   /* do the sampling, random samples are only known at the end so */
+   /* the sample mask is written afterwards                        */
+   md.n_vox = 0;
+   voxel_loop(n_infiles, infiles, (md.sample_type == SAMPLE_RND) ? 0 : n_outfiles,
+              outfiles, arg_string, loop_opts, get_points, (void *)&md);
+
+   /* check that there were enough points for the random samples of */
+   /* every stream before any output file is touched               */
+   if(md.sample_type == SAMPLE_RND){
+      for(i = 0; i < md.n_streams; i++){
+         if(md.streams[i].n_kept < md.rand_samples){
+            fprintf(stderr, "%s: -random_samples (%d) is more than the %ld points found",
+                    argv[0], md.rand_samples, md.streams[i].n_kept);
+            if(md.masking){
+               fprintf(stderr, " for mask value %g", md.streams[i].label);
+               }
+            fprintf(stderr, "\n\n");
+            exit(EXIT_FAILURE);
+            }
+         }
+      }
+
+   /* write out the kept samples and tidy up */
+   for(i = 0; i < md.n_streams; i++){
+      finish_stream(&md, &md.streams[i], argv[0]);
+      }
+
+   /* write the sample mask for random samples */
+   if(md.sample_type == SAMPLE_RND && md.sample_mask){
+      md.n_chosen = 0;
+      for(i = 0; i < md.n_streams; i++){
+         md.n_chosen += md.streams[i].n_kept;
+         }
+      md.chosen = (long *)malloc(sizeof(long) * (md.n_chosen + 1));
+      md.n_chosen = 0;
+      for(i = 0; i < md.n_streams; i++){
+         for(j = 0; j < md.streams[i].n_kept; j++){
+            md.chosen[md.n_chosen++] = md.streams[i].sample_vox[j];
+            }
+         }
+      qsort(md.chosen, md.n_chosen, sizeof(long), compare_voxels);
+
+      md.n_vox = 0;
+      md.next_chosen = 0;
+      voxel_loop(1, infiles, n_outfiles, outfiles, arg_string,
+                 loop_opts, mark_points, (void *)&md);
+      free(md.chosen);
+      }
+   for(i = 0; i < md.n_streams; i++){
+      free(md.streams[i].sample_vox);
+      }
 
-   /* tidy up */
-   fclose(md.outFP);
    free_loop_options(loop_opts);
 
    return (EXIT_SUCCESS);
    }
 
-/* get points from file(s), write out to an input FP */
+/* get points from file(s), write out to the output stream(s) */
 void get_points(void *caller_data, long num_voxels, int input_num_buffers,
                 int input_vector_length, double *input_data[], int output_num_buffers,
                 int output_vector_length, double *output_data[], Loop_Info * loop_info)
 {
    Loop_Data *md = (Loop_Data *) caller_data;
-   int      i, idim, ivox;
+   Sample_Stream *stream;
+   int      i, ivox;
    int      n_infiles;
-   int      do_sample;
+   int      have_record;
+   long     vox, slot;
    double   mask_value;
-   int      dim_index;
-   long     index[MAX_VAR_DIMS];
-   double   voxel_coord[WORLD_NDIMS];
-   double   world_coord[WORLD_NDIMS];
 
    /* shut the compiler up */
-   (void)output_num_buffers;
    (void)output_vector_length;
 
    n_infiles = (md->masking) ? input_num_buffers - 1 : input_num_buffers;
 
    /* for each voxel */
    for(ivox = 0; ivox < num_voxels * input_vector_length; ivox++){
-
-      /* nasty way that works for masking or not */
+      vox = md->n_vox++;
+      have_record = FALSE;
       mask_value = 0;
-      if(!md->masking ||
-         (md->masking && fabs(input_data[md->mask_idx][ivox] - md->mask_val) < 0.5)){
 
-         /* flag to sample */
-         do_sample = FALSE;
+      /* for each stream with this mask value */
+      for(i = 0; i < md->n_streams; i++){
+         stream = &md->streams[i];
+         if(md->masking && fabs(input_data[md->mask_idx][ivox] - stream->label) >= 0.5){
+            continue;
+            }
 
          switch (md->sample_type){
          case SAMPLE_ALL:
-            do_sample = TRUE;
+            if(!have_record){
+               make_record(md, input_data, n_infiles, ivox, loop_info);
+               have_record = TRUE;
+               }
+            if(md->output_columns){
+               keep_sample(md, stream, stream->n_kept, vox);
+               }
+            else {
+               write_sample(md, stream, md->record);
+               }
             mask_value = 1.0;
             break;
 
          case SAMPLE_RND:
-            /* if this voxel 'qualifies', write out data */
-            if(genrand_res53() < ((double)md->rand_samples / md->max_samples)){
-               md->rand_samples--;
-               do_sample = TRUE;
-               mask_value = 1.0;
+            /* if this voxel 'qualifies', keep it in place of another */
+            slot = reservoir_slot(md, stream);
+            if(slot >= 0){
+               if(!have_record){
+                  make_record(md, input_data, n_infiles, ivox, loop_info);
+                  have_record = TRUE;
+                  }
+               keep_sample(md, stream, slot, vox);
                }
-
-            md->max_samples--;
             break;
 
          default:
             fprintf(stderr, "ERROR - Sample type is undefined (%d)\n", md->sample_type);
             exit(EXIT_FAILURE);
             }
-
-         /* now write out the data */
-         if(do_sample){
-
-            /* get and convert voxel to world coordinates */
-            if(md->output_coords){
-               get_info_voxel_index(loop_info, ivox, file_ndims, index);
-               for(idim = 0; idim < WORLD_NDIMS; idim++){
-                  dim_index = space_to_dim[idim];
-                  if(dim_index >= 0){
-                     voxel_coord[idim] = index[dim_index];
-                     }
-                  }
-               transform_coord(world_coord, voxel_to_world, voxel_coord);
-               }
-
-            switch (md->output_type){
-            case OUTPUT_ASCII:
-               if(md->output_coords){
-                  fprintf(md->outFP, "%.20g\t%.20g\t%.20g\t", world_coord[0],
-                          world_coord[1], world_coord[2]);
-                  }
-
-               for(i = 0; i < n_infiles; i++){
-                  fprintf(md->outFP, "%.20g\t", input_data[i][ivox]);
-                  }
-               fprintf(md->outFP, "\n");
-               break;
-
-            case OUTPUT_DOUBLE:
-               if(md->output_coords){
-                  fwrite(&(world_coord[0]), sizeof(double), 1, md->outFP);
-                  fwrite(&(world_coord[1]), sizeof(double), 1, md->outFP);
-                  fwrite(&(world_coord[2]), sizeof(double), 1, md->outFP);
-                  }
-
-               for(i = 0; i < n_infiles; i++){
-                  fwrite(&(input_data[i][ivox]), sizeof(double), 1, md->outFP);
-                  }
-
-               break;
-
-            default:
-               fprintf(stderr, "ERROR - Output type is undefined (%d)\n",
-                       md->output_type);
-               exit(EXIT_FAILURE);
-               }
-            }
-
          }
 
       /* output sampling mask */
-      if(md->sample_mask){
+      if(md->sample_mask && output_num_buffers > 0){
          output_data[md->sample_mask_idx][ivox] = mask_value;
          }
       }
 
    }
 
-/* count points that are within a mask */
-void count_points(void *caller_data, long num_voxels, int input_num_buffers,
-                  int input_vector_length, double *input_data[],
-                  int output_num_buffers, int output_vector_length,
-                  double *output_data[], Loop_Info * loop_info)
+/* write out the sampling mask from the sorted list of chosen voxels */
+void mark_points(void *caller_data, long num_voxels, int input_num_buffers,
+                 int input_vector_length, double *input_data[],
+                 int output_num_buffers, int output_vector_length,
+                 double *output_data[], Loop_Info * loop_info)
 {
    Loop_Data *md = (Loop_Data *) caller_data;
    int      ivox;
+   long     vox;
 
    /* shut the compiler up */
    (void)input_num_buffers;
+   (void)input_data;
    (void)output_num_buffers;
    (void)output_vector_length;
-   (void)output_data;
    (void)loop_info;
 
    for(ivox = 0; ivox < num_voxels * input_vector_length; ivox++){
-      if(md->masking){
-         if(fabs(input_data[0][ivox] - md->mask_val) < 0.5){
-            md->max_samples++;
+      vox = md->n_vox++;
+      output_data[md->sample_mask_idx][ivox] = 0.0;
+      while(md->next_chosen < md->n_chosen && md->chosen[md->next_chosen] <= vox){
+         if(md->chosen[md->next_chosen] == vox){
+            output_data[md->sample_mask_idx][ivox] = 1.0;
+            }
+         md->next_chosen++;
+         }
+      }
+   }
+
+/* get a <value> <file> pair for -label_outfile */
+int get_label_outfile(char *dst, char *key, int argc, char **argv)
+{
+   char    *end;
+   int      iarg;
+
+   /* shut the compiler up */
+   (void)dst;
+
+   if(argc < 2){
+      fprintf(stderr, "\"%s\" option requires 2 additional arguments\n", key);
+      exit(EXIT_FAILURE);
+      }
+
+   label_outfiles = (Label_Outfile *) realloc(label_outfiles,
+                                              sizeof(Label_Outfile) *
+                                              (n_label_outfiles + 1));
+   label_outfiles[n_label_outfiles].label = strtod(argv[0], &end);
+   if(end == argv[0] || *end != '\0'){
+      fprintf(stderr, "\"%s\" expects a mask value, but got \"%s\"\n", key, argv[0]);
+      exit(EXIT_FAILURE);
+      }
+   label_outfiles[n_label_outfiles].fname = argv[1];
+   n_label_outfiles++;
+
+   /* remove the arguments */
+   for(iarg = 0; iarg < argc - 2; iarg++){
+      argv[iarg] = argv[iarg + 2];
+      }
+
+   return argc - 2;
+   }
+
+/* set up the buffers of a stream and open its output file, random */
+/* samples are only written at the end so their file is opened then */
+void open_stream(Loop_Data * md, Sample_Stream * stream, char *prog)
+{
+   stream->outFP = NULL;
+   if(stream->fname != NULL && strcmp(stream->fname, "-") != 0 &&
+      !append_output && access(stream->fname, F_OK) == 0 && !clobber){
+      fprintf(stderr, "%s: %s exists, use -clobber to overwrite\n\n", prog,
+              stream->fname);
+      exit(EXIT_FAILURE);
+      }
+   if(md->sample_type != SAMPLE_RND){
+      open_stream_file(stream, prog);
+      }
+
+   stream->buffer = (char *)malloc(md->buffer_size);
+   stream->buffer_used = 0;
+
+   /* random samples are kept until the end */
+   stream->n_kept = 0;
+   stream->n_alloc = 0;
+   stream->samples = NULL;
+   stream->sample_vox = NULL;
+   if(md->sample_type == SAMPLE_RND){
+      stream->n_alloc = md->rand_samples;
+      stream->samples = (double *)malloc(sizeof(double) * md->n_cols * stream->n_alloc);
+      stream->sample_vox = (long *)malloc(sizeof(long) * stream->n_alloc);
+      }
+   stream->n_seen = 0;
+   stream->next_sample = 0;
+   stream->w = 0;
+   }
+
+/* open the output file of a stream */
+void open_stream_file(Sample_Stream * stream, char *prog)
+{
+   if(stream->fname == NULL || strcmp(stream->fname, "-") == 0){
+      stream->outFP = stdout;
+      }
+   else if((stream->outFP = fopen(stream->fname, (append_output) ? "a" : "w")) == NULL){
+      fprintf(stderr, "%s:  problems opening %s\n", prog, stream->fname);
+      exit(EXIT_FAILURE);
+      }
+   }
+
+/* gather the (world co-ordinates and) values of a voxel into md->record */
+void make_record(Loop_Data * md, double *input_data[], int n_infiles, long ivox,
+                 Loop_Info * loop_info)
+{
+   int      i, idim;
+   int      dim_index;
+   long     index[MAX_VAR_DIMS];
+   double   voxel_coord[WORLD_NDIMS];
+   double   world_coord[WORLD_NDIMS];
+   double  *value;
+
+   value = md->record;
+
+   /* get and convert voxel to world coordinates */
+   if(md->output_coords){
+      get_info_voxel_index(loop_info, ivox, file_ndims, index);
+      for(idim = 0; idim < WORLD_NDIMS; idim++){
+         dim_index = space_to_dim[idim];
+         if(dim_index >= 0){
+            voxel_coord[idim] = index[dim_index];
             }
          }
-      else {
-         md->max_samples++;
+      transform_coord(world_coord, voxel_to_world, voxel_coord);
+      for(idim = 0; idim < WORLD_NDIMS; idim++){
+         *value++ = world_coord[idim];
+         }
+      }
+
+   for(i = 0; i < n_infiles; i++){
+      *value++ = input_data[i][ivox];
+      }
+   }
+
+/* Algorithm L reservoir sampling (Li 1994): returns the slot in which */
+/* to keep the next voxel of a stream, or -1 to skip it. Rather than a */
+/* random number for every voxel, the number of voxels to skip is      */
+/* drawn each time one is kept                                         */
+long reservoir_slot(Loop_Data * md, Sample_Stream * stream)
+{
+   double   k, i, skip;
+   long     slot;
+
+   k = md->rand_samples;
+   i = stream->n_seen;
+   stream->n_seen += 1;
+
+   /* fill the reservoir */
+   if(i < k){
+      slot = (long)i;
+      if(i == k - 1){
+         stream->w = exp(log(1.0 - genrand_res53()) / k);
+         }
+      }
+
+   /* skip voxels until the next one to keep */
+   else if(i < stream->next_sample){
+      return -1;
+      }
+   else {
+      slot = (long)(genrand_res53() * k);
+      stream->w *= exp(log(1.0 - genrand_res53()) / k);
+      }
+
+   /* find the next voxel to keep */
+   if(i >= k - 1){
+      skip = floor(log(1.0 - genrand_res53()) / log(1.0 - stream->w));
+      if(!(skip >= 0.0)){
+         skip = 0.0;
+         }
+      stream->next_sample = i + skip + 1;
+      }
+
+   return slot;
+   }
+
+/* keep md->record in a slot of a stream, growing it if needed */
+void keep_sample(Loop_Data * md, Sample_Stream * stream, long slot, long vox)
+{
+   if(slot >= stream->n_alloc){
+      stream->n_alloc = (stream->n_alloc > 0) ? 2 * stream->n_alloc : 1024;
+      stream->samples = (double *)realloc(stream->samples, sizeof(double) *
+                                          md->n_cols * stream->n_alloc);
+      stream->sample_vox = (long *)realloc(stream->sample_vox,
+                                           sizeof(long) * stream->n_alloc);
+      if(stream->samples == NULL || stream->sample_vox == NULL){
+         fprintf(stderr, "ERROR - out of memory keeping samples\n");
+         exit(EXIT_FAILURE);
          }
       }
+
+   memcpy(&stream->samples[slot * md->n_cols], md->record, sizeof(double) * md->n_cols);
+   stream->sample_vox[slot] = vox;
+   if(slot >= stream->n_kept){
+      stream->n_kept = slot + 1;
+      }
    }
 
-inline void write_data(FILE * fp, double value, Output_enum ot)
+/* add a value to the output buffer of a stream */
+void put_value(Loop_Data * md, Sample_Stream * stream, double value)
 {
-   switch (ot){
+   float    fvalue;
+
+   if(stream->buffer_used + MAX_ASCII_VALUE_LENGTH > md->buffer_size){
+      flush_stream(stream);
+      }
+
+   switch (md->output_type){
    case OUTPUT_ASCII:
-      fprintf(fp, "%.20g\n", value);
+      stream->buffer_used += sprintf(&stream->buffer[stream->buffer_used],
+                                     "%.20g\t", value);
       break;
 
    case OUTPUT_DOUBLE:
-      fwrite(&(value), sizeof(double), 1, fp);
+      memcpy(&stream->buffer[stream->buffer_used], &value, sizeof(double));
+      stream->buffer_used += sizeof(double);
+      break;
+
+   case OUTPUT_FLOAT:
+      fvalue = (float)value;
+      memcpy(&stream->buffer[stream->buffer_used], &fvalue, sizeof(float));
+      stream->buffer_used += sizeof(float);
       break;
 
    default:
-      fprintf(stderr, "ERROR - Output type is undefined (%d)\n", ot);
+      fprintf(stderr, "ERROR - Output type is undefined (%d)\n", md->output_type);
       exit(EXIT_FAILURE);
       }
    }
 
+/* write a sample (a row of values) to a stream */
+void write_sample(Loop_Data * md, Sample_Stream * stream, double *record)
+{
+   int      i;
+
+   for(i = 0; i < md->n_cols; i++){
+      put_value(md, stream, record[i]);
+      }
+   if(md->output_type == OUTPUT_ASCII){
+      stream->buffer[stream->buffer_used++] = '\n';
+      }
+   }
+
+/* write out the buffer of a stream */
+void flush_stream(Sample_Stream * stream)
+{
+   if(stream->buffer_used > 0){
+      if(fwrite(stream->buffer, 1, stream->buffer_used, stream->outFP) !=
+         stream->buffer_used){
+         fprintf(stderr, "ERROR - problems writing output data\n");
+         exit(EXIT_FAILURE);
+         }
+      stream->buffer_used = 0;
+      }
+   }
+
+/* write out the kept samples of a stream in file order and close it */
+void finish_stream(Loop_Data * md, Sample_Stream * stream, char *prog)
+{
+   Sample_Order *order;
+   long     j;
+   int      i;
+
+   if(stream->outFP == NULL){
+      open_stream_file(stream, prog);
+      }
+   if(verbose){
+      fprintf(stderr, " | Got %ld samples for %s\n", stream->n_kept,
+              (stream->fname == NULL) ? "stdout" : stream->fname);
+      }
+
+   /* random samples are in no particular order */
+   order = (Sample_Order *) malloc(sizeof(Sample_Order) * (stream->n_kept + 1));
+   for(j = 0; j < stream->n_kept; j++){
+      order[j].vox = stream->sample_vox[j];
+      order[j].slot = j;
+      }
+   if(md->sample_type == SAMPLE_RND){
+      qsort(order, stream->n_kept, sizeof(Sample_Order), compare_samples);
+      }
+
+   if(md->output_columns){
+      for(i = 0; i < md->n_cols; i++){
+         for(j = 0; j < stream->n_kept; j++){
+            put_value(md, stream, stream->samples[order[j].slot * md->n_cols + i]);
+            }
+         }
+      }
+   else {
+      for(j = 0; j < stream->n_kept; j++){
+         write_sample(md, stream, &stream->samples[order[j].slot * md->n_cols]);
+         }
+      }
+   free(order);
+
+   flush_stream(stream);
+   fclose(stream->outFP);
+   free(stream->buffer);
+   free(stream->samples);
+   }
+
+/* qsort comparisons for kept samples and voxel indices */
+int compare_samples(const void *a, const void *b)
+{
+   long     va = ((Sample_Order *) a)->vox;
+   long     vb = ((Sample_Order *) b)->vox;
+
+   return (va > vb) - (va < vb);
+   }
+
+int compare_voxels(const void *a, const void *b)
+{
+   long     va = *(long *)a;
+   long     vb = *(long *)b;
+
+   return (va > vb) - (va < vb);
+   }
+
 void normalize_vector(double vector[])
 {
    int      idim;
@@ -115,6 +115,9 @@
  *               Where P(i) is the bin probability
  * PctT     - The threshold needed for a particular "Critical percentage" of
  *               of a histogram.
+ * Quantile - Exact quantiles, found from a sorted list of the distinct
+ *               values and their counts that is built in the same pass.
+ *               -exact uses these for Median and PctT as well.
  */
 
 #include "config.h"
@@ -130,6 +133,7 @@
 #include <ctype.h>
 #include <ParseArgv.h>
 #include <voxel_loop.h>
+#include <parallel_voxel_loop.h>
 
 #ifndef TRUE
 #  define TRUE  1
@@ -140,6 +144,8 @@
 #define WORLD_NDIMS 3
 #define DEFAULT_VIO_BOOL (-1)
 #define BINS_DEFAULT 2000
+#define VALUE_BUFFER_SIZE 65536
+#define MAX_LABELS 1048576
 
 /* Double_Array structure */
 typedef struct {
@@ -147,6 +153,17 @@ typedef struct {
    double  *values;
 } Double_Array;
 
+/* Sorted list of distinct values and their counts, with a buffer of new
+   values that have not yet been sorted into it */
+typedef struct {
+   long     nbuffer;
+   long     buffer_alloc;
+   double  *buffer;
+   long     nruns;
+   double  *run_value;
+   double  *run_count;
+} Value_List;
+
 /* Stats structure */
 typedef struct {
    double   vol_range[2];
@@ -172,8 +189,21 @@ typedef struct {
    double   biModalT;
    double   pct_T;
    double   entropy;
+   Value_List *values;
+   double   *quantile;
 } Stats_Info;
 
+/* Table of stats for each range and mask. With -label_stats there is a
+   slot for each label seen so far, found through label_slot (-1 for
+   labels that have not been seen) */
+typedef struct {
+   Stats_Info **stats;
+   long     nslots;
+   long     slots_alloc;
+   long    *label_slot;
+   long    *slot_label;
+} Stats_Table;
+
 /* Function prototypes */
 void     do_math(void *caller_data, long num_voxels, int input_num_buffers,
                  int input_vector_length, double *input_data[], int output_num_buffers,
@@ -198,11 +228,27 @@ void     verify_range_options(Double_Array * min, Double_Array * max,
                               Double_Array * range, Double_Array * binvalue);
 void     init_stats(Stats_Info * stats, int hist_bins);
 void     free_stats(Stats_Info * stats);
+Stats_Table *new_stats_table(void);
+void     free_stats_table(Stats_Table * table);
+long     get_label_slot(Stats_Table * table, long ilabel);
+void     merge_stats(Stats_Info * stats, Stats_Info * other);
+Value_List *new_value_list(void);
+void     free_value_list(Value_List * list);
+void     add_value(Value_List * list, double value);
+void     flush_value_list(Value_List * list);
+void     merge_value_runs(Value_List * list, long nruns,
+                          double run_value[], double run_count[]);
+void     merge_value_lists(Value_List * list, Value_List * other);
+double   get_quantile(Value_List * list, double fraction);
+void     print_label_stats(Stats_Info * stats, long label);
+void     print_label_column(Stats_Info * stats, char *name, double value);
+int      compare_doubles(const void *a, const void *b);
 
 /* Argument variables */
 int      max_buffer_size_in_kb = 4 * 1024;
 
 static int verbose = FALSE;
+static int nthreads = 1;
 static int quiet = FALSE;
 static int clobber = FALSE;
 static int ignoreNaN = DEFAULT_VIO_BOOL;
@@ -232,6 +278,10 @@ static int PctT = FALSE;
 static double pctT = 0.0;
 static int Entropy = FALSE;
 
+static Double_Array quantiles = { 0, NULL };
+static int Exact = FALSE;
+static int Keep_Values = FALSE;
+
 /* Alternative methods of calculating the bimodal threshold */
 #define BMT_OTSU 1              /* Otsu algorithm (default) */
 #define BMT_KITTLER 2           /* Kittler-Illingworth algorithm */
@@ -250,7 +300,9 @@ static Double_Array mask_min = { 0, NULL };
 static Double_Array mask_max = { 0, NULL };
 static Double_Array mask_range = { 0, NULL };
 static Double_Array mask_binvalue = { 0, NULL };
-static int num_masks;
+static long num_masks;
+static int label_stats = FALSE;
+static long label_min = 0;
 
 char    *hist_file;
 static int hist_bins = BINS_DEFAULT;
@@ -261,7 +313,7 @@ static int integer_histogram = FALSE;
 static int max_bins = 65536;
 
 /* Global Variables to store info for stats */
-Stats_Info **stats_info = NULL;
+Stats_Table *stats_table = NULL;
 double   voxel_volume;
 double   nvoxels;
 int      space_to_dim[WORLD_NDIMS] = { -1, -1, -1 };
@@ -282,6 +334,8 @@ static ArgvInfo argTable[] = {
    {"-max_buffer_size_in_kb",
     ARGV_INT, (char *)1, (char *)&max_buffer_size_in_kb,
     "maximum size of internal buffers."},
+   {"-threads", ARGV_INT, (char *)1, (char *)&nthreads,
+    "Number of threads used to collect stats (default 1)."},
 
    {NULL, ARGV_HELP, (char *)NULL, (char *)NULL, "\nVoxel selection options:"},
    {"-floor", ARGV_FUNC, (char *)get_double_list, (char *)&vol_min,
@@ -302,6 +356,8 @@ static ArgvInfo argTable[] = {
     "Exclude voxels outside this range (list)"},
    {"-mask_binvalue", ARGV_FUNC, (char *)get_double_list, (char *)&mask_binvalue,
     "Include mask voxels within 0.5 of this value (list)"},
+   {"-label_stats", ARGV_CONSTANT, (char *)TRUE, (char *)&label_stats,
+    "Print a table of stats for each label in the mask file."},
    {"-ignore_nan", ARGV_CONSTANT, (char *)TRUE, (char *)&ignoreNaN,
     "Exclude NaN values from stats (default)."},
    {"-include_nan", ARGV_CONSTANT, (char *)FALSE, (char *)&ignoreNaN,
@@ -386,6 +442,12 @@ static ArgvInfo argTable[] = {
    {"-simple", ARGV_CONSTANT, (char *)BMT_SIMPLE, (char *)&BMTMethod,
     "Use simple mean-of-means algorithm for bimodal threshold"},
 
+   {NULL, ARGV_HELP, (char *)NULL, (char *)NULL, "\nExact Statistics:"},
+   {"-quantile", ARGV_FUNC, (char *)get_double_list, (char *)&quantiles,
+    "<%> exact quantile(s) of the data (list)."},
+   {"-exact", ARGV_CONSTANT, (char *)TRUE, (char *)&Exact,
+    "compute median and pctT exactly rather than from the histogram."},
+
    {NULL, ARGV_HELP, NULL, NULL, ""},
    {NULL, ARGV_END, NULL, NULL, NULL}
 };
@@ -747,12 +809,17 @@ int main(int argc, char *argv[])
    Loop_Options *loop_options;
    int      mincid, imgid;
    int      idim;
-   int      irange, imask;
+   int      irange, imask, iquant;
    double   real_range[2], valid_range[2];
    nc_type  datatype;
    int      is_signed;
    double   voxel_to_world[WORLD_NDIMS][WORLD_NDIMS + 1];
    Stats_Info *stats;
+   Stats_Table **thread_stats;
+   int      ithread;
+   int      maskid;
+   long     islot, jslot;
+   double   label_range[2];
    FILE    *FP;
    double   scale, voxmin, voxmax;
 
@@ -785,12 +852,26 @@ int main(int argc, char *argv[])
    verify_range_options(&vol_min, &vol_max, &vol_range, &vol_binvalue);
    num_ranges = vol_min.numvalues;
 
+   /* Labels take the place of mask ranges */
+   if(label_stats) {
+      if(mask_file == NULL) {
+         (void)fprintf(stderr, "%s: -label_stats needs a -mask file\n", argv[0]);
+         exit(EXIT_FAILURE);
+      }
+      if(mask_min.numvalues > 0 || mask_max.numvalues > 0 ||
+         mask_range.numvalues > 0 || mask_binvalue.numvalues > 0) {
+         (void)fprintf(stderr, "%s: Do not give mask ranges with -label_stats\n",
+                       argv[0]);
+         exit(EXIT_FAILURE);
+      }
+   }
+
    /* Check mask range options: not over-specified and put values 
       in mask_min/mask_max */
    verify_range_options(&mask_min, &mask_max, &mask_range, &mask_binvalue);
    num_masks = mask_min.numvalues;
 
-   if (mask_file != NULL && num_masks == 1 && 
+   if (mask_file != NULL && !label_stats && num_masks == 1 && 
        *mask_min.values == -DBL_MAX && *mask_max.values == DBL_MAX) {
        fprintf(stderr, 
                "%s: Warning: Mask specified without a range. Mask will be ignored.\n",
@@ -811,10 +892,20 @@ int main(int argc, char *argv[])
       pctT /= 100;
    }
 
+   /* Check the quantiles */
+   for(iquant = 0; iquant < quantiles.numvalues; iquant++) {
+      if(quantiles.values[iquant] < 0.0 || quantiles.values[iquant] > 100.0) {
+         (void)fprintf(stderr, "%s: Quantiles must be between 0 and 100%%\n",
+                       argv[0]);
+         exit(EXIT_FAILURE);
+      }
+   }
+
    /* if nothing selected, do everything */
    if(!Vol_Count && !Vol_Per && !Vol && !Min && !Max && !Sum && !Sum2 &&
       !Mean && !Variance && !Stddev && !Hist_Count && !Hist_Per &&
-      !Median && !Majority && !BiModalT && !PctT && !Entropy && !CoM) {
+      !Median && !Majority && !BiModalT && !PctT && !Entropy && !CoM &&
+      quantiles.numvalues == 0) {
       All = TRUE;
       Hist = TRUE;
    }
@@ -826,6 +917,10 @@ int main(int argc, char *argv[])
    if(hist_bins <= 0)
       Hist = FALSE;
 
+   /* Keep the values themselves if exact statistics are needed */
+   Keep_Values = (quantiles.numvalues > 0) || 
+      (Exact && (All || Median || PctT));
+
    /* do checking on arguments */
    if(hist_bins < 1) {
       (void)fprintf(stderr, "%s: Must have one or more bins for a histogram\n", argv[0]);
@@ -866,6 +961,21 @@ int main(int argc, char *argv[])
       discrete_histogram = FALSE;
    }
 
+   /* Each integer label in the range of the mask file takes the place
+      of a mask, but stats are only kept for the labels that occur */
+   if(label_stats) {
+      maskid = miopen(infiles[1], NC_NOWRITE);
+      (void)miget_image_range(maskid, label_range);
+      (void)miclose(maskid);
+      label_min = (long)rint(label_range[0]);
+      num_masks = (long)rint(label_range[1]) - label_min + 1;
+      if(num_masks < 1 || num_masks > MAX_LABELS) {
+         (void)fprintf(stderr, "%s: Too many labels in %s (%g to %g)\n",
+                       argv[0], infiles[1], label_range[0], label_range[1]);
+         exit(EXIT_FAILURE);
+      }
+   }
+
    /* set up the histogram definition, if needed */
    if(Hist) {
       if(hist_range[0] == -DBL_MAX) {
@@ -936,18 +1046,16 @@ int main(int argc, char *argv[])
 
    }
 
-   /* Initialize the stats structure */
-   stats_info = malloc(num_ranges * sizeof(*stats_info));
-   for(irange = 0; irange < num_ranges; irange++) {
-      stats_info[irange] = malloc(num_masks * sizeof(**stats_info));
-      for(imask = 0; imask < num_masks; imask++) {
-         stats = &stats_info[irange][imask];
-         init_stats(stats, hist_bins);
-         stats->vol_range[0] = vol_min.values[irange];
-         stats->vol_range[1] = vol_max.values[irange];
-         stats->mask_range[0] = mask_min.values[imask];
-         stats->mask_range[1] = mask_max.values[imask];
-      }
+   /* Initialize the stats structure, with a separate one for each
+      extra thread */
+   stats_table = new_stats_table();
+   if(nthreads < 1) {
+      nthreads = 1;
+   }
+   thread_stats = malloc(nthreads * sizeof(*thread_stats));
+   thread_stats[0] = stats_table;
+   for(ithread = 1; ithread < nthreads; ithread++) {
+      thread_stats[ithread] = new_stats_table();
    }
 
    /* Do math */
@@ -955,9 +1063,26 @@ int main(int argc, char *argv[])
    set_loop_first_input_mincid(loop_options, mincid);
    set_loop_verbose(loop_options, verbose);
    set_loop_buffer_size(loop_options, (long)1024 * max_buffer_size_in_kb);
-   voxel_loop(nfiles, infiles, 0, NULL, NULL, loop_options, do_math, NULL);
+   parallel_voxel_loop(nthreads, (void **)thread_stats, nfiles, infiles,
+                       0, NULL, NULL, loop_options, do_math, NULL);
    free_loop_options(loop_options);
 
+   /* Add in the stats from the other threads, matching up the labels
+      that each thread has seen */
+   for(ithread = 1; ithread < nthreads; ithread++) {
+      for(jslot = 0; jslot < thread_stats[ithread]->nslots; jslot++) {
+         islot = (label_stats) ?
+            get_label_slot(stats_table, thread_stats[ithread]->slot_label[jslot]) :
+            jslot;
+         for(irange = 0; irange < num_ranges; irange++) {
+            merge_stats(&stats_table->stats[irange][islot],
+                        &thread_stats[ithread]->stats[irange][jslot]);
+         }
+      }
+      free_stats_table(thread_stats[ithread]);
+   }
+   free(thread_stats);
+
    /* Open the histogram file if it will be needed */
    if(hist_file == NULL) {
       FP = NULL;
@@ -970,11 +1095,27 @@ int main(int argc, char *argv[])
       }
    }
 
+   /* Print the heading of the label table */
+   if(label_stats && !quiet) {
+      print_label_stats(NULL, 0);
+   }
+
    /* Loop over ranges and masks, calculating results */
    for(irange = 0; irange < num_ranges; irange++) {
       for(imask = 0; imask < num_masks; imask++) {
 
-         stats = &stats_info[irange][imask];
+         /* Labels are done in order, leaving out those that are not
+            in the mask */
+         if(label_stats) {
+            islot = stats_table->label_slot[imask];
+            if(islot < 0 || stats_table->stats[irange][islot].vvoxels <= 0) {
+               continue;
+            }
+         }
+         else {
+            islot = imask;
+         }
+         stats = &stats_table->stats[irange][islot];
 
          stats->vol_per = stats->vvoxels / nvoxels * 100;
          stats->hist_per = stats->hvoxels / nvoxels * 100;
@@ -993,6 +1134,15 @@ int main(int argc, char *argv[])
          }
          transform_coord(stats->world_com, voxel_to_world, stats->voxel_com);
 
+         /* Get exact quantiles from the sorted values */
+         if(stats->values != NULL) {
+            flush_value_list(stats->values);
+            for(iquant = 0; iquant < quantiles.numvalues; iquant++) {
+               stats->quantile[iquant] = 
+                  get_quantile(stats->values, quantiles.values[iquant] / 100.0);
+            }
+         }
+
          /* Do the histogram calculations */
          if(Hist) {
             int      c;
@@ -1085,6 +1235,12 @@ int main(int argc, char *argv[])
             }
             stats->pct_T += hist_centre[0]; /* Add histogram minimum */
 
+            /* Replace the histogram estimates with the exact values */
+            if(Exact && stats->values != NULL) {
+               stats->median = get_quantile(stats->values, 0.5);
+               stats->pct_T = get_quantile(stats->values, pctT);
+            }
+
             switch (BMTMethod) {
             case BMT_KITTLER:
                 stats->biModalT = kittler_threshold(stats->histogram,
@@ -1142,6 +1298,12 @@ int main(int argc, char *argv[])
 
          }                             /* end histogram calculations */
 
+         /* Labels get one line of the table */
+         if(label_stats) {
+            print_label_stats(stats, label_min + imask);
+            continue;
+         }
+
          /* Print range of data allowed */
          if(verbose || (num_ranges > 1 && !quiet)) {
             (void)fprintf(stdout, "Included Range:    %g   %g\n", stats->vol_range[0],
@@ -1219,6 +1381,13 @@ int main(int argc, char *argv[])
          if(All || CoM) {
             print_com(stats);
          }
+         for(iquant = 0; iquant < quantiles.numvalues; iquant++) {
+            char     label[100], str[100];
+
+            (void)sprintf(label, "Quantile [%g%%]:", quantiles.values[iquant]);
+            (void)sprintf(str, "%-19s", label);
+            print_result(str, stats->quantile[iquant]);
+         }
 
          if(Hist) {
             if(All && !quiet) {
@@ -1266,13 +1435,7 @@ int main(int argc, char *argv[])
    }
 
    /* Free things up */
-   for(irange = 0; irange < num_ranges; irange++) {
-      for(imask = 0; imask < num_masks; imask++) {
-         free_stats(&stats_info[irange][imask]);
-      }
-      free(stats_info[irange]);
-   }
-   free(stats_info);
+   free_stats_table(stats_table);
 
    return EXIT_SUCCESS;
 }
@@ -1284,25 +1447,51 @@ void do_math(void *caller_data, long num_voxels,
              double *output_data[], Loop_Info * loop_info)
 /* ARGSUSED */
 {
-   long     ivox;
+   long     ivox, offset, ilabel, imask;
    long     index[MAX_VAR_DIMS];
-   int      imask, irange;
+   int      irange;
    double   mask_min, mask_max;
    Stats_Info *stats;
+   Stats_Table *table;
+
+   /* Each thread has its own stats, and works on part of the buffer
+      starting at offset */
+   table = (Stats_Table *) caller_data;
+   offset = get_parallel_loop_offset();
+
+   /* For labels, send each voxel straight to the stats for its label */
+   if(label_stats) {
+      for(irange = 0; irange < num_ranges; irange++) {
+         for(ivox = 0; ivox < num_voxels * input_vector_length; ivox++) {
+            if(input_data[1][ivox] == -DBL_MAX) {
+               continue;
+            }
+            ilabel = (long)rint(input_data[1][ivox]) - label_min;
+            if(ilabel < 0 || ilabel >= num_masks) {
+               continue;
+            }
+            if(CoM || All) {
+               get_info_voxel_index(loop_info, offset + ivox, file_ndims, index);
+            }
+            do_stats(input_data[0][ivox], index,
+                     &table->stats[irange][get_label_slot(table, ilabel)]);
+         }
+      }
+   }
 
    /* Loop through the voxels - a bit of optimization in case we 
       have a brain-dead compiler */
-   if(mask_file != NULL) {
+   else if(mask_file != NULL) {
       for(irange = 0; irange < num_ranges; irange++) {
          for(imask = 0; imask < num_masks; imask++) {
-            stats = &stats_info[irange][imask];
+            stats = &table->stats[irange][imask];
             mask_min = stats->mask_range[0];
             mask_max = stats->mask_range[1];
             if(CoM || All) {
                for(ivox = 0; ivox < num_voxels * input_vector_length; ivox++) {
                   if((input_data[1][ivox] >= mask_min) &&
                      (input_data[1][ivox] <= mask_max)) {
-                     get_info_voxel_index(loop_info, ivox, file_ndims, index);
+                     get_info_voxel_index(loop_info, offset + ivox, file_ndims, index);
                      do_stats(input_data[0][ivox], index, stats);
                   }
                }
@@ -1321,10 +1510,10 @@ void do_math(void *caller_data, long num_voxels,
 
    else {
       for(irange = 0; irange < num_ranges; irange++) {
-         stats = &stats_info[irange][0];
+         stats = &table->stats[irange][0];
          if(CoM || All) {
             for(ivox = 0; ivox < num_voxels * input_vector_length; ivox++) {
-               get_info_voxel_index(loop_info, ivox, file_ndims, index);
+               get_info_voxel_index(loop_info, offset + ivox, file_ndims, index);
                do_stats(input_data[0][ivox], index, stats);
             }
          }
@@ -1365,6 +1554,11 @@ void do_stats(double value, long index[], Stats_Info * stats)
          stats->max = value;
       }
 
+      /* Keep the value for exact quantiles */
+      if(stats->values != NULL) {
+         add_value(stats->values, value);
+      }
+
       /* Get voxel index */
       if(CoM || All) {
          for(idim = 0; idim < WORLD_NDIMS; idim++) {
@@ -1396,6 +1590,67 @@ void print_result(char *title, double result)
    (void)fprintf(stdout, "%.10g\n", result);
 }
 
+/* Print one line of the label table, or the heading if stats is NULL.
+   The columns are the requested stats, in the usual order. */
+void print_label_stats(Stats_Info * stats, long label)
+{
+   int      iquant;
+   char     name[100];
+
+   if(stats == NULL) {
+      (void)fprintf(stdout, "# label");
+   }
+   else {
+      (void)fprintf(stdout, "%ld", label);
+   }
+#define LABEL_COLUMN(flag, name, field) \
+   if(flag) print_label_column(stats, name, (stats) ? stats->field : 0.0)
+
+   LABEL_COLUMN(num_ranges > 1, "floor", vol_range[0]);
+   LABEL_COLUMN(num_ranges > 1, "ceil", vol_range[1]);
+   LABEL_COLUMN(All || Vol_Count, "count", vvoxels);
+   LABEL_COLUMN(All || Vol_Per, "percent", vol_per);
+   LABEL_COLUMN(All || Vol, "volume", volume);
+   LABEL_COLUMN(All || Min, "min", min);
+   LABEL_COLUMN(All || Max, "max", max);
+   LABEL_COLUMN(All || Sum, "sum", sum);
+   LABEL_COLUMN(All || Sum2, "sum2", sum2);
+   LABEL_COLUMN(All || Mean, "mean", mean);
+   LABEL_COLUMN(All || Variance, "variance", variance);
+   LABEL_COLUMN(All || Stddev, "stddev", stddev);
+   LABEL_COLUMN(All || CoM, "com_x", world_com[0]);
+   LABEL_COLUMN(All || CoM, "com_y", world_com[1]);
+   LABEL_COLUMN(All || CoM, "com_z", world_com[2]);
+   for(iquant = 0; iquant < quantiles.numvalues; iquant++) {
+      (void)sprintf(name, "q%g", quantiles.values[iquant]);
+      LABEL_COLUMN(TRUE, name, quantile[iquant]);
+   }
+   if(Hist) {
+      LABEL_COLUMN(All || Hist_Count, "hist_count", hvoxels);
+      LABEL_COLUMN(All || Hist_Per, "hist_percent", hist_per);
+      LABEL_COLUMN(All || Median, "median", median);
+      LABEL_COLUMN(All || Majority, "majority", majority);
+      LABEL_COLUMN(All || BiModalT, "biModalT", biModalT);
+      LABEL_COLUMN(All || PctT, "pctT", pct_T);
+      LABEL_COLUMN(All || Entropy, "entropy", entropy);
+   }
+
+#undef LABEL_COLUMN
+   (void)fprintf(stdout, "\n");
+}
+
+/* Print a column of the label table - the name if stats is NULL, 
+   otherwise the value */
+void print_label_column(Stats_Info * stats, char *name, double value)
+{
+   if(stats == NULL) {
+      (void)fprintf(stdout, " %s", name);
+   }
+   else {
+      (void)fprintf(stdout, " %.10g", value);
+   }
+}
+
 /* Get the number of voxels in the file - this is the total number,
    not just spatial dimensions */
 long get_minc_nvoxels(int mincid)
@@ -1870,6 +2125,18 @@ void init_stats(Stats_Info * stats, int hist_bins)
    else {
       stats->histogram = NULL;
    }
+   if(Keep_Values) {
+      stats->values = new_value_list();
+      stats->quantile = calloc(quantiles.numvalues + 1, sizeof(double));
+      if(stats->quantile == NULL) {
+         (void)fprintf(stderr, "Memory allocation error\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   else {
+      stats->values = NULL;
+      stats->quantile = NULL;
+   }
    stats->hvoxels = 0.0;               /* number of voxels in histogram  */
    stats->vvoxels = 0.0;               /* number of valid voxels         */
    stats->volume = 0.0;
@@ -1903,4 +2170,346 @@ void free_stats(Stats_Info * stats)
 {
    if(stats->histogram != NULL)
       free(stats->histogram);
+   if(stats->values != NULL)
+      free_value_list(stats->values);
+   if(stats->quantile != NULL)
+      free(stats->quantile);
+}
+
+/* Allocate and initialize a table of Stats_Info structures, one for each
+   range and mask. With -label_stats the table starts out empty and
+   slots are added by get_label_slot */
+Stats_Table *new_stats_table(void)
+{
+   Stats_Table *table;
+   Stats_Info *stats;
+   int      irange;
+   long     imask;
+
+   table = malloc(sizeof(*table));
+   if(table != NULL) {
+      table->stats = calloc(num_ranges, sizeof(*table->stats));
+   }
+   if(table == NULL || table->stats == NULL) {
+      (void)fprintf(stderr, "Memory allocation error\n");
+      exit(EXIT_FAILURE);
+   }
+   table->label_slot = NULL;
+   table->slot_label = NULL;
+   if(label_stats) {
+      table->nslots = table->slots_alloc = 0;
+      table->label_slot = malloc(num_masks * sizeof(*table->label_slot));
+      if(table->label_slot == NULL) {
+         (void)fprintf(stderr, "Memory allocation error\n");
+         exit(EXIT_FAILURE);
+      }
+      for(imask = 0; imask < num_masks; imask++) {
+         table->label_slot[imask] = -1;
+      }
+      return table;
+   }
+
+   table->nslots = table->slots_alloc = num_masks;
+   for(irange = 0; irange < num_ranges; irange++) {
+      table->stats[irange] = malloc(num_masks * sizeof(**table->stats));
+      for(imask = 0; imask < num_masks; imask++) {
+         stats = &table->stats[irange][imask];
+         init_stats(stats, hist_bins);
+         stats->vol_range[0] = vol_min.values[irange];
+         stats->vol_range[1] = vol_max.values[irange];
+         stats->mask_range[0] = mask_min.values[imask];
+         stats->mask_range[1] = mask_max.values[imask];
+      }
+   }
+
+   return table;
+}
+
+/* Get the slot of a label (counted from label_min) in a table, adding
+   stats for it the first time that it is seen */
+long get_label_slot(Stats_Table * table, long ilabel)
+{
+   Stats_Info *stats;
+   int      irange;
+   long     islot;
+
+   islot = table->label_slot[ilabel];
+   if(islot >= 0) {
+      return islot;
+   }
+
+   /* Make room for another slot */
+   if(table->nslots >= table->slots_alloc) {
+      table->slots_alloc = (table->slots_alloc > 0) ? 2 * table->slots_alloc : 16;
+      for(irange = 0; irange < num_ranges; irange++) {
+         table->stats[irange] = realloc(table->stats[irange],
+                                        table->slots_alloc * sizeof(**table->stats));
+         if(table->stats[irange] == NULL) {
+            (void)fprintf(stderr, "Memory allocation error\n");
+            exit(EXIT_FAILURE);
+         }
+      }
+      table->slot_label = realloc(table->slot_label,
+                                  table->slots_alloc * sizeof(*table->slot_label));
+      if(table->slot_label == NULL) {
+         (void)fprintf(stderr, "Memory allocation error\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   islot = table->nslots++;
+   table->label_slot[ilabel] = islot;
+   table->slot_label[islot] = ilabel;
+   for(irange = 0; irange < num_ranges; irange++) {
+      stats = &table->stats[irange][islot];
+      init_stats(stats, hist_bins);
+      stats->vol_range[0] = vol_min.values[irange];
+      stats->vol_range[1] = vol_max.values[irange];
+      stats->mask_range[0] = label_min + ilabel - 0.5;
+      stats->mask_range[1] = label_min + ilabel + 0.5;
+   }
+
+   return islot;
+}
+
+/* Free a table of Stats_Info structures */
+void free_stats_table(Stats_Table * table)
+{
+   int      irange;
+   long     islot;
+
+   for(irange = 0; irange < num_ranges; irange++) {
+      for(islot = 0; islot < table->nslots; islot++) {
+         free_stats(&table->stats[irange][islot]);
+      }
+      free(table->stats[irange]);
+   }
+   free(table->stats);
+   free(table->label_slot);
+   free(table->slot_label);
+   free(table);
+}
+
+/* Add the sums collected in other into stats */
+void merge_stats(Stats_Info * stats, Stats_Info * other)
+{
+   int      idim, ibin;
+
+   stats->vvoxels += other->vvoxels;
+   stats->hvoxels += other->hvoxels;
+   stats->sum += other->sum;
+   stats->sum2 += other->sum2;
+   if(other->min < stats->min) {
+      stats->min = other->min;
+   }
+   if(other->max > stats->max) {
+      stats->max = other->max;
+   }
+   for(idim = 0; idim < WORLD_NDIMS; idim++) {
+      stats->voxel_com_sum[idim] += other->voxel_com_sum[idim];
+   }
+   if(stats->histogram != NULL && other->histogram != NULL) {
+      for(ibin = 0; ibin < hist_bins; ibin++) {
+         stats->histogram[ibin] += other->histogram[ibin];
+      }
+   }
+   if(stats->values != NULL && other->values != NULL) {
+      merge_value_lists(stats->values, other->values);
+   }
+}
+
+/* Allocate an empty list of values */
+Value_List *new_value_list(void)
+{
+   Value_List *list;
+
+   list = malloc(sizeof(*list));
+   if(list == NULL) {
+      (void)fprintf(stderr, "Memory allocation error\n");
+      exit(EXIT_FAILURE);
+   }
+   list->nbuffer = 0;
+   list->buffer_alloc = 0;
+   list->buffer = NULL;
+   list->nruns = 0;
+   list->run_value = NULL;
+   list->run_count = NULL;
+
+   return list;
+}
+
+/* Free a list of values */
+void free_value_list(Value_List * list)
+{
+   if(list->buffer != NULL)
+      free(list->buffer);
+   if(list->run_value != NULL)
+      free(list->run_value);
+   if(list->run_count != NULL)
+      free(list->run_count);
+   free(list);
+}
+
+/* Add a value to the buffer of a list. The buffer is sorted into the
+   list when it is full. It grows with the list, so that data with many
+   distinct values (e.g. float) are sorted in O(n log n) time, while
+   integer data stay in a short list of counts. */
+void add_value(Value_List * list, double value)
+{
+   if(list->nbuffer >= list->buffer_alloc) {
+      if(list->buffer_alloc >= VALUE_BUFFER_SIZE &&
+         list->buffer_alloc >= list->nruns) {
+         flush_value_list(list);
+      }
+      else {
+         list->buffer_alloc = 
+            (list->buffer_alloc < VALUE_BUFFER_SIZE) ? VALUE_BUFFER_SIZE :
+            2 * list->buffer_alloc;
+         list->buffer = realloc(list->buffer, 
+                                list->buffer_alloc * sizeof(*list->buffer));
+         if(list->buffer == NULL) {
+            (void)fprintf(stderr, "Memory allocation error\n");
+            exit(EXIT_FAILURE);
+         }
+      }
+   }
+   list->buffer[list->nbuffer++] = value;
+}
+
+/* Sort the buffered values of a list into its runs */
+void flush_value_list(Value_List * list)
+{
+   long     ivalue, nruns;
+   double  *run_count;
+
+   if(list->nbuffer <= 0)
+      return;
+
+   /* Sort the buffer and collapse it into runs of equal values in place,
+      with the counts in a separate array */
+   qsort(list->buffer, list->nbuffer, sizeof(*list->buffer), compare_doubles);
+   run_count = malloc(list->nbuffer * sizeof(*run_count));
+   if(run_count == NULL) {
+      (void)fprintf(stderr, "Memory allocation error\n");
+      exit(EXIT_FAILURE);
+   }
+   nruns = 0;
+   for(ivalue = 0; ivalue < list->nbuffer; ivalue++) {
+      if(nruns > 0 && list->buffer[ivalue] == list->buffer[nruns - 1]) {
+         run_count[nruns - 1]++;
+      }
+      else {
+         list->buffer[nruns] = list->buffer[ivalue];
+         run_count[nruns] = 1.0;
+         nruns++;
+      }
+   }
+   list->nbuffer = 0;
+
+   merge_value_runs(list, nruns, list->buffer, run_count);
+   free(run_count);
+}
+
+/* Merge sorted runs of values into the runs of a list */
+void merge_value_runs(Value_List * list, long nruns,
+                      double run_value[], double run_count[])
+{
+   long     i, j, n;
+   double  *new_value, *new_count;
+
+   if(nruns <= 0)
+      return;
+
+   new_value = malloc((list->nruns + nruns) * sizeof(*new_value));
+   new_count = malloc((list->nruns + nruns) * sizeof(*new_count));
+   if(new_value == NULL || new_count == NULL) {
+      (void)fprintf(stderr, "Memory allocation error\n");
+      exit(EXIT_FAILURE);
+   }
+
+   i = j = n = 0;
+   while(i < list->nruns || j < nruns) {
+      if(j >= nruns || (i < list->nruns && list->run_value[i] < run_value[j])) {
+         new_value[n] = list->run_value[i];
+         new_count[n] = list->run_count[i];
+         i++;
+      }
+      else if(i >= list->nruns || run_value[j] < list->run_value[i]) {
+         new_value[n] = run_value[j];
+         new_count[n] = run_count[j];
+         j++;
+      }
+      else {
+         new_value[n] = run_value[j];
+         new_count[n] = list->run_count[i] + run_count[j];
+         i++;
+         j++;
+      }
+      n++;
+   }
+
+   if(list->run_value != NULL)
+      free(list->run_value);
+   if(list->run_count != NULL)
+      free(list->run_count);
+   list->run_value = new_value;
+   list->run_count = new_count;
+   list->nruns = n;
+}
+
+/* Add the values collected in other into list */
+void merge_value_lists(Value_List * list, Value_List * other)
+{
+   flush_value_list(other);
+   merge_value_runs(list, other->nruns, other->run_value, other->run_count);
+}
+
+/* Get a quantile (0 to 1) from a flushed list of values, interpolating
+   linearly between the two nearest values */
+double get_quantile(Value_List * list, double fraction)
+{
+   long     irun, rank;
+   double   nvalues, position, cumulative;
+   double   lower, upper;
+
+   nvalues = 0.0;
+   for(irun = 0; irun < list->nruns; irun++) {
+      nvalues += list->run_count[irun];
+   }
+   if(nvalues <= 0.0) {
+      return 0.0;
+   }
+
+   /* Find the values with ranks on either side of the position */
+   position = fraction * (nvalues - 1.0);
+   rank = (long)floor(position);
+   lower = upper = list->run_value[list->nruns - 1];
+   cumulative = 0.0;
+   for(irun = 0; irun < list->nruns; irun++) {
+      cumulative += list->run_count[irun];
+      if(rank < cumulative) {
+         lower = list->run_value[irun];
+         if(rank + 1 < cumulative || irun + 1 >= list->nruns)
+            upper = lower;
+         else
+            upper = list->run_value[irun + 1];
+         break;
+      }
+   }
+
+   return lower + (position - rank) * (upper - lower);
+}
+
+/* Comparison function for sorting doubles with qsort */
+int compare_doubles(const void *a, const void *b)
+{
+   double   da = *(const double *)a;
+   double   db = *(const double *)b;
+
+   if(da < db)
+      return -1;
+   else if(da > db)
+      return 1;
+   else
+      return 0;
 }
@@ -93,6 +93,7 @@
 #include <ParseArgv.h>
 #include <time_stamp.h>
 #include <voxel_loop.h>
+#include <parallel_voxel_loop.h>
 
 #ifndef TRUE
 #  define TRUE 1
@@ -118,6 +119,7 @@ static void do_window(void *caller_data, long num_voxels,
 /* Argument variables */
 static int clobber = FALSE;
 static int verbose = TRUE;
+static int nthreads = 1;
 #if MINC2
 static int v2format = FALSE;
 #endif /* MINC2 */
@@ -136,6 +138,8 @@ static ArgvInfo argTable[] = {
        "Print out log messages (default)."},
    {"-quiet", ARGV_CONSTANT, (char *) FALSE, (char *) &verbose,
        "Do not print out log messages."},
+   {"-threads", ARGV_INT, (char *) 1, (char *) &nthreads,
+       "Number of threads used to process each buffer (default 1)."},
    {NULL, ARGV_END, NULL, NULL, NULL}
 };
 /* Main program */
@@ -193,8 +197,8 @@ int main(int argc, char *argv[])
 #if MINC2
    set_loop_v2format(loop_options, v2format);
 #endif /* MINC2 */
-   voxel_loop(1, &infile, 1, &outfile, arg_string, loop_options,
-              do_window, (void *) &window_data);
+   parallel_voxel_loop(nthreads, NULL, 1, &infile, 1, &outfile, 
+                       arg_string, loop_options, do_window, (void *) &window_data);
 
    exit(EXIT_SUCCESS);
 }